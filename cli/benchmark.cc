@@ -0,0 +1,523 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#  include <windows.h>
+#  include <psapi.h>
+#elif defined(__APPLE__)
+#  include <mach/mach.h>
+#else
+#  include <unistd.h>
+#endif
+
+#include <cxxopts.hpp>
+#include <nlohmann/json.hpp>
+
+#include <ctranslate2/generator.h>
+#include <ctranslate2/translator.h>
+#include <ctranslate2/utils.h>
+#include <ctranslate2/devices.h>
+#include <ctranslate2/models/language_model.h>
+#include <ctranslate2/models/sequence_to_sequence.h>
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsed_ms(const Clock::time_point& start, const Clock::time_point& end) {
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+template <typename T>
+static std::vector<T> parse_list(const std::string& value) {
+  std::vector<T> values;
+  std::istringstream stream(value);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (item.empty())
+      continue;
+    std::istringstream item_stream(item);
+    T parsed;
+    if (!(item_stream >> parsed))
+      throw std::invalid_argument("Invalid list value: " + value);
+    values.emplace_back(std::move(parsed));
+  }
+  if (values.empty())
+    throw std::invalid_argument("Empty list value: " + value);
+  return values;
+}
+
+// Returns the current resident set size of the process in bytes.
+static size_t get_current_rss() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof (counters)))
+    return 0;
+  return counters.WorkingSetSize;
+#elif defined(__APPLE__)
+  mach_task_basic_info_data_t info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(),
+                MACH_TASK_BASIC_INFO,
+                reinterpret_cast<task_info_t>(&info),
+                &count) != KERN_SUCCESS)
+    return 0;
+  return info.resident_size;
+#else
+  std::ifstream statm("/proc/self/statm");
+  size_t size = 0;
+  size_t resident = 0;
+  if (!(statm >> size >> resident))
+    return 0;
+  return resident * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+// Samples the resident set size in a background thread to measure the peak memory usage of
+// a single configuration. The process peak (ru_maxrss) cannot be used since it never
+// decreases and would include the configurations that ran before.
+class RssSampler {
+public:
+  RssSampler(const std::chrono::milliseconds interval = std::chrono::milliseconds(10))
+    : _initial_rss(get_current_rss())
+    , _peak_rss(_initial_rss)
+    , _thread([this, interval] {
+      std::unique_lock<std::mutex> lock(_mutex);
+      while (!_cv.wait_for(lock, interval, [this] { return _stop; }))
+        _peak_rss = std::max(_peak_rss, get_current_rss());
+    })
+  {
+  }
+
+  ~RssSampler() {
+    stop();
+  }
+
+  void stop() {
+    {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      if (_stop)
+        return;
+      _stop = true;
+      _peak_rss = std::max(_peak_rss, get_current_rss());
+    }
+    _cv.notify_one();
+    _thread.join();
+  }
+
+  size_t initial_rss() const {
+    return _initial_rss;
+  }
+
+  size_t peak_rss() const {
+    return _peak_rss;
+  }
+
+private:
+  const size_t _initial_rss;
+  size_t _peak_rss;
+  bool _stop = false;
+  std::mutex _mutex;
+  std::condition_variable _cv;
+  std::thread _thread;
+};
+
+static double percentile(std::vector<double> values, const double p) {
+  if (values.empty())
+    return 0;
+  std::sort(values.begin(), values.end());
+  const double rank = p / 100. * (values.size() - 1);
+  const size_t lower = static_cast<size_t>(rank);
+  const size_t upper = std::min(lower + 1, values.size() - 1);
+  return values[lower] + (rank - lower) * (values[upper] - values[lower]);
+}
+
+// Builds a batch of random tokens from the vocabulary, excluding the special tokens.
+static std::vector<std::vector<std::string>>
+make_random_batch(const ctranslate2::Vocabulary& vocabulary,
+                  const size_t batch_size,
+                  const size_t length,
+                  std::mt19937& generator) {
+  const size_t vocabulary_size = vocabulary.size();
+  std::uniform_int_distribution<size_t> distribution(0, vocabulary_size - 1);
+
+  std::vector<std::vector<std::string>> batch(batch_size);
+  for (auto& example : batch) {
+    example.reserve(length);
+    while (example.size() < length) {
+      const size_t id = distribution(generator);
+      if (vocabulary_size > 3
+          && (id == vocabulary.unk_id() || id == vocabulary.bos_id() || id == vocabulary.eos_id()))
+        continue;
+      example.emplace_back(vocabulary.to_token(id));
+    }
+  }
+  return batch;
+}
+
+struct Scenario {
+  size_t batch_size;
+  size_t beam_size;
+  size_t input_length;
+  size_t output_length;
+};
+
+struct BatchStats {
+  double latency_ms = 0;
+  double first_token_ms = 0;
+  size_t num_tokens = 0;
+};
+
+// Model-specific part of the benchmark: runs one batch synchronously and returns its stats.
+class BenchmarkRunner {
+public:
+  virtual ~BenchmarkRunner() = default;
+  virtual const ctranslate2::Vocabulary& input_vocabulary() const = 0;
+  virtual BatchStats run(const std::vector<std::vector<std::string>>& batch,
+                         const Scenario& scenario,
+                         const size_t output_length,
+                         const bool measure_first_token) = 0;
+};
+
+// Returns a callback recording the time of the first generated token in the batch.
+static std::function<bool(ctranslate2::GenerationStepResult)>
+make_first_token_callback(std::atomic<bool>& first_token, Clock::time_point& first_token_time) {
+  return [&first_token, &first_token_time](ctranslate2::GenerationStepResult) {
+    if (!first_token.exchange(true))
+      first_token_time = Clock::now();
+    return false;
+  };
+}
+
+class TranslatorRunner : public BenchmarkRunner {
+public:
+  TranslatorRunner(const std::vector<std::shared_ptr<const ctranslate2::models::Model>>& replicas,
+                   const ctranslate2::ReplicaPoolConfig& config)
+    : _pool(replicas, config)
+    , _model(dynamic_cast<const ctranslate2::models::SequenceToSequenceModel&>(*replicas[0]))
+  {
+  }
+
+  const ctranslate2::Vocabulary& input_vocabulary() const override {
+    return _model.get_source_vocabulary();
+  }
+
+  BatchStats run(const std::vector<std::vector<std::string>>& batch,
+                 const Scenario& scenario,
+                 const size_t output_length,
+                 const bool measure_first_token) override {
+    ctranslate2::TranslationOptions options;
+    options.beam_size = scenario.beam_size;
+    options.max_input_length = 0;
+    options.max_decoding_length = output_length;
+    options.min_decoding_length = output_length;
+
+    std::atomic<bool> first_token(false);
+    Clock::time_point first_token_time;
+    if (measure_first_token)
+      options.callback = make_first_token_callback(first_token, first_token_time);
+
+    const auto start = Clock::now();
+    const auto results = _pool.translate_batch(batch, options);
+    const auto end = Clock::now();
+
+    BatchStats stats;
+    stats.latency_ms = elapsed_ms(start, end);
+    stats.first_token_ms = first_token ? elapsed_ms(start, first_token_time) : stats.latency_ms;
+    for (const auto& result : results)
+      stats.num_tokens += result.output().size();
+    return stats;
+  }
+
+private:
+  ctranslate2::Translator _pool;
+  const ctranslate2::models::SequenceToSequenceModel& _model;
+};
+
+class GeneratorRunner : public BenchmarkRunner {
+public:
+  GeneratorRunner(const std::vector<std::shared_ptr<const ctranslate2::models::Model>>& replicas,
+                  const ctranslate2::ReplicaPoolConfig& config)
+    : _pool(replicas, config)
+    , _model(dynamic_cast<const ctranslate2::models::LanguageModel&>(*replicas[0]))
+  {
+  }
+
+  const ctranslate2::Vocabulary& input_vocabulary() const override {
+    return _model.get_vocabulary();
+  }
+
+  BatchStats run(const std::vector<std::vector<std::string>>& batch,
+                 const Scenario& scenario,
+                 const size_t output_length,
+                 const bool measure_first_token) override {
+    ctranslate2::GenerationOptions options;
+    options.beam_size = scenario.beam_size;
+    options.max_length = output_length;
+    options.min_length = output_length;
+    options.include_prompt_in_result = false;
+
+    std::atomic<bool> first_token(false);
+    Clock::time_point first_token_time;
+    if (measure_first_token)
+      options.callback = make_first_token_callback(first_token, first_token_time);
+
+    const auto start = Clock::now();
+    auto results = _pool.generate_batch_async(batch, options);
+    size_t num_tokens = 0;
+    for (auto& result : results)
+      num_tokens += result.get().sequences_ids[0].size();
+    const auto end = Clock::now();
+
+    BatchStats stats;
+    stats.latency_ms = elapsed_ms(start, end);
+    stats.first_token_ms = first_token ? elapsed_ms(start, first_token_time) : stats.latency_ms;
+    stats.num_tokens = num_tokens;
+    return stats;
+  }
+
+private:
+  ctranslate2::Generator _pool;
+  const ctranslate2::models::LanguageModel& _model;
+};
+
+static std::unique_ptr<BenchmarkRunner>
+create_runner(const std::vector<std::shared_ptr<const ctranslate2::models::Model>>& replicas,
+              const ctranslate2::ReplicaPoolConfig& config) {
+  const auto* model = replicas[0].get();
+  if (dynamic_cast<const ctranslate2::models::SequenceToSequenceModel*>(model))
+    return std::make_unique<TranslatorRunner>(replicas, config);
+  if (dynamic_cast<const ctranslate2::models::LanguageModel*>(model))
+    return std::make_unique<GeneratorRunner>(replicas, config);
+  throw std::invalid_argument("The benchmark only supports sequence-to-sequence models "
+                              "and language models");
+}
+
+// Runs one batch per replica at the same time so that all replicas are busy.
+static std::vector<BatchStats> run_concurrent_batches(BenchmarkRunner& runner,
+                                                      const std::vector<std::vector<std::vector<std::string>>>& batches,
+                                                      const Scenario& scenario,
+                                                      const size_t output_length,
+                                                      const bool measure_first_token) {
+  std::vector<BatchStats> stats(batches.size());
+  std::vector<std::thread> threads;
+  threads.reserve(batches.size());
+  for (size_t i = 0; i < batches.size(); ++i) {
+    threads.emplace_back([&, i]() {
+      stats[i] = runner.run(batches[i], scenario, output_length, measure_first_token);
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  return stats;
+}
+
+static nlohmann::json run_scenario(BenchmarkRunner& runner,
+                                   const Scenario& scenario,
+                                   const size_t num_concurrent_batches,
+                                   const size_t warmup_iterations,
+                                   const size_t iterations,
+                                   const unsigned int seed) {
+  std::mt19937 generator(seed);
+  std::vector<std::vector<std::vector<std::string>>> batches;
+  batches.reserve(num_concurrent_batches);
+  for (size_t i = 0; i < num_concurrent_batches; ++i)
+    batches.emplace_back(make_random_batch(runner.input_vocabulary(),
+                                           scenario.batch_size,
+                                           scenario.input_length,
+                                           generator));
+
+  RssSampler rss_sampler;
+
+  for (size_t i = 0; i < warmup_iterations; ++i)
+    run_concurrent_batches(runner, batches, scenario, scenario.output_length, false);
+
+  // The decoding callback is only supported in greedy search, so the time to first token
+  // is otherwise measured by a separate decoding that stops after one token.
+  const bool use_callback = scenario.beam_size == 1;
+
+  std::vector<double> latencies;
+  std::vector<double> first_token_latencies;
+  size_t num_tokens = 0;
+  double total_time_ms = 0;
+
+  for (size_t i = 0; i < iterations; ++i) {
+    const auto start = Clock::now();
+    const auto stats = run_concurrent_batches(runner,
+                                              batches,
+                                              scenario,
+                                              scenario.output_length,
+                                              use_callback);
+    total_time_ms += elapsed_ms(start, Clock::now());
+
+    for (const auto& batch_stats : stats) {
+      latencies.emplace_back(batch_stats.latency_ms);
+      num_tokens += batch_stats.num_tokens;
+      if (use_callback)
+        first_token_latencies.emplace_back(batch_stats.first_token_ms);
+    }
+
+    if (!use_callback) {
+      for (const auto& batch_stats : run_concurrent_batches(runner, batches, scenario, 1, false))
+        first_token_latencies.emplace_back(batch_stats.latency_ms);
+    }
+  }
+
+  rss_sampler.stop();
+
+  nlohmann::json result;
+  result["batch_size"] = scenario.batch_size;
+  result["beam_size"] = scenario.beam_size;
+  result["input_length"] = scenario.input_length;
+  result["output_length"] = scenario.output_length;
+  result["latency_p50_ms"] = percentile(latencies, 50);
+  result["latency_p99_ms"] = percentile(latencies, 99);
+  result["time_to_first_token_p50_ms"] = percentile(first_token_latencies, 50);
+  result["time_to_first_token_p99_ms"] = percentile(first_token_latencies, 99);
+  result["output_tokens"] = num_tokens;
+  result["tokens_per_second"] = total_time_ms > 0 ? num_tokens / (total_time_ms / 1000) : 0;
+  result["peak_rss_bytes"] = rss_sampler.peak_rss();
+  result["peak_rss_delta_bytes"] = rss_sampler.peak_rss() - rss_sampler.initial_rss();
+  return result;
+}
+
+int main(int argc, char* argv[]) {
+  cxxopts::Options cmd_options("ct2-benchmark", "CTranslate2 benchmark client");
+  cmd_options.custom_help("--model <directory> [OPTIONS]");
+
+  cmd_options.add_options("General")
+    ("h,help", "Display available options.")
+    ("seed", "Seed value of the random inputs.",
+     cxxopts::value<unsigned int>()->default_value("0"))
+    ("warmup", "Number of iterations to run before measuring.",
+     cxxopts::value<size_t>()->default_value("1"))
+    ("iterations", "Number of measured iterations for each configuration.",
+     cxxopts::value<size_t>()->default_value("10"))
+    ("out", "Path to the JSON report (write to the standard output if not set).",
+     cxxopts::value<std::string>())
+    ;
+
+  cmd_options.add_options("Device")
+    ("inter_threads", "Comma-separated list of numbers of replicas running in parallel.",
+     cxxopts::value<std::string>()->default_value("1"))
+    ("intra_threads", "Comma-separated list of numbers of computation threads per replica.",
+     cxxopts::value<std::string>()->default_value("0"))
+    ("device", "Device to use (can be cpu, cuda, auto).",
+     cxxopts::value<std::string>()->default_value("cpu"))
+    ("device_index", "Comma-separated list of device IDs to use.",
+     cxxopts::value<std::vector<int>>()->default_value("0"))
+    ;
+
+  cmd_options.add_options("Model")
+    ("model", "Path to the CTranslate2 model directory.", cxxopts::value<std::string>())
+    ("compute_type", "Comma-separated list of computation types.",
+     cxxopts::value<std::string>()->default_value("default"))
+    ;
+
+  cmd_options.add_options("Workload")
+    ("batch_size", "Comma-separated list of batch sizes.",
+     cxxopts::value<std::string>()->default_value("1"))
+    ("beam_size", "Comma-separated list of beam sizes.",
+     cxxopts::value<std::string>()->default_value("1"))
+    ("input_length", "Comma-separated list of input lengths.",
+     cxxopts::value<std::string>()->default_value("32"))
+    ("output_length", "Comma-separated list of output lengths.",
+     cxxopts::value<std::string>()->default_value("32"))
+    ;
+
+  auto args = cmd_options.parse(argc, argv);
+
+  if (args.count("help")) {
+    std::cerr << cmd_options.help() << std::endl;
+    return 0;
+  }
+  if (!args.count("model")) {
+    throw std::invalid_argument("Option --model is required to run the benchmark");
+  }
+
+  const auto model_path = args["model"].as<std::string>();
+  const auto device = ctranslate2::str_to_device(args["device"].as<std::string>());
+  const auto device_indices = args["device_index"].as<std::vector<int>>();
+  const auto seed = args["seed"].as<unsigned int>();
+  const auto warmup_iterations = args["warmup"].as<size_t>();
+  const auto iterations = args["iterations"].as<size_t>();
+
+  const auto inter_threads_list = parse_list<size_t>(args["inter_threads"].as<std::string>());
+  const auto intra_threads_list = parse_list<size_t>(args["intra_threads"].as<std::string>());
+  const auto compute_types = parse_list<std::string>(args["compute_type"].as<std::string>());
+
+  std::vector<Scenario> scenarios;
+  for (const auto batch_size : parse_list<size_t>(args["batch_size"].as<std::string>()))
+    for (const auto beam_size : parse_list<size_t>(args["beam_size"].as<std::string>()))
+      for (const auto input_length : parse_list<size_t>(args["input_length"].as<std::string>()))
+        for (const auto output_length : parse_list<size_t>(args["output_length"].as<std::string>()))
+          scenarios.push_back({batch_size, beam_size, input_length, output_length});
+
+  nlohmann::json report;
+  report["model"] = model_path;
+  report["device"] = ctranslate2::device_to_str(device);
+  report["warmup"] = warmup_iterations;
+  report["iterations"] = iterations;
+  report["results"] = nlohmann::json::array();
+
+  for (const auto& compute_type_str : compute_types) {
+    for (const auto inter_threads : inter_threads_list) {
+      for (const auto intra_threads : intra_threads_list) {
+        ctranslate2::models::ModelLoader model_loader(model_path);
+        model_loader.device = device;
+        model_loader.device_indices = device_indices;
+        model_loader.compute_type = ctranslate2::str_to_compute_type(compute_type_str);
+        model_loader.num_replicas_per_device = inter_threads;
+
+        ctranslate2::ReplicaPoolConfig pool_config;
+        pool_config.num_threads_per_replica = intra_threads;
+
+        // The same number of computation threads should be used for loading and running model.
+        ctranslate2::set_num_threads(intra_threads);
+
+        const auto load_start = Clock::now();
+        const auto replicas = model_loader.load();
+        const double load_time_ms = elapsed_ms(load_start, Clock::now());
+
+        auto runner = create_runner(replicas, pool_config);
+
+        for (const auto& scenario : scenarios) {
+          std::cerr << "Running compute_type=" << compute_type_str
+                    << " inter_threads=" << inter_threads
+                    << " intra_threads=" << intra_threads
+                    << " batch_size=" << scenario.batch_size
+                    << " beam_size=" << scenario.beam_size
+                    << " input_length=" << scenario.input_length
+                    << " output_length=" << scenario.output_length << std::endl;
+
+          auto result = run_scenario(*runner,
+                                     scenario,
+                                     replicas.size(),
+                                     warmup_iterations,
+                                     iterations,
+                                     seed);
+          result["compute_type"] = compute_type_str;
+          result["inter_threads"] = inter_threads;
+          result["intra_threads"] = intra_threads;
+          result["load_time_ms"] = load_time_ms;
+          report["results"].push_back(std::move(result));
+        }
+      }
+    }
+  }
+
+  if (args.count("out")) {
+    std::ofstream output(args["out"].as<std::string>());
+    output << report.dump(2) << std::endl;
+  } else {
+    std::cout << report.dump(2) << std::endl;
+  }
+
+  return 0;
+}
@@ -61,7 +61,7 @@ int main(int argc, char* argv[]) {
      cxxopts::value<size_t>()->default_value("0"))
     ("max_queued_batches", "Maximum number of batches to load in advance (set -1 for unlimited, 0 for an automatic value).",
      cxxopts::value<long>()->default_value("0"))
-    ("batch_type", "Batch type (can be examples, tokens).",
+    ("batch_type", "Batch type (can be examples, tokens, padded_tokens).",
      cxxopts::value<std::string>()->default_value("examples"))
     ("max_input_length", "Truncate inputs after this many tokens (set 0 to disable).",
      cxxopts::value<size_t>()->default_value("1024"))
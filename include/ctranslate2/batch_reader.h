@@ -12,6 +12,10 @@ namespace ctranslate2 {
   enum class BatchType {
     Examples,
     Tokens,
+    // Number of positions computed after padding: number of examples x beam size x length
+    // of the longest example. A batch is also split when more than 30% of its positions
+    // would be padding.
+    PaddedTokens,
   };
 
   BatchType str_to_batch_type(const std::string& batch_type);
@@ -54,9 +58,12 @@ namespace ctranslate2 {
   public:
     virtual ~BatchReader() = default;
 
+    // beam_size is the number of hypotheses decoded for each example, which is only used
+    // by BatchType::PaddedTokens.
     std::vector<Example>
     get_next(const size_t max_batch_size,
-             const BatchType batch_type = BatchType::Examples);
+             const BatchType batch_type = BatchType::Examples,
+             const size_t beam_size = 1);
 
     // Consumes and returns the next example.
     virtual Example get_next_example() = 0;
@@ -149,6 +156,7 @@ namespace ctranslate2 {
   std::vector<Batch>
   rebatch_input(const std::vector<Example>& examples,
                 size_t max_batch_size = 0,
-                BatchType batch_type = BatchType::Examples);
+                BatchType batch_type = BatchType::Examples,
+                size_t beam_size = 1);
 
 }
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "batch_reader.h"
+#include "decoding.h"
+#include "scheduling.h"
+
+namespace ctranslate2 {
+
+  // An example submitted for continuous batching.
+  template <typename Options, typename Result>
+  struct DecodingRequest {
+    Example example;
+    size_t index = 0;  // Index of the example in the submitted batch.
+    std::shared_ptr<const Options> options;  // Shared by all examples of the same batch.
+    std::promise<Result> promise;
+  };
+
+  // Queue of requests consumed by decoding loops. Each loop runs on a replica and pulls new
+  // requests from the queue at each decoding step until the queue is empty and the loop has
+  // nothing left to decode. The requests are ordered by decreasing priority, then by
+  // earliest deadline, then in submission order.
+  template <typename Request>
+  class RequestQueue {
+  public:
+    // Adds requests to the queue and returns the number of loops that should be started
+    // to process them, so that at most max_loops loops are running at the same time.
+    size_t push(std::vector<Request> requests, size_t max_loops) {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      for (auto& request : requests) {
+        const auto position = std::upper_bound(_requests.begin(),
+                                               _requests.end(),
+                                               request,
+                                               &runs_before);
+        _requests.emplace(position, std::move(request));
+      }
+
+      size_t num_new_loops = 0;
+      if (_num_loops < max_loops)
+        num_new_loops = std::min(max_loops - _num_loops, _requests.size());
+
+      _num_loops += num_new_loops;
+      return num_new_loops;
+    }
+
+    // Moves at most max_requests requests to the output vector. If the queue is empty and
+    // the loop is idle, the loop is unregistered and false is returned.
+    bool pop(size_t max_requests, bool idle, std::vector<Request>& requests) {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      if (_requests.empty() && idle) {
+        _num_loops--;
+        return false;
+      }
+
+      while (!_requests.empty() && requests.size() < max_requests) {
+        requests.emplace_back(std::move(_requests.front()));
+        _requests.pop_front();
+      }
+
+      return true;
+    }
+
+  private:
+    static bool runs_before(const Request& a, const Request& b) {
+      const auto& a_scheduling = a.options->scheduling;
+      const auto& b_scheduling = b.options->scheduling;
+      if (a_scheduling.priority != b_scheduling.priority)
+        return a_scheduling.priority > b_scheduling.priority;
+      return a_scheduling.deadline < b_scheduling.deadline;
+    }
+
+    std::mutex _mutex;
+    std::deque<Request> _requests;
+    size_t _num_loops = 0;
+  };
+
+  // Runs a continuous batching loop until the queue is empty:
+  //  - add(ContinuousDecoding&, size_t id, Request&) should add the request to the
+  //    decoding batch, or return false if the request promise was already satisfied;
+  //  - finalize(Request&, DecodingResult) should return the final result of the request.
+  template <typename Request, typename AddFunc, typename FinalizeFunc>
+  void run_continuous_batching(ContinuousDecoding& decoding,
+                               RequestQueue<Request>& queue,
+                               const size_t max_batch_size,
+                               const AddFunc& add,
+                               const FinalizeFunc& finalize) {
+    std::unordered_map<size_t, Request> running;
+    std::vector<Request> new_requests;
+    size_t next_id = 0;
+
+    while (queue.pop(max_batch_size - decoding.size(), decoding.empty(), new_requests)) {
+      for (auto& request : new_requests) {
+        const size_t id = next_id++;
+
+        try {
+          request.options->scheduling.check();
+          if (add(decoding, id, request))
+            running.emplace(id, std::move(request));
+        } catch (...) {
+          request.promise.set_exception(std::current_exception());
+        }
+      }
+
+      new_requests.clear();
+
+      // Remove the requests that were cancelled or reached their deadline.
+      std::vector<size_t> stopped_ids;
+      for (auto& [id, request] : running) {
+        try {
+          request.options->scheduling.check();
+        } catch (...) {
+          request.promise.set_exception(std::current_exception());
+          stopped_ids.emplace_back(id);
+        }
+      }
+
+      if (!stopped_ids.empty()) {
+        decoding.remove(stopped_ids);
+        for (const size_t id : stopped_ids)
+          running.erase(id);
+      }
+
+      std::vector<std::pair<size_t, DecodingResult>> results;
+
+      try {
+        results = decoding.step();
+      } catch (...) {
+        // The batch state is no longer valid: fail all running requests.
+        const auto exception = std::current_exception();
+        for (const size_t id : decoding.clear()) {
+          auto it = running.find(id);
+          it->second.promise.set_exception(exception);
+          running.erase(it);
+        }
+      }
+
+      for (auto& [id, result] : results) {
+        auto it = running.find(id);
+        auto& request = it->second;
+
+        try {
+          request.promise.set_value(finalize(request, std::move(result)));
+        } catch (...) {
+          request.promise.set_exception(std::current_exception());
+        }
+
+        running.erase(it);
+      }
+    }
+  }
+
+  // Processes the queued requests in static batches instead. This is used when the model
+  // does not support continuous batching. run_batch(const std::vector<Request*>&) should
+  // return one result per request.
+  template <typename Request, typename Func>
+  void run_static_batching(RequestQueue<Request>& queue,
+                           const size_t max_batch_size,
+                           const Func& run_batch) {
+    std::vector<Request> requests;
+
+    while (queue.pop(max_batch_size, /*idle=*/true, requests)) {
+      // Only requests sharing the same options can be in the same batch.
+      for (size_t begin = 0; begin < requests.size();) {
+        std::vector<Request*> batch;
+        size_t end = begin;
+        for (; end < requests.size() && requests[end].options == requests[begin].options; ++end)
+          batch.emplace_back(&requests[end]);
+
+        try {
+          SchedulingOptions scheduling = batch.front()->options->scheduling;
+          for (const auto* request : batch)
+            scheduling.merge(request->options->scheduling);
+          scheduling.check();
+          const SchedulingScope scheduling_scope(scheduling);
+          auto results = run_batch(batch);
+          for (size_t i = 0; i < batch.size(); ++i)
+            batch[i]->promise.set_value(std::move(results[i]));
+        } catch (...) {
+          for (auto* request : batch)
+            request->promise.set_exception(std::current_exception());
+        }
+
+        begin = end;
+      }
+
+      requests.clear();
+    }
+  }
+
+}
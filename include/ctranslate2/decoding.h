@@ -1,6 +1,7 @@
 #pragma once
 
 #include <functional>
+#include <memory>
 #include <optional>
 
 #include "ctranslate2/decoding_utils.h"
@@ -53,11 +54,14 @@ namespace ctranslate2 {
 
   class BeamSearch : public SearchStrategy {
   public:
+    // The callback is called with the tokens that are common to all hypotheses of a batch,
+    // which will be included in the best hypothesis whatever the next steps.
     BeamSearch(const dim_t beam_size,
                const float length_penalty = 0,
                const float coverage_penalty = 0,
                const float prefix_bias_beta = 0,
-               const float patience = 1);
+               const float patience = 1,
+               std::function<bool(DecodingStepResult)> callback = nullptr);
 
     std::vector<DecodingResult>
     search(layers::Decoder& decoder,
@@ -83,6 +87,7 @@ namespace ctranslate2 {
     const float _coverage_penalty;
     const float _prefix_bias_beta;
     const size_t _max_candidates;
+    const std::function<bool(DecodingStepResult)> _callback;
   };
 
   class BiasedDecoder {
@@ -163,6 +168,15 @@ namespace ctranslate2 {
     std::vector<std::vector<size_t>> disable_sequences;
     std::vector<std::shared_ptr<LogitsProcessor>> logits_processors;
     std::function<bool(DecodingStepResult)> callback = nullptr;
+
+    // Speculative decoding: the draft decoder proposes num_draft_tokens tokens with greedy
+    // search and the decoder verifies them in a single forward pass. The result is the same
+    // as greedy search without a draft decoder. The draft decoder should use the same
+    // vocabulary as the decoder. If draft_state is not set, the initial state of the draft
+    // decoder is used.
+    layers::Decoder* draft_decoder = nullptr;
+    layers::DecoderState* draft_state = nullptr;
+    size_t num_draft_tokens = 4;
   };
 
   std::vector<DecodingResult>
@@ -172,4 +186,52 @@ namespace ctranslate2 {
          std::vector<size_t> end_ids,
          DecodingOptions options = DecodingOptions());
 
+
+  // Decodes independent requests in a batch that is updated at each step (continuous
+  // batching): requests can be added between two steps and are removed from the batch as
+  // soon as they are finished, so short requests do not wait for the longest sequence and
+  // new requests can use the freed slots.
+  //
+  // Only greedy search and random sampling with a single hypothesis are supported. The
+  // decoder must support it, see layers::Decoder::support_continuous_batching.
+  class ContinuousDecoding {
+  public:
+    ContinuousDecoding(layers::Decoder& decoder);
+    ~ContinuousDecoding();
+
+    // Adds a request identified by id. state is the initial decoder state of this request
+    // (batch size 1). All start tokens except the last one are forwarded in a single step
+    // and the first token is generated before the request joins the batch.
+    void add(size_t id,
+             layers::DecoderState state,
+             std::vector<size_t> start_tokens,
+             std::vector<size_t> end_ids,
+             DecodingOptions options);
+
+    // Generates the next token of all requests in the batch and returns the results of the
+    // finished requests.
+    std::vector<std::pair<size_t, DecodingResult>> step();
+
+    // Removes some requests from the batch, e.g. when they are cancelled.
+    void remove(const std::vector<size_t>& ids);
+
+    // Removes all requests from the batch and returns their id.
+    std::vector<size_t> clear();
+
+    // Number of requests in the batch.
+    size_t size() const;
+
+    bool empty() const {
+      return size() == 0;
+    }
+
+  private:
+    struct Sequence;
+
+    layers::Decoder& _decoder;
+    layers::DecoderState _state;
+    std::vector<Sequence> _sequences;
+    std::vector<std::pair<size_t, DecodingResult>> _finished;
+  };
+
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <fstream>
+#include <memory>
 #include <string>
 
 namespace ctranslate2 {
@@ -13,4 +14,22 @@ namespace ctranslate2 {
                                 std::ios_base::openmode mode = std::ios_base::out,
                                 bool check = true);
 
+  // File mapped in memory with copy-on-write semantics: changes to the data are not
+  // written back to the file, and pages that are never written are shared with other
+  // processes mapping the same file.
+  class MappedFile {
+  public:
+    virtual ~MappedFile() = default;
+
+    virtual char* data() const = 0;
+    virtual size_t size() const = 0;
+  };
+
+  // Maps a file in memory, or returns nullptr if the file can't be mapped.
+  std::shared_ptr<MappedFile> map_file_read(const std::string& path);
+
+  // Returns a string identifying a file version without reading it: its canonical path,
+  // size, and last modification time. Returns an empty string if the file can't be found.
+  std::string get_file_signature(const std::string& path);
+
 }
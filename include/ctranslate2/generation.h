@@ -5,6 +5,7 @@
 #include <string>
 
 #include "decoding.h"
+#include "scheduling.h"
 #include "vocabulary.h"
 
 namespace ctranslate2 {
@@ -69,12 +70,20 @@ namespace ctranslate2 {
     // the same static prompt.
     bool cache_static_prompt = true;
 
+    // Also cache the model state after the prompt tokens that are forwarded at once (see
+    // include_prompt_in_result), so that future runs can reuse the longest common prefix.
+    bool cache_prompt = false;
+
     // Include the input tokens in the generation result.
     bool include_prompt_in_result = true;
 
-    // Function to call for each generated token in greedy search.
+    // Function to call for each generated token. In beam search, it is called when the tokens
+    // are common to all beams.
     // Returns true indicate the current generation is considered finished thus can be stopped early.
     std::function<bool(GenerationStepResult)> callback = nullptr;
+
+    // Priority, deadline and cancellation of the request.
+    SchedulingOptions scheduling;
   };
 
   struct GenerationResult {
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "generation.h"
+
+namespace ctranslate2 {
+
+  // Error returned by a stream when the consumer did not read the results fast enough.
+  class GenerationStreamOverflow : public std::runtime_error {
+  public:
+    using std::runtime_error::runtime_error;
+  };
+
+  // Stream of step results produced by a decoding and read from another thread.
+  //
+  // The results are passed in a bounded lock-free queue with a single producer (the replica
+  // running the decoding) and a single consumer. The producer never waits for the consumer,
+  // since the replica can be shared with other requests: when the queue is full, the
+  // decoding is stopped and the consumer gets a GenerationStreamOverflow error after reading
+  // the queued results.
+  class GenerationStream {
+  public:
+    // The capacity is rounded up to the next power of 2.
+    GenerationStream(size_t capacity = 256);
+
+    // Returns the pointer owned by the consumer. The stream is closed when the consumer
+    // releases it, so that the decoding stops when nobody reads the results.
+    static std::shared_ptr<GenerationStream>
+    make_consumer_handle(const std::shared_ptr<GenerationStream>& stream);
+
+    // Consumer side.
+
+    // Waits for the next step result. Returns false when the decoding is finished, or
+    // rethrows the decoding error if any (GenerationStreamOverflow if the queue was full).
+    bool next(GenerationStepResult& step_result);
+
+    // Same as next, but returns false immediately if no step result is available.
+    // Use finished() to check if the decoding is finished.
+    bool try_next(GenerationStepResult& step_result);
+
+    // Stops the decoding at the next step. The results that are already queued can still
+    // be read.
+    void close();
+    bool closed() const {
+      return _closed.load(std::memory_order_relaxed);
+    }
+
+    // Returns true when all step results were read and the decoding is finished.
+    bool finished() const;
+
+    // Producer side.
+
+    // Adds a step result to the stream and returns true if the decoding should stop. The
+    // result is dropped if the stream is closed or if the queue is full.
+    bool push(GenerationStepResult step_result);
+
+    // Marks the end of the stream, with an optional decoding error.
+    void finish(std::exception_ptr exception = nullptr);
+
+  private:
+    std::vector<GenerationStepResult> _buffer;
+    const size_t _mask;
+
+    // Index of the next result to read, updated by the consumer.
+    std::atomic<size_t> _head{0};
+    // Index of the next result to write, updated by the producer.
+    std::atomic<size_t> _tail{0};
+
+    std::atomic<bool> _finished{false};
+    std::atomic<bool> _closed{false};
+    std::exception_ptr _exception;
+    // Only accessed by the producer.
+    bool _overflowed = false;
+
+    std::mutex _wait_mutex;
+    std::condition_variable _can_read;
+    std::atomic<bool> _consumer_waiting{false};
+
+    bool try_push(GenerationStepResult& step_result);
+    bool try_pop(GenerationStepResult& step_result);
+    bool readable() const;
+    void notify_consumer();
+  };
+
+  // Producer side of a stream, shared by the function posted to the replicas. The stream is
+  // finished when the decoding returns, or when the producer is destroyed without running
+  // the decoding (e.g. the request was cancelled while it was queued).
+  class GenerationStreamProducer {
+  public:
+    GenerationStreamProducer(std::shared_ptr<GenerationStream> stream);
+    ~GenerationStreamProducer();
+
+    // Returns a callback adding the step results to the stream after calling the user
+    // callback, if any.
+    std::function<bool(GenerationStepResult)>
+    make_callback(std::function<bool(GenerationStepResult)> callback) const;
+
+    template <typename Func>
+    auto run(const Func& func) {
+      try {
+        auto results = func();
+        finish(nullptr);
+        return results;
+      } catch (...) {
+        finish(std::current_exception());
+        throw;
+      }
+    }
+
+  private:
+    const std::shared_ptr<GenerationStream> _stream;
+    bool _finished = false;
+
+    void finish(std::exception_ptr exception);
+  };
+
+}
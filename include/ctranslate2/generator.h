@@ -1,5 +1,6 @@
 #pragma once
 
+#include "generation_stream.h"
 #include "replica_pool.h"
 #include "models/language_model.h"
 
@@ -17,6 +18,14 @@ namespace ctranslate2 {
                          const size_t max_batch_size = 0,
                          const BatchType batch_type = BatchType::Examples);
 
+    // Generates from a single prompt and returns a stream of the generated tokens. With beam
+    // search, the tokens are returned when they are common to all beams. The decoding is
+    // stopped if more than stream_capacity step results are waiting to be read.
+    std::shared_ptr<GenerationStream>
+    generate_tokens(const std::vector<std::string>& start_tokens,
+                    GenerationOptions options = GenerationOptions(),
+                    const size_t stream_capacity = 256);
+
     std::vector<std::future<ScoringResult>>
     score_batch_async(const std::vector<std::vector<std::string>>& tokens,
                       const ScoringOptions& options = ScoringOptions(),
@@ -35,6 +44,10 @@ namespace ctranslate2 {
     forward_batch_async(StorageView ids,
                         StorageView lengths,
                         const bool return_log_probs);
+
+  private:
+    const std::shared_ptr<RequestQueue<models::GenerationRequest>> _generation_requests
+      = std::make_shared<RequestQueue<models::GenerationRequest>>();
   };
 
 }
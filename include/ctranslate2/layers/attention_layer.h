@@ -11,6 +11,7 @@ namespace ctranslate2 {
 
     class RotaryEmbeddings;
     class Alibi;
+    class PagedKVCache;
 
     class AttentionLayer : public Layer
     {
@@ -37,14 +38,26 @@ namespace ctranslate2 {
                       const Padder* values_padder = nullptr,
                       bool return_normalized_attention = true,
                       StorageView* position_bias = nullptr,
-                      dim_t offset = 0) const = 0;
+                      dim_t offset = 0,
+                      const PagedKVCache* paged_cache = nullptr,
+                      StorageView* cached_keys_scale = nullptr,
+                      StorageView* cached_values_scale = nullptr) const = 0;
 
       virtual bool has_positional_embeddings() const = 0;
 
+      // Returns true if the cached keys and values can be stored in a PagedKVCache.
+      virtual bool support_paged_cache() const {
+        return false;
+      }
+
       bool multi_query() const {
         return _multi_query;
       }
 
+      dim_t num_heads_kv() const {
+        return _num_heads_kv;
+      }
+
       static StorageView prepare_length_mask(const StorageView& lengths,
                                              const dim_t num_heads,
                                              const dim_t num_queries,
@@ -94,6 +107,8 @@ namespace ctranslate2 {
                        const bool transpose = true);
 
       void apply(StorageView& x, const dim_t offset = 0, bool fa2 = false);
+      // Applies the embeddings starting at a different offset for each batch.
+      void apply(StorageView& x, const std::vector<dim_t>& offsets);
 
       StorageView& get_cos_half() {
         return *_cos_half;
@@ -141,6 +156,13 @@ namespace ctranslate2 {
 
       void apply(StorageView& x, const float scale = 1);
 
+      // Returns the bias table with shape [1, num_heads, 1, length] where length >= key_length.
+      const StorageView& get(const dim_t num_heads,
+                             const dim_t key_length,
+                             const Device device,
+                             const DataType dtype,
+                             const float scale = 1);
+
     private:
       const bool _use_positive_positions;
       const dim_t _num_initial_positions;
@@ -149,5 +171,70 @@ namespace ctranslate2 {
 
       StorageView _alibi;
     };
+
+    // Paged cache for the keys and values of the decoder self-attention.
+    //
+    // The keys (or values) of each layer are stored in fixed-size pages with shape
+    // [num_pages, num_heads_kv, page_size, head_dim], and each sequence has a table of page
+    // indices. Appending time steps only writes into the pages and reordering the batch
+    // (e.g. in beam search) only reorders the page tables. The pages are shared by all
+    // sequences, and a page that is referenced by multiple sequences is copied before
+    // it is written.
+    //
+    // An instance prepares the pages for a single decoding step and is shared by all layers.
+    class PagedKVCache {
+    public:
+      // Returns the page size configured with CT2_KV_CACHE_PAGE_SIZE, or 0 if disabled.
+      static dim_t default_page_size();
+
+      // Updates the page table [batch_size, max_pages] and the cache lengths [batch_size]
+      // to reserve num_steps new time steps per sequence. num_pages is the number of pages
+      // currently allocated in each layer. The sequences can have different cache lengths,
+      // in which case the new time steps are written at a different position in each sequence.
+      PagedKVCache(StorageView& page_table,
+                   StorageView& lengths,
+                   dim_t num_pages,
+                   dim_t batch_size,
+                   dim_t num_steps,
+                   dim_t page_size);
+
+      // Writes the new keys or values x in the layer pages. x has the shape
+      // [batch_size, num_heads_kv, num_steps, head_dim] or [batch_size, num_steps, head_dim].
+      void append(const StorageView& x, StorageView& pages) const;
+
+      const StorageView& page_table() const {
+        return _page_table;
+      }
+
+      // Maximum number of cached time steps, including the new ones.
+      dim_t length() const {
+        return _length;
+      }
+
+      // Returns true if the cache was empty before the new time steps.
+      bool was_empty() const {
+        return _length == _num_steps;
+      }
+
+      // Position of the first new time step in each sequence.
+      const std::vector<dim_t>& offsets() const {
+        return _offsets;
+      }
+
+      // Returns true if all sequences have the same cache length.
+      bool aligned() const {
+        return _aligned;
+      }
+
+    private:
+      const StorageView& _page_table;
+      const dim_t _page_size;
+      const dim_t _num_steps;
+      std::vector<dim_t> _offsets;
+      bool _aligned;
+      dim_t _length;
+      dim_t _num_pages;
+      std::vector<std::pair<int32_t, int32_t>> _copies;
+    };
   }
 }
@@ -91,8 +91,12 @@ namespace ctranslate2 {
     public:
       void operator()(StorageView& input, dim_t index = 0);
       void operator()(const StorageView& input, StorageView& output, dim_t index = 0);
+      // Adds the position encodings starting at a different index for each batch.
+      void operator()(StorageView& input, const std::vector<dim_t>& indices);
     protected:
       virtual const StorageView& get_position_encoding(dim_t max_time) = 0;
+    private:
+      const StorageView& get_checked_position_encoding(dim_t max_time, dim_t depth);
     };
 
     // Concrete position encoder loading encoding vectors from the model.
@@ -122,6 +126,8 @@ namespace ctranslate2 {
       StorageView _encoding;
     };
 
+    class LayerNorm;
+
     class Dense : public Layer
     {
     public:
@@ -132,8 +138,24 @@ namespace ctranslate2 {
       DataType output_type() const override;
       dim_t output_size() const override;
       void operator()(const StorageView& input, StorageView& output) const;
+      // Applies the layer on input_norm(input + residual), where the sum is returned in
+      // residual_output when a residual is set. With int8 weights on CPU, the residual
+      // addition and the normalization are fused with the quantization of the input.
+      void operator()(const StorageView& input,
+                      const LayerNorm& input_norm,
+                      StorageView& output,
+                      const StorageView* residual = nullptr,
+                      StorageView* residual_output = nullptr) const;
+      // Restricts the output to the weight rows in index. On CPU, float32 and int8 weights
+      // are not copied and the selected rows are read in place with ops::IndexedGemm.
       void select_weights(const StorageView* index, const StorageView* extra_bias = nullptr);
     private:
+      void gemm(const StorageView& input,
+                const StorageView& weight,
+                StorageView& output,
+                const StorageView* compensation,
+                const StorageView* bias = nullptr) const;
+
       bool _packed_weight;
       bool _is_low_rank;
       const StorageView& _weight;
@@ -145,11 +167,15 @@ namespace ctranslate2 {
       StorageView _partial_weight;
       StorageView _partial_bias;
       StorageView _partial_qscale;
+      StorageView _partial_qzero;
       StorageView _partial_u8_shift_compensation;
+      StorageView _partial_index;
       const DataType _output_type;
       const models::QUANTIZATION_TYPE _quant_method;
       const bool _quantized_gemm;
+      const bool _use_indexed_gemm;
       const ops::Gemm _gemm_op;
+      const ops::IndexedGemm _indexed_gemm_op;
       const ops::Quantize _quantize_op;
       const ops::Dequantize _dequantize_op;
       const ops::ActivationType* _activation_type;
@@ -163,6 +189,14 @@ namespace ctranslate2 {
       DataType output_type() const override;
       dim_t output_size() const override;
       void operator()(const StorageView& input, StorageView& output) const;
+      // Quantizes the normalized input + residual to int8, see ops::NormQuantize.
+      void quantize(const StorageView& input,
+                    StorageView& output,
+                    StorageView& scale,
+                    bool shift_to_uint8,
+                    bool round_before_cast,
+                    const StorageView* residual = nullptr,
+                    StorageView* residual_output = nullptr) const;
     private:
       const StorageView* _beta;
       const StorageView& _gamma;
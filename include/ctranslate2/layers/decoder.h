@@ -1,7 +1,9 @@
 #pragma once
 
-#include <map>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
 
@@ -45,12 +47,60 @@ namespace ctranslate2 {
                         const dim_t beam_size,
                         const StorageView* alive_batches = nullptr) const;
 
-      // Replicate the decoder state beam_size times.
-      void replicate_state(DecoderState& state, const dim_t beam_size) const;
+      // Replicate the decoder state beam_size times. The states that are not replicated
+      // (e.g. the encoder memory) are shared by the beams of each batch, which are expected to
+      // be updated together. If the replicas can be removed independently of each other (e.g.
+      // multiple hypotheses in greedy search), set independent_replicas so that the shared
+      // states are accessed through the index returned by source_index().
+      void replicate_state(DecoderState& state,
+                           const dim_t beam_size,
+                           const bool independent_replicas = false) const;
 
       // Returns true if the state must be replicated beam_size times.
       virtual bool replicate_state(const std::string& name) const;
 
+      // Adds a state mapping each batch to its row in the states that are not replicated.
+      // Until then, the batches of a row are assumed to be consecutive and of the same number.
+      // This does nothing if all states are replicated or if the index already exists.
+      void add_source_index(DecoderState& state) const;
+
+      // Returns the index added by add_source_index, or nullptr if there is none.
+      static const StorageView* source_index(const DecoderState& state);
+
+      // Returns true if the state is not indexed by batch and must be kept as is when the
+      // batch is updated or replicated (e.g. the pages of a paged cache).
+      virtual bool shared_state(const std::string& name) const;
+
+      // Returns true if the decoder can run batches where each sequence is at a different
+      // decoding step, as required by continuous batching. The states can then be merged with
+      // append_state. This mode is configured when the model is loaded, see
+      // models::ModelLoader::continuous_batching.
+      virtual bool support_continuous_batching() const;
+
+      // Appends the batches of the state other to state. By default, the states are
+      // concatenated on the batch dimension.
+      virtual void append_state(DecoderState& state, DecoderState other) const;
+
+      // Removes the cached steps after length from the state, e.g. to reject tokens that
+      // were forwarded speculatively. Throws if the state cannot be truncated.
+      virtual void truncate_state(DecoderState& state, dim_t length) const;
+
+      // Returns true if the first length cached steps can be exported with get_cached_steps
+      // and imported with set_cached_steps, e.g. to reuse the steps of a prompt prefix.
+      virtual bool support_prefix_cache(dim_t length) const;
+
+      // Returns the cached time steps [begin, end) of a batch. Each entry of the returned
+      // state has the time dimension first and no batch dimension.
+      virtual DecoderState get_cached_steps(const DecoderState& state,
+                                            dim_t batch_id,
+                                            dim_t begin,
+                                            dim_t end) const;
+
+      // Sets the cache of an initial state from the steps returned by get_cached_steps.
+      // steps contains one state per batch and all states must have the same number of steps.
+      virtual void set_cached_steps(DecoderState& state,
+                                    const std::vector<DecoderState>& steps) const;
+
       // Restrict the output layer to a set of ids and/or resize it to a preferred size multiple.
       // Elements in restrict_ids must be unique and sorted.
       void update_output_layer(const dim_t size_multiple = 1,
@@ -61,11 +111,16 @@ namespace ctranslate2 {
       }
 
       bool is_in_output(size_t word_id) const {
-        return _to_output_word_id.find(word_id) != _to_output_word_id.end();
+        return word_id < _to_output_word_id.size() && _to_output_word_id[word_id] >= 0;
       }
 
       size_t to_output_word_id(size_t original_id) const {
-        return _to_output_word_id.empty() ? original_id : _to_output_word_id.at(original_id);
+        if (_to_output_word_id.empty())
+          return original_id;
+        if (!is_in_output(original_id))
+          throw std::out_of_range("Word id " + std::to_string(original_id)
+                                  + " is not in the output layer");
+        return _to_output_word_id[original_id];
       }
 
       size_t to_original_word_id(size_t output_id) const {
@@ -93,19 +148,59 @@ namespace ctranslate2 {
       const Device _device;
 
     private:
+      // Removes the rows of the states that are not replicated which are no longer
+      // referenced by the source index.
+      void remove_unused_source_rows(DecoderState& state) const;
+
       std::vector<size_t> _to_original_word_id;
-      std::unordered_map<size_t, size_t> _to_output_word_id;
+      // Output id of each vocabulary id, or -1 if the id is not in the output layer.
+      std::vector<int32_t> _to_output_word_id;
       dim_t _vocabulary_size = 0;
     };
 
 
-    class DecoderStateCache {
+    // Cache of the decoder steps computed for prompt prefixes. The prompts are stored in a
+    // radix tree where each node holds the steps of its tokens (as returned by
+    // Decoder::get_cached_steps), so that a prompt can reuse the steps of its longest cached
+    // prefix. When the cache exceeds its maximum size, the least recently used leaves are
+    // evicted. This class is thread safe.
+    class PrefixCache {
     public:
-      void save(std::vector<size_t> prompt, DecoderState state);
-      const DecoderState* get(const std::vector<size_t>& prompt) const;
+      // max_size is the maximum size of the cached steps in bytes.
+      PrefixCache(size_t max_size);
+      ~PrefixCache();
+
+      // Returns the cached steps of the longest prefix of at most max_length tokens that is
+      // cached for all prompts, and sets length to the prefix length. The steps of each
+      // prompt are concatenated in the time dimension.
+      std::vector<DecoderState> get(const std::vector<std::vector<size_t>>& prompts,
+                                    size_t max_length,
+                                    size_t& length);
+
+      // Caches the steps of the first length tokens of prompt. get_steps(begin, end) should
+      // return the steps [begin, end) and is only called for the tokens that are not cached.
+      void save(const std::vector<size_t>& prompt,
+                size_t length,
+                const std::function<DecoderState(dim_t, dim_t)>& get_steps);
+
+      // Returns the size of the cached steps in bytes.
+      size_t size() const;
 
     private:
-      std::map<std::vector<size_t>, DecoderState> _cache;
+      struct Node;
+
+      // Returns the number of tokens of prompt (up to max_length) that are cached and fills
+      // path with the traversed nodes. The last node can be partially matched.
+      size_t match_prefix(const std::vector<size_t>& prompt,
+                          size_t max_length,
+                          std::vector<Node*>* path = nullptr) const;
+      // Removes the least recently used leaves until the cache size is below the maximum size.
+      void evict();
+
+      const size_t _max_size;
+      std::unique_ptr<Node> _root;
+      size_t _size = 0;
+      size_t _clock = 0;
       mutable std::mutex _mutex;
     };
 
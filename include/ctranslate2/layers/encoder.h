@@ -1,5 +1,11 @@
 #pragma once
 
+#include <array>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
 #include "ctranslate2/layers/common.h"
 #include "ctranslate2/storage_view.h"
 
@@ -36,5 +42,62 @@ namespace ctranslate2 {
                               StorageView& output) = 0;
     };
 
+
+    // Cache of the encoder outputs indexed by a hash of the encoder inputs, so that a source
+    // encoded multiple times (e.g. translated then scored, or decoded again with another
+    // temperature) is only encoded once. Each entry is the output of a single example without
+    // padding. When the cache exceeds its maximum size, the least recently used entries are
+    // evicted. This class is thread safe.
+    class EncoderCache {
+    public:
+      using Key = std::array<uint64_t, 2>;
+
+      // max_size is the maximum size of the cached outputs in bytes. The cache is disabled
+      // when max_size is 0.
+      EncoderCache(size_t max_size);
+
+      bool enabled() const {
+        return _max_size > 0;
+      }
+
+      // Updates the key of an example with some bytes of its inputs.
+      static void hash(Key& key, const void* data, size_t size);
+
+      // Returns the cached output of an example, or nullptr if it is not cached.
+      std::shared_ptr<const StorageView> get(const Key& key);
+
+      // Caches the output of an example and returns it. The output is not cached if it is
+      // larger than the cache.
+      std::shared_ptr<const StorageView> save(const Key& key, StorageView output);
+
+      // Returns the size of the cached outputs in bytes.
+      size_t size() const;
+
+      // Stacks the outputs of shape [time, depth] in a batch of shape [batch, max_time, depth].
+      // max_time is a multiple of time_multiple and the padding positions are set to 0.
+      static void stack(const std::vector<std::shared_ptr<const StorageView>>& outputs,
+                        dim_t time_multiple,
+                        StorageView& batch,
+                        StorageView* lengths = nullptr);
+
+    private:
+      struct KeyHash {
+        size_t operator()(const Key& key) const {
+          return key[0];
+        }
+      };
+
+      struct Entry {
+        std::shared_ptr<const StorageView> output;
+        std::list<Key>::iterator lru_position;
+      };
+
+      const size_t _max_size;
+      std::unordered_map<Key, Entry, KeyHash> _entries;
+      std::list<Key> _lru;  // The most recently used key is first.
+      size_t _size = 0;
+      mutable std::mutex _mutex;
+    };
+
   }
 }
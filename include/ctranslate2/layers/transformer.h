@@ -20,6 +20,14 @@ namespace ctranslate2 {
 
       void operator()(const StorageView& input, StorageView& output) const;
 
+      // Applies the layer on input_norm(input + residual), where the sum is returned in
+      // residual_output. The layer norm and the residual connection of the layer are not used.
+      void operator()(const StorageView& input,
+                      const StorageView& residual,
+                      const LayerNorm& input_norm,
+                      StorageView& residual_output,
+                      StorageView& output) const;
+
       DataType output_type() const override {
         return _ff2.output_type();
       }
@@ -29,11 +37,19 @@ namespace ctranslate2 {
       }
 
     private:
+      void forward(const StorageView& input,
+                   const LayerNorm* input_norm,
+                   const StorageView* residual,
+                   StorageView* residual_output,
+                   StorageView& output) const;
+
       const std::unique_ptr<const LayerNorm> _layer_norm;
       const bool _pre_norm;
       const ops::ActivationType _activation_type;
+      const bool _fused_gate;
       const Dense _ff1;
       const std::unique_ptr<const Dense> _ff1_noact;
+      const ops::GatedActivation _gated_activation_op;
       const Dense _ff2;
       const bool _tensor_parallel;
     };
@@ -71,6 +87,16 @@ namespace ctranslate2 {
       const FeedForwardNetwork _ff;
     };
 
+    // Runs the cross attention when the decoder batches have different numbers of batches per
+    // memory row (see Decoder::add_source_index). The queries are gathered in groups of
+    // group_size batches for each memory row so that the memory is not replicated, and the
+    // outputs are gathered back in the batch order.
+    struct MemoryIndex {
+      StorageView group_queries;
+      StorageView ungroup_outputs;
+      dim_t group_size;
+    };
+
     class TransformerDecoderLayer : public Layer
     {
     public:
@@ -96,7 +122,11 @@ namespace ctranslate2 {
                       const Padder* memory_padder = nullptr,
                       bool return_normalized_attention = true,
                       StorageView* position_bias = nullptr,
-                      dim_t offset = 0) const;
+                      dim_t offset = 0,
+                      const PagedKVCache* paged_cache = nullptr,
+                      StorageView* cached_self_attn_keys_scale = nullptr,
+                      StorageView* cached_self_attn_values_scale = nullptr,
+                      const MemoryIndex* memory_index = nullptr) const;
 
       DataType output_type() const override {
         return _ff.output_type();
@@ -166,6 +196,17 @@ namespace ctranslate2 {
 
       DecoderState initial_state(bool iterative_decoding = true) const override;
       bool replicate_state(const std::string& name) const override;
+      bool shared_state(const std::string& name) const override;
+      bool support_continuous_batching() const override;
+      void append_state(DecoderState& state, DecoderState other) const override;
+      void truncate_state(DecoderState& state, dim_t length) const override;
+      bool support_prefix_cache(dim_t length) const override;
+      DecoderState get_cached_steps(const DecoderState& state,
+                                    dim_t batch_id,
+                                    dim_t begin,
+                                    dim_t end) const override;
+      void set_cached_steps(DecoderState& state,
+                            const std::vector<DecoderState>& steps) const override;
 
       void operator()(dim_t step,
                       const StorageView& ids,
@@ -221,6 +262,16 @@ namespace ctranslate2 {
       Dense _proj;
       const dim_t _sliding_window;
       const bool _tensor_parallel;
+      const bool _support_paged_cache;
+      const dim_t _kv_cache_page_size;
+      const bool _kv_cache_int8;
+
+      dim_t get_cache_time_dim(const std::string& name, const StorageView& value) const;
+
+      // The int8 cache is not used with the paged cache.
+      bool quantize_kv_cache() const {
+        return _kv_cache_int8 && _kv_cache_page_size == 0;
+      }
     };
 
   }
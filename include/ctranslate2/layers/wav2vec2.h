@@ -91,10 +91,10 @@ namespace ctranslate2 {
                 && features.dim(1) != input_size());
       }
 
-      const StorageView* _upgraded_model;
+      const bool _upgraded_model;
 
     private:
-      const StorageView* _return_logits;
+      const bool _return_logits;
       std::optional<Wav2Vec2LayerNormConvLayer> _feat_layer0;
       std::optional<std::vector<std::unique_ptr<const Wav2Vec2LayerNormConvLayer>>> _feat_layers;
       std::optional<LayerNorm> _fp_norm;
@@ -3,6 +3,7 @@
 #include "ctranslate2/layers/encoder.h"
 #include "ctranslate2/layers/decoder.h"
 #include "ctranslate2/models/model.h"
+#include "ctranslate2/continuous_batching.h"
 #include "ctranslate2/encoding.h"
 #include "ctranslate2/generation.h"
 #include "ctranslate2/scoring.h"
@@ -17,18 +18,20 @@ namespace ctranslate2 {
 
       const Vocabulary& get_vocabulary() const;
 
-      // The returned cache is thread safe.
-      layers::DecoderStateCache& get_state_cache() const;
+      // The returned cache is thread safe and shared by all replicas of the model.
+      layers::PrefixCache& get_prefix_cache() const;
 
     protected:
       void initialize(ModelReader& model_reader) override;
 
     private:
       std::shared_ptr<const Vocabulary> _vocabulary;
-      std::shared_ptr<layers::DecoderStateCache> _state_cache;
+      std::shared_ptr<layers::PrefixCache> _prefix_cache;
     };
 
 
+    using GenerationRequest = DecodingRequest<GenerationOptions, GenerationResult>;
+
     // Base class for generative language models.
     class SequenceGeneratorReplica : public ModelReplica {
     public:
@@ -50,6 +53,9 @@ namespace ctranslate2 {
       generate(const std::vector<std::vector<std::string>>& start_tokens,
                const GenerationOptions& options = GenerationOptions());
 
+      // Generates the queued requests with continuous batching until the queue is empty.
+      void generate_continuous(RequestQueue<GenerationRequest>& queue, size_t max_batch_size);
+
       StorageView forward(const std::vector<std::vector<std::string>>& tokens,
                           const bool return_log_probs);
       StorageView forward(const std::vector<std::vector<size_t>>& ids,
@@ -76,6 +82,10 @@ namespace ctranslate2 {
       run_generation(const std::vector<std::vector<std::string>>& start_tokens,
                      const GenerationOptions& options) = 0;
 
+      // The default implementation runs the queued requests in static batches.
+      virtual void run_continuous_generation(RequestQueue<GenerationRequest>& queue,
+                                             size_t max_batch_size);
+
       virtual StorageView forward(const StorageView& ids, const StorageView& lengths) = 0;
 
     private:
@@ -102,11 +112,22 @@ namespace ctranslate2 {
       run_generation(const std::vector<std::vector<std::string>>& start_tokens,
                      const GenerationOptions& options) override;
 
+      void run_continuous_generation(RequestQueue<GenerationRequest>& queue,
+                                     size_t max_batch_size) override;
+
       StorageView forward(const StorageView& ids, const StorageView& lengths) override;
 
     private:
       const std::shared_ptr<const LanguageModel> _model;
       const std::unique_ptr<layers::Decoder> _decoder;
+
+      std::vector<size_t> get_static_prompt_ids(const GenerationOptions& options) const;
+
+      // Forwards the first length tokens of each prompt and returns the decoder state.
+      // The steps of the longest prefix found in the prefix cache are not forwarded again.
+      layers::DecoderState prefill(const std::vector<std::vector<size_t>>& prompts,
+                                   size_t length,
+                                   const GenerationOptions& options);
     };
 
 
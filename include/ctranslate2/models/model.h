@@ -9,12 +9,17 @@
 #include "ctranslate2/storage_view.h"
 
 namespace ctranslate2 {
+  namespace layers {
+    class EncoderCache;
+  }
+
   namespace models {
 
     enum class QUANTIZATION_TYPE {
       CT2,
       AWQ_GEMM,
-      AWQ_GEMV
+      AWQ_GEMV,
+      INT4
     };
 
     static const size_t current_binary_version = 6;
@@ -34,18 +39,21 @@ namespace ctranslate2 {
                                                int device_index = 0,
                                                ComputeType compute_type = ComputeType::DEFAULT,
                                                bool use_flash_attention = false,
-                                               bool tensor_parallel = false);
+                                               bool tensor_parallel = false,
+                                               bool use_mmap = false);
       static std::shared_ptr<const Model> load(ModelReader& model_reader,
                                                Device device = Device::CPU,
                                                int device_index = 0,
                                                ComputeType compute_type = ComputeType::DEFAULT,
                                                bool use_flash_attention = false,
-                                               bool tensor_parallel = false);
+                                               bool tensor_parallel = false,
+                                               bool use_mmap = false);
 
       virtual std::unique_ptr<SequenceToSequenceReplica> as_sequence_to_sequence() const;
       virtual std::unique_ptr<SequenceGeneratorReplica> as_sequence_generator() const;
       virtual std::unique_ptr<SequenceEncoderReplica> as_sequence_encoder() const;
 
+      Model();
       virtual ~Model();
 
       nlohmann::json config;
@@ -68,6 +76,11 @@ namespace ctranslate2 {
         return _device_index;
       }
 
+      // NUMA node where the weights were allocated, or -1 if the model is not bound to a node.
+      int numa_node() const {
+        return _numa_node;
+      }
+
       ComputeType saved_compute_type() const {
         return _saved_compute_type;
       }
@@ -96,6 +109,11 @@ namespace ctranslate2 {
         return _use_flash_attention;
       }
 
+      // True if the model was loaded with ModelLoader::continuous_batching.
+      bool use_continuous_batching() const {
+        return _continuous_batching;
+      }
+
       QUANTIZATION_TYPE quant_method() const {
         return _quant_method;
       }
@@ -108,10 +126,20 @@ namespace ctranslate2 {
         return true;
       }
 
+      // Optional model files that change how the variables are processed (e.g. which weights
+      // are packed). The weight cache key depends on them.
+      virtual std::vector<std::string> get_processing_files() const {
+        return {};
+      }
+
       ScopedDeviceSetter get_scoped_device_setter() const {
         return ScopedDeviceSetter(_device, _device_index);
       }
 
+      // Cache of the encoder outputs, see CT2_ENCODER_CACHE_SIZE. The returned cache is thread
+      // safe and shared by the replicas on the same device.
+      layers::EncoderCache& get_encoder_cache() const;
+
       // If the model contains variables, they will be moved to the new device.
       void set_device(const Device device, const int index = 0);
 
@@ -173,25 +201,40 @@ namespace ctranslate2 {
       virtual std::unique_ptr<Model> clone() const = 0;
 
     private:
+      friend class ModelLoader;
+
       void process_linear_weights();
+      void fuse_gated_linear_weights();
       void set_compute_type(ComputeType type, Device device, int device_index, bool update_weight=true);
       void ensure_dtype(const std::string& name,
                         StorageView& variable,
                         const DataType target_dtype);
       ComputeType infer_compute_type() const;
+      // Cache of the processed variables, see CT2_WEIGHT_CACHE_DIR.
+      void save_weight_cache(const std::string& path, const std::string& key) const;
+      bool load_weight_cache(const std::string& path,
+                             const std::string& key,
+                             ComputeType compute_type,
+                             Device device,
+                             int device_index);
 
       Device _device = Device::CPU;
       int _device_index = 0;
+      int _numa_node = -1;
       size_t _binary_version = 0;
       size_t _spec_revision = 0;
       ComputeType _saved_compute_type = ComputeType::DEFAULT;
       ComputeType _requested_compute_type = ComputeType::DEFAULT;
       ComputeType _effective_compute_type = ComputeType::DEFAULT;
       dim_t _preferred_size_multiple = 1;
+      // Mapped model file viewed by some variables. It should be released after the variables.
+      std::shared_ptr<MappedFile> _mapped_file;
       std::unordered_map<std::string, std::shared_ptr<StorageView>> _variable_index;
       bool _use_flash_attention = false;
       bool _tensor_parallel = false;
+      bool _continuous_batching = false;
       QUANTIZATION_TYPE _quant_method = QUANTIZATION_TYPE::CT2;
+      std::shared_ptr<layers::EncoderCache> _encoder_cache;
     };
 
     template<>
@@ -222,6 +265,17 @@ namespace ctranslate2 {
       ComputeType compute_type = ComputeType::DEFAULT;
       bool use_flash_attention = false;
       bool tensor_parallel = false;
+      // Map the model file in memory and use the variables without copy when possible.
+      bool use_mmap = false;
+      // On CPU, split the replicas in groups bound to each NUMA node. The weights are copied
+      // once per node in local memory.
+      bool numa_aware = false;
+      // Configure the decoders of the replicas for continuous batching. The decoder
+      // self-attention then uses the paged KV cache for all requests.
+      bool continuous_batching = false;
+
+    private:
+      std::vector<std::shared_ptr<const Model>> load_numa_replicas() const;
     };
 
     // Base class for replicas.
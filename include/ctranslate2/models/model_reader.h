@@ -5,6 +5,7 @@
 #include <string>
 #include <unordered_map>
 
+#include "ctranslate2/filesystem.h"
 #include "ctranslate2/vocabulary.h"
 
 namespace ctranslate2 {
@@ -21,6 +22,14 @@ namespace ctranslate2 {
       virtual std::unique_ptr<std::istream> get_file(const std::string& filename,
                                                      const bool binary = false) = 0;
 
+      // Returns a file included in the model mapped in memory, or nullptr if the file can't
+      // be mapped. The default implementation does not support memory mapping.
+      virtual std::shared_ptr<MappedFile> get_mapped_file(const std::string& filename);
+
+      // Returns a string that changes when the file content changes without reading the
+      // file, or an empty string if this is not supported. See get_file_signature.
+      virtual std::string get_file_signature(const std::string& filename);
+
       // Wrapper around get_file, raises an exception if the file can't be openned.
       std::unique_ptr<std::istream> get_required_file(const std::string& filename,
                                                       const bool binary = false);
@@ -32,6 +41,8 @@ namespace ctranslate2 {
       std::string get_model_id() const override;
       std::unique_ptr<std::istream> get_file(const std::string& filename,
                                              const bool binary = false) override;
+      std::shared_ptr<MappedFile> get_mapped_file(const std::string& filename) override;
+      std::string get_file_signature(const std::string& filename) override;
 
     private:
       std::string _model_dir;
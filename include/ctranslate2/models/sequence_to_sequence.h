@@ -1,5 +1,6 @@
 #pragma once
 
+#include "ctranslate2/continuous_batching.h"
 #include "ctranslate2/layers/decoder.h"
 #include "ctranslate2/layers/encoder.h"
 #include "ctranslate2/models/model.h"
@@ -17,6 +18,8 @@ namespace ctranslate2 {
       const Vocabulary& get_target_vocabulary() const;
       const VocabularyMap* get_vocabulary_map() const;
 
+      std::vector<std::string> get_processing_files() const override;
+
       bool with_source_bos() const {
         return config["add_source_bos"];
       }
@@ -42,6 +45,8 @@ namespace ctranslate2 {
     };
 
 
+    using TranslationRequest = DecodingRequest<TranslationOptions, TranslationResult>;
+
     class SequenceToSequenceReplica : public ModelReplica {
     public:
       SequenceToSequenceReplica(const std::shared_ptr<const Model>& model)
@@ -63,6 +68,9 @@ namespace ctranslate2 {
                 const std::vector<std::vector<std::string>>& target_prefix = {},
                 const TranslationOptions& options = TranslationOptions());
 
+      // Translates the queued requests with continuous batching until the queue is empty.
+      void translate_continuous(RequestQueue<TranslationRequest>& queue, size_t max_batch_size);
+
     protected:
       virtual bool skip_scoring(const std::vector<std::string>& source,
                                 const std::vector<std::string>& target,
@@ -95,6 +103,10 @@ namespace ctranslate2 {
       run_translation(const std::vector<std::vector<std::string>>& source,
                       const std::vector<std::vector<std::string>>& target_prefix,
                       const TranslationOptions& options) = 0;
+
+      // The default implementation runs the queued requests in static batches.
+      virtual void run_continuous_translation(RequestQueue<TranslationRequest>& queue,
+                                              size_t max_batch_size);
     };
 
 
@@ -133,6 +145,9 @@ namespace ctranslate2 {
                       const std::vector<std::vector<std::string>>& target_prefix,
                       const TranslationOptions& options) override;
 
+      void run_continuous_translation(RequestQueue<TranslationRequest>& queue,
+                                      size_t max_batch_size) override;
+
     private:
       std::vector<std::vector<std::vector<size_t>>>
       make_source_ids(const std::vector<std::vector<std::vector<std::string>>>& source_features,
@@ -146,9 +161,13 @@ namespace ctranslate2 {
       size_t get_source_length(const std::vector<std::string>& source,
                                bool include_special_tokens) const;
 
+      // Encodes the source with the encoder cache of the model, if enabled.
       void encode(const std::vector<std::vector<std::vector<size_t>>>& ids,
                   StorageView& memory,
                   StorageView& memory_lengths);
+      void run_encoder(const std::vector<std::vector<std::vector<size_t>>>& ids,
+                       StorageView& memory,
+                       StorageView& memory_lengths);
 
       const std::shared_ptr<const SequenceToSequenceModel> _model;
       const std::unique_ptr<layers::Encoder> _encoder;
@@ -3,6 +3,7 @@
 #include "ctranslate2/generation.h"
 #include "ctranslate2/layers/whisper.h"
 #include "ctranslate2/models/model.h"
+#include "ctranslate2/ops/log_mel_spectrogram.h"
 #include "ctranslate2/replica_pool.h"
 
 namespace ctranslate2 {
@@ -58,6 +59,57 @@ namespace ctranslate2 {
       std::vector<int> suppress_tokens = {-1};
     };
 
+    struct WhisperTranscriptionOptions {
+      // Options used to decode each window. The sampling temperature is set by the
+      // temperature fallback.
+      WhisperOptions decoding_options;
+
+      // Language token, e.g. "<|en|>". If empty, the language is detected on the first
+      // window of each region.
+      std::string language;
+
+      // Task token.
+      std::string task = "<|transcribe|>";
+
+      // Predict timestamps and move the next window to the end of the last complete segment.
+      bool with_timestamps = true;
+
+      // Prompt each window with the tokens of the previous windows in the same region.
+      bool condition_on_previous_text = true;
+
+      // Temperatures used successively when the average log probability of a window is
+      // below log_prob_threshold.
+      std::vector<float> temperatures = {0, 0.2, 0.4, 0.6, 0.8, 1.0};
+      float log_prob_threshold = -1;
+
+      // A window is skipped as silence when the no speech probability is above this
+      // threshold and the average log probability is below log_prob_threshold.
+      float no_speech_threshold = 0.6;
+
+      // Maximum number of windows decoded in a batch (0 for no limit).
+      size_t max_batch_size = 16;
+
+      // Split each audio in independent regions of this number of frames which are
+      // transcribed in parallel (0 to disable). The previous text is not shared across regions.
+      size_t region_frames = 0;
+    };
+
+    struct WhisperSegment {
+      // Start and end times in seconds.
+      float start = 0;
+      float end = 0;
+      std::vector<std::string> tokens;
+      std::vector<size_t> tokens_ids;
+      float avg_log_prob = 0;
+      float no_speech_prob = 0;
+      float temperature = 0;
+    };
+
+    struct WhisperTranscriptionResult {
+      std::string language;
+      std::vector<WhisperSegment> segments;
+    };
+
     struct WhisperGenerationResult {
       std::vector<std::vector<std::string>> sequences;
       std::vector<std::vector<size_t>> sequences_ids;
@@ -79,6 +131,43 @@ namespace ctranslate2 {
       std::vector<float> text_token_probs;
     };
 
+    // Computes the Whisper features of an audio stream by windows of 30 seconds.
+    //
+    // The samples are 16 kHz mono audio and can be pushed in chunks of any size. The frames
+    // are computed from the continuous signal, so the windows match the slices of the features
+    // computed on the full audio. However, each window is normalized with its own maximum value
+    // while Whisper normalizes the full audio at once: the features are identical when the audio
+    // is not longer than a window.
+    class WhisperFeatureStream {
+    public:
+      WhisperFeatureStream(size_t n_mels, dim_t window_frames = 3000);
+
+      void push(const float* samples, size_t num_samples);
+      void push(const std::vector<float>& samples);
+
+      // Marks the end of the audio. The last window is padded with silence.
+      void finish();
+
+      // Sets the features of the next window with shape [n_mels, window_frames] and returns
+      // true, or returns false if the window is not complete yet.
+      bool next(StorageView& features);
+
+      // Number of frames in the audio pushed so far.
+      dim_t num_frames() const;
+
+    private:
+      const ops::LogMelSpectrogram _log_mel_spectrogram;
+      const dim_t _window_frames;
+      std::vector<float> _signal;  // Padded signal starting at the next frame to compute.
+      std::vector<float> _frames;  // Frames [*, n_mels] starting at the next window.
+      size_t _num_samples = 0;
+      dim_t _num_computed_frames = 0;
+      dim_t _max_frames = -1;  // Set when the audio is finished.
+      bool _started = false;
+
+      void compute_frames();
+    };
+
     class WhisperModel : public Model {
     public:
       const Vocabulary& get_vocabulary() const;
@@ -139,6 +228,12 @@ namespace ctranslate2 {
             std::vector<size_t> num_frames,
             dim_t median_filter_width);
 
+      // Transcribes audio of any length. Each features has the shape [n_mels, num_frames]
+      // and the windows of all audio are decoded in batches.
+      std::vector<WhisperTranscriptionResult>
+      transcribe(const std::vector<StorageView>& features,
+                 const WhisperTranscriptionOptions& options);
+
     private:
       const std::shared_ptr<const WhisperModel> _model;
       const std::unique_ptr<layers::WhisperEncoder> _encoder;
@@ -153,6 +248,14 @@ namespace ctranslate2 {
       bool _is_multilingual;
 
       StorageView maybe_encode(StorageView features);
+      // Runs the encoder with the encoder cache of the model, if enabled.
+      StorageView run_encoder(StorageView features);
+
+      std::vector<WhisperGenerationResult>
+      generate_windows(const StorageView& encoder_output,
+                       const std::vector<size_t>& windows,
+                       const std::vector<std::vector<size_t>>& prompts,
+                       const WhisperOptions& options);
     };
 
     class Whisper : public ReplicaPool<WhisperReplica> {
@@ -185,6 +288,9 @@ namespace ctranslate2 {
             std::vector<size_t> num_frames,
             dim_t median_filter_width);
 
+      std::vector<std::future<WhisperTranscriptionResult>>
+      transcribe(std::vector<StorageView> features,
+                 WhisperTranscriptionOptions options = {});
     };
 
   }
@@ -19,7 +19,7 @@ namespace ctranslate2 {
                       StorageView* rotary_cos,
                       StorageView* rotary_sin,
                       const bool rotary_interleave,
-                      StorageView* alibi,
+                      const StorageView* alibi,
                       dim_t offset) const;
 
     private:
@@ -37,7 +37,7 @@ namespace ctranslate2 {
                    StorageView* rotary_cos,
                    StorageView* rotary_sin,
                    const bool rotary_interleave,
-                   StorageView* alibi,
+                   const StorageView* alibi,
                    dim_t offset) const;
     };
   }
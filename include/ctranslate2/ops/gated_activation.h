@@ -0,0 +1,22 @@
+#pragma once
+
+#include "activation.h"
+#include "op.h"
+
+namespace ctranslate2 {
+  namespace ops {
+
+    // Computes y = activation(x1) * x2 where x1 and x2 are the first and second halves
+    // of the last dimension of x. This is the output transformation of gated linear units
+    // (e.g. SwiGLU or GeGLU) when both input projections are computed by a single GEMM.
+    class GatedActivation : public Op {
+    public:
+      GatedActivation(const ActivationType activation_type);
+      void operator()(const StorageView& x, StorageView& y) const;
+
+    private:
+      const ActivationType _activation_type;
+    };
+
+  }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "activation.h"
+#include "op.h"
+
+namespace ctranslate2 {
+  namespace ops {
+
+    // Matrix multiplication with 4-bit weights: c = a * dequantize(b)^T + bias.
+    //
+    // b has the shape [n, k / 2] and contains the packed 4-bit weights (see cpu/kernels.h for
+    // the layout). scale and zero have the shape [n, k / group_size] and are used to dequantize
+    // each group of weights as (q - zero) * scale.
+    class GemmInt4 : public Op {
+    public:
+      GemmInt4(const ActivationType* activation_type = nullptr);
+
+      void operator()(const StorageView& a,
+                      const StorageView& b,
+                      const StorageView& scale,
+                      const StorageView& zero,
+                      StorageView& c,
+                      const StorageView* bias = nullptr) const;
+
+    private:
+      const ActivationType* _activation_type;
+    };
+
+  }
+}
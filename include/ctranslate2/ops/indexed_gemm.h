@@ -0,0 +1,33 @@
+#pragma once
+
+#include "activation.h"
+#include "op.h"
+
+namespace ctranslate2 {
+  namespace ops {
+
+    // Matrix multiplication with a subset of the weight rows: c = a * b[index]^T + bias.
+    //
+    // b has the shape [*, k] and index contains the n selected rows. The rows are read in
+    // place, so this avoids copying the weight when the selection changes frequently (e.g. the
+    // output layer restricted to a vocabulary map). bias, if set, already has n values.
+    //
+    // With int8 inputs c should be an int32 storage and a is shifted to uint8 when the compensation
+    // term is passed, as in Gemm.
+    class IndexedGemm : public Op {
+    public:
+      IndexedGemm(const ActivationType* activation_type = nullptr);
+
+      void operator()(const StorageView& a,
+                      const StorageView& b,
+                      const StorageView& index,
+                      StorageView& c,
+                      const StorageView* a_shift_compensation = nullptr,
+                      const StorageView* bias = nullptr) const;
+
+    private:
+      const ActivationType* _activation_type;
+    };
+
+  }
+}
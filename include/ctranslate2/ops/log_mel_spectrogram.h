@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+
+#include "op.h"
+
+namespace ctranslate2 {
+  namespace ops {
+
+    // Computes the log-Mel spectrogram of 16 kHz audio as in the Whisper preprocessing.
+    //
+    // The audio has the shape [batch_size, num_samples] and the features have the shape
+    // [batch_size, num_mels, num_samples / hop_length]. The STFT uses a periodic Hann window
+    // and reflect padding, the Mel filterbank uses the Slaney scale and normalization, and
+    // each example is normalized with its own maximum value.
+    //
+    // The DFT of the frames is computed as a matrix multiplication with a precomputed basis,
+    // so the frames of a batch are transformed with a single GEMM.
+    class LogMelSpectrogram : public Op {
+    public:
+      LogMelSpectrogram(const dim_t num_mels,
+                        const dim_t n_fft = 400,
+                        const dim_t hop_length = 160,
+                        const dim_t sample_rate = 16000);
+
+      void operator()(const StorageView& audio, StorageView& features) const;
+
+      // Computes the log10 Mel energies of num_frames frames without padding or normalization.
+      // Frame t reads signal[t * hop_length, t * hop_length + n_fft) and the output has the
+      // shape [num_frames, num_mels].
+      void compute_frames(const float* signal, const dim_t num_frames, float* output) const;
+
+      // Clamps the log10 Mel energies to 8 below their maximum value and rescales them.
+      static void normalize(float* features, const dim_t size);
+
+      dim_t num_mels() const {
+        return _num_mels;
+      }
+
+      dim_t n_fft() const {
+        return _n_fft;
+      }
+
+      dim_t hop_length() const {
+        return _hop_length;
+      }
+
+    private:
+      const dim_t _num_mels;
+      const dim_t _n_fft;
+      const dim_t _hop_length;
+      const dim_t _num_bins;
+      std::vector<float> _dft_basis;  // [n_fft, 2 * num_bins] with the window applied.
+      std::vector<float> _mel_filters;  // [num_mels, num_bins]
+    };
+
+  }
+}
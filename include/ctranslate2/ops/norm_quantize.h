@@ -0,0 +1,35 @@
+#pragma once
+
+#include "op.h"
+
+namespace ctranslate2 {
+  namespace ops {
+
+    // Quantizes norm(input + residual) to int8 with one scale per row, where norm is a
+    // LayerNorm when beta is set and a RMSNorm otherwise. The residual addition, the
+    // normalization, and the quantization run in a single pass over each row. When a residual
+    // is passed, the sum input + residual is also returned so that it can be reused.
+    class NormQuantize : public Op {
+    public:
+      NormQuantize(const float epsilon,
+                   const bool use_residual = false,
+                   const bool shift_to_uint8 = false,
+                   const bool round_before_cast = true);
+
+      void operator()(const StorageView* beta,
+                      const StorageView& gamma,
+                      const StorageView& input,
+                      StorageView& output,
+                      StorageView& scale,
+                      const StorageView* residual = nullptr,
+                      StorageView* sum = nullptr) const;
+
+    private:
+      const float _epsilon;
+      const bool _use_residual;
+      const bool _shift_to_uint8;
+      const bool _round_before_cast;
+    };
+
+  }
+}
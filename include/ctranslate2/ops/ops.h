@@ -5,16 +5,20 @@
 #include "concat.h"
 #include "conv1d.h"
 #include "cos.h"
+#include "gated_activation.h"
 #include "gather.h"
 #include "gelu.h"
 #include "gemm.h"
+#include "gemm_int4.h"
 #include "gumbel_max.h"
 #include "identity.h"
+#include "indexed_gemm.h"
 #include "layer_norm.h"
 #include "matmul.h"
 #include "mean.h"
 #include "mul.h"
 #include "multinomial.h"
+#include "norm_quantize.h"
 #include "quantize.h"
 #include "relu.h"
 #include "sin.h"
@@ -35,11 +39,13 @@
 #include "rms_norm.h"
 #include "tanh.h"
 #include "median_filter.h"
+#include "log_mel_spectrogram.h"
 #include "rotary.h"
 #include "alibi_add.h"
 #include "slide.h"
 #include "nccl_ops.h"
 #include "flash_attention.h"
+#include "paged_attention.h"
 #include "awq/gemm.h"
 #include "awq/gemv.h"
 #include "awq/dequantize_awq.h"
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "op.h"
+
+namespace ctranslate2 {
+  namespace ops {
+
+    // Dot product attention reading the keys and values from a paged cache.
+    //
+    // The queries have the shape [batch, rows, head_dim] where the rows of each batch are
+    // ordered so that consecutive blocks of rows / num_heads_kv rows attend to the same
+    // key/value head (e.g. [batch, num_heads, time, head_dim] or [batch, time * num_heads,
+    // head_dim] when there is a single key/value head). The pages have the shape
+    // [num_pages, num_heads_kv, page_size, head_dim] and page_table has the shape
+    // [batch, max_pages_per_sequence]. If set, lengths contains the number of keys attended
+    // by each query row.
+    class PagedAttention : public Op {
+    public:
+      PagedAttention(const float queries_scale);
+
+      void operator()(const StorageView& queries,
+                      const StorageView& key_pages,
+                      const StorageView& value_pages,
+                      const StorageView& page_table,
+                      const dim_t keys_length,
+                      const StorageView* lengths,
+                      StorageView& output) const;
+
+    private:
+      const float _queries_scale;
+    };
+
+  }
+}
@@ -1,34 +1,70 @@
 #pragma once
 
-#include <chrono>
+#include <cstdint>
 #include <ostream>
-#include <string>
 
 #include "ctranslate2/devices.h"
 
 namespace ctranslate2 {
 
-#ifdef CT2_ENABLE_PROFILING
-#  define PROFILE(NAME) ctranslate2::ScopeProfiler scope_profiler(NAME)
+#define PROFILE(NAME) ctranslate2::TraceScope trace_scope(NAME)
+#define PROFILE_FUN PROFILE(__func__)
 
-  // Times of profilers created in different threads with the same name are accumulated.
-  class ScopeProfiler {
+  // Records the execution time of the enclosing scope when tracing is enabled. When tracing
+  // is disabled, the cost is a single atomic load.
+  // The name should have a static storage duration since only the pointer is saved.
+  class TraceScope {
   public:
-    ScopeProfiler(const std::string& name);
-    ~ScopeProfiler();
+    TraceScope(const char* name);
+    ~TraceScope();
 
   private:
-    ScopeProfiler* _parent = nullptr;
-    std::string _name;
-    std::chrono::high_resolution_clock::time_point _start;
+    const char* _name;
+    int64_t _start;
+    TraceScope* _parent;
   };
 
-#else
-#  define PROFILE(NAME) do {} while(0)
-#endif
+  // Annotations attached to the events recorded in the current thread.
+  enum class TraceArg {
+    Replica,
+    Batch,
+    Step,
+  };
+
+  // Sets an annotation for the events recorded in the current thread (-1 to unset).
+  void set_trace_arg(TraceArg arg, int64_t value);
+
+  // Sets an annotation of the current thread and restores the previous value on exit.
+  class TraceArgScope {
+  public:
+    TraceArgScope(TraceArg arg, int64_t value);
+    ~TraceArgScope();
+
+  private:
+    const TraceArg _arg;
+    int64_t _previous;
+  };
+
+  // Each thread records its events in a ring buffer of buffer_size events (0 to use the
+  // default size). When a buffer is full, the oldest events are overwritten. The buffer
+  // size only applies to threads that did not record events yet.
+  // If device is CUDA, the stream is synchronized at the beginning and end of each scope.
+  void start_tracing(Device device = Device::CPU, size_t buffer_size = 0);
+  void stop_tracing();
+  bool is_tracing_enabled();
+
+  // Writes the events recorded since the last call to start_tracing in the Chrome trace
+  // format, which can be opened in chrome://tracing or https://ui.perfetto.dev.
+  void dump_trace(std::ostream& os);
 
-#define PROFILE_FUN PROFILE(std::string(__FILE__) + ":" + std::string(__func__))
+  // Time in nanoseconds used by the trace events.
+  int64_t get_trace_time();
+  // Records an event that did not run in a single scope (e.g. the time spent in a queue).
+  void add_trace_event(const char* name, int64_t start, int64_t end);
+  // Returns a new identifier for the batch annotation.
+  int64_t new_trace_batch_id();
 
+  // The profiling reports the time accumulated in each traced scope.
   void init_profiling(Device device, size_t num_threads = 1);  // Not thread-safe.
   void dump_profiling(std::ostream& os);  // Not thread-safe.
 
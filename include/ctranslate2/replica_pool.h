@@ -2,9 +2,13 @@
 
 #include <chrono>
 #include <future>
+#include <queue>
 
 #include "batch_reader.h"
+#include "continuous_batching.h"
 #include "models/model.h"
+#include "profiler.h"
+#include "scheduling.h"
 #include "thread_pool.h"
 #include "utils.h"
 
@@ -14,6 +18,9 @@ namespace ctranslate2 {
     size_t num_threads_per_replica = 0;
     long max_queued_batches = 0;
     int cpu_core_offset = -1;
+    // Maximum number of examples decoded at the same time by each replica with continuous
+    // batching, or 0 to run the examples in static batches.
+    size_t continuous_batch_size = 0;
   };
 
   template <typename Replica>
@@ -58,7 +65,7 @@ namespace ctranslate2 {
     // The function will be run with the first available replica.
     // The function must have the signature: Result(Replica&)
     template <typename Result, typename Func>
-    std::future<Result> post(Func func) {
+    std::future<Result> post(Func func, const SchedulingOptions& scheduling = {}) {
       auto batched_func = [func = std::move(func)](Replica& replica) mutable {
         std::vector<Result> results;
         results.reserve(1);
@@ -66,34 +73,39 @@ namespace ctranslate2 {
         return results;
       };
 
-      auto futures = post_batch<Result>(std::move(batched_func), 1);
+      auto futures = post_batch<Result>(std::move(batched_func), 1, scheduling);
       return std::move(futures[0]);
     }
 
     // Posts a function and return one future per result.
     // The function will be run with the first available replica.
     // The function must have the signature: std::vector<Result>(Replica&)
+    // The queued functions are run according to their scheduling options.
     template <typename Result, typename Func>
-    std::vector<std::future<Result>> post_batch(Func func, size_t num_results) {
+    std::vector<std::future<Result>> post_batch(Func func,
+                                                size_t num_results,
+                                                const SchedulingOptions& scheduling = {}) {
       std::vector<std::promise<Result>> promises(num_results);
       std::vector<std::future<Result>> futures;
       futures.reserve(promises.size());
       for (auto& promise : promises)
         futures.emplace_back(promise.get_future());
 
-      post_batch(std::move(func), std::move(promises));
+      post_batch(std::move(func), std::move(promises), scheduling);
 
       return futures;
     }
 
     // Same as above, but taking the list of promises directly.
     template <typename Result, typename Func>
-    void post_batch(Func func, std::vector<std::promise<Result>> promises) {
+    void post_batch(Func func,
+                    std::vector<std::promise<Result>> promises,
+                    const SchedulingOptions& scheduling = {}) {
       auto wrapped_func = [func = std::move(func)]() mutable {
         return func(get_thread_replica());
       };
 
-      post_func(std::move(wrapped_func), std::move(promises));
+      post_func(std::move(wrapped_func), std::move(promises), scheduling);
     }
 
     // Number of batches in the work queue.
@@ -153,19 +165,70 @@ namespace ctranslate2 {
     }
 
   protected:
+    bool use_continuous_batching() const {
+      return _continuous_batch_size > 0;
+    }
+
+    // Adds the examples to a queue of requests that are decoded with continuous batching.
+    // Decoding loops are started on the replicas as needed. The loop function must have
+    // the signature: void(Replica&, RequestQueue<Request>&, size_t max_batch_size)
+    template <typename Result, typename Options, typename Func>
+    std::vector<std::future<Result>>
+    post_continuous_examples(const std::vector<Example>& examples,
+                             const Options& options,
+                             const std::shared_ptr<RequestQueue<DecodingRequest<Options, Result>>>& queue,
+                             const Func& func) {
+      const auto shared_options = std::make_shared<const Options>(options);
+
+      std::vector<DecodingRequest<Options, Result>> requests(examples.size());
+      std::vector<std::future<Result>> futures;
+      futures.reserve(requests.size());
+
+      for (size_t i = 0; i < requests.size(); ++i) {
+        auto& request = requests[i];
+        request.example = examples[i];
+        request.index = i;
+        request.options = shared_options;
+        futures.emplace_back(request.promise.get_future());
+      }
+
+      const size_t num_loops = queue->push(std::move(requests), num_replicas());
+
+      // The loop keeps a reference to the queue which can outlive the pool (the workers
+      // process all remaining jobs before exiting).
+      for (size_t i = 0; i < num_loops; ++i) {
+        auto loop = [queue, func, max_batch_size = _continuous_batch_size]() {
+          func(get_thread_replica(), *queue, max_batch_size);
+        };
+
+        _thread_pool->post(std::make_unique<LoopJob<decltype(loop)>>(std::move(loop),
+                                                                     options.scheduling));
+      }
+
+      return futures;
+    }
+
     template <typename Result, typename Func>
     std::vector<std::future<Result>>
     post_examples(const std::vector<Example>& examples,
                   size_t max_batch_size,
                   BatchType batch_type,
-                  const Func& func) {
+                  size_t beam_size,
+                  const Func& func,
+                  const SchedulingOptions& scheduling = {}) {
       std::vector<std::promise<Result>> promises(examples.size());
       std::vector<std::future<Result>> futures;
       futures.reserve(promises.size());
       for (auto& promise : promises)
         futures.emplace_back(promise.get_future());
 
-      post_examples(examples, max_batch_size, batch_type, std::move(promises), func);
+      post_examples(examples,
+                    max_batch_size,
+                    batch_type,
+                    beam_size,
+                    std::move(promises),
+                    func,
+                    scheduling);
 
       return futures;
     }
@@ -174,9 +237,11 @@ namespace ctranslate2 {
     void post_examples(const std::vector<Example>& examples,
                        size_t max_batch_size,
                        BatchType batch_type,
+                       size_t beam_size,
                        std::vector<std::promise<Result>> promises,
-                       const Func& func) {
-      for (auto& batch : rebatch_input(examples, max_batch_size, batch_type)) {
+                       const Func& func,
+                       const SchedulingOptions& scheduling = {}) {
+      for (auto& batch : rebatch_input(examples, max_batch_size, batch_type, beam_size)) {
         std::vector<std::promise<Result>> batch_promises;
         batch_promises.reserve(batch.num_examples());
         for (const size_t index : batch.example_index)
@@ -184,7 +249,8 @@ namespace ctranslate2 {
 
         post_batch<Result>(
           [batch = std::move(batch), func](Replica& replica) { return func(replica, batch); },
-          std::move(batch_promises));
+          std::move(batch_promises),
+          scheduling);
       }
     }
 
@@ -194,7 +260,9 @@ namespace ctranslate2 {
                          const Func& func,
                          size_t max_batch_size,
                          size_t read_batch_size,
-                         BatchType batch_type) {
+                         BatchType batch_type,
+                         size_t beam_size,
+                         const SchedulingOptions& scheduling = {}) {
       std::queue<std::future<Result>> results;
 
       auto pop_results = [&results, &result_writer](bool blocking) {
@@ -210,12 +278,23 @@ namespace ctranslate2 {
       if (read_batch_size == 0)
         read_batch_size = (max_batch_size == 1 ? max_batch_size : max_batch_size * 16);
 
+      // The examples are read by number of tokens and the padding is minimized when
+      // splitting the read buffer in batches.
+      const BatchType read_batch_type = (batch_type == BatchType::PaddedTokens
+                                         ? BatchType::Tokens
+                                         : batch_type);
+
       while (true) {
-        auto examples = batch_reader.get_next(read_batch_size, batch_type);
+        auto examples = batch_reader.get_next(read_batch_size, read_batch_type);
         if (examples.empty())
           break;
 
-        auto futures = post_examples<Result>(examples, max_batch_size, batch_type, func);
+        auto futures = post_examples<Result>(examples,
+                                             max_batch_size,
+                                             batch_type,
+                                             beam_size,
+                                             func,
+                                             scheduling);
         for (auto& future : futures)
           results.emplace(std::move(future));
 
@@ -227,6 +306,7 @@ namespace ctranslate2 {
 
   private:
     std::unique_ptr<ThreadPool> _thread_pool;
+    size_t _continuous_batch_size = 0;
 
     static Replica& get_thread_replica() {
       auto& worker = static_cast<ReplicaWorker<Replica>&>(ThreadPool::get_local_worker());
@@ -237,15 +317,22 @@ namespace ctranslate2 {
                          const ReplicaPoolConfig& config) {
       // The same number of computation threads should be used for loading and running model.
       set_num_threads(config.num_threads_per_replica);
-      initialize_pool(model_loader.load(), config);
+      models::ModelLoader loader = model_loader;
+      if (config.continuous_batch_size > 0)
+        loader.continuous_batching = true;
+      initialize_pool(loader.load(), config);
     }
 
     void initialize_pool(const std::vector<std::shared_ptr<const models::Model>>& models,
                          const ReplicaPoolConfig& config) {
       std::vector<std::unique_ptr<Worker>> workers;
       workers.reserve(models.size());
-      for (const auto& model : models) {
-        workers.emplace_back(std::make_unique<ReplicaWorker<Replica>>(model, config.num_threads_per_replica));
+      for (size_t i = 0; i < models.size(); ++i) {
+        if (models[i]->numa_node() >= 0 && config.cpu_core_offset >= 0)
+          throw std::invalid_argument("cpu_core_offset cannot be used with NUMA-aware replicas");
+        workers.emplace_back(std::make_unique<ReplicaWorker<Replica>>(models[i],
+                                                                      config.num_threads_per_replica,
+                                                                      i));
       }
 
       size_t max_queue_size = std::numeric_limits<size_t>::max();
@@ -257,28 +344,52 @@ namespace ctranslate2 {
       _thread_pool = std::make_unique<ThreadPool>(std::move(workers),
                                                   max_queue_size,
                                                   config.cpu_core_offset);
+      _continuous_batch_size = config.continuous_batch_size;
     }
 
     template <typename Result, typename Func>
-    void post_func(Func func, std::vector<std::promise<Result>> promises) {
+    void post_func(Func func,
+                   std::vector<std::promise<Result>> promises,
+                   const SchedulingOptions& scheduling) {
       _thread_pool->post(std::make_unique<BatchJob<Result, Func>>(std::move(promises),
-                                                                  std::move(func)));
+                                                                  std::move(func),
+                                                                  scheduling));
     }
 
     template <typename Result, typename Func>
     class BatchJob : public Job {
     public:
-      BatchJob(std::vector<std::promise<Result>> promises, Func func)
+      BatchJob(std::vector<std::promise<Result>> promises,
+               Func func,
+               const SchedulingOptions& scheduling)
         : _promises(std::move(promises))
         , _func(std::move(func))
+        , _scheduling(scheduling)
+        , _batch_id(new_trace_batch_id())
+        , _post_time(get_trace_time())
       {
       }
 
+      int priority() const override {
+        return static_cast<int>(_scheduling.priority);
+      }
+
+      std::chrono::steady_clock::time_point deadline() const override {
+        return _scheduling.deadline;
+      }
+
       void run() override {
+        const TraceArgScope trace_batch(TraceArg::Batch, _batch_id);
+        add_trace_event("BatchQueue", _post_time, get_trace_time());
+        PROFILE("Batch");
+
         std::vector<Result> results;
         std::exception_ptr exception;
 
         try {
+          // Cancelled and expired requests are not started.
+          _scheduling.check();
+          const SchedulingScope scheduling_scope(_scheduling);
           results = _func();
         } catch (...) {
           exception = std::current_exception();
@@ -295,6 +406,43 @@ namespace ctranslate2 {
     private:
       std::vector<std::promise<Result>> _promises;
       Func _func;
+      const SchedulingOptions _scheduling;
+      const int64_t _batch_id;
+      const int64_t _post_time;
+    };
+
+    // The loop is queued with the priority and deadline of the requests that started it.
+    // The cancellation of each request is handled by the loop itself.
+    template <typename Func>
+    class LoopJob : public Job {
+    public:
+      LoopJob(Func func, const SchedulingOptions& scheduling)
+        : _func(std::move(func))
+        , _priority(scheduling.priority)
+        , _deadline(scheduling.deadline)
+        , _batch_id(new_trace_batch_id())
+      {
+      }
+
+      int priority() const override {
+        return static_cast<int>(_priority);
+      }
+
+      std::chrono::steady_clock::time_point deadline() const override {
+        return _deadline;
+      }
+
+      void run() override {
+        const TraceArgScope trace_batch(TraceArg::Batch, _batch_id);
+        PROFILE("ContinuousBatching");
+        _func();
+      }
+
+    private:
+      Func _func;
+      const Priority _priority;
+      const SchedulingOptions::Clock::time_point _deadline;
+      const int64_t _batch_id;
     };
 
   };
@@ -304,10 +452,14 @@ namespace ctranslate2 {
   template <typename Replica>
   class ReplicaWorker : public Worker {
   public:
-    ReplicaWorker(const std::shared_ptr<const models::Model>& model, size_t num_threads)
+    ReplicaWorker(const std::shared_ptr<const models::Model>& model,
+                  size_t num_threads,
+                  size_t index = 0)
       : _device(model->device())
       , _device_index(model->device_index())
+      , _numa_node(model->numa_node())
       , _num_threads(num_threads)
+      , _index(index)
       , _allocator(nullptr)
     {
       set_model(model);
@@ -339,11 +491,17 @@ namespace ctranslate2 {
     void initialize() override {
       set_device_index(_device, _device_index);
 
+      // The intra-op threads are created later by this thread and inherit the binding.
+      if (_numa_node >= 0)
+        set_thread_numa_node(_numa_node);
+
       // Set the number of computation threads for the current thread.
       set_num_threads(_num_threads);
 
       // Register the memory allocator used in this thread.
       _allocator = &get_allocator(_device);
+
+      set_trace_arg(TraceArg::Replica, _index);
     }
 
     void idle() override {
@@ -359,7 +517,9 @@ namespace ctranslate2 {
   private:
     const Device _device;
     const int _device_index;
+    const int _numa_node;
     const size_t _num_threads;
+    const size_t _index;
     Allocator* _allocator;
     std::unique_ptr<Replica> _replica;
   };
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+
+namespace ctranslate2 {
+
+  // Priority classes of the requests. Queued requests with a higher priority are run first.
+  enum class Priority {
+    Low,
+    Normal,
+    High,
+  };
+
+  // Token shared with a request to cancel it from another thread.
+  class CancellationToken {
+  public:
+    void cancel() {
+      _cancelled.store(true, std::memory_order_relaxed);
+    }
+
+    bool is_cancelled() const {
+      return _cancelled.load(std::memory_order_relaxed);
+    }
+
+  private:
+    std::atomic<bool> _cancelled{false};
+  };
+
+  // Exception set in the result of a request that was cancelled or reached its deadline.
+  class RequestCancelled : public std::runtime_error {
+  public:
+    using std::runtime_error::runtime_error;
+  };
+
+  struct SchedulingOptions {
+    using Clock = std::chrono::steady_clock;
+
+    // Queued requests are run by decreasing priority, then by earliest deadline.
+    Priority priority = Priority::Normal;
+    // Absolute deadline of the request. A request is not started after its deadline and
+    // the decoding is stopped when the deadline is reached.
+    Clock::time_point deadline = Clock::time_point::max();
+    // The decoding is stopped between two steps when the token is cancelled.
+    std::shared_ptr<const CancellationToken> cancellation_token;
+
+    bool is_cancelled() const {
+      return cancellation_token && cancellation_token->is_cancelled();
+    }
+
+    bool is_expired() const {
+      return deadline != Clock::time_point::max() && Clock::now() >= deadline;
+    }
+
+    // Throws RequestCancelled if the request should be stopped.
+    void check() const;
+
+    // Includes another request in the same job: the job is scheduled with the highest
+    // priority and the earliest deadline of its requests.
+    void merge(const SchedulingOptions& other) {
+      priority = std::max(priority, other.priority);
+      deadline = std::min(deadline, other.deadline);
+    }
+  };
+
+  // Sets the scheduling options of the request running in the current thread.
+  class SchedulingScope {
+  public:
+    SchedulingScope(const SchedulingOptions& options);
+    ~SchedulingScope();
+
+  private:
+    const SchedulingOptions* _previous;
+  };
+
+  // Throws RequestCancelled if the request running in the current thread should be stopped.
+  // This function is called between decoding steps.
+  void check_request_cancelled();
+
+}
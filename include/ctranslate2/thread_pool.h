@@ -1,15 +1,17 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <limits>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <vector>
 
+#include "scheduling.h"
+
 namespace ctranslate2 {
 
   // Base class for asynchronous jobs.
@@ -18,6 +20,16 @@ namespace ctranslate2 {
     virtual ~Job();
     virtual void run() = 0;
 
+    // Queued jobs are run by decreasing priority, then by earliest deadline, then in
+    // submission order.
+    virtual int priority() const {
+      return static_cast<int>(Priority::Normal);
+    }
+
+    virtual std::chrono::steady_clock::time_point deadline() const {
+      return std::chrono::steady_clock::time_point::max();
+    }
+
     // The job counter is used to track the number of active jobs (queued and currently processed).
     void set_job_counter(std::atomic<size_t>& counter);
 
@@ -43,10 +55,21 @@ namespace ctranslate2 {
     void close();
 
   private:
+    struct QueuedJob {
+      int priority;
+      std::chrono::steady_clock::time_point deadline;
+      size_t index;
+      std::unique_ptr<Job> job;
+
+      // Order of the heap: the job that should run first is the greatest.
+      bool operator<(const QueuedJob& other) const;
+    };
+
     bool can_get_job() const;
 
     mutable std::mutex _mutex;
-    std::queue<std::unique_ptr<Job>> _queue;
+    std::vector<QueuedJob> _queue;  // Heap.
+    size_t _num_put_jobs = 0;
     std::condition_variable _can_put_job;
     std::condition_variable _can_get_job;
     size_t _maximum_size;
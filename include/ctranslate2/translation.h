@@ -80,9 +80,13 @@ namespace ctranslate2 {
     // Replace unknown target tokens by the original source token with the highest attention.
     bool replace_unknowns = false;
 
-    // Function to call for each generated token in greedy search.
+    // Function to call for each generated token. In beam search, it is called when the tokens
+    // are common to all beams.
     // Returns true indicate the current generation is considered finished thus can be stopped early.
     std::function<bool(GenerationStepResult)> callback = nullptr;
+
+    // Priority, deadline and cancellation of the request.
+    SchedulingOptions scheduling;
   };
 
   struct TranslationResult {
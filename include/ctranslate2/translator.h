@@ -1,6 +1,7 @@
 #pragma once
 
 #include "filesystem.h"
+#include "generation_stream.h"
 #include "replica_pool.h"
 #include "models/sequence_to_sequence.h"
 
@@ -51,6 +52,15 @@ namespace ctranslate2 {
                     const size_t max_batch_size = 0,
                     const BatchType batch_type = BatchType::Examples);
 
+    // Translates a single example and returns a stream of the generated tokens. With beam
+    // search, the tokens are returned when they are common to all beams. The decoding is
+    // stopped if more than stream_capacity step results are waiting to be read.
+    std::shared_ptr<GenerationStream>
+    generate_tokens(const std::vector<std::string>& source,
+                    const std::vector<std::string>& target_prefix = {},
+                    TranslationOptions options = TranslationOptions(),
+                    const size_t stream_capacity = 256);
+
     std::vector<std::future<ScoringResult>>
     score_batch_async(const std::vector<std::vector<std::string>>& source,
                       const std::vector<std::vector<std::string>>& target,
@@ -199,9 +209,11 @@ namespace ctranslate2 {
         max_batch_size,
         read_batch_size,
         batch_type,
+        std::max(options.beam_size, options.num_hypotheses),
         [options](models::SequenceToSequenceReplica& model, const Batch& batch) {
           return run_translation(model, batch, options);
-        });
+        },
+        options.scheduling);
 
       const auto t2 = std::chrono::high_resolution_clock::now();
       stats.total_time_in_ms = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(
@@ -293,6 +305,7 @@ namespace ctranslate2 {
         max_batch_size,
         read_batch_size,
         batch_type,
+        /*beam_size=*/1,
         [options](models::SequenceToSequenceReplica& model, const Batch& batch) {
           return run_scoring(model, batch, options);
         });
@@ -306,6 +319,9 @@ namespace ctranslate2 {
   private:
     friend class BufferedTranslationWrapper;
 
+    const std::shared_ptr<RequestQueue<models::TranslationRequest>> _translation_requests
+      = std::make_shared<RequestQueue<models::TranslationRequest>>();
+
     template <typename Result,
               typename SourceTokenizer,
               typename TargetTokenizer,
@@ -320,7 +336,9 @@ namespace ctranslate2 {
                         size_t max_batch_size,
                         size_t read_batch_size,
                         BatchType batch_type,
-                        const Func& func) {
+                        size_t beam_size,
+                        const Func& func,
+                        const SchedulingOptions& scheduling = {}) {
       std::unique_ptr<BatchReader> batch_reader;
       if (target) {
         auto parallel_reader = std::make_unique<ParallelBatchReader>();
@@ -338,7 +356,9 @@ namespace ctranslate2 {
                               func,
                               max_batch_size,
                               read_batch_size,
-                              batch_type);
+                              batch_type,
+                              beam_size,
+                              scheduling);
 
       output.flush();
     }
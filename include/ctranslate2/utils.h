@@ -13,6 +13,9 @@ namespace ctranslate2 {
   void log_system_config();
   int get_gpu_count();
   void set_num_threads(size_t num_threads);
+  // Binds the current thread to the CPUs of a NUMA node. Threads created afterwards by this
+  // thread (e.g. the intra-op threads) inherit this binding.
+  void set_thread_numa_node(int node_id);
 
   bool ends_with(const std::string& str, const std::string& suffix);
   bool starts_with(const std::string& str, const std::string& prefix);
@@ -31,6 +31,7 @@ namespace ctranslate2 {
                      size_t min_length,
                      const std::optional<std::vector<std::string>>& static_prompt,
                      bool cache_static_prompt,
+                     bool cache_prompt,
                      bool include_prompt_in_result,
                      bool return_scores,
                      bool return_logits_vocab,
@@ -62,6 +63,7 @@ namespace ctranslate2 {
         options.return_logits_vocab = return_logits_vocab;
         options.return_alternatives = return_alternatives;
         options.cache_static_prompt = cache_static_prompt;
+        options.cache_prompt = cache_prompt;
         options.include_prompt_in_result = include_prompt_in_result;
         options.min_alternative_expansion_prob = min_alternative_expansion_prob;
         options.callback = std::move(callback);
@@ -134,7 +136,7 @@ namespace ctranslate2 {
                 >>> generator.generate_batch([["<s>"]], max_length=50, sampling_topk=20)
         )pbdoc")
 
-        .def(py::init<const std::string&, const std::string&, const std::variant<int, std::vector<int>>&, const StringOrMap&, size_t, size_t, long, bool, bool, py::object>(),
+        .def(py::init<const std::string&, const std::string&, const std::variant<int, std::vector<int>>&, const StringOrMap&, size_t, size_t, long, bool, bool, bool, py::object, size_t, bool>(),
              py::arg("model_path"),
              py::arg("device")="cpu",
              py::kw_only(),
@@ -145,7 +147,10 @@ namespace ctranslate2 {
              py::arg("max_queued_batches")=0,
              py::arg("flash_attention")=false,
              py::arg("tensor_parallel")=false,
+             py::arg("use_mmap")=false,
              py::arg("files")=py::none(),
+             py::arg("continuous_batch_size")=0,
+             py::arg("numa_aware")=false,
              R"pbdoc(
                  Initializes the generator.
 
@@ -163,9 +168,17 @@ namespace ctranslate2 {
                      until a free slot is available.
                    flash_attention: run model with flash attention 2 for self-attention layer
                    tensor_parallel: run model with tensor parallel mode.
+                   use_mmap: Map the model file in memory and use the weights without copy
+                     when they are already in the expected type and layout.
                    files: Load model files from the memory. This argument is a dictionary mapping
                      file names to file contents as file-like or bytes objects. If this is set,
                      :obj:`model_path` acts as an identifier for this model.
+                   continuous_batch_size: Decode the examples with continuous batching: each
+                     worker decodes up to this number of examples at the same time and admits
+                     new examples as soon as others are finished (0 to disable). When enabled,
+                     ``max_batch_size`` and ``batch_type`` are ignored by the batch methods.
+                   numa_aware: On CPU, split the workers in groups bound to the cores of each
+                     NUMA node, with a copy of the model weights in the memory of each node.
              )pbdoc")
 
         .def_property_readonly("device", &GeneratorWrapper::device,
@@ -203,6 +216,7 @@ namespace ctranslate2 {
              py::arg("min_length")=0,
              py::arg("static_prompt")=py::none(),
              py::arg("cache_static_prompt")=true,
+             py::arg("cache_prompt")=false,
              py::arg("include_prompt_in_result")=true,
              py::arg("return_scores")=false,
              py::arg("return_logits_vocab")=false,
@@ -238,7 +252,8 @@ namespace ctranslate2 {
                      :obj:`max_batch_size`, the inputs are sorted by length and split by chunks of
                      :obj:`max_batch_size` examples so that the number of padding positions is
                      minimized.
-                   batch_type: Whether :obj:`max_batch_size` is the number of "examples" or "tokens".
+                   batch_type: Whether :obj:`max_batch_size` is the number of "examples",
+                     "tokens", or "padded_tokens".
                    asynchronous: Run the generation asynchronously.
                    beam_size: Beam size (1 for greedy search).
                    patience: Beam search patience factor, as described in
@@ -261,6 +276,9 @@ namespace ctranslate2 {
                      state for this prompt to accelerate future generations.
                    cache_static_prompt: Cache the model state after the static prompt and
                      reuse it for future generations using the same static prompt.
+                   cache_prompt: Also cache the model state after the start tokens that are
+                     forwarded at once (see :obj:`include_prompt_in_result`), so that future
+                     generations can reuse the longest common prefix.
                    include_prompt_in_result: Include the :obj:`start_tokens` in the result.
                    return_scores: Include the scores in the output.
                    return_logits_vocab: Include log probs for each token in the output
@@ -270,9 +288,9 @@ namespace ctranslate2 {
                    sampling_topp: Keep the most probable tokens whose cumulative probability exceeds
                      this value.
                    sampling_temperature: Sampling temperature to generate more random samples.
-                   callback: Optional function that is called for each generated token when
-                     :obj:`beam_size` is 1. If the callback function returns ``True``, the
-                     decoding will stop for this batch index.
+                   callback: Optional function that is called for each generated token. With
+                     beam search, it is called when the tokens are common to all beams. If the
+                     callback function returns ``True``, the decoding will stop for this batch index.
 
                  Returns:
                    A list of generation results.
@@ -299,7 +317,8 @@ namespace ctranslate2 {
                      :obj:`max_batch_size`, the inputs are sorted by length and split by chunks of
                      :obj:`max_batch_size` examples so that the number of padding positions is
                      minimized.
-                   batch_type: Whether :obj:`max_batch_size` is the number of "examples" or "tokens".
+                   batch_type: Whether :obj:`max_batch_size` is the number of "examples",
+                     "tokens", or "padded_tokens".
                    max_input_length: Truncate inputs after this many tokens (0 to disable).
                    asynchronous: Run the scoring asynchronously.
 
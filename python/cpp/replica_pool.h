@@ -47,7 +47,10 @@ namespace ctranslate2 {
                         long max_queued_batches,
                         bool flash_attention,
                         bool tensor_parallel,
-                        py::object files)
+                        bool use_mmap,
+                        py::object files,
+                        size_t continuous_batch_size = 0,
+                        bool numa_aware = false)
         : _model_loader(create_model_reader(model_path, files))
         , _device(str_to_device(device))
         , _num_replicas_per_device(inter_threads)
@@ -60,9 +63,13 @@ namespace ctranslate2 {
         _model_loader.num_replicas_per_device = inter_threads;
         _model_loader.use_flash_attention = flash_attention;
         _model_loader.tensor_parallel = tensor_parallel;
+        _model_loader.use_mmap = use_mmap;
+        _model_loader.numa_aware = numa_aware;
+        _model_loader.continuous_batching = continuous_batch_size > 0;
 
         _pool_config.num_threads_per_replica = intra_threads;
         _pool_config.max_queued_batches = max_queued_batches;
+        _pool_config.continuous_batch_size = continuous_batch_size;
 
         _pool = std::make_unique<T>(_model_loader, _pool_config);
         _device_index = _model_loader.device_indices;
@@ -131,9 +138,8 @@ namespace ctranslate2 {
           _cached_models.clear();
         loaded_models.clear();
 
-        // We clear the CUDA allocator cache to further reduce the memory after unloading the model.
-        if (_device == Device::CUDA)
-          _pool->clear_cache();
+        // We clear the allocator cache to further reduce the memory after unloading the model.
+        _pool->clear_cache();
 
         _model_is_loaded = false;
       }
@@ -283,7 +283,7 @@ namespace ctranslate2 {
                 >>> translator.translate_batch([["▁Hello", "▁world", "!"]])
         )pbdoc")
 
-        .def(py::init<const std::string&, const std::string&, const std::variant<int, std::vector<int>>&, const StringOrMap&, size_t, size_t, long, bool, bool, py::object>(),
+        .def(py::init<const std::string&, const std::string&, const std::variant<int, std::vector<int>>&, const StringOrMap&, size_t, size_t, long, bool, bool, bool, py::object, size_t, bool>(),
              py::arg("model_path"),
              py::arg("device")="cpu",
              py::kw_only(),
@@ -294,7 +294,10 @@ namespace ctranslate2 {
              py::arg("max_queued_batches")=0,
              py::arg("flash_attention")=false,
              py::arg("tensor_parallel")=false,
+             py::arg("use_mmap")=false,
              py::arg("files")=py::none(),
+             py::arg("continuous_batch_size")=0,
+             py::arg("numa_aware")=false,
              R"pbdoc(
                  Initializes the translator.
 
@@ -312,9 +315,17 @@ namespace ctranslate2 {
                      until a free slot is available.
                    flash_attention: run model with flash attention 2 for self-attention layer
                    tensor_parallel: run model with tensor parallel mode
+                   use_mmap: Map the model file in memory and use the weights without copy
+                     when they are already in the expected type and layout.
                    files: Load model files from the memory. This argument is a dictionary mapping
                      file names to file contents as file-like or bytes objects. If this is set,
                      :obj:`model_path` acts as an identifier for this model.
+                   continuous_batch_size: Decode the examples with continuous batching: each
+                     worker decodes up to this number of examples at the same time and admits
+                     new examples as soon as others are finished (0 to disable). When enabled,
+                     ``max_batch_size`` and ``batch_type`` are ignored by the batch methods.
+                   numa_aware: On CPU, split the workers in groups bound to the cores of each
+                     NUMA node, with a copy of the model weights in the memory of each node.
              )pbdoc")
 
         .def_property_readonly("device", &TranslatorWrapper::device,
@@ -376,7 +387,8 @@ namespace ctranslate2 {
                      :obj:`max_batch_size`, the inputs are sorted by length and split by chunks of
                      :obj:`max_batch_size` examples so that the number of padding positions is
                      minimized.
-                   batch_type: Whether :obj:`max_batch_size` is the number of "examples" or "tokens".
+                   batch_type: Whether :obj:`max_batch_size` is the number of "examples",
+                     "tokens", or "padded_tokens".
                    asynchronous: Run the translation asynchronously.
                    beam_size: Beam size (1 for greedy search).
                    patience: Beam search patience factor, as described in
@@ -408,9 +420,9 @@ namespace ctranslate2 {
                      this value.
                    sampling_temperature: Sampling temperature to generate more random samples.
                    replace_unknowns: Replace unknown target tokens by the source token with the highest attention.
-                   callback: Optional function that is called for each generated token when
-                     :obj:`beam_size` is 1. If the callback function returns ``True``, the
-                     decoding will stop for this batch.
+                   callback: Optional function that is called for each generated token. With
+                     beam search, it is called when the tokens are common to all beams. If the
+                     callback function returns ``True``, the decoding will stop for this batch.
 
                  Returns:
                    A list of translation results.
@@ -463,7 +475,7 @@ namespace ctranslate2 {
                      by length and splitting by chunks of :obj:`max_batch_size` examples
                      (set 0 for an automatic value).
                    batch_type: Whether :obj:`max_batch_size` and :obj:`read_batch_size` are the
-                     numbers of "examples" or "tokens".
+                     numbers of "examples", "tokens", or "padded_tokens".
                    asynchronous: Run the translation asynchronously.
                    beam_size: Beam size (1 for greedy search).
                    patience: Beam search patience factor, as described in
@@ -521,7 +533,8 @@ namespace ctranslate2 {
                      :obj:`max_batch_size`, the inputs are sorted by length and split by chunks of
                      :obj:`max_batch_size` examples so that the number of padding positions is
                      minimized.
-                   batch_type: Whether :obj:`max_batch_size` is the number of "examples" or "tokens".
+                   batch_type: Whether :obj:`max_batch_size` is the number of "examples",
+                     "tokens", or "padded_tokens".
                    max_input_length: Truncate inputs after this many tokens (0 to disable).
                    offset: Ignore the first n tokens in target in score calculation.
                    asynchronous: Run the scoring asynchronously.
@@ -566,7 +579,7 @@ namespace ctranslate2 {
                      by length and splitting by chunks of :obj:`max_batch_size` examples
                      (set 0 for an automatic value).
                    batch_type: Whether :obj:`max_batch_size` and :obj:`read_batch_size` are the
-                     number of "examples" or "tokens".
+                     number of "examples", "tokens", or "padded_tokens".
                    max_input_length: Truncate inputs after this many tokens (0 to disable).
                    offset: Ignore the first n tokens in target in score calculation.
                    with_tokens_score: Include the token-level scores in the output file.
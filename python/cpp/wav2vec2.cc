@@ -29,7 +29,7 @@ namespace ctranslate2 {
                https://github.com/facebookresearch/fairseq/tree/main/examples/wav2vec
         )pbdoc")
 
-        .def(py::init<const std::string&, const std::string&, const std::variant<int, std::vector<int>>&, const StringOrMap&, size_t, size_t, long, bool, bool, py::object>(),
+        .def(py::init<const std::string&, const std::string&, const std::variant<int, std::vector<int>>&, const StringOrMap&, size_t, size_t, long, bool, bool, bool, py::object>(),
              py::arg("model_path"),
              py::arg("device")="cpu",
              py::kw_only(),
@@ -40,6 +40,7 @@ namespace ctranslate2 {
              py::arg("max_queued_batches")=0,
              py::arg("flash_attention")=false,
              py::arg("tensor_parallel")=false,
+             py::arg("use_mmap")=false,
              py::arg("files")=py::none(),
              R"pbdoc(
                  Initializes a Wav2Vec2 model from a converted model.
@@ -58,6 +59,8 @@ namespace ctranslate2 {
                      until a free slot is available.
                    flash_attention: run model with flash attention 2 for self-attention layer
                    tensor_parallel: run model with tensor parallel mode
+                   use_mmap: Map the model file in memory and use the weights without copy
+                     when they are already in the expected type and layout.
                    files: Load model files from the memory. This argument is a dictionary mapping
                      file names to file contents as file-like or bytes objects. If this is set,
                      :obj:`model_path` acts as an identifier for this model.
@@ -111,6 +111,59 @@ namespace ctranslate2 {
                                     median_filter_width);
         return wait_on_futures(std::move(futures));
       }
+
+      std::vector<models::WhisperTranscriptionResult>
+      transcribe(const std::vector<StorageView>& features,
+                 const std::optional<std::string>& language,
+                 const std::string& task,
+                 bool with_timestamps,
+                 bool condition_on_previous_text,
+                 std::vector<float> temperatures,
+                 float log_prob_threshold,
+                 float no_speech_threshold,
+                 size_t max_batch_size,
+                 size_t region_frames,
+                 size_t beam_size,
+                 float patience,
+                 float length_penalty,
+                 float repetition_penalty,
+                 size_t no_repeat_ngram_size,
+                 size_t max_length,
+                 size_t max_initial_timestamp_index,
+                 bool suppress_blank,
+                 const std::optional<std::vector<int>>& suppress_tokens) {
+        models::WhisperTranscriptionOptions options;
+        options.language = language.value_or("");
+        options.task = task;
+        options.with_timestamps = with_timestamps;
+        options.condition_on_previous_text = condition_on_previous_text;
+        options.temperatures = std::move(temperatures);
+        options.log_prob_threshold = log_prob_threshold;
+        options.no_speech_threshold = no_speech_threshold;
+        options.max_batch_size = max_batch_size;
+        options.region_frames = region_frames;
+
+        auto& decoding_options = options.decoding_options;
+        decoding_options.beam_size = beam_size;
+        decoding_options.patience = patience;
+        decoding_options.length_penalty = length_penalty;
+        decoding_options.repetition_penalty = repetition_penalty;
+        decoding_options.no_repeat_ngram_size = no_repeat_ngram_size;
+        decoding_options.max_length = max_length;
+        decoding_options.max_initial_timestamp_index = max_initial_timestamp_index;
+        decoding_options.suppress_blank = suppress_blank;
+
+        if (suppress_tokens)
+          decoding_options.suppress_tokens = suppress_tokens.value();
+        else
+          decoding_options.suppress_tokens.clear();
+
+        std::shared_lock lock(_mutex);
+        assert_model_is_ready();
+
+        auto futures = _pool->transcribe(features, std::move(options));
+        return wait_on_futures(std::move(futures));
+      }
     };
 
 
@@ -156,6 +209,51 @@ namespace ctranslate2 {
         })
         ;
 
+      py::class_<models::WhisperSegment>(m, "WhisperSegment",
+                                         "A transcribed segment of audio.")
+
+        .def_readonly("start", &models::WhisperSegment::start,
+                      "Start time of the segment in seconds.")
+        .def_readonly("end", &models::WhisperSegment::end,
+                      "End time of the segment in seconds.")
+        .def_readonly("tokens", &models::WhisperSegment::tokens,
+                      "Text tokens of the segment.")
+        .def_readonly("tokens_ids", &models::WhisperSegment::tokens_ids,
+                      "Text token IDs of the segment.")
+        .def_readonly("avg_log_prob", &models::WhisperSegment::avg_log_prob,
+                      "Average log probability of the window containing the segment.")
+        .def_readonly("no_speech_prob", &models::WhisperSegment::no_speech_prob,
+                      "Probability of the no speech token in the window containing the segment.")
+        .def_readonly("temperature", &models::WhisperSegment::temperature,
+                      "Temperature used to decode the window containing the segment.")
+
+        .def("__repr__", [](const models::WhisperSegment& segment) {
+          return "WhisperSegment(start=" + std::string(py::repr(py::cast(segment.start)))
+            + ", end=" + std::string(py::repr(py::cast(segment.end)))
+            + ", tokens=" + std::string(py::repr(py::cast(segment.tokens)))
+            + ", tokens_ids=" + std::string(py::repr(py::cast(segment.tokens_ids)))
+            + ", avg_log_prob=" + std::string(py::repr(py::cast(segment.avg_log_prob)))
+            + ", no_speech_prob=" + std::string(py::repr(py::cast(segment.no_speech_prob)))
+            + ", temperature=" + std::string(py::repr(py::cast(segment.temperature)))
+            + ")";
+        })
+        ;
+
+      py::class_<models::WhisperTranscriptionResult>(m, "WhisperTranscriptionResult",
+                                                     "A transcription result from the Whisper model.")
+
+        .def_readonly("language", &models::WhisperTranscriptionResult::language,
+                      "Language token of the audio, or an empty string for English-only models.")
+        .def_readonly("segments", &models::WhisperTranscriptionResult::segments,
+                      "List of transcribed segments.")
+
+        .def("__repr__", [](const models::WhisperTranscriptionResult& result) {
+          return "WhisperTranscriptionResult(language=" + std::string(py::repr(py::cast(result.language)))
+            + ", segments=" + std::string(py::repr(py::cast(result.segments)))
+            + ")";
+        })
+        ;
+
       py::class_<WhisperWrapper>(
         m, "Whisper",
         R"pbdoc(
@@ -174,7 +272,7 @@ namespace ctranslate2 {
         .def_property_readonly("num_languages", &WhisperWrapper::num_languages,
                                "Returns the number of languages supported.")
 
-        .def(py::init<const std::string&, const std::string&, const std::variant<int, std::vector<int>>&, const StringOrMap&, size_t, size_t, long, bool, bool, py::object>(),
+        .def(py::init<const std::string&, const std::string&, const std::variant<int, std::vector<int>>&, const StringOrMap&, size_t, size_t, long, bool, bool, bool, py::object>(),
              py::arg("model_path"),
              py::arg("device")="cpu",
              py::kw_only(),
@@ -185,6 +283,7 @@ namespace ctranslate2 {
              py::arg("max_queued_batches")=0,
              py::arg("flash_attention")=false,
              py::arg("tensor_parallel")=false,
+             py::arg("use_mmap")=false,
              py::arg("files")=py::none(),
              R"pbdoc(
                  Initializes a Whisper model from a converted model.
@@ -203,6 +302,8 @@ namespace ctranslate2 {
                      until a free slot is available.
                    flash_attention: run model with flash attention 2 for self-attention layer
                    tensor_parallel: run model with tensor parallel mode
+                   use_mmap: Map the model file in memory and use the weights without copy
+                     when they are already in the expected type and layout.
                    files: Load model files from the memory. This argument is a dictionary mapping
                      file names to file contents as file-like or bytes objects. If this is set,
                      :obj:`model_path` acts as an identifier for this model.
@@ -341,6 +442,72 @@ namespace ctranslate2 {
                    A list of alignment results.
              )pbdoc")
 
+        .def("transcribe", &WhisperWrapper::transcribe,
+             py::arg("features"),
+             py::kw_only(),
+             py::arg("language")=py::none(),
+             py::arg("task")="<|transcribe|>",
+             py::arg("with_timestamps")=true,
+             py::arg("condition_on_previous_text")=true,
+             py::arg("temperatures")=std::vector<float>{0, 0.2, 0.4, 0.6, 0.8, 1.0},
+             py::arg("log_prob_threshold")=-1,
+             py::arg("no_speech_threshold")=0.6,
+             py::arg("max_batch_size")=16,
+             py::arg("region_frames")=0,
+             py::arg("beam_size")=5,
+             py::arg("patience")=1,
+             py::arg("length_penalty")=1,
+             py::arg("repetition_penalty")=1,
+             py::arg("no_repeat_ngram_size")=0,
+             py::arg("max_length")=448,
+             py::arg("max_initial_timestamp_index")=50,
+             py::arg("suppress_blank")=true,
+             py::arg("suppress_tokens")=std::vector<int>{-1},
+             py::call_guard<py::gil_scoped_release>(),
+             R"pbdoc(
+                 Transcribes audio of any length.
+
+                 The audio is transcribed window by window as in the Whisper transcription:
+                 each window starts at the end of the last complete segment, is decoded again
+                 with a higher temperature when the average log probability is too low, and is
+                 prompted with the previous text. The windows of all audio are decoded in batches.
+
+                 Arguments:
+                   features: List of Mel spectograms, one per audio, as float arrays with shape
+                     ``[n_mels, num_frames]``.
+                   language: Language token, e.g. ``"<|en|>"``. If not set, the language is
+                     detected on the first window of each region.
+                   task: Task token.
+                   with_timestamps: Predict timestamps to split the windows in segments.
+                   condition_on_previous_text: Prompt each window with the previous text.
+                   temperatures: Temperatures used successively when the decoding fails.
+                   log_prob_threshold: Decode again with the next temperature when the average
+                     log probability of a window is below this value.
+                   no_speech_threshold: Skip a window as silence when the no speech probability
+                     is above this value and the average log probability is below
+                     :obj:`log_prob_threshold`.
+                   max_batch_size: Maximum number of windows decoded in a batch (0 for no limit).
+                   region_frames: Split each audio in independent regions of this number of
+                     frames which are transcribed in parallel (0 to disable).
+                   beam_size: Beam size (1 for greedy search).
+                   patience: Beam search patience factor, as described in
+                     https://arxiv.org/abs/2204.05424. The decoding will continue until
+                     beam_size*patience hypotheses are finished.
+                   length_penalty: Exponential penalty applied to the length during beam search.
+                   repetition_penalty: Penalty applied to the score of previously generated tokens
+                     (set > 1 to penalize).
+                   no_repeat_ngram_size: Prevent repetitions of ngrams with this size
+                     (set 0 to disable).
+                   max_length: Maximum generation length, including the prompt.
+                   max_initial_timestamp_index: Maximum index of the first predicted timestamp.
+                   suppress_blank: Suppress blank outputs at the beginning of the sampling.
+                   suppress_tokens: List of token IDs to suppress. -1 will suppress a default set
+                     of symbols as defined in the model ``config.json`` file.
+
+                 Returns:
+                   A list of transcription results, one per audio.
+             )pbdoc")
+
         .def("unload_model", &WhisperWrapper::unload_model,
              py::arg("to_cpu")=false,
              py::call_guard<py::gil_scoped_release>(),
@@ -365,6 +532,69 @@ namespace ctranslate2 {
         .def_property_readonly("model_is_loaded", &WhisperWrapper::model_is_loaded,
                                "Whether the model is loaded on the initial device and ready to be used.")
         ;
+
+      py::class_<models::WhisperFeatureStream>(
+        m, "WhisperFeatureStream",
+        R"pbdoc(
+            Computes the log-Mel features of an audio stream by windows of 30 seconds.
+
+            Example:
+
+                >>> stream = ctranslate2.models.WhisperFeatureStream(n_mels=whisper.n_mels)
+                >>> stream.push(ctranslate2.StorageView.from_array(audio_chunk))
+                >>> features = stream.next()
+        )pbdoc")
+
+        .def(py::init<size_t, dim_t>(),
+             py::arg("n_mels")=80,
+             py::arg("window_frames")=3000,
+             R"pbdoc(
+                 Initializes the feature stream.
+
+                 Arguments:
+                   n_mels: Number of Mel bands expected by the model.
+                   window_frames: Number of frames in each window.
+             )pbdoc")
+
+        .def("push",
+             [](models::WhisperFeatureStream& stream, const StorageView& samples) {
+               if (samples.device() != Device::CPU
+                   || samples.dtype() != DataType::FLOAT32
+                   || samples.rank() != 1)
+                 throw std::invalid_argument("The audio samples should be a 1D float32 array "
+                                             "on the CPU");
+               stream.push(samples.data<float>(), samples.size());
+             },
+             py::arg("samples"),
+             py::call_guard<py::gil_scoped_release>(),
+             R"pbdoc(
+                 Adds audio samples to the stream.
+
+                 Arguments:
+                   samples: 16 kHz mono audio samples as a 1D float32 array.
+             )pbdoc")
+
+        .def("finish", &models::WhisperFeatureStream::finish,
+             py::call_guard<py::gil_scoped_release>(),
+             "Marks the end of the audio. The last window is padded with silence.")
+
+        .def("next",
+             [](models::WhisperFeatureStream& stream) -> std::optional<StorageView> {
+               StorageView features;
+               if (!stream.next(features))
+                 return std::nullopt;
+               features.expand_dims(0);
+               return features;
+             },
+             py::call_guard<py::gil_scoped_release>(),
+             R"pbdoc(
+                 Returns the features of the next window with shape
+                 ``[1, n_mels, window_frames]``, or ``None`` if the window is not complete yet.
+             )pbdoc")
+
+        .def_property_readonly("num_frames", &models::WhisperFeatureStream::num_frames,
+                               "Number of frames in the audio pushed so far.")
+        ;
     }
 
   }
@@ -50,7 +50,8 @@ def translator_translate_iterable(
       source: An iterable of tokenized source examples.
       target_prefix: An optional iterable of tokenized target prefixes.
       max_batch_size: The maximum batch size.
-      batch_type: Whether :obj:`max_batch_size` is the number of "examples" or "tokens".
+      batch_type: Whether :obj:`max_batch_size` is the number of "examples",
+        "tokens", or "padded_tokens".
       **kwargs: Any translation options accepted by
         :meth:`ctranslate2.Translator.translate_batch`.
 
@@ -111,7 +112,8 @@ def translator_score_iterable(
       source: An iterable of tokenized source examples.
       target: An iterable of tokenized target examples.
       max_batch_size: The maximum batch size.
-      batch_type: Whether :obj:`max_batch_size` is the number of "examples" or "tokens".
+      batch_type: Whether :obj:`max_batch_size` is the number of "examples",
+        "tokens", or "padded_tokens".
       **kwargs: Any scoring options accepted by
         :meth:`ctranslate2.Translator.score_batch`.
 
@@ -148,7 +150,8 @@ def generator_generate_iterable(
     Arguments:
       start_tokens: An iterable of tokenized prompts.
       max_batch_size: The maximum batch size.
-      batch_type: Whether :obj:`max_batch_size` is the number of "examples" or "tokens".
+      batch_type: Whether :obj:`max_batch_size` is the number of "examples",
+        "tokens", or "padded_tokens".
       **kwargs: Any generation options accepted by
         :meth:`ctranslate2.Generator.generate_batch`.
 
@@ -185,7 +188,8 @@ def generator_score_iterable(
     Arguments:
       tokens: An iterable of tokenized examples.
       max_batch_size: The maximum batch size.
-      batch_type: Whether :obj:`max_batch_size` is the number of "examples" or "tokens".
+      batch_type: Whether :obj:`max_batch_size` is the number of "examples",
+        "tokens", or "padded_tokens".
       **kwargs: Any score options accepted by
         :meth:`ctranslate2.Generator.score_batch`.
 
@@ -286,6 +290,7 @@ def generator_generate_tokens(
     end_token: Optional[Union[str, List[str], List[int]]] = None,
     static_prompt: Optional[List[str]] = None,
     cache_static_prompt: bool = True,
+    cache_prompt: bool = False,
     callback: Callable[[GenerationStepResult], bool] = None,
 ) -> Iterable[GenerationStepResult]:
     """Yields tokens as they are generated by the model.
@@ -294,7 +299,8 @@ def generator_generate_tokens(
       prompt: Batch of start tokens. If the decoder starts from a
         special start token like <s>, this token should be added to this input.
       max_batch_size: The maximum batch size.
-      batch_type: Whether :obj:`max_batch_size` is the number of "examples" or "tokens".
+      batch_type: Whether :obj:`max_batch_size` is the number of "examples",
+        "tokens", or "padded_tokens".
       max_length: Maximum generation length.
       min_length: Minimum generation length.
       sampling_topk: Randomly sample predictions from the top K candidates.
@@ -313,6 +319,8 @@ def generator_generate_tokens(
         state for this prompt to accelerate future generations.
       cache_static_prompt: Cache the model state after the static prompt and
         reuse it for future generations using the same static prompt.
+      cache_prompt: Also cache the model state after the prompt, so that future
+        generations can reuse the longest common prefix.
       callback: Optional function that is called for each generated token when
         obj:`beam_size` is 1. If the callback function returns ``True``, the
         decoding will stop for this batch index.
@@ -343,6 +351,7 @@ def generator_generate_tokens(
         return_scores=return_log_prob,
         static_prompt=static_prompt,
         cache_static_prompt=cache_static_prompt,
+        cache_prompt=cache_prompt,
         include_prompt_in_result=False,
         callback=callback,
     )
@@ -367,6 +376,7 @@ async def generator_async_generate_tokens(
     end_token: Optional[Union[str, List[str], List[int]]] = None,
     static_prompt: Optional[List[str]] = None,
     cache_static_prompt: bool = True,
+    cache_prompt: bool = False,
     callback: Callable[[GenerationStepResult], bool] = None,
 ) -> AsyncIterable[GenerationStepResult]:
     """Yields tokens asynchronously as they are generated by the model.
@@ -375,7 +385,8 @@ async def generator_async_generate_tokens(
       prompt: Batch of start tokens. If the decoder starts from a
         special start token like <s>, this token should be added to this input.
       max_batch_size: The maximum batch size.
-      batch_type: Whether :obj:`max_batch_size` is the number of "examples" or "tokens".
+      batch_type: Whether :obj:`max_batch_size` is the number of "examples",
+        "tokens", or "padded_tokens".
       max_length: Maximum generation length.
       min_length: Minimum generation length.
       sampling_topk: Randomly sample predictions from the top K candidates.
@@ -394,6 +405,8 @@ async def generator_async_generate_tokens(
         state for this prompt to accelerate future generations.
       cache_static_prompt: Cache the model state after the static prompt and
         reuse it for future generations using the same static prompt.
+      cache_prompt: Also cache the model state after the prompt, so that future
+        generations can reuse the longest common prefix.
       callback: Optional function that is called for each generated token when
         obj:`beam_size` is 1. If the callback function returns ``True``, the
         decoding will stop for this batch index.
@@ -424,6 +437,7 @@ async def generator_async_generate_tokens(
         return_scores=return_log_prob,
         static_prompt=static_prompt,
         cache_static_prompt=cache_static_prompt,
+        cache_prompt=cache_prompt,
         include_prompt_in_result=False,
         callback=callback,
     ):
@@ -571,7 +585,7 @@ def _batch_iterator(iterable, batch_size, batch_type):
 
         if batch_type == "examples":
             cur_batch_size += 1
-        elif batch_type == "tokens":
+        elif batch_type in ("tokens", "padded_tokens"):
             cur_batch_size += len(example[0])
         else:
             raise ValueError("Invalid batch type %s" % batch_type)
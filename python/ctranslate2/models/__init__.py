@@ -7,8 +7,11 @@ try:
         Wav2Vec2,
         Wav2Vec2Bert,
         Whisper,
+        WhisperFeatureStream,
         WhisperGenerationResult,
         WhisperGenerationResultAsync,
+        WhisperSegment,
+        WhisperTranscriptionResult,
     )
 except ImportError as e:
     # Allow using the Python package without the compiled extension.
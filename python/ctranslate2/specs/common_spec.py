@@ -30,6 +30,7 @@ class Quantization(enum.IntEnum):
     CT2 = 0
     AWQ_GEMM = 1
     AWQ_GEMV = 2
+    INT4 = 3
 
 
 class LayerNormSpec(model_spec.LayerSpec):
@@ -24,6 +24,9 @@ except ImportError:
 OPTIONAL = "__optional"
 CURRENT_BINARY_VERSION = 6
 
+# Alignment in bytes of the variable data in model.bin.
+_VARIABLE_ALIGNMENT = 64
+
 ACCEPTED_MODEL_TYPES = (
     "int8",
     "int8_float32",
@@ -33,8 +36,12 @@ ACCEPTED_MODEL_TYPES = (
     "float16",
     "bfloat16",
     "float32",
+    "int4",
 )
 
+# Number of 4-bit weights sharing the same scale and zero point with the int4 quantization.
+INT4_GROUP_SIZE = 128
+
 SKIP_CREATING_ALIAS = ("rotary_scaling_long_factor", "rotary_scaling_short_factor")
 
 
@@ -244,13 +251,25 @@ class LayerSpec(FrozenAttr, metaclass=FrozenMeta):
                     value = NumpyVariable(value)
                 elif quantization in ("float16", "bfloat16", "float32"):
                     value = value.to(quantization)
+                elif quantization == "int4":
+                    if (
+                        hasattr(spec, "%s_zero" % key)
+                        and is_convertible
+                        and len(value.shape) == 2
+                        and value.shape[1] % 32 == 0
+                    ):
+                        value, scale, zero = _quantize_int4(value.to("float32").numpy())
+                        setattr(spec, "%s_zero" % key, zero)
+                    else:
+                        # Other weights are kept in full precision.
+                        value = value.to("float32")
 
             elif is_convertible:
                 if quantization in ("float16", "int8_float16"):
                     value = value.to("float16")
                 elif quantization in ("bfloat16", "int8_bfloat16"):
                     value = value.to("bfloat16")
-                elif quantization in ("float32", "int16", "int8_float32"):
+                elif quantization in ("float32", "int16", "int8_float32", "int4"):
                     value = value.to("float32")
 
             setattr(spec, key, value)
@@ -267,7 +286,7 @@ class LayerSpec(FrozenAttr, metaclass=FrozenMeta):
 
         Arguments:
           quantization: Weight quantization scheme (possible values are: int8, int8_float32,
-            int8_float16, int8_bfloat16, int16, float16, bfloat16, float32).
+            int8_float16, int8_bfloat16, int16, float16, bfloat16, float32, int4).
         """
         self._alias_variables()
         self._quantize(quantization)
@@ -277,6 +296,36 @@ class LayerSpec(FrozenAttr, metaclass=FrozenMeta):
         visit_spec(self, fn)
 
 
+def _quantize_int4(value):
+    """Quantizes a 2D weight to 4-bit integers with a scale and zero point per group.
+
+    The input dimension should be a multiple of 32.
+    """
+    depth = value.shape[1]
+    group_size = next(size for size in (INT4_GROUP_SIZE, 64, 32) if depth % size == 0)
+    groups = value.reshape(value.shape[0], -1, group_size)
+    minimum = np.minimum(np.amin(groups, axis=2), 0)
+    maximum = np.maximum(np.amax(groups, axis=2), 0)
+    scale = (maximum - minimum) / 15
+    scale[scale == 0] = 1
+    zero = np.rint(-minimum / scale)
+
+    groups = np.rint(groups / np.expand_dims(scale, 2) + np.expand_dims(zero, 2))
+    groups = np.clip(groups, 0, 15).astype(np.uint8)
+
+    # Pack the values by blocks of 32: the byte i of a block contains the value i
+    # in the low bits and the value i + 16 in the high bits.
+    blocks = groups.reshape(value.shape[0], -1, 2, 16)
+    packed = blocks[:, :, 0] | (blocks[:, :, 1] << 4)
+    packed = packed.reshape(value.shape[0], depth // 2).view(np.int8)
+
+    return (
+        NumpyVariable(packed),
+        NumpyVariable(scale.astype(np.float32)),
+        NumpyVariable(zero.astype(np.float32)),
+    )
+
+
 def _dtype_to_type_id(object_dtype):
     # Order should match the DataType enum in include/ctranslate2/types.h
     dtypes = ("float32", "int8", "int16", "int32", "float16", "bfloat16")
@@ -351,6 +400,24 @@ class ModelSpec(LayerSpec):
         """Returns the default configuration used by this model."""
         return None
 
+    def optimize(self, quantization: Optional[str] = None) -> None:
+        if quantization == "int4":
+            if self._config is None or hasattr(self._config, "quantization_type"):
+                raise ValueError(
+                    "The int4 quantization can only be applied to non quantized "
+                    "models with a configuration"
+                )
+
+        super().optimize(quantization)
+
+        if quantization == "int4":
+            from ctranslate2.specs import common_spec
+
+            self._config.add_attribute(
+                "quantization_type", common_spec.Quantization.INT4
+            )
+            self._config.add_attribute("quantization_bits", 4)
+
     def register_file(self, path: str, filename: Optional[str] = None) -> None:
         """Registers a file to be saved in the model directory."""
         if not os.path.isfile(path):
@@ -391,17 +458,22 @@ class ModelSpec(LayerSpec):
 
         with open(path, "wb") as model:
 
-            def _write_string(string):
-                model.write(struct.pack("H", len(string) + 1))
+            def _write_string(string, padding=0):
+                model.write(struct.pack("H", len(string) + 1 + padding))
                 model.write(string.encode("utf-8"))
-                model.write(struct.pack("B", 0))
+                model.write(struct.pack("B", 0) * (1 + padding))
 
             model.write(struct.pack("I", CURRENT_BINARY_VERSION))
             _write_string(self.name)
             model.write(struct.pack("I", self.revision))
             model.write(struct.pack("I", len(variables)))
             for name, value in variables:
-                _write_string(name)
+                # Pad the variable name with null characters so that the variable data
+                # is aligned in the file and can be used directly when the file is mapped
+                # in memory. The loader reads the name until the first null character.
+                header_size = 2 + len(name) + 1 + 1 + 4 * len(value.shape) + 1 + 4
+                padding = -(model.tell() + header_size) % _VARIABLE_ALIGNMENT
+                _write_string(name, padding)
                 model.write(struct.pack("B", len(value.shape)))
                 for dim in value.shape:
                     model.write(struct.pack("I", dim))
@@ -911,6 +911,57 @@ class TestWhisper:
             "ask what you can do for your country."
         )
 
+    @test_utils.only_on_linux
+    @test_utils.on_available_devices
+    def test_transformers_whisper_transcribe(self, tmp_dir, device):
+        import transformers
+
+        model_name = "openai/whisper-tiny.en"
+        converter = ctranslate2.converters.TransformersConverter(model_name)
+        output_dir = str(tmp_dir.join("ctranslate2_model"))
+        output_dir = converter.convert(output_dir)
+
+        processor = transformers.WhisperProcessor.from_pretrained(model_name)
+
+        features = []
+        for name in ("mr_quilter", "jfk"):
+            audio_path = os.path.join(test_utils.get_data_dir(), "audio", name + ".npy")
+            audio = np.load(audio_path)
+            inputs = processor(audio, padding=False, sampling_rate=16000)
+            features.append(
+                ctranslate2.StorageView.from_array(inputs.input_features[0])
+            )
+
+        model = ctranslate2.models.Whisper(output_dir, device=device)
+        results = model.transcribe(features, beam_size=1)
+
+        assert len(results) == 2
+        assert results[1].language == ""
+
+        for result, audio_features in zip(results, features):
+            assert result.segments
+            duration = audio_features.shape[1] * 0.01
+            previous_end = 0
+            for segment in result.segments:
+                assert previous_end <= segment.start <= segment.end <= duration + 0.02
+                previous_end = segment.end
+
+            # The transcription should not depend on the other audios in the batch.
+            single_result = model.transcribe([audio_features], beam_size=1)[0]
+            assert [segment.tokens_ids for segment in result.segments] == [
+                segment.tokens_ids for segment in single_result.segments
+            ]
+
+        tokens_ids = [
+            token_id
+            for segment in results[1].segments
+            for token_id in segment.tokens_ids
+        ]
+        assert processor.decode(tokens_ids) == (
+            " And so my fellow Americans ask not what your country can do for you, "
+            "ask what you can do for your country."
+        )
+
     @test_utils.only_on_linux
     def test_transformers_whisper_partial_audio_context(self, tmp_dir):
         import transformers
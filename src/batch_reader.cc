@@ -12,6 +12,8 @@ namespace ctranslate2 {
       return BatchType::Examples;
     else if (batch_type == "tokens")
       return BatchType::Tokens;
+    else if (batch_type == "padded_tokens")
+      return BatchType::PaddedTokens;
     throw std::invalid_argument("Invalid batch type: " + batch_type);
   }
 
@@ -25,6 +27,50 @@ namespace ctranslate2 {
     };
   }
 
+  // Maximum ratio of padding positions in a batch of type BatchType::PaddedTokens.
+  constexpr float max_padding_ratio = 0.3;
+
+  // Tracks the cost of a batch when the examples are padded to the longest example.
+  class PaddedBatchCost {
+  public:
+    PaddedBatchCost(const size_t beam_size)
+      : _beam_size(std::max(beam_size, size_t(1)))
+    {
+    }
+
+    // Returns true if the example can be added without exceeding the budget or the
+    // maximum padding ratio.
+    bool can_add(const Example& example, const size_t max_batch_size) const {
+      const size_t length = get_length(example);
+      const size_t num_examples = _num_examples + 1;
+      const size_t max_length = std::max(_max_length, length);
+      const size_t num_positions = num_examples * max_length;
+      const size_t num_tokens = _num_tokens + length;
+
+      if (num_positions * _beam_size > max_batch_size)
+        return false;
+      return (num_positions - num_tokens) <= max_padding_ratio * num_positions;
+    }
+
+    void add(const Example& example) {
+      const size_t length = get_length(example);
+      _num_examples += 1;
+      _max_length = std::max(_max_length, length);
+      _num_tokens += length;
+    }
+
+  private:
+    static size_t get_length(const Example& example) {
+      // Empty examples still take one position, e.g. for the start token.
+      return std::max(example.length(), size_t(1));
+    }
+
+    const size_t _beam_size;
+    size_t _num_examples = 0;
+    size_t _max_length = 0;
+    size_t _num_tokens = 0;
+  };
+
   std::vector<std::vector<std::string>> Batch::get_stream(size_t index) const {
     std::vector<std::vector<std::string>> stream;
     if (examples.empty() || index >= examples.front().num_streams())
@@ -37,7 +83,8 @@ namespace ctranslate2 {
 
   std::vector<Example>
   BatchReader::get_next(const size_t max_batch_size,
-                        const BatchType batch_type) {
+                        const BatchType batch_type,
+                        const size_t beam_size) {
     if (max_batch_size == 0)
       throw std::invalid_argument("BatchReader: max_batch_size must be > 0");
 
@@ -52,6 +99,20 @@ namespace ctranslate2 {
 
     batch.reserve(max_batch_size);
 
+    if (batch_type == BatchType::PaddedTokens) {
+      PaddedBatchCost cost(beam_size);
+
+      while (!_next.empty()) {
+        if (!batch.empty() && !cost.can_add(_next, max_batch_size))
+          break;
+        cost.add(_next);
+        batch.emplace_back(std::move(_next));
+        _next = get_next_example();
+      }
+
+      return batch;
+    }
+
     size_t batch_size = 0;
 
     while (!_next.empty()) {
@@ -138,7 +199,8 @@ namespace ctranslate2 {
   std::vector<Batch>
   rebatch_input(const std::vector<Example>& examples,
                 size_t max_batch_size,
-                BatchType batch_type) {
+                BatchType batch_type,
+                size_t beam_size) {
     if (examples.empty())
       return {};
 
@@ -170,7 +232,7 @@ namespace ctranslate2 {
     VectorReader batch_reader(index_vector(examples, example_index));
 
     for (size_t offset = 0;;) {
-      auto examples_part = batch_reader.get_next(max_batch_size, batch_type);
+      auto examples_part = batch_reader.get_next(max_batch_size, batch_type, beam_size);
       if (examples_part.empty())
         break;
 
@@ -99,10 +99,12 @@ namespace ctranslate2 {
           examples,
           _max_batch_size,
           BatchType::Examples,
+          std::max(_options.beam_size, _options.num_hypotheses),
           std::move(promises),
           [this](models::SequenceToSequenceReplica& model, const Batch& batch) {
             return run_translation(model, batch, _options);
-          });
+          },
+          _options.scheduling);
       }
 
       if (stop)
@@ -6,10 +6,18 @@
 #  include <cstdlib>
 #endif
 
+#include <vector>
+
 #ifdef CT2_WITH_MKL
 #  include <mkl.h>
 #endif
 
+#include <spdlog/spdlog.h>
+
+#include "ctranslate2/utils.h"
+#include "cpu/caching_allocator.h"
+#include "env.h"
+
 namespace ctranslate2 {
   namespace cpu {
 
@@ -73,16 +81,71 @@ namespace ctranslate2 {
     };
 #endif
 
+    static Allocator& get_default_allocator(size_t alignment) {
+#ifdef CT2_WITH_MKL
+      static MklAllocator allocator(alignment);
+#else
+      static AlignedAllocator allocator(alignment);
+#endif
+      return allocator;
+    }
+
+    static Allocator& get_caching_allocator(size_t alignment) {
+      unsigned int bin_growth = 2;
+      unsigned int min_bin = 6;
+      unsigned int max_bin = 26;
+      size_t max_cached_bytes = 200 * (1 << 20);  // 200MB per thread
+      size_t max_total_cached_bytes = size_t(1) << 30;  // 1GB for all threads
+
+      const std::string config = read_string_from_env("CT2_CPU_CACHING_ALLOCATOR_CONFIG");
+      if (!config.empty()) {
+        const std::vector<std::string> values = split_string(config, ',');
+        if (values.size() != 4 && values.size() != 5)
+          throw std::invalid_argument("CT2_CPU_CACHING_ALLOCATOR_CONFIG environment variable "
+                                      "should have format: "
+                                      "bin_growth,min_bin,max_bin,max_cached_bytes"
+                                      "[,max_total_cached_bytes]");
+        bin_growth = std::stoul(values[0]);
+        min_bin = std::stoul(values[1]);
+        max_bin = std::stoul(values[2]);
+        max_cached_bytes = std::stoull(values[3]);
+        if (values.size() == 5)
+          max_total_cached_bytes = std::stoull(values[4]);
+      }
+
+      // The caching allocator is never destroyed so that memory can still be released
+      // by objects destroyed on program exit.
+      static auto* allocator = new CachingAllocator(get_default_allocator(alignment),
+                                                    alignment,
+                                                    bin_growth,
+                                                    min_bin,
+                                                    max_bin,
+                                                    max_cached_bytes,
+                                                    max_total_cached_bytes);
+      return *allocator;
+    }
+
+    static Allocator& resolve_cpu_allocator(size_t alignment) {
+      const auto allocator_name = read_string_from_env("CT2_CPU_ALLOCATOR", "default");
+
+      Allocator* allocator = nullptr;
+      if (allocator_name == "default")
+        allocator = &get_default_allocator(alignment);
+      else if (allocator_name == "caching")
+        allocator = &get_caching_allocator(alignment);
+      else
+        throw std::invalid_argument("Invalid CPU allocator " + allocator_name);
+
+      spdlog::info("Using CPU allocator: {}", allocator_name);
+      return *allocator;
+    }
+
   }
 
   template<>
   Allocator& get_allocator<Device::CPU>() {
     constexpr size_t alignment = 64;
-#ifdef CT2_WITH_MKL
-    static cpu::MklAllocator allocator(alignment);
-#else
-    static cpu::AlignedAllocator allocator(alignment);
-#endif
+    static Allocator& allocator = cpu::resolve_cpu_allocator(alignment);
     return allocator;
   }
 
@@ -1,7 +1,13 @@
 #include "backend.h"
 
+#if defined(CT2_WITH_BUILTIN_GEMM) && defined(__linux__)
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif
+
 #include "ctranslate2/utils.h"
 #include "cpu_info.h"
+#include "cpu_isa.h"
 #include "env.h"
 
 namespace ctranslate2 {
@@ -30,6 +36,60 @@ namespace ctranslate2 {
       return mayiuse;
     }
 
+#ifdef CT2_WITH_BUILTIN_GEMM
+    static bool mayiuse_builtin_gemm_init() {
+      if (!read_bool_from_env("CT2_USE_BUILTIN_GEMM", true))
+        return false;
+      // Respect CT2_FORCE_CPU_ISA when it selects an older instruction set.
+      if (!read_string_from_env("CT2_FORCE_CPU_ISA").empty() && get_cpu_isa() != CpuIsa::AVX512)
+        return false;
+      return cpu_supports_avx512_vnni();
+    }
+
+    static bool mayiuse_amx_init() {
+      if (!mayiuse_builtin_gemm() || !cpu_supports_amx() || !read_bool_from_env("CT2_USE_AMX", true))
+        return false;
+
+#ifdef __linux__
+      // Linux requires the process to request the permission to use the AMX tile data.
+      constexpr long arch_req_xcomp_perm = 0x1023;
+      constexpr long xfeature_xtiledata = 18;
+      return syscall(SYS_arch_prctl, arch_req_xcomp_perm, xfeature_xtiledata) == 0;
+#else
+      return false;
+#endif
+    }
+#endif
+
+    bool mayiuse_builtin_gemm() {
+#ifdef CT2_WITH_BUILTIN_GEMM
+      static const bool mayiuse = mayiuse_builtin_gemm_init();
+      return mayiuse;
+#else
+      return false;
+#endif
+    }
+
+    bool mayiuse_amx() {
+#ifdef CT2_WITH_BUILTIN_GEMM
+      static const bool mayiuse = mayiuse_amx_init();
+      return mayiuse;
+#else
+      return false;
+#endif
+    }
+
+    bool use_bf16_gemm() {
+#ifdef CT2_WITH_BUILTIN_GEMM
+      static const bool use_bf16 = (read_bool_from_env("CT2_USE_BF16_GEMM")
+                                    && mayiuse_builtin_gemm()
+                                    && cpu_supports_avx512_bf16());
+      return use_bf16;
+#else
+      return false;
+#endif
+    }
+
     std::string gemm_backend_to_str(GemmBackend gemm_backend) {
       switch (gemm_backend) {
       case GemmBackend::MKL:
@@ -42,6 +102,8 @@ namespace ctranslate2 {
         return "OpenBLAS";
       case GemmBackend::RUY:
         return "Ruy";
+      case GemmBackend::BUILTIN:
+        return "built-in";
       default:
         return "none";
       }
@@ -62,6 +124,10 @@ namespace ctranslate2 {
       }
 #endif
 
+      if (is_int8 && mayiuse_builtin_gemm()) {
+        return GemmBackend::BUILTIN;
+      }
+
 #ifdef CT2_WITH_DNNL
       if (compute_type == ComputeType::FLOAT32 || is_int8) {
         return GemmBackend::DNNL;
@@ -95,12 +161,20 @@ namespace ctranslate2 {
 
     bool prefer_u8s8s32_gemm() {
       const auto gemm_s8_backend = get_gemm_backend(ComputeType::INT8);
-      return gemm_s8_backend == cpu::GemmBackend::MKL || gemm_s8_backend == cpu::GemmBackend::DNNL;
+      return (gemm_s8_backend == cpu::GemmBackend::MKL
+              || gemm_s8_backend == cpu::GemmBackend::DNNL
+              || gemm_s8_backend == cpu::GemmBackend::BUILTIN);
     }
 
     bool pack_gemm_weights(ComputeType compute_type) {
+      // The built-in kernels always run on packed weights.
+      const GemmBackend backend = get_gemm_backend(compute_type);
+      if (backend == GemmBackend::BUILTIN
+          || (compute_type == ComputeType::FLOAT32 && use_bf16_gemm()))
+        return true;
+
       static const bool should_pack = read_bool_from_env("CT2_USE_EXPERIMENTAL_PACKED_GEMM");
-      return should_pack && get_gemm_backend(compute_type) == GemmBackend::MKL;
+      return should_pack && backend == GemmBackend::MKL;
     }
 
 #ifdef CT2_WITH_RUY
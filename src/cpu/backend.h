@@ -18,6 +18,7 @@ namespace ctranslate2 {
       ACCELERATE,
       OPENBLAS,
       RUY,
+      BUILTIN,
     };
 
     std::string gemm_backend_to_str(GemmBackend gemm_backend);
@@ -26,6 +27,10 @@ namespace ctranslate2 {
     bool has_gemm_backend(ComputeType compute_type);
     bool prefer_u8s8s32_gemm();
     bool pack_gemm_weights(ComputeType compute_type);
+    // Built-in GEMM kernels, see builtin_gemm.h.
+    bool mayiuse_builtin_gemm();
+    bool mayiuse_amx();
+    bool use_bf16_gemm();
 #ifdef CT2_WITH_RUY
     ruy::Context *get_ruy_context();
 #endif
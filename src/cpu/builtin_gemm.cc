@@ -0,0 +1,441 @@
+#include "builtin_gemm.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <immintrin.h>
+
+#include "parallel.h"
+
+namespace ctranslate2 {
+  namespace cpu {
+
+    // Number of columns in a block of the packed B matrix.
+    constexpr dim_t block_n = 16;
+    // Number of bytes in a row of a packed block, which is also the row size of the AMX tiles.
+    constexpr dim_t row_bytes = 64;
+    // Number of rows in the AMX tiles.
+    constexpr dim_t tile_rows = 16;
+
+    // Register blocking of the AVX512 kernels: rows of A x blocks of B.
+    constexpr dim_t vnni_mr = 4;
+    constexpr dim_t vnni_nr = 4;
+
+    static inline dim_t round_up(dim_t x, dim_t multiple) {
+      return ceil_divide(x, multiple) * multiple;
+    }
+
+    static inline __mmask16 column_mask(dim_t count) {
+      return count >= block_n ? __mmask16(0xFFFF) : __mmask16((1u << count) - 1);
+    }
+
+    static inline uint16_t float_to_bf16(float x) {
+      if (std::isnan(x))
+        return 0x7FC0;
+      uint32_t bits;
+      std::memcpy(&bits, &x, sizeof (bits));
+      bits += 0x7FFF + ((bits >> 16) & 1);  // Round to nearest even.
+      return bits >> 16;
+    }
+
+    template <typename Traits>
+    struct GemmArgs {
+      dim_t m;
+      dim_t n;
+      dim_t k;
+      dim_t kpad;
+      float alpha;
+      float beta;
+      const typename Traits::AType* a;  // Padded copy with kpad columns.
+      const typename Traits::BType* b;  // Packed.
+      typename Traits::CType* c;
+      dim_t ldc;
+      const int32_t* compensation;
+    };
+
+    struct S8Traits {
+      using AType = uint8_t;
+      using BType = int8_t;
+      using CType = int32_t;
+      using Acc = __m512i;
+
+      static constexpr dim_t k_group = 4;
+      static constexpr dim_t tile_k = 64;
+
+      static Acc zero() {
+        return _mm512_setzero_si512();
+      }
+
+      static Acc dot(Acc acc, __m512i a, __m512i b) {
+        return _mm512_dpbusd_epi32(acc, a, b);
+      }
+
+      static Acc load(const CType* x) {
+        return _mm512_load_si512(x);
+      }
+
+      static void store(const GemmArgs<S8Traits>& args, Acc acc, dim_t row, dim_t col) {
+        const __mmask16 mask = column_mask(args.n - col);
+        int32_t* c = args.c + row * args.ldc + col;
+
+        if (args.alpha != 1 || args.beta != 0) {
+          __m512 y = _mm512_mul_ps(_mm512_cvtepi32_ps(acc), _mm512_set1_ps(args.alpha));
+          if (args.beta != 0)
+            y = _mm512_fmadd_ps(_mm512_cvtepi32_ps(_mm512_maskz_loadu_epi32(mask, c)),
+                                _mm512_set1_ps(args.beta),
+                                y);
+          acc = _mm512_cvtps_epi32(y);
+        }
+
+        if (args.compensation)
+          acc = _mm512_add_epi32(acc, _mm512_maskz_loadu_epi32(mask, args.compensation + col));
+
+        _mm512_mask_storeu_epi32(c, mask, acc);
+      }
+    };
+
+    struct BF16Traits {
+      using AType = uint16_t;
+      using BType = uint16_t;
+      using CType = float;
+      using Acc = __m512;
+
+      static constexpr dim_t k_group = 2;
+      static constexpr dim_t tile_k = 32;
+
+      static Acc zero() {
+        return _mm512_setzero_ps();
+      }
+
+      static Acc dot(Acc acc, __m512i a, __m512i b) {
+        return _mm512_dpbf16_ps(acc, (__m512bh)a, (__m512bh)b);
+      }
+
+      static Acc load(const CType* x) {
+        return _mm512_load_ps(x);
+      }
+
+      static void store(const GemmArgs<BF16Traits>& args, Acc acc, dim_t row, dim_t col) {
+        const __mmask16 mask = column_mask(args.n - col);
+        float* c = args.c + row * args.ldc + col;
+
+        if (args.beta != 0)
+          acc = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, c), _mm512_set1_ps(args.beta), acc);
+
+        _mm512_mask_storeu_ps(c, mask, acc);
+      }
+    };
+
+    template <typename Traits>
+    static dim_t packed_k(dim_t k) {
+      return round_up(k, Traits::tile_k);
+    }
+
+    template <typename Traits>
+    static dim_t packed_n(dim_t n) {
+      // The AMX kernel reads pairs of blocks.
+      return round_up(n, 2 * block_n);
+    }
+
+    template <typename Traits, typename T, typename Function>
+    static void pack_b(const T* b,
+                       bool transpose_b,
+                       dim_t k,
+                       dim_t n,
+                       typename Traits::BType* packed_b,
+                       const Function& convert) {
+      const dim_t kpad = packed_k<Traits>(k);
+      const dim_t num_blocks = packed_n<Traits>(n) / block_n;
+
+      parallel_for(0, num_blocks, 1, [&](dim_t begin, dim_t end) {
+        for (dim_t block = begin; block < end; ++block) {
+          auto* dst = packed_b + block * kpad * block_n;
+
+          for (dim_t kk = 0; kk < kpad; kk += Traits::k_group) {
+            for (dim_t j = 0; j < block_n; ++j) {
+              for (dim_t r = 0; r < Traits::k_group; ++r) {
+                const dim_t row = kk + r;
+                const dim_t col = block * block_n + j;
+
+                if (row < k && col < n)
+                  *dst++ = convert(transpose_b ? b[col * k + row] : b[row * n + col]);
+                else
+                  *dst++ = 0;
+              }
+            }
+          }
+        }
+      });
+    }
+
+    // Computes a tile of vnni_mr x vnni_nr blocks with AVX512 dot product instructions.
+    template <typename Traits, dim_t MR, dim_t NR>
+    static void vnni_tile(const GemmArgs<Traits>& args, dim_t i0, dim_t b0) {
+      typename Traits::Acc acc[MR][NR];
+      for (dim_t i = 0; i < MR; ++i) {
+        for (dim_t j = 0; j < NR; ++j)
+          acc[i][j] = Traits::zero();
+      }
+
+      const dim_t block_size = args.kpad * block_n;
+      const auto* a = args.a + i0 * args.kpad;
+      const auto* b = args.b + b0 * block_size;
+      const dim_t k_end = round_up(args.k, Traits::k_group);
+
+      for (dim_t kk = 0; kk < k_end; kk += Traits::k_group) {
+        __m512i b_group[NR];
+        for (dim_t j = 0; j < NR; ++j)
+          b_group[j] = _mm512_loadu_si512(b + j * block_size + kk * block_n);
+
+        for (dim_t i = 0; i < MR; ++i) {
+          int32_t a_group;
+          std::memcpy(&a_group, a + i * args.kpad + kk, sizeof (a_group));
+          const __m512i a_broadcast = _mm512_set1_epi32(a_group);
+
+          for (dim_t j = 0; j < NR; ++j)
+            acc[i][j] = Traits::dot(acc[i][j], a_broadcast, b_group[j]);
+        }
+      }
+
+      for (dim_t i = 0; i < MR; ++i) {
+        for (dim_t j = 0; j < NR; ++j)
+          Traits::store(args, acc[i][j], i0 + i, (b0 + j) * block_n);
+      }
+    }
+
+    template <typename Traits>
+    static void run_vnni(const GemmArgs<Traits>& args) {
+      using Kernel = void (*)(const GemmArgs<Traits>&, dim_t, dim_t);
+      static constexpr Kernel kernels[vnni_mr][vnni_nr] = {
+        {vnni_tile<Traits, 1, 1>, vnni_tile<Traits, 1, 2>, vnni_tile<Traits, 1, 3>, vnni_tile<Traits, 1, 4>},
+        {vnni_tile<Traits, 2, 1>, vnni_tile<Traits, 2, 2>, vnni_tile<Traits, 2, 3>, vnni_tile<Traits, 2, 4>},
+        {vnni_tile<Traits, 3, 1>, vnni_tile<Traits, 3, 2>, vnni_tile<Traits, 3, 3>, vnni_tile<Traits, 3, 4>},
+        {vnni_tile<Traits, 4, 1>, vnni_tile<Traits, 4, 2>, vnni_tile<Traits, 4, 3>, vnni_tile<Traits, 4, 4>},
+      };
+
+      const dim_t num_blocks = ceil_divide(args.n, block_n);
+      const dim_t row_tiles = ceil_divide(args.m, vnni_mr);
+      const dim_t col_tiles = ceil_divide(num_blocks, vnni_nr);
+
+      parallel_for(0, row_tiles * col_tiles, 1, [&](dim_t begin, dim_t end) {
+        for (dim_t t = begin; t < end; ++t) {
+          const dim_t i0 = (t / col_tiles) * vnni_mr;
+          const dim_t b0 = (t % col_tiles) * vnni_nr;
+          const dim_t rows = std::min(vnni_mr, args.m - i0);
+          const dim_t blocks = std::min(vnni_nr, num_blocks - b0);
+          kernels[rows - 1][blocks - 1](args, i0, b0);
+        }
+      });
+    }
+
+    struct TileConfig {
+      uint8_t palette_id;
+      uint8_t start_row;
+      uint8_t reserved[14];
+      uint16_t colsb[16];
+      uint8_t rows[16];
+    };
+
+    // The AMX kernels use 4 accumulator tiles (0-3), 2 tiles for A (4-5) and 2 tiles for B (6-7),
+    // all with 16 rows of 64 bytes.
+    static void configure_tiles() {
+      alignas(64) TileConfig config;
+      std::memset(&config, 0, sizeof (config));
+      config.palette_id = 1;
+      for (int t = 0; t < 8; ++t) {
+        config.colsb[t] = row_bytes;
+        config.rows[t] = tile_rows;
+      }
+      _tile_loadconfig(&config);
+    }
+
+    // Computes 2 x 2 tiles of 16 x 16 values and stores them in tiles.
+    static void s8_amx_block(const GemmArgs<S8Traits>& args, dim_t i0, dim_t b0, int32_t* tiles) {
+      const dim_t block_size = args.kpad * block_n;
+      const uint8_t* a0 = args.a + i0 * args.kpad;
+      const uint8_t* a1 = a0 + tile_rows * args.kpad;
+      const int8_t* b_0 = args.b + b0 * block_size;
+      const int8_t* b_1 = b_0 + block_size;
+
+      _tile_zero(0);
+      _tile_zero(1);
+      _tile_zero(2);
+      _tile_zero(3);
+
+      for (dim_t kk = 0; kk < args.kpad; kk += S8Traits::tile_k) {
+        _tile_loadd(4, a0 + kk, args.kpad);
+        _tile_loadd(5, a1 + kk, args.kpad);
+        _tile_loadd(6, b_0 + kk * block_n, row_bytes);
+        _tile_loadd(7, b_1 + kk * block_n, row_bytes);
+        _tile_dpbusd(0, 4, 6);
+        _tile_dpbusd(1, 4, 7);
+        _tile_dpbusd(2, 5, 6);
+        _tile_dpbusd(3, 5, 7);
+      }
+
+      _tile_stored(0, tiles, row_bytes);
+      _tile_stored(1, tiles + tile_rows * block_n, row_bytes);
+      _tile_stored(2, tiles + 2 * tile_rows * block_n, row_bytes);
+      _tile_stored(3, tiles + 3 * tile_rows * block_n, row_bytes);
+    }
+
+    static void bf16_amx_block(const GemmArgs<BF16Traits>& args, dim_t i0, dim_t b0, float* tiles) {
+      const dim_t block_size = args.kpad * block_n;
+      const dim_t lda = args.kpad * sizeof (uint16_t);
+      const uint16_t* a0 = args.a + i0 * args.kpad;
+      const uint16_t* a1 = a0 + tile_rows * args.kpad;
+      const uint16_t* b_0 = args.b + b0 * block_size;
+      const uint16_t* b_1 = b_0 + block_size;
+
+      _tile_zero(0);
+      _tile_zero(1);
+      _tile_zero(2);
+      _tile_zero(3);
+
+      for (dim_t kk = 0; kk < args.kpad; kk += BF16Traits::tile_k) {
+        _tile_loadd(4, a0 + kk, lda);
+        _tile_loadd(5, a1 + kk, lda);
+        _tile_loadd(6, b_0 + kk * block_n, row_bytes);
+        _tile_loadd(7, b_1 + kk * block_n, row_bytes);
+        _tile_dpbf16ps(0, 4, 6);
+        _tile_dpbf16ps(1, 4, 7);
+        _tile_dpbf16ps(2, 5, 6);
+        _tile_dpbf16ps(3, 5, 7);
+      }
+
+      _tile_stored(0, tiles, row_bytes);
+      _tile_stored(1, tiles + tile_rows * block_n, row_bytes);
+      _tile_stored(2, tiles + 2 * tile_rows * block_n, row_bytes);
+      _tile_stored(3, tiles + 3 * tile_rows * block_n, row_bytes);
+    }
+
+    // A must be padded to a multiple of 2 * tile_rows rows.
+    template <typename Traits, typename Block>
+    static void run_amx(const GemmArgs<Traits>& args, const Block& block) {
+      const dim_t num_blocks = ceil_divide(args.n, block_n);
+      const dim_t row_tiles = ceil_divide(args.m, 2 * tile_rows);
+      const dim_t col_tiles = ceil_divide(num_blocks, dim_t(2));
+
+      parallel_for(0, row_tiles * col_tiles, 1, [&](dim_t begin, dim_t end) {
+        configure_tiles();
+
+        alignas(64) typename Traits::CType tiles[4 * tile_rows * block_n];
+
+        for (dim_t t = begin; t < end; ++t) {
+          const dim_t i0 = (t / col_tiles) * 2 * tile_rows;
+          const dim_t b0 = (t % col_tiles) * 2;
+
+          block(args, i0, b0, tiles);
+
+          for (dim_t q = 0; q < 4; ++q) {
+            const dim_t row_begin = i0 + (q / 2) * tile_rows;
+            const dim_t col = (b0 + q % 2) * block_n;
+            if (row_begin >= args.m || col >= args.n)
+              continue;
+
+            const dim_t rows = std::min(tile_rows, args.m - row_begin);
+            const auto* tile = tiles + q * tile_rows * block_n;
+            for (dim_t r = 0; r < rows; ++r)
+              Traits::store(args, Traits::load(tile + r * block_n), row_begin + r, col);
+          }
+        }
+
+        _tile_release();
+      });
+    }
+
+
+    dim_t builtin_gemm_s8_pack_b_size(dim_t k, dim_t n) {
+      return packed_k<S8Traits>(k) * packed_n<S8Traits>(n) * sizeof (int8_t);
+    }
+
+    void builtin_gemm_s8_pack_b(const int8_t* b,
+                                bool transpose_b,
+                                dim_t k,
+                                dim_t n,
+                                int8_t* packed_b) {
+      pack_b<S8Traits>(b, transpose_b, k, n, packed_b, [](int8_t v) { return v; });
+    }
+
+    void builtin_gemm_u8s8s32(bool use_amx,
+                              dim_t m, dim_t n, dim_t k,
+                              float alpha,
+                              const uint8_t* a, dim_t lda,
+                              const int8_t* packed_b,
+                              float beta,
+                              int32_t* c, dim_t ldc,
+                              const int32_t* compensation) {
+      use_amx = use_amx && m >= tile_rows;
+
+      const dim_t kpad = packed_k<S8Traits>(k);
+      const dim_t mpad = use_amx ? round_up(m, 2 * tile_rows) : m;
+
+      // Padded rows and columns are zero so that the kernels do not need to handle tails.
+      std::vector<uint8_t> padded_a(mpad * kpad, 0);
+      parallel_for(0, m, std::max(GRAIN_SIZE / kpad, dim_t(1)), [&](dim_t begin, dim_t end) {
+        for (dim_t i = begin; i < end; ++i)
+          std::memcpy(padded_a.data() + i * kpad, a + i * lda, k);
+      });
+
+      const GemmArgs<S8Traits> args{
+        m, n, k, kpad, alpha, beta, padded_a.data(), packed_b, c, ldc, compensation};
+
+      if (use_amx)
+        run_amx(args, s8_amx_block);
+      else
+        run_vnni(args);
+    }
+
+    dim_t builtin_gemm_bf16_pack_b_size(dim_t k, dim_t n) {
+      return packed_k<BF16Traits>(k) * packed_n<BF16Traits>(n) * sizeof (uint16_t);
+    }
+
+    void builtin_gemm_bf16_pack_b(const float* b,
+                                  bool transpose_b,
+                                  dim_t k,
+                                  dim_t n,
+                                  float alpha,
+                                  uint16_t* packed_b) {
+      pack_b<BF16Traits>(b, transpose_b, k, n, packed_b,
+                         [alpha](float v) { return float_to_bf16(v * alpha); });
+    }
+
+    void builtin_gemm_bf16(bool use_amx,
+                           dim_t m, dim_t n, dim_t k,
+                           const float* a, dim_t lda,
+                           const uint16_t* packed_b,
+                           float beta,
+                           float* c, dim_t ldc) {
+      use_amx = use_amx && m >= tile_rows;
+
+      const dim_t kpad = packed_k<BF16Traits>(k);
+      const dim_t mpad = use_amx ? round_up(m, 2 * tile_rows) : m;
+
+      std::vector<uint16_t> padded_a(mpad * kpad, 0);
+      parallel_for(0, m, std::max(GRAIN_SIZE / kpad, dim_t(1)), [&](dim_t begin, dim_t end) {
+        for (dim_t i = begin; i < end; ++i) {
+          const float* src = a + i * lda;
+          uint16_t* dst = padded_a.data() + i * kpad;
+
+          // kpad is a multiple of 16 so the last vector can be stored without a mask.
+          for (dim_t kk = 0; kk < k; kk += block_n) {
+            const __m512 x = _mm512_maskz_loadu_ps(column_mask(k - kk), src + kk);
+            const __m256bh y = _mm512_cvtneps_pbh(x);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + kk), (__m256i)y);
+          }
+        }
+      });
+
+      const GemmArgs<BF16Traits> args{
+        m, n, k, kpad, 1, beta, padded_a.data(), packed_b, c, ldc, nullptr};
+
+      if (use_amx)
+        run_amx(args, bf16_amx_block);
+      else
+        run_vnni(args);
+    }
+
+  }
+}
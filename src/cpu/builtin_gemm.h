@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+#include "ctranslate2/types.h"
+
+namespace ctranslate2 {
+  namespace cpu {
+
+    // Built-in GEMM kernels for x86 CPUs supporting AVX512-VNNI, AVX512-BF16, and AMX.
+    //
+    // This file is compiled for these instruction sets, so the functions should only be
+    // called when cpu::mayiuse_builtin_gemm() returns true (see backend.h).
+    //
+    // The kernels read a pre-packed B matrix. Its columns are grouped in blocks of 16 and,
+    // in each block, the values of 4 consecutive k (int8) or 2 consecutive k (bfloat16) are
+    // stored next to each other for each column. A block is then a sequence of 64-byte rows,
+    // which is the layout read by the AMX tiles and by the AVX512 dot product instructions.
+
+    // Returns the size in bytes of the packed B matrix.
+    dim_t builtin_gemm_s8_pack_b_size(dim_t k, dim_t n);
+    void builtin_gemm_s8_pack_b(const int8_t* b,
+                                bool transpose_b,
+                                dim_t k,
+                                dim_t n,
+                                int8_t* packed_b);
+
+    // Computes c = alpha * a * packed_b + beta * c + compensation.
+    void builtin_gemm_u8s8s32(bool use_amx,
+                              dim_t m, dim_t n, dim_t k,
+                              float alpha,
+                              const uint8_t* a, dim_t lda,
+                              const int8_t* packed_b,
+                              float beta,
+                              int32_t* c, dim_t ldc,
+                              const int32_t* compensation);
+
+    // Returns the size in bytes of the packed B matrix. The values are scaled by alpha and
+    // rounded to bfloat16.
+    dim_t builtin_gemm_bf16_pack_b_size(dim_t k, dim_t n);
+    void builtin_gemm_bf16_pack_b(const float* b,
+                                  bool transpose_b,
+                                  dim_t k,
+                                  dim_t n,
+                                  float alpha,
+                                  uint16_t* packed_b);
+
+    // Computes c = a * packed_b + beta * c where a is rounded to bfloat16.
+    void builtin_gemm_bf16(bool use_amx,
+                           dim_t m, dim_t n, dim_t k,
+                           const float* a, dim_t lda,
+                           const uint16_t* packed_b,
+                           float beta,
+                           float* c, dim_t ldc);
+
+  }
+}
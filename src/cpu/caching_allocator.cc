@@ -0,0 +1,199 @@
+#include "cpu/caching_allocator.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace ctranslate2 {
+  namespace cpu {
+
+    // Protects the registration of the thread caches. It is only locked when a thread uses
+    // an allocator for the first time, when a thread exits, and when the cache is cleared.
+    static std::mutex& get_caches_mutex() {
+      static auto* mutex = new std::mutex();
+      return *mutex;
+    }
+
+    struct CachingAllocator::ThreadCache {
+      std::mutex mutex;
+      CachingAllocator* allocator;  // Null once the allocator is destroyed.
+      std::vector<std::vector<void*>> free_blocks;
+      size_t cached_bytes = 0;
+    };
+
+    // Owns the caches of the current thread and returns their blocks on thread exit.
+    class CachingAllocator::ThreadCaches {
+    public:
+      ~ThreadCaches() {
+        released = true;
+
+        const std::lock_guard<std::mutex> lock(get_caches_mutex());
+        for (auto& cache : _caches) {
+          CachingAllocator* allocator = cache->allocator;
+          if (!allocator)
+            continue;
+
+          allocator->release_cache(*cache);
+          auto& caches = allocator->_caches;
+          caches.erase(std::find(caches.begin(), caches.end(), cache));
+        }
+      }
+
+      ThreadCache* get(CachingAllocator& allocator) {
+        for (const auto& cache : _caches) {
+          if (cache->allocator == &allocator)
+            return cache.get();
+        }
+
+        auto cache = std::make_shared<ThreadCache>();
+        cache->allocator = &allocator;
+        cache->free_blocks.resize(allocator._bin_bytes.size());
+
+        {
+          const std::lock_guard<std::mutex> lock(get_caches_mutex());
+          allocator._caches.emplace_back(cache);
+        }
+
+        _caches.emplace_back(cache);
+        return cache.get();
+      }
+
+      // Set when the caches were destroyed but the thread can still free memory,
+      // for example when static objects are destroyed on program exit.
+      static thread_local bool released;
+
+    private:
+      std::vector<std::shared_ptr<ThreadCache>> _caches;
+    };
+
+    thread_local bool CachingAllocator::ThreadCaches::released = false;
+
+    CachingAllocator::CachingAllocator(Allocator& allocator,
+                                       size_t alignment,
+                                       unsigned int bin_growth,
+                                       unsigned int min_bin,
+                                       unsigned int max_bin,
+                                       size_t max_cached_bytes,
+                                       size_t max_total_cached_bytes)
+      : _allocator(allocator)
+      , _header_size(alignment)
+      , _max_cached_bytes(max_cached_bytes)
+      , _max_total_cached_bytes(max_total_cached_bytes)
+      , _total_cached_bytes(0)
+    {
+      if (bin_growth < 2 || min_bin > max_bin)
+        throw std::invalid_argument("Invalid configuration for the CPU caching allocator");
+
+      size_t bin_bytes = 1;
+      for (unsigned int i = 0; i < max_bin; ++i) {
+        if (bin_bytes > std::numeric_limits<size_t>::max() / bin_growth)
+          throw std::invalid_argument("The largest bin of the CPU caching allocator "
+                                      "is too large");
+        bin_bytes *= bin_growth;
+        if (i + 1 >= min_bin)
+          _bin_bytes.push_back(bin_bytes);
+      }
+      if (min_bin == 0)
+        _bin_bytes.insert(_bin_bytes.begin(), 1);
+    }
+
+    CachingAllocator::~CachingAllocator() {
+      const std::lock_guard<std::mutex> lock(get_caches_mutex());
+      for (auto& cache : _caches) {
+        release_cache(*cache);
+        cache->allocator = nullptr;
+      }
+    }
+
+    void* CachingAllocator::allocate(size_t size, int device_index) {
+      const int bin = get_bin(size);
+
+      if (bin >= 0) {
+        ThreadCache* cache = get_thread_cache();
+        if (cache) {
+          const std::lock_guard<std::mutex> lock(cache->mutex);
+          auto& blocks = cache->free_blocks[bin];
+          if (!blocks.empty()) {
+            void* ptr = blocks.back();
+            blocks.pop_back();
+            cache->cached_bytes -= _bin_bytes[bin];
+            _total_cached_bytes -= _bin_bytes[bin];
+            return ptr;
+          }
+        }
+      }
+
+      const size_t block_size = bin >= 0 ? _bin_bytes[bin] : size;
+      auto* base = static_cast<char*>(_allocator.allocate(block_size + _header_size,
+                                                          device_index));
+      *reinterpret_cast<int*>(base) = bin;
+      return base + _header_size;
+    }
+
+    void CachingAllocator::free(void* ptr, int device_index) {
+      auto* base = static_cast<char*>(ptr) - _header_size;
+      const int bin = *reinterpret_cast<int*>(base);
+
+      if (bin >= 0) {
+        ThreadCache* cache = get_thread_cache();
+        if (cache) {
+          const size_t bin_bytes = _bin_bytes[bin];
+          const std::lock_guard<std::mutex> lock(cache->mutex);
+
+          if (cache->cached_bytes + bin_bytes <= _max_cached_bytes) {
+            if (_total_cached_bytes.fetch_add(bin_bytes) + bin_bytes <= _max_total_cached_bytes) {
+              cache->free_blocks[bin].emplace_back(ptr);
+              cache->cached_bytes += bin_bytes;
+              return;
+            }
+
+            _total_cached_bytes -= bin_bytes;
+          }
+        }
+      }
+
+      _allocator.free(base, device_index);
+    }
+
+    void CachingAllocator::clear_cache() {
+      {
+        const std::lock_guard<std::mutex> lock(get_caches_mutex());
+        for (auto& cache : _caches)
+          release_cache(*cache);
+      }
+
+      _allocator.clear_cache();
+    }
+
+    size_t CachingAllocator::cached_bytes() const {
+      return _total_cached_bytes.load();
+    }
+
+    int CachingAllocator::get_bin(size_t size) const {
+      for (size_t i = 0; i < _bin_bytes.size(); ++i) {
+        if (size <= _bin_bytes[i])
+          return i;
+      }
+      return -1;
+    }
+
+    CachingAllocator::ThreadCache* CachingAllocator::get_thread_cache() {
+      if (ThreadCaches::released)
+        return nullptr;
+      static thread_local ThreadCaches caches;
+      return caches.get(*this);
+    }
+
+    void CachingAllocator::release_cache(ThreadCache& cache) {
+      const std::lock_guard<std::mutex> lock(cache.mutex);
+      for (auto& blocks : cache.free_blocks) {
+        for (void* ptr : blocks)
+          _allocator.free(static_cast<char*>(ptr) - _header_size);
+        blocks.clear();
+      }
+      _total_cached_bytes -= cache.cached_bytes;
+      cache.cached_bytes = 0;
+    }
+
+  }
+}
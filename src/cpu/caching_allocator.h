@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "ctranslate2/allocator.h"
+
+namespace ctranslate2 {
+  namespace cpu {
+
+    // Caching allocator with power-of-bin_growth size classes, similar to the CUB allocator
+    // used on GPU. Freed blocks are kept in free lists owned by the thread releasing them,
+    // so that replicas running in different threads never contend on the same lock.
+    //
+    // Each thread caches at most max_cached_bytes, and all threads together cache at most
+    // max_total_cached_bytes. The blocks cached by a thread are released when it exits.
+    //
+    // Each block starts with a header recording its size class. The returned pointer is
+    // offset by the alignment so that it keeps the alignment of the underlying allocator.
+    class CachingAllocator : public Allocator {
+    public:
+      CachingAllocator(Allocator& allocator,
+                       size_t alignment,
+                       unsigned int bin_growth,
+                       unsigned int min_bin,
+                       unsigned int max_bin,
+                       size_t max_cached_bytes,
+                       size_t max_total_cached_bytes);
+      ~CachingAllocator();
+
+      void* allocate(size_t size, int device_index) override;
+      void free(void* ptr, int device_index) override;
+      void clear_cache() override;
+
+      // Number of bytes currently cached by all threads.
+      size_t cached_bytes() const;
+
+    private:
+      struct ThreadCache;
+      class ThreadCaches;
+
+      Allocator& _allocator;
+      const size_t _header_size;
+      const size_t _max_cached_bytes;
+      const size_t _max_total_cached_bytes;
+      std::vector<size_t> _bin_bytes;
+      std::atomic<size_t> _total_cached_bytes;
+
+      // Caches of the threads that used this allocator, protected by a global mutex.
+      std::vector<std::shared_ptr<ThreadCache>> _caches;
+
+      int get_bin(size_t size) const;
+      ThreadCache* get_thread_cache();
+      void release_cache(ThreadCache& cache);
+    };
+
+  }
+}
@@ -39,6 +39,20 @@ namespace ctranslate2 {
               && info.features.avx512bw);
     }
 
+    bool cpu_supports_avx512_vnni() {
+      return cpu_supports_avx512() && info.features.avx512vnni;
+    }
+
+    bool cpu_supports_avx512_bf16() {
+      return cpu_supports_avx512() && info.features.avx512_bf16;
+    }
+
+    bool cpu_supports_amx() {
+      return (info.features.amx_tile
+              && info.features.amx_int8
+              && info.features.amx_bf16);
+    }
+
   }
 }
 
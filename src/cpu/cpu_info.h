@@ -12,6 +12,9 @@ namespace ctranslate2 {
     bool cpu_supports_avx();
     bool cpu_supports_avx2();
     bool cpu_supports_avx512();
+    bool cpu_supports_avx512_vnni();
+    bool cpu_supports_avx512_bf16();
+    bool cpu_supports_amx();
 #elif defined(CT2_ARM64_BUILD)
     bool cpu_supports_neon();
 #endif
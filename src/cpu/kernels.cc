@@ -1,6 +1,8 @@
 #include "cpu/kernels.h"
 
+#include <algorithm>
 #include <limits>
+#include <vector>
 
 #if defined(__AVX512F__)
 #  define TARGET_ISA CpuIsa::AVX512
@@ -458,6 +460,53 @@ namespace ctranslate2 {
       });
     }
 
+    template<>
+    void online_softmax<TARGET_ISA>(float* scores,
+                                    const float* bias,
+                                    const int32_t* begins,
+                                    const int32_t* ends,
+                                    float* row_max,
+                                    float* row_sum,
+                                    float* correction,
+                                    dim_t num_rows,
+                                    dim_t num_cols,
+                                    dim_t ld) {
+      using VecType = Vec<float, TARGET_ISA>;
+
+      for (dim_t i = 0; i < num_rows; ++i) {
+        float* x = scores + i * ld;
+        const dim_t begin = std::max(dim_t(begins[i]), dim_t(0));
+        const dim_t end = std::min(dim_t(ends[i]), num_cols);
+
+        if (end <= begin) {
+          std::fill(x, x + num_cols, 0.f);
+          correction[i] = 1;
+          continue;
+        }
+
+        std::fill(x, x + begin, 0.f);
+        std::fill(x + end, x + num_cols, 0.f);
+
+        x += begin;
+        const dim_t size = end - begin;
+
+        if (bias)
+          add<TARGET_ISA>(bias + begin, x, x, size);
+
+        const float prev_max = row_max[i];
+        const float new_max = std::max(prev_max, reduce_max<TARGET_ISA>(x, size));
+        const auto vec_new_max = VecType::load(new_max);
+
+        vectorized_unary_transform<TARGET_ISA>(x, x, size, [vec_new_max](vec_type<float, TARGET_ISA> v) {
+          return VecType::exp(VecType::sub(v, vec_new_max));
+        });
+
+        correction[i] = std::exp(prev_max - new_max);
+        row_sum[i] = row_sum[i] * correction[i] + reduce_sum<TARGET_ISA>(x, size);
+        row_max[i] = new_max;
+      }
+    }
+
     CT2_FFAST_MATH_BEGIN
     template<>
     void layer_norm<TARGET_ISA>(const float* input,
@@ -571,6 +620,56 @@ namespace ctranslate2 {
         }
       });
     }
+
+    // Normalizes a single row after adding the residual, if any. The sum is accumulated
+    // while it is written so that the row is read only once from memory.
+    static void add_and_normalize_row(const float* x,
+                                      const float* residual,
+                                      float* sum_output,
+                                      const float* gamma,
+                                      const float* beta,
+                                      float* y,
+                                      dim_t depth,
+                                      float epsilon,
+                                      bool unit_offset) {
+      float sum = 0;
+      float sum_squares = 0;
+
+      if (residual) {
+        for (dim_t j = 0; j < depth; ++j) {
+          const float v = x[j] + residual[j];
+          sum_output[j] = v;
+          sum += v;
+          sum_squares += v * v;
+        }
+        x = sum_output;
+      } else {
+        for (dim_t j = 0; j < depth; ++j) {
+          sum += x[j];
+          sum_squares += x[j] * x[j];
+        }
+      }
+
+      if (beta) {
+        const float mean = sum / depth;
+        const float variance = std::max(sum_squares / depth - mean * mean, 0.f);
+        const float rstd = 1.f / std::sqrt(variance + epsilon);
+
+        for (dim_t j = 0; j < depth; ++j)
+          y[j] = (x[j] - mean) * rstd * gamma[j] + beta[j];
+
+      } else {
+        const float inv_rms = 1.f / std::sqrt(sum_squares / depth + epsilon);
+
+        if (unit_offset) {
+          for (dim_t j = 0; j < depth; ++j)
+            y[j] = x[j] * inv_rms * (1 + gamma[j]);
+        } else {
+          for (dim_t j = 0; j < depth; ++j)
+            y[j] = x[j] * inv_rms * gamma[j];
+        }
+      }
+    }
     CT2_FFAST_MATH_END
 
     template <typename RoundFunc>
@@ -650,6 +749,66 @@ namespace ctranslate2 {
         quantize_s8_batch(x, y, scales, batch_size, depth, shift_to_uint8, identity());
     }
 
+    template <typename RoundFunc>
+    static void norm_quantize_s8_batch(const float* x,
+                                       const float* residual,
+                                       float* sum,
+                                       const float* gamma,
+                                       const float* beta,
+                                       int8_t* y,
+                                       float* scales,
+                                       dim_t batch_size,
+                                       dim_t depth,
+                                       float epsilon,
+                                       bool unit_offset,
+                                       bool shift_to_uint8,
+                                       const RoundFunc& round_func) {
+      parallel_for(0, batch_size, 1, [&](dim_t begin, dim_t end) {
+        // The normalized row stays in cache until it is quantized.
+        std::vector<float> normalized(depth);
+
+        for (dim_t i = begin; i < end; ++i) {
+          const auto offset = i * depth;
+          add_and_normalize_row(x + offset,
+                                residual ? residual + offset : nullptr,
+                                residual ? sum + offset : nullptr,
+                                gamma,
+                                beta,
+                                normalized.data(),
+                                depth,
+                                epsilon,
+                                unit_offset);
+          scales[i] = quantize_s8_row(normalized.data(),
+                                      y + offset,
+                                      depth,
+                                      shift_to_uint8,
+                                      round_func);
+        }
+      });
+    }
+
+    template<>
+    void norm_quantize_s8<TARGET_ISA>(const float* x,
+                                      const float* residual,
+                                      float* sum,
+                                      const float* gamma,
+                                      const float* beta,
+                                      int8_t* y,
+                                      float* scales,
+                                      dim_t batch_size,
+                                      dim_t depth,
+                                      float epsilon,
+                                      bool unit_offset,
+                                      bool shift_to_uint8,
+                                      bool round_before_cast) {
+      if (round_before_cast)
+        norm_quantize_s8_batch(x, residual, sum, gamma, beta, y, scales, batch_size, depth,
+                               epsilon, unit_offset, shift_to_uint8, Vec<float, TARGET_ISA>::round);
+      else
+        norm_quantize_s8_batch(x, residual, sum, gamma, beta, y, scales, batch_size, depth,
+                               epsilon, unit_offset, shift_to_uint8, identity());
+    }
+
     template <bool with_bias, typename EpilogueFunc>
     static void dequantize_gemm_output_row(const int32_t* c,
                                            const float a_scale,
@@ -755,5 +914,259 @@ namespace ctranslate2 {
       });
     }
 
+    constexpr dim_t int4_block_size = 32;
+
+    // Computes the products of num_rows input rows with a row of 4-bit weights. The number
+    // of rows is a template parameter so that the accumulators are kept in registers.
+    template <dim_t num_rows>
+    static void gemm_int4_rows(const float* a,
+                               const float* a_sums,
+                               const uint8_t* b,
+                               const float* scales,
+                               const float* zeros,
+                               float* c,
+                               dim_t n,
+                               dim_t k,
+                               dim_t group_size) {
+      using VecType = Vec<float, TARGET_ISA>;
+
+      const dim_t num_groups = k / group_size;
+      float out[num_rows] = {};
+
+      for (dim_t g = 0; g < num_groups; ++g) {
+        vec_type<float, TARGET_ISA> acc_low[num_rows];
+        vec_type<float, TARGET_ISA> acc_high[num_rows];
+        for (dim_t r = 0; r < num_rows; ++r) {
+          acc_low[r] = VecType::load(0.f);
+          acc_high[r] = VecType::load(0.f);
+        }
+
+        for (dim_t i = g * group_size; i < (g + 1) * group_size; i += int4_block_size) {
+          for (dim_t t = 0; t < int4_block_size / 2; t += VecType::width) {
+            vec_type<float, TARGET_ISA> low;
+            vec_type<float, TARGET_ISA> high;
+            VecType::load_int4(b + i / 2 + t, low, high);
+
+            for (dim_t r = 0; r < num_rows; ++r) {
+              const float* x = a + r * k + i + t;
+              acc_low[r] = VecType::mul_add(VecType::load(x), low, acc_low[r]);
+              acc_high[r] = VecType::mul_add(VecType::load(x + int4_block_size / 2),
+                                             high,
+                                             acc_high[r]);
+            }
+          }
+        }
+
+        // With q the unpacked weights, the zero point is applied per group with:
+        //   sum(a * (q - zero) * scale) = scale * (sum(a * q) - zero * sum(a))
+        for (dim_t r = 0; r < num_rows; ++r) {
+          const float dot = VecType::reduce_add(VecType::add(acc_low[r], acc_high[r]));
+          out[r] += scales[g] * (dot - zeros[g] * a_sums[r * num_groups + g]);
+        }
+      }
+
+      for (dim_t r = 0; r < num_rows; ++r)
+        c[r * n] = out[r];
+    }
+
+    template<>
+    void gemm_int4<TARGET_ISA>(const float* a,
+                               const uint8_t* b,
+                               const float* scales,
+                               const float* zeros,
+                               float* c,
+                               dim_t m,
+                               dim_t n,
+                               dim_t k,
+                               dim_t group_size) {
+      constexpr dim_t max_rows = 4;
+      const dim_t num_groups = k / group_size;
+
+      std::vector<float> a_sums(m * num_groups);
+      for (dim_t i = 0; i < m; ++i) {
+        for (dim_t g = 0; g < num_groups; ++g)
+          a_sums[i * num_groups + g] = reduce_sum<TARGET_ISA>(a + i * k + g * group_size,
+                                                              group_size);
+      }
+
+      parallel_for(0, n, 1, [&](dim_t begin, dim_t end) {
+        for (dim_t j = begin; j < end; ++j) {
+          const uint8_t* b_row = b + j * (k / 2);
+          const float* scales_row = scales + j * num_groups;
+          const float* zeros_row = zeros + j * num_groups;
+
+          for (dim_t i = 0; i < m; i += max_rows) {
+            const float* a_rows = a + i * k;
+            const float* a_rows_sums = a_sums.data() + i * num_groups;
+            float* c_rows = c + i * n + j;
+
+            switch (std::min(max_rows, m - i)) {
+            case 1:
+              gemm_int4_rows<1>(a_rows, a_rows_sums, b_row, scales_row, zeros_row, c_rows,
+                                n, k, group_size);
+              break;
+            case 2:
+              gemm_int4_rows<2>(a_rows, a_rows_sums, b_row, scales_row, zeros_row, c_rows,
+                                n, k, group_size);
+              break;
+            case 3:
+              gemm_int4_rows<3>(a_rows, a_rows_sums, b_row, scales_row, zeros_row, c_rows,
+                                n, k, group_size);
+              break;
+            default:
+              gemm_int4_rows<4>(a_rows, a_rows_sums, b_row, scales_row, zeros_row, c_rows,
+                                n, k, group_size);
+              break;
+            }
+          }
+        }
+      });
+    }
+
+    template<>
+    void dequantize_int4<TARGET_ISA>(const uint8_t* x,
+                                     const float* scales,
+                                     const float* zeros,
+                                     float* y,
+                                     dim_t n,
+                                     dim_t k,
+                                     dim_t group_size) {
+      using VecType = Vec<float, TARGET_ISA>;
+      const dim_t num_groups = k / group_size;
+
+      parallel_for(0, n, 1, [&](dim_t begin, dim_t end) {
+        vec_type<float, TARGET_ISA> low;
+        vec_type<float, TARGET_ISA> high;
+
+        for (dim_t j = begin; j < end; ++j) {
+          for (dim_t g = 0; g < num_groups; ++g) {
+            const dim_t offset = j * k + g * group_size;
+            const auto scale = VecType::load(scales[j * num_groups + g]);
+            const auto zero = VecType::load(zeros[j * num_groups + g]);
+
+            for (dim_t i = offset; i < offset + group_size; i += int4_block_size) {
+              for (dim_t t = 0; t < int4_block_size / 2; t += VecType::width) {
+                VecType::load_int4(x + i / 2 + t, low, high);
+                VecType::store(VecType::mul(VecType::sub(low, zero), scale), y + i + t);
+                VecType::store(VecType::mul(VecType::sub(high, zero), scale),
+                               y + i + t + int4_block_size / 2);
+              }
+            }
+          }
+        }
+      });
+    }
+
+    template <dim_t num_rows>
+    static void gemm_indexed_rows(const float* a,
+                                  const float* b,
+                                  float* c,
+                                  dim_t n,
+                                  dim_t k) {
+      using VecType = Vec<float, TARGET_ISA>;
+
+      vec_type<float, TARGET_ISA> acc[num_rows];
+      for (dim_t r = 0; r < num_rows; ++r)
+        acc[r] = VecType::load(0.f);
+
+      dim_t i = 0;
+      for (; i + VecType::width <= k; i += VecType::width) {
+        const auto w = VecType::load(b + i);
+        for (dim_t r = 0; r < num_rows; ++r)
+          acc[r] = VecType::mul_add(VecType::load(a + r * k + i), w, acc[r]);
+      }
+
+      if (i < k) {
+        const dim_t remaining = k - i;
+        const auto w = VecType::load(b + i, remaining);
+        for (dim_t r = 0; r < num_rows; ++r)
+          acc[r] = VecType::mul_add(VecType::load(a + r * k + i, remaining), w, acc[r]);
+      }
+
+      for (dim_t r = 0; r < num_rows; ++r)
+        c[r * n] = VecType::reduce_add(acc[r]);
+    }
+
+    template<>
+    void gemm_indexed<TARGET_ISA>(const float* a,
+                                  const float* b,
+                                  const int32_t* index,
+                                  float* c,
+                                  dim_t m,
+                                  dim_t n,
+                                  dim_t k) {
+      constexpr dim_t max_rows = 4;
+
+      parallel_for(0, n, 1, [&](dim_t begin, dim_t end) {
+        for (dim_t j = begin; j < end; ++j) {
+          const float* b_row = b + dim_t(index[j]) * k;
+
+          for (dim_t i = 0; i < m; i += max_rows) {
+            const float* a_rows = a + i * k;
+            float* c_rows = c + i * n + j;
+
+            switch (std::min(max_rows, m - i)) {
+            case 1:
+              gemm_indexed_rows<1>(a_rows, b_row, c_rows, n, k);
+              break;
+            case 2:
+              gemm_indexed_rows<2>(a_rows, b_row, c_rows, n, k);
+              break;
+            case 3:
+              gemm_indexed_rows<3>(a_rows, b_row, c_rows, n, k);
+              break;
+            default:
+              gemm_indexed_rows<4>(a_rows, b_row, c_rows, n, k);
+              break;
+            }
+          }
+        }
+      });
+    }
+
+    // The integer dot products are written as plain loops which are vectorized by the
+    // compiler for the target instruction set.
+    template <typename AType>
+    static void gemm_indexed_s8_impl(const AType* a,
+                                     const int8_t* b,
+                                     const int32_t* index,
+                                     int32_t* c,
+                                     dim_t m,
+                                     dim_t n,
+                                     dim_t k,
+                                     const int32_t* compensation) {
+      parallel_for(0, n, 1, [&](dim_t begin, dim_t end) {
+        for (dim_t j = begin; j < end; ++j) {
+          const int8_t* b_row = b + dim_t(index[j]) * k;
+          const int32_t comp = compensation ? compensation[j] : 0;
+
+          for (dim_t i = 0; i < m; ++i) {
+            const AType* a_row = a + i * k;
+            int32_t sum = 0;
+            for (dim_t t = 0; t < k; ++t)
+              sum += int32_t(a_row[t]) * int32_t(b_row[t]);
+            c[i * n + j] = sum + comp;
+          }
+        }
+      });
+    }
+
+    template<>
+    void gemm_indexed_s8<TARGET_ISA>(const int8_t* a,
+                                     bool a_is_shifted,
+                                     const int8_t* b,
+                                     const int32_t* index,
+                                     int32_t* c,
+                                     dim_t m,
+                                     dim_t n,
+                                     dim_t k,
+                                     const int32_t* compensation) {
+      if (a_is_shifted)
+        gemm_indexed_s8_impl(reinterpret_cast<const uint8_t*>(a), b, index, c, m, n, k,
+                             compensation);
+      else
+        gemm_indexed_s8_impl(a, b, index, c, m, n, k, compensation);
+    }
+
   }
 }
@@ -72,6 +72,23 @@ namespace ctranslate2 {
                  dim_t depth,
                  bool log);
 
+    // Updates the softmax statistics of rows attending to a new tile of keys, as done in
+    // flash attention. For each row i, only the scores in [begins[i], ends[i]) are valid. The
+    // valid scores are replaced by exp(score + bias - max) and the other scores by 0.
+    // row_max and row_sum are updated, and correction is the factor that should be applied to
+    // the previous outputs of the row.
+    template <CpuIsa ISA>
+    void online_softmax(float* scores,
+                        const float* bias,
+                        const int32_t* begins,
+                        const int32_t* ends,
+                        float* row_max,
+                        float* row_sum,
+                        float* correction,
+                        dim_t num_rows,
+                        dim_t num_cols,
+                        dim_t ld);
+
     template <CpuIsa ISA>
     void layer_norm(const float* input,
                     const float* gamma,
@@ -109,6 +126,24 @@ namespace ctranslate2 {
                      bool shift_to_uint8,
                      bool round_before_cast);
 
+    // Quantizes norm(x + residual) as quantize_s8 in a single pass over each row, where
+    // norm is a LayerNorm when beta is set and a RMSNorm otherwise. When residual is set,
+    // x + residual is also written to sum. With unit_offset, the RMSNorm scale is 1 + gamma.
+    template <CpuIsa ISA>
+    void norm_quantize_s8(const float* x,
+                          const float* residual,
+                          float* sum,
+                          const float* gamma,
+                          const float* beta,
+                          int8_t* y,
+                          float* scales,
+                          dim_t batch_size,
+                          dim_t depth,
+                          float epsilon,
+                          bool unit_offset,
+                          bool shift_to_uint8,
+                          bool round_before_cast);
+
     // Assumes transpose_a=false, transpose_b=true.
     template <CpuIsa ISA>
     void dequantize_gemm_output(const int32_t* c,
@@ -120,6 +155,57 @@ namespace ctranslate2 {
                                 const float* bias = nullptr,
                                 const ops::ActivationType* activation_type = nullptr);
 
+    // 4-bit weights are packed by blocks of 32 values in 16 bytes: the byte i of a block
+    // holds the value i in its low bits and the value i + 16 in its high bits. Each row of
+    // the [n, k] weight has one scale and one zero point per group of group_size values,
+    // and the values are dequantized as (q - zero) * scale.
+
+    // Computes c = a * dequantize(b)^T where a is a [m, k] matrix. The weights are unpacked
+    // in registers one block at a time, so this is efficient when m is small.
+    template <CpuIsa ISA>
+    void gemm_int4(const float* a,
+                   const uint8_t* b,
+                   const float* scales,
+                   const float* zeros,
+                   float* c,
+                   dim_t m,
+                   dim_t n,
+                   dim_t k,
+                   dim_t group_size);
+
+    template <CpuIsa ISA>
+    void dequantize_int4(const uint8_t* x,
+                         const float* scales,
+                         const float* zeros,
+                         float* y,
+                         dim_t n,
+                         dim_t k,
+                         dim_t group_size);
+
+    // Computes c = a * b[index]^T where a is a [m, k] matrix and index selects n rows of
+    // the weight b. The selected rows are read in place, so this is efficient when m is small.
+    template <CpuIsa ISA>
+    void gemm_indexed(const float* a,
+                      const float* b,
+                      const int32_t* index,
+                      float* c,
+                      dim_t m,
+                      dim_t n,
+                      dim_t k);
+
+    // Same as gemm_indexed for 8-bit values. a is unsigned when a_is_shifted is true and the
+    // compensation term (if any) is added to each output column.
+    template <CpuIsa ISA>
+    void gemm_indexed_s8(const int8_t* a,
+                         bool a_is_shifted,
+                         const int8_t* b,
+                         const int32_t* index,
+                         int32_t* c,
+                         dim_t m,
+                         dim_t n,
+                         dim_t k,
+                         const int32_t* compensation = nullptr);
+
     struct identity {
       template <typename T>
       constexpr T&& operator()(T&& v) const noexcept {
@@ -0,0 +1,147 @@
+#include "numa.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef __linux__
+#  include <pthread.h>
+#  include <sched.h>
+#endif
+
+#include "ctranslate2/utils.h"
+
+namespace ctranslate2 {
+  namespace cpu {
+
+    std::vector<int> parse_cpu_list(const std::string& list) {
+      std::vector<int> cpus;
+
+      for (const auto& range : split_string(list, ',')) {
+        if (range.empty())
+          continue;
+
+        const auto separator = range.find('-');
+        const int first = std::stoi(range.substr(0, separator));
+        const int last = (separator == std::string::npos
+                          ? first
+                          : std::stoi(range.substr(separator + 1)));
+        for (int cpu = first; cpu <= last; ++cpu)
+          cpus.emplace_back(cpu);
+      }
+
+      return cpus;
+    }
+
+#ifdef __linux__
+    static std::vector<int> read_process_cpus() {
+      cpu_set_t allowed_cpus;
+      CPU_ZERO(&allowed_cpus);
+      if (sched_getaffinity(0, sizeof (cpu_set_t), &allowed_cpus) != 0)
+        return {};
+
+      std::vector<int> cpus;
+      for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed_cpus))
+          cpus.emplace_back(cpu);
+      }
+      return cpus;
+    }
+#endif
+
+    // Read when the library is loaded, before a thread is bound to some cores.
+    static const std::vector<int>& process_cpus = get_process_cpus();
+
+    const std::vector<int>& get_process_cpus() {
+#ifdef __linux__
+      static const std::vector<int> cpus = read_process_cpus();
+#else
+      static const std::vector<int> cpus;
+#endif
+      return cpus;
+    }
+
+#ifdef __linux__
+    static std::vector<NumaNode> read_numa_nodes() {
+      const auto& allowed_cpus = get_process_cpus();
+      if (allowed_cpus.empty())
+        return {};
+
+      std::vector<NumaNode> nodes;
+
+      std::ifstream online_file("/sys/devices/system/node/online");
+      std::string online;
+      if (!online_file || !std::getline(online_file, online))
+        return {};
+
+      for (const int id : parse_cpu_list(online)) {
+        std::ifstream cpulist_file("/sys/devices/system/node/node"
+                                   + std::to_string(id)
+                                   + "/cpulist");
+        std::string cpulist;
+        if (!cpulist_file || !std::getline(cpulist_file, cpulist))
+          continue;
+
+        NumaNode node;
+        node.id = id;
+        for (const int cpu : parse_cpu_list(cpulist)) {
+          if (std::binary_search(allowed_cpus.begin(), allowed_cpus.end(), cpu))
+            node.cpus.emplace_back(cpu);
+        }
+
+        if (!node.cpus.empty())
+          nodes.emplace_back(std::move(node));
+      }
+
+      return nodes;
+    }
+#endif
+
+    const std::vector<NumaNode>& get_numa_nodes() {
+#ifdef __linux__
+      static const std::vector<NumaNode> nodes = read_numa_nodes();
+#else
+      static const std::vector<NumaNode> nodes;
+#endif
+      return nodes;
+    }
+
+    void set_thread_cpus(const std::vector<int>& cpus) {
+#ifdef __linux__
+      cpu_set_t cpuset;
+      CPU_ZERO(&cpuset);
+      for (const int cpu : cpus)
+        CPU_SET(cpu, &cpuset);
+
+      const int status = pthread_setaffinity_np(pthread_self(), sizeof (cpu_set_t), &cpuset);
+      if (status != 0)
+        throw std::runtime_error("Error calling pthread_setaffinity_np: "
+                                 + std::to_string(status));
+#else
+      (void)cpus;
+#endif
+    }
+
+    static thread_local int thread_numa_node = -1;
+
+    int get_thread_numa_node() {
+      return thread_numa_node;
+    }
+
+  }
+
+  void set_thread_numa_node(int node_id) {
+    const auto& nodes = cpu::get_numa_nodes();
+    const auto node = std::find_if(nodes.begin(), nodes.end(),
+                                   [node_id](const cpu::NumaNode& node) {
+                                     return node.id == node_id;
+                                   });
+    if (node == nodes.end())
+      throw std::invalid_argument("NUMA node " + std::to_string(node_id)
+                                  + " has no available CPUs");
+
+    cpu::set_thread_cpus(node->cpus);
+    cpu::thread_numa_node = node_id;
+  }
+
+}
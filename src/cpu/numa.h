@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace ctranslate2 {
+  namespace cpu {
+
+    struct NumaNode {
+      int id;
+      std::vector<int> cpus;
+    };
+
+    // Parses a list of CPUs in the sysfs format (e.g. "0-3,8-11").
+    std::vector<int> parse_cpu_list(const std::string& list);
+
+    // Returns the NUMA nodes with at least one CPU available to this process, as listed
+    // in /sys/devices/system/node. The list is empty when the topology is unknown.
+    const std::vector<NumaNode>& get_numa_nodes();
+
+    // Returns the CPUs available to this process when it started. The list is empty when
+    // the affinity is unknown.
+    const std::vector<int>& get_process_cpus();
+
+    // Restricts the current thread to the given CPUs.
+    void set_thread_cpus(const std::vector<int>& cpus);
+
+    // Returns the NUMA node of the current thread as set by set_thread_numa_node, or -1.
+    int get_thread_numa_node();
+
+  }
+}
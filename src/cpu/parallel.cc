@@ -1,26 +1,28 @@
 #include "parallel.h"
 
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
 namespace ctranslate2 {
   namespace cpu {
 
-#ifndef _OPENMP
-
-    static thread_local size_t num_threads = 1;
+    // 0 means that the thread did not set a value.
+    static thread_local size_t num_threads = 0;
 
     void set_num_threads(size_t num) {
       num_threads = num;
     }
 
     size_t get_num_threads() {
-      return num_threads;
-    }
-
-    BS::thread_pool_light& get_thread_pool() {
-      static thread_local BS::thread_pool_light thread_pool(num_threads);
-      return thread_pool;
-    }
-
+      if (num_threads > 0)
+        return num_threads;
+#ifdef _OPENMP
+      return omp_get_max_threads();
+#else
+      return 1;
 #endif
+    }
 
   }
 }
@@ -2,14 +2,9 @@
 
 #include <algorithm>
 
-#ifdef _OPENMP
-#  include <omp.h>
-#else
-#  include <BS_thread_pool_light.hpp>
-#endif
-
 #include "ctranslate2/types.h"
 #include "ctranslate2/utils.h"
+#include "task_scheduler.h"
 
 namespace ctranslate2 {
   namespace cpu {
@@ -28,13 +23,11 @@ namespace ctranslate2 {
       return std::max(min_copy_bytes / copy_bytes, dim_t(1));
     }
 
-#ifndef _OPENMP
+    // Maximum number of threads used by parallel_for when called from the current thread.
+    // In OpenMP builds, threads that never set a value use the OpenMP setting of the thread.
     void set_num_threads(size_t num_threads);
     size_t get_num_threads();
 
-    BS::thread_pool_light& get_thread_pool();
-#endif
-
     template <typename Function>
     inline void parallel_for(const dim_t begin,
                              const dim_t end,
@@ -46,43 +39,26 @@ namespace ctranslate2 {
 
       const dim_t size = end - begin;
 
-#ifdef _OPENMP
-      if (omp_get_max_threads() == 1 || omp_in_parallel() || size <= grain_size) {
-        f(begin, end);
-        return;
-      }
-
-      #pragma omp parallel
-      {
-        dim_t num_threads = omp_get_num_threads();
-        if (grain_size > 0) {
-          num_threads = std::min(num_threads, ceil_divide(size, grain_size));
-        }
-
-        const dim_t tid = omp_get_thread_num();
-        const dim_t chunk_size = ceil_divide(size, num_threads);
-        const dim_t begin_tid = begin + tid * chunk_size;
-        if (begin_tid < end) {
-          f(begin_tid, std::min(end, chunk_size + begin_tid));
-        }
-      }
-
-#else
-      dim_t num_blocks = get_num_threads();
+      // The loops run in the task scheduler in all builds. OpenMP is only used by the
+      // third-party BLAS libraries.
+      dim_t num_threads = get_num_threads();
       if (grain_size > 0) {
-        num_blocks = std::min(num_blocks, ceil_divide(size, grain_size));
+        num_threads = std::min(num_threads, ceil_divide(size, grain_size));
       }
 
-      if (num_blocks == 1) {
+      if (num_threads <= 1) {
         f(begin, end);
         return;
       }
 
-      auto& thread_pool = get_thread_pool();
-      thread_pool.push_loop(begin, end, f, num_blocks);
-      thread_pool.wait_for_tasks();
-
-#endif
+      get_task_scheduler().parallel_for(
+        begin,
+        end,
+        num_threads,
+        [](const void* context, dim_t chunk_begin, dim_t chunk_end) {
+          (*static_cast<const Function*>(context))(chunk_begin, chunk_end);
+        },
+        &f);
     }
 
     template <typename T1, typename T2, typename Function>
@@ -1,6 +1,7 @@
 #include "ctranslate2/primitives.h"
 
 #include <cmath>
+#include <cstring>
 #include <functional>
 #include <numeric>
 #include <stdexcept>
@@ -27,6 +28,9 @@
 
 #include "ctranslate2/allocator.h"
 #include "cpu/backend.h"
+#ifdef CT2_WITH_BUILTIN_GEMM
+#  include "cpu/builtin_gemm.h"
+#endif
 #include "cpu/kernels.h"
 #include "cpu/parallel.h"
 #include "type_dispatch.h"
@@ -80,6 +84,7 @@ namespace ctranslate2 {
   template void primitives<Device::CPU>::convert(const bfloat16_t*, float*, dim_t);
   template void primitives<Device::CPU>::convert(const float16_t*, bfloat16_t*, dim_t);
   template void primitives<Device::CPU>::convert(const bfloat16_t*, float16_t*, dim_t);
+  template void primitives<Device::CPU>::convert(const int8_t*, float*, dim_t);
 
   template<>
   template <typename T>
@@ -543,6 +548,17 @@ namespace ctranslate2 {
                                              const dim_t n,
                                              const float alpha,
                                              float* dest) {
+#ifdef CT2_WITH_BUILTIN_GEMM
+    if (cpu::use_bf16_gemm()) {
+      const dim_t pack_bytes = cpu::builtin_gemm_bf16_pack_b_size(k, n);
+      if (!dest)
+        return pack_bytes;
+      // The destination is a bfloat16 storage, see ops::Gemm::pack_b_input.
+      cpu::builtin_gemm_bf16_pack_b(b, transpose_b, k, n, alpha, reinterpret_cast<uint16_t*>(dest));
+      return 0;
+    }
+#endif
+
 #ifdef CT2_WITH_MKL
     if (sgemm_backend == cpu::GemmBackend::MKL) {
       if (!dest)
@@ -605,6 +621,15 @@ namespace ctranslate2 {
                                              const dim_t n,
                                              const float,
                                              int8_t* dest) {
+#ifdef CT2_WITH_BUILTIN_GEMM
+    if (gemm_s8_backend == cpu::GemmBackend::BUILTIN) {
+      if (!dest)
+        return cpu::builtin_gemm_s8_pack_b_size(k, n);
+      cpu::builtin_gemm_s8_pack_b(b, transpose_b, k, n, dest);
+      return 0;
+    }
+#endif
+
 #ifdef CT2_WITH_MKL
     if (gemm_s8_backend == cpu::GemmBackend::MKL) {
       if (!dest)
@@ -643,6 +668,22 @@ namespace ctranslate2 {
     (void)b_is_packed;
 #endif
 
+#ifdef CT2_WITH_BUILTIN_GEMM
+    // The weights were packed in bfloat16, see gemm_pack_b.
+    if (b_is_packed && cpu::use_bf16_gemm()) {
+      if (a_is_packed || transpose_a)
+        throw std::invalid_argument("The built-in BF16 GEMM does not support a packed "
+                                    "or transposed a matrix");
+      cpu::builtin_gemm_bf16(cpu::mayiuse_amx(),
+                             m, n, k,
+                             a, lda,
+                             reinterpret_cast<const uint16_t*>(b),
+                             beta,
+                             c, ldc);
+      return;
+    }
+#endif
+
     switch (sgemm_backend) {
 
 #ifdef CT2_WITH_MKL
@@ -846,7 +887,7 @@ namespace ctranslate2 {
     }
   }
 
-#ifdef CT2_WITH_MKL
+#if defined(CT2_WITH_MKL) || defined(CT2_WITH_BUILTIN_GEMM)
   static void shift_to_u8(const int8_t* x, uint8_t* ux, dim_t size) {
     cpu::unary_transform(x, ux, size, [](int8_t v) { return static_cast<uint8_t>(v + 128); });
   }
@@ -965,6 +1006,61 @@ namespace ctranslate2 {
     }
 #endif
 
+#ifdef CT2_WITH_BUILTIN_GEMM
+    case cpu::GemmBackend::BUILTIN: {
+      // As for MKL, a is shifted to the uint8 domain and a compensation term is added.
+      if (a_is_packed || transpose_a)
+        throw std::invalid_argument("The built-in INT8 GEMM does not support a packed "
+                                    "or transposed a matrix");
+
+      const uint8_t* ua = nullptr;
+      uint8_t* tmp_ua = nullptr;
+      int32_t* tmp_a_shift_compensation = nullptr;
+      int8_t* tmp_packed_b = nullptr;
+
+      if (a_shift_compensation) {
+        // If the compensation term is passed as argument, we assume a is already shifted.
+        ua = reinterpret_cast<const uint8_t*>(a);
+      } else if (b_is_packed) {
+        throw std::invalid_argument("The built-in INT8 GEMM requires the uint8 shift "
+                                    "compensation term when b is packed");
+      } else {
+        const dim_t a_size = m * k;
+        tmp_ua = static_cast<uint8_t*>(allocator.allocate(a_size));
+        shift_to_u8(a, tmp_ua, a_size);
+        ua = tmp_ua;
+
+        tmp_a_shift_compensation = static_cast<int32_t*>(allocator.allocate(n * sizeof (int32_t)));
+        compute_u8_compensation(b, transpose_b, k, n, alpha, tmp_a_shift_compensation);
+        a_shift_compensation = tmp_a_shift_compensation;
+      }
+
+      if (!b_is_packed) {
+        tmp_packed_b = static_cast<int8_t*>(
+          allocator.allocate(cpu::builtin_gemm_s8_pack_b_size(k, n)));
+        cpu::builtin_gemm_s8_pack_b(b, transpose_b, k, n, tmp_packed_b);
+        b = tmp_packed_b;
+      }
+
+      cpu::builtin_gemm_u8s8s32(cpu::mayiuse_amx(),
+                                m, n, k,
+                                alpha,
+                                ua, lda,
+                                b,
+                                beta,
+                                c, ldc,
+                                a_shift_compensation);
+
+      if (tmp_ua)
+        allocator.free(tmp_ua);
+      if (tmp_a_shift_compensation)
+        allocator.free(tmp_a_shift_compensation);
+      if (tmp_packed_b)
+        allocator.free(tmp_packed_b);
+      break;
+    }
+#endif
+
 #ifdef CT2_WITH_DNNL
     case cpu::GemmBackend::DNNL: {
       const char transa = transpose_a ? 'T' : 'N';
@@ -0,0 +1,315 @@
+#include "task_scheduler.h"
+
+#include <chrono>
+#include <exception>
+#include <map>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+#include "ctranslate2/utils.h"
+#include "env.h"
+#include "numa.h"
+#include "parallel.h"
+
+namespace ctranslate2 {
+  namespace cpu {
+
+    // Number of chunks per participating thread. More chunks balance uneven iterations
+    // better but increase the scheduling overhead.
+    constexpr dim_t chunks_per_thread = 4;
+
+    // Time spent looking for tasks before a worker goes to sleep. Kernels are usually called
+    // in quick succession, so this avoids waking up the workers for each loop.
+    constexpr auto spin_duration = std::chrono::microseconds(50);
+
+    struct TaskScheduler::Loop {
+      LoopFunction function;
+      const void* context;
+      dim_t begin;
+      dim_t end;
+      dim_t chunk_size;
+      dim_t num_chunks;
+      size_t num_threads;
+
+      std::atomic<dim_t> next_chunk{0};
+      std::atomic<dim_t> done_chunks{0};
+
+      std::mutex mutex;
+      std::condition_variable finished;
+      std::exception_ptr exception;
+
+      // Runs chunks until all of them are claimed.
+      void run() {
+        while (true) {
+          const dim_t chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+          if (chunk >= num_chunks)
+            return;
+
+          const dim_t chunk_begin = begin + chunk * chunk_size;
+          const dim_t chunk_end = std::min(end, chunk_begin + chunk_size);
+
+          try {
+            function(context, chunk_begin, chunk_end);
+          } catch (...) {
+            const std::lock_guard<std::mutex> lock(mutex);
+            if (!exception)
+              exception = std::current_exception();
+          }
+
+          if (done_chunks.fetch_add(1, std::memory_order_acq_rel) + 1 == num_chunks) {
+            const std::lock_guard<std::mutex> lock(mutex);
+            finished.notify_all();
+          }
+        }
+      }
+
+      void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] {
+          return done_chunks.load(std::memory_order_acquire) == num_chunks;
+        });
+        if (exception)
+          std::rethrow_exception(exception);
+      }
+    };
+
+    struct WorkerInfo {
+      TaskScheduler* scheduler = nullptr;
+      size_t index = 0;
+    };
+
+    static thread_local WorkerInfo local_worker;
+
+
+    TaskScheduler::TaskScheduler(size_t num_workers, std::vector<int> cpus)
+      : _cpus(std::move(cpus))
+    {
+      _workers.reserve(num_workers);
+      for (size_t i = 0; i < num_workers; ++i)
+        _workers.emplace_back(std::make_unique<Worker>());
+      for (size_t i = 0; i < num_workers; ++i)
+        _workers[i]->thread = std::thread(&TaskScheduler::run_worker, this, i);
+    }
+
+    TaskScheduler::~TaskScheduler() {
+      {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        _request_end = true;
+      }
+
+      _can_get_task.notify_all();
+
+      for (auto& worker : _workers)
+        worker->thread.join();
+    }
+
+    void TaskScheduler::parallel_for(dim_t begin,
+                                     dim_t end,
+                                     dim_t max_threads,
+                                     LoopFunction function,
+                                     const void* context) {
+      const dim_t size = end - begin;
+      const dim_t num_threads = std::min({max_threads,
+                                          static_cast<dim_t>(_workers.size() + 1),
+                                          size});
+
+      if (num_threads <= 1) {
+        function(context, begin, end);
+        return;
+      }
+
+      auto loop = std::make_shared<Loop>();
+      loop->function = function;
+      loop->context = context;
+      loop->begin = begin;
+      loop->end = end;
+      loop->chunk_size = ceil_divide(size, num_threads * chunks_per_thread);
+      loop->num_chunks = ceil_divide(size, loop->chunk_size);
+      loop->num_threads = get_num_threads();
+
+      push_tasks(loop, num_threads - 1);
+
+#ifdef _OPENMP
+      // The BLAS calls made by the loop run on the thread of the chunk, like in a nested
+      // OpenMP region, so that they do not start more threads than the loop budget.
+      const int omp_num_threads = omp_get_max_threads();
+      omp_set_num_threads(1);
+#endif
+
+      loop->run();
+
+#ifdef _OPENMP
+      omp_set_num_threads(omp_num_threads);
+#endif
+
+      loop->wait();
+    }
+
+    void TaskScheduler::push_tasks(const std::shared_ptr<Loop>& loop, dim_t num_tasks) {
+      _num_pending.fetch_add(num_tasks);
+
+      if (local_worker.scheduler == this) {
+        // Nested loop: the tasks are added to the queue of this worker and can be stolen.
+        auto& worker = *_workers[local_worker.index];
+        const std::lock_guard<std::mutex> lock(worker.mutex);
+        for (dim_t i = 0; i < num_tasks; ++i)
+          worker.tasks.emplace_back(loop);
+      } else {
+        const std::lock_guard<std::mutex> lock(_shared_mutex);
+        for (dim_t i = 0; i < num_tasks; ++i)
+          _shared_tasks.emplace_back(loop);
+      }
+
+      const size_t num_sleeping = _num_sleeping.load();
+      if (num_sleeping > 0) {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        if (static_cast<size_t>(num_tasks) >= num_sleeping)
+          _can_get_task.notify_all();
+        else {
+          for (dim_t i = 0; i < num_tasks; ++i)
+            _can_get_task.notify_one();
+        }
+      }
+    }
+
+    std::shared_ptr<TaskScheduler::Loop> TaskScheduler::pop_task(size_t index) {
+      std::shared_ptr<Loop> loop;
+
+      if (_num_pending.load(std::memory_order_relaxed) == 0)
+        return loop;
+
+      // The worker first runs the most recent task of its queue, which is usually the
+      // innermost loop, then the tasks posted by the other threads, then steals the
+      // oldest task from another worker.
+      {
+        auto& worker = *_workers[index];
+        const std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+          loop = std::move(worker.tasks.back());
+          worker.tasks.pop_back();
+        }
+      }
+
+      if (!loop) {
+        const std::lock_guard<std::mutex> lock(_shared_mutex);
+        if (!_shared_tasks.empty()) {
+          loop = std::move(_shared_tasks.front());
+          _shared_tasks.pop_front();
+        }
+      }
+
+      for (size_t i = 1; !loop && i < _workers.size(); ++i) {
+        auto& victim = *_workers[(index + i) % _workers.size()];
+        const std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+          loop = std::move(victim.tasks.front());
+          victim.tasks.pop_front();
+        }
+      }
+
+      if (loop)
+        _num_pending.fetch_sub(1);
+      return loop;
+    }
+
+    void TaskScheduler::run_task(Loop& loop) {
+      // Nested loops use the number of threads of the thread that started the outer loop.
+      const size_t num_threads = get_num_threads();
+      set_num_threads(loop.num_threads);
+      loop.run();
+      set_num_threads(num_threads);
+    }
+
+    void TaskScheduler::run_worker(size_t index) {
+      local_worker.scheduler = this;
+      local_worker.index = index;
+
+      if (!_cpus.empty())
+        set_thread_cpus(_cpus);
+
+#ifdef _OPENMP
+      omp_set_num_threads(1);
+#endif
+
+      auto idle_since = std::chrono::steady_clock::now();
+
+      while (true) {
+        auto loop = pop_task(index);
+        if (loop) {
+          run_task(*loop);
+          idle_since = std::chrono::steady_clock::now();
+          continue;
+        }
+
+        if (std::chrono::steady_clock::now() - idle_since < spin_duration) {
+          std::this_thread::yield();
+          continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _num_sleeping.fetch_add(1);
+        _can_get_task.wait(lock, [this] {
+          return _request_end || _num_pending.load() > 0;
+        });
+        _num_sleeping.fetch_sub(1);
+
+        if (_request_end)
+          break;
+
+        idle_since = std::chrono::steady_clock::now();
+      }
+    }
+
+
+    static std::unique_ptr<TaskScheduler> create_task_scheduler(int numa_node) {
+      std::vector<int> cpus;
+
+      if (numa_node >= 0) {
+        for (const auto& node : get_numa_nodes()) {
+          if (node.id == numa_node)
+            cpus = node.cpus;
+        }
+      } else {
+        cpus = get_process_cpus();
+      }
+
+      size_t num_cores = cpus.size();
+      if (num_cores == 0)
+        num_cores = std::max(std::thread::hardware_concurrency(), 1u);
+
+      // The thread calling parallel_for also runs a part of the loop.
+      const size_t num_workers = std::max(read_int_from_env("CT2_CPU_WORKER_THREADS",
+                                                            static_cast<int>(num_cores) - 1),
+                                          0);
+
+      return std::make_unique<TaskScheduler>(num_workers, std::move(cpus));
+    }
+
+    TaskScheduler& get_task_scheduler() {
+      if (local_worker.scheduler)
+        return *local_worker.scheduler;
+
+      static thread_local int cached_numa_node = -1;
+      static thread_local TaskScheduler* cached_scheduler = nullptr;
+
+      const int numa_node = get_thread_numa_node();
+      if (!cached_scheduler || cached_numa_node != numa_node) {
+        static std::mutex mutex;
+        static std::map<int, std::unique_ptr<TaskScheduler>> schedulers;
+
+        const std::lock_guard<std::mutex> lock(mutex);
+        auto& scheduler = schedulers[numa_node];
+        if (!scheduler)
+          scheduler = create_task_scheduler(numa_node);
+
+        cached_numa_node = numa_node;
+        cached_scheduler = scheduler.get();
+      }
+
+      return *cached_scheduler;
+    }
+
+  }
+}
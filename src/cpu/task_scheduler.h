@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ctranslate2/types.h"
+
+namespace ctranslate2 {
+  namespace cpu {
+
+    // Pool of worker threads running the parallel loops of the CPU kernels. In OpenMP builds,
+    // OpenMP is only used by the BLAS libraries.
+    //
+    // A single pool is shared by all threads of the process (one pool per NUMA node when
+    // replicas are bound to nodes), so the number of running threads does not grow with
+    // the number of replicas. Each loop is split in small chunks that are claimed
+    // dynamically, so uneven iterations do not leave threads idle.
+    //
+    // The thread calling parallel_for always participates and can complete the loop alone.
+    // Loops can then be nested: a worker running a loop offers the chunks of the inner loop
+    // in its own queue and the idle workers steal them.
+    class TaskScheduler {
+    public:
+      using LoopFunction = void (*)(const void* context, dim_t begin, dim_t end);
+
+      // The workers are restricted to the given CPUs, if any.
+      TaskScheduler(size_t num_workers, std::vector<int> cpus = {});
+      ~TaskScheduler();
+
+      TaskScheduler(const TaskScheduler&) = delete;
+      TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+      size_t num_workers() const {
+        return _workers.size();
+      }
+
+      // Calls function(context, i, j) on chunks of [begin, end) using at most max_threads
+      // threads, including the calling thread. Exceptions are rethrown in the calling thread.
+      void parallel_for(dim_t begin,
+                        dim_t end,
+                        dim_t max_threads,
+                        LoopFunction function,
+                        const void* context);
+
+    private:
+      struct Loop;
+
+      struct Worker {
+        std::mutex mutex;
+        std::deque<std::shared_ptr<Loop>> tasks;
+        std::thread thread;
+      };
+
+      void run_worker(size_t index);
+      void push_tasks(const std::shared_ptr<Loop>& loop, dim_t num_tasks);
+      std::shared_ptr<Loop> pop_task(size_t index);
+      void run_task(Loop& loop);
+
+      const std::vector<int> _cpus;
+      std::vector<std::unique_ptr<Worker>> _workers;
+
+      // Tasks posted by threads that are not workers of this pool.
+      std::mutex _shared_mutex;
+      std::deque<std::shared_ptr<Loop>> _shared_tasks;
+
+      std::mutex _mutex;
+      std::condition_variable _can_get_task;
+      std::atomic<size_t> _num_pending{0};
+      std::atomic<size_t> _num_sleeping{0};
+      bool _request_end = false;
+    };
+
+    // Returns the pool used by the current thread: the pool of its NUMA node, or the pool
+    // shared by the unbound threads. The pools are created on first use.
+    TaskScheduler& get_task_scheduler();
+
+  }
+}
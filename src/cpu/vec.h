@@ -43,6 +43,12 @@ namespace ctranslate2 {
         return *ptr;
       }
 
+      // Loads width bytes and converts their low and high 4 bits.
+      static inline void load_int4(const uint8_t* ptr, value_type& low, value_type& high) {
+        low = *ptr & 0xF;
+        high = *ptr >> 4;
+      }
+
       static inline void store(value_type value, T* ptr) {
         *ptr = value;
       }
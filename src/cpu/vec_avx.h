@@ -82,6 +82,26 @@ namespace ctranslate2 {
         }
       }
 
+      // Loads width bytes and converts their low and high 4 bits.
+      static inline void load_int4(const uint8_t* ptr, value_type& low, value_type& high) {
+        const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ptr));
+#ifdef __AVX2__
+        const __m256i values = _mm256_cvtepu8_epi32(bytes);
+        low = _mm256_cvtepi32_ps(_mm256_and_si256(values, _mm256_set1_epi32(0xF)));
+        high = _mm256_cvtepi32_ps(_mm256_srli_epi32(values, 4));
+#else
+        const __m128i mask = _mm_set1_epi32(0xF);
+        const __m128i values_0 = _mm_cvtepu8_epi32(bytes);
+        const __m128i values_1 = _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 4));
+        low = _mm256_cvtepi32_ps(_mm256_insertf128_si256(
+          _mm256_castsi128_si256(_mm_and_si128(values_0, mask)),
+          _mm_and_si128(values_1, mask), 1));
+        high = _mm256_cvtepi32_ps(_mm256_insertf128_si256(
+          _mm256_castsi128_si256(_mm_srli_epi32(values_0, 4)),
+          _mm_srli_epi32(values_1, 4), 1));
+#endif
+      }
+
       static inline void store(value_type value, float* ptr) {
         _mm256_storeu_ps(ptr, value);
       }
@@ -46,6 +46,14 @@ namespace ctranslate2 {
         return _mm512_cvtepi32_ps(_mm512_mask_loadu_epi32(padding, mask, ptr));
       }
 
+      // Loads width bytes and converts their low and high 4 bits.
+      static inline void load_int4(const uint8_t* ptr, value_type& low, value_type& high) {
+        const __m512i values = _mm512_cvtepu8_epi32(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr)));
+        low = _mm512_cvtepi32_ps(_mm512_and_si512(values, _mm512_set1_epi32(0xF)));
+        high = _mm512_cvtepi32_ps(_mm512_srli_epi32(values, 4));
+      }
+
       static inline void store(value_type value, float* ptr) {
         _mm512_storeu_ps(ptr, value);
       }
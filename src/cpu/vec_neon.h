@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstring>
+
 #include <arm_neon.h>
 #include <neon_mathfun.h>
 
@@ -57,6 +59,15 @@ namespace ctranslate2 {
         }
       }
 
+      // Loads width bytes and converts their low and high 4 bits.
+      static inline void load_int4(const uint8_t* ptr, value_type& low, value_type& high) {
+        uint32_t bytes;
+        std::memcpy(&bytes, ptr, sizeof (bytes));
+        const uint8x8_t values = vreinterpret_u8_u32(vdup_n_u32(bytes));
+        low = vcvtq_f32_u32(vmovl_u16(vget_low_u16(vmovl_u8(vand_u8(values, vdup_n_u8(0xF))))));
+        high = vcvtq_f32_u32(vmovl_u16(vget_low_u16(vmovl_u8(vshr_n_u8(values, 4)))));
+      }
+
       static inline void store(value_type value, float* ptr) {
         vst1q_f32(ptr, value);
       }
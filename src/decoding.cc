@@ -6,6 +6,7 @@
 #include <numeric>
 
 #include "ctranslate2/ops/ops.h"
+#include "ctranslate2/scheduling.h"
 #include "dispatch.h"
 
 namespace ctranslate2 {
@@ -412,15 +413,49 @@ namespace ctranslate2 {
                          const float length_penalty,
                          const float coverage_penalty,
                          const float prefix_bias_beta,
-                         const float patience)
+                         const float patience,
+                         std::function<bool(DecodingStepResult)> callback)
     : _beam_size(beam_size)
     , _length_penalty(length_penalty)
     , _coverage_penalty(coverage_penalty)
     , _prefix_bias_beta(prefix_bias_beta)
     , _max_candidates(get_max_candidates(beam_size, patience))
+    , _callback(std::move(callback))
   {
   }
 
+  // Returns the number of tokens after start that are the same in all alive beams and
+  // registered hypotheses of a batch. The beams are the candidates selected in active_beams.
+  static dim_t get_stable_length(const StorageView& alive_seq,
+                                 const StorageView& active_beams,
+                                 const std::vector<std::vector<size_t>>& hypotheses,
+                                 const dim_t batch,
+                                 const dim_t beam_size,
+                                 const dim_t num_candidates,
+                                 const dim_t start,
+                                 dim_t stable_length) {
+    const dim_t length = alive_seq.dim(-1) - start;
+    const int32_t* beam_ids = active_beams.index<int32_t>({batch * beam_size});
+
+    for (; stable_length < length; ++stable_length) {
+      const dim_t t = start + stable_length;
+      const int32_t id = alive_seq.at<int32_t>({batch, beam_ids[0] - batch * num_candidates, t});
+
+      for (dim_t k = 1; k < beam_size; ++k) {
+        if (alive_seq.at<int32_t>({batch, beam_ids[k] - batch * num_candidates, t}) != id)
+          return stable_length;
+      }
+
+      for (const auto& hypothesis : hypotheses) {
+        if (static_cast<dim_t>(hypothesis.size()) <= stable_length
+            || hypothesis[stable_length] != static_cast<size_t>(id))
+          return stable_length;
+      }
+    }
+
+    return stable_length;
+  }
+
   std::vector<DecodingResult>
   BeamSearch::search(layers::Decoder& decoder,
                      layers::DecoderState& state,
@@ -490,7 +525,33 @@ namespace ctranslate2 {
                                         return_prefix,
                                         use_hard_prefix ? prefix_ids : nullptr);
 
+    // Number of tokens of each hypothesis that were passed to the callback.
+    std::vector<dim_t> num_streamed_tokens(_callback ? batch_size : 0, 0);
+
+    // Passes the tokens [begin, end) of the hypothesis to the callback and returns true
+    // if the decoding of this batch should stop.
+    const auto stream_tokens = [this, &num_streamed_tokens](const size_t batch_id,
+                                                           const dim_t start,
+                                                           const size_t* hypothesis,
+                                                           const dim_t end,
+                                                           const bool is_last) {
+      for (dim_t& t = num_streamed_tokens[batch_id]; t < end;) {
+        DecodingStepResult step_result;
+        step_result.step = start + t;
+        step_result.batch_id = batch_id;
+        step_result.token_id = hypothesis[t];
+        step_result.hypothesis_id = 0;
+        step_result.is_last = is_last && t + 1 == end;
+        ++t;
+        if (_callback(std::move(step_result)))
+          return true;
+      }
+      return false;
+    };
+
     for (dim_t step = 0; step < max_step; ++step) {
+      const TraceArgScope trace_step(TraceArg::Step, start_step + step);
+      check_request_cancelled();
       const bool is_expanded = (!expand_after_first_step || step > 0);
 
       // Compute log probs for the current step.
@@ -656,6 +717,37 @@ namespace ctranslate2 {
         else
           is_finished = result.hypotheses.size() >= _max_candidates;
 
+        bool stop_streaming = false;
+        if (_callback && !is_finished) {
+          const dim_t start = return_prefix ? 0 : prefix_length;
+          const dim_t stable_length = get_stable_length(alive_seq,
+                                                        active_beams,
+                                                        result.hypotheses,
+                                                        i,
+                                                        _beam_size,
+                                                        num_candidates,
+                                                        start,
+                                                        num_streamed_tokens[batch_id]);
+
+          if (stable_length > num_streamed_tokens[batch_id]) {
+            const dim_t best_beam = active_beams.at<int32_t>(i * _beam_size) - i * num_candidates;
+            const auto* ids = alive_seq.index<int32_t>({i, best_beam, start});
+            const std::vector<size_t> tokens(ids, ids + stable_length);
+
+            if (stream_tokens(batch_id, start, tokens.data(), stable_length, false)) {
+              // Stop the decoding and also consider the best active beam.
+              result.scores.emplace_back(topk_scores.scalar_at<float>({i, best_beam}));
+              result.hypotheses.emplace_back(build_hypothesis(alive_seq, i, best_beam, start, step + 1));
+              if (alive_attention)
+                result.attention.emplace_back(build_attention(alive_attention, i, best_beam, start, step + 1));
+              if (return_logits_vocab)
+                result.logits_vocab.emplace_back(std::move(logits_vec[is_expanded ? i * _beam_size : i]));
+              is_finished = true;
+              stop_streaming = true;
+            }
+          }
+        }
+
         if (is_finished) {
           finalize_result(result,
                           num_hypotheses,
@@ -664,6 +756,15 @@ namespace ctranslate2 {
                           return_scores,
                           return_attention,
                           return_logits_vocab);
+
+          if (_callback && !stop_streaming && !result.hypotheses.empty()) {
+            const auto& hypothesis = result.hypotheses[0];
+            stream_tokens(batch_id,
+                          return_prefix ? 0 : prefix_length,
+                          hypothesis.data(),
+                          hypothesis.size(),
+                          true);
+          }
         } else {
           non_finished_index.emplace_back(i);
         }
@@ -750,11 +851,10 @@ namespace ctranslate2 {
 
     // We can return multiple hypotheses from greedy search when random sampling is enabled.
     // In that case we replicate the batches and then merge the hypotheses in a single result.
+    // The hypotheses can finish at different steps, so the states that are not replicated
+    // (e.g. the encoder memory) are indexed instead of copied.
     if (num_hypotheses > 1) {
-      for (auto& [name, value] : state) {
-        if (value)
-          repeat_batch(value, num_hypotheses);
-      }
+      decoder.replicate_state(state, num_hypotheses, /*independent_replicas=*/true);
 
       std::vector<size_t> repeat_start_ids = repeat_vector(start_ids, num_hypotheses);
       std::vector<std::vector<size_t>> repeat_prefix_ids;
@@ -842,6 +942,8 @@ namespace ctranslate2 {
     const dim_t max_step = get_max_step(max_length, return_prefix, prefix_ids);
 
     for (dim_t step = 0; step < max_step; ++step) {
+      const TraceArgScope trace_step(TraceArg::Step, start_step + step);
+      check_request_cancelled();
       convert_to_original_word_ids(decoder, sample_from);
       decoder(start_step + step,
               sample_from.to(device),
@@ -973,7 +1075,8 @@ namespace ctranslate2 {
     return results;
   }
 
-  static layers::DecoderState get_batch_state(const layers::DecoderState& state,
+  static layers::DecoderState get_batch_state(const layers::Decoder& decoder,
+                                              const layers::DecoderState& state,
                                               const int32_t batch_id) {
     const Device device = state.begin()->second.device();
     const ops::Gather gather_op;
@@ -988,7 +1091,9 @@ namespace ctranslate2 {
       const auto& name = pair.first;
       const auto& value = pair.second;
       StorageView batch_value(value.dtype(), device);
-      if (value)
+      if (decoder.shared_state(name))
+        batch_value = value;
+      else if (value)
         gather_op(value, indices, batch_value);
       batch_state.emplace(name, std::move(batch_value));
     }
@@ -1049,10 +1154,6 @@ namespace ctranslate2 {
             || options.min_alternative_expansion_prob > 1))
       throw std::invalid_argument("The minimum alternative expansion probability must be "
                                   "between 0 and 1");
-    if (options.callback && (options.beam_size != 1 || options.prefix_bias_beta > 0))
-      throw std::invalid_argument("The callback function is not compatible with "
-                                  "beam_size > 1 or prefix_bias_beta > 0");
-
     if (options.sampling_topp <= 0 || options.sampling_topp > 1)
       throw std::invalid_argument("The sampling_topp parameter must be between 0 and 1");
     if (options.sampling_topp < 1
@@ -1084,7 +1185,8 @@ namespace ctranslate2 {
                                           options.length_penalty,
                                           options.coverage_penalty,
                                           options.prefix_bias_beta,
-                                          options.patience);
+                                          options.patience,
+                                          options.callback);
   }
 
   static std::vector<std::shared_ptr<LogitsProcessor>>
@@ -1223,14 +1325,15 @@ namespace ctranslate2 {
 
     const size_t num_alternatives = start_ids.size();
 
-    for (auto& [name, value] : state) {
-      if (decoder.replicate_state(name)) {
-        // Reduce state to the effective number of alternatives.
-        if (num_alternatives < options.num_hypotheses)
+    // The beam dimension becomes the batch, so the alternatives are decoded independently and
+    // the states that are not replicated must be indexed.
+    decoder.add_source_index(state);
+
+    // Reduce state to the effective number of alternatives.
+    if (num_alternatives < options.num_hypotheses) {
+      for (auto& [name, value] : state) {
+        if (!decoder.shared_state(name) && decoder.replicate_state(name))
           value.resize(0, num_alternatives);
-      } else {
-        // The beam dimension becomes the batch so we need to replicate all states.
-        repeat_batch(value, num_alternatives);
       }
     }
 
@@ -1303,6 +1406,346 @@ namespace ctranslate2 {
     return new_ids;
   }
 
+  static void map_to_output_word_ids(const layers::Decoder& decoder,
+                                     std::vector<size_t>& end_ids,
+                                     DecodingOptions& options) {
+    end_ids = map_to_output_word_ids(decoder, end_ids);
+    for (auto& ids : options.disable_sequences)
+      ids = map_to_output_word_ids(decoder, ids);
+
+    options.disable_ids = map_to_output_word_ids(decoder, options.disable_ids);
+    options.disable_ids_begin = map_to_output_word_ids(decoder, options.disable_ids_begin);
+  }
+
+  static void restore_original_word_ids(const layers::Decoder& decoder, DecodingResult& result) {
+    for (auto& hypothesis : result.hypotheses) {
+      for (auto& id : hypothesis)
+        id = decoder.to_original_word_id(id);
+    }
+  }
+
+  // Decoding state of a sequence that is decoded on its own with greedy search or random
+  // sampling, e.g. when the sequences of a batch are at different steps.
+  struct SingleSequence {
+    DecodingOptions options;
+    std::vector<size_t> end_ids;
+    std::vector<std::vector<size_t>> prefix_ids;
+    std::unique_ptr<const Sampler> sampler;
+    std::vector<std::shared_ptr<LogitsProcessor>> logits_processors;
+    StorageView alive_seq;
+    dim_t step = 0;
+    size_t next_id = 0;
+    DecodingResult result;
+  };
+
+  static void validate_single_sequence_options(const DecodingOptions& options,
+                                               const std::string& mode) {
+    if (options.beam_size != 1
+        || options.num_hypotheses != 1
+        || options.prefix_bias_beta > 0
+        || options.coverage_penalty != 0
+        || options.return_attention
+        || options.return_alternatives)
+      throw std::invalid_argument(mode + " only supports greedy search and random sampling "
+                                  "with a single hypothesis, and does not return attention "
+                                  "weights or alternatives");
+  }
+
+  // The start tokens are output ids. The first token is the decoder start token and the
+  // next tokens are the prefix.
+  static SingleSequence make_single_sequence(const std::vector<size_t>& start_tokens,
+                                             std::vector<size_t> end_ids,
+                                             DecodingOptions options) {
+    SingleSequence sequence;
+    sequence.sampler = make_sampler(options);
+    sequence.logits_processors = make_logits_processors(options);
+    sequence.end_ids = std::move(end_ids);
+    sequence.prefix_ids.emplace_back(start_tokens.begin() + 1, start_tokens.end());
+    sequence.step = sequence.prefix_ids[0].size();
+    sequence.result.hypotheses.resize(1);
+    if (options.return_scores)
+      sequence.result.scores.resize(1, 0.f);
+    if (options.return_prefix)
+      sequence.result.hypotheses[0] = sequence.prefix_ids[0];
+    if (sequence.step > 0) {
+      const std::vector<int32_t> prefix(sequence.prefix_ids[0].begin(),
+                                        sequence.prefix_ids[0].end());
+      sequence.alive_seq = StorageView({1, sequence.step}, prefix);
+    }
+    sequence.options = std::move(options);
+    return sequence;
+  }
+
+  // Reports the prefix tokens as if they were generated, like in greedy search. logits has
+  // the shape [1, time, vocab] and the first time steps are the prefix positions.
+  static void process_prefix(SingleSequence& sequence, const StorageView& logits) {
+    const auto& options = sequence.options;
+    const auto& prefix = sequence.prefix_ids[0];
+    const dim_t vocabulary_size = logits.dim(-1);
+
+    for (size_t t = 0; t < prefix.size(); ++t) {
+      StorageView step_logits(logits.dtype(), logits.device());
+      if (options.return_logits_vocab) {
+        const ops::Slide slide_op(1, t, 1);
+        slide_op(logits, step_logits);
+        sequence.result.logits_vocab.resize(1);
+        sequence.result.logits_vocab[0].emplace_back(
+          StorageView(step_logits).reshape({vocabulary_size}));
+      }
+
+      // As in greedy search, the prefix tokens have a score of 0.
+      if (options.callback && options.return_prefix) {
+        DecodingStepResult step_result;
+        step_result.step = t;
+        step_result.batch_id = 0;
+        step_result.token_id = prefix[t];
+        step_result.hypothesis_id = 0;
+        step_result.is_last = false;
+        if (options.return_scores)
+          step_result.score = 0;
+        if (options.return_logits_vocab)
+          step_result.logits = std::move(step_logits.reshape({1, vocabulary_size}));
+        options.callback(std::move(step_result));
+      }
+    }
+  }
+
+  // Selects the next token from the logits of shape [1, vocab] and returns true if the
+  // sequence is finished.
+  static bool process_step(SingleSequence& sequence, StorageView& logits) {
+    static const std::vector<dim_t> batch_offset = {0};
+
+    const auto& options = sequence.options;
+    const dim_t step = sequence.step;
+    const dim_t prefix_length = sequence.prefix_ids[0].size();
+    const auto* prefix_ids = prefix_length > 0 ? &sequence.prefix_ids : nullptr;
+    const DataType dtype = logits.dtype();
+    const Device device = logits.device();
+
+    DisableTokens disable_tokens(logits);
+
+    // Prevent the generation of end_id until the minimum length is reached.
+    apply_min_length(step,
+                     options.min_length,
+                     sequence.end_ids,
+                     disable_tokens,
+                     batch_offset,
+                     options.return_prefix,
+                     prefix_ids);
+
+    for (const auto& logits_processor : sequence.logits_processors)
+      logits_processor->apply(step,
+                              logits,
+                              disable_tokens,
+                              sequence.alive_seq,
+                              batch_offset,
+                              prefix_ids);
+
+    disable_tokens.apply();
+
+    StorageView logits_orig(dtype, device);
+    if (options.return_logits_vocab) {
+      logits_orig.copy_from(logits);
+      sequence.result.logits_vocab.resize(1);
+      sequence.result.logits_vocab[0].emplace_back(
+        StorageView(logits_orig).reshape({logits.dim(-1)}));
+    }
+
+    if (options.return_scores)
+      ops::LogSoftMax()(logits);
+
+    StorageView best_ids(DataType::INT32);
+    StorageView best_probs(dtype);
+    (*sequence.sampler)(logits, best_ids, best_probs);
+
+    const size_t word_id = best_ids.at<int32_t>(0);
+    const float score = best_probs.scalar_at<float>({0, 0});
+
+    if (!sequence.logits_processors.empty()) {
+      if (sequence.alive_seq) {
+        const StorageView cur_alive_seq = std::move(sequence.alive_seq);
+        ops::Concat(-1)({&cur_alive_seq, &best_ids}, sequence.alive_seq);
+      } else {
+        sequence.alive_seq = best_ids;
+      }
+    }
+
+    const bool is_end = is_eos(word_id, sequence.end_ids);
+    if (!is_end || options.include_eos_in_hypotheses)
+      sequence.result.hypotheses[0].push_back(word_id);
+    if (options.return_scores)
+      sequence.result.scores[0] += score;
+
+    const dim_t max_step = options.max_length + (options.return_prefix ? 0 : prefix_length);
+    bool is_finished = is_end || step + 1 >= max_step;
+
+    if (options.callback) {
+      DecodingStepResult step_result;
+      step_result.step = step;
+      step_result.batch_id = 0;
+      step_result.token_id = word_id;
+      step_result.hypothesis_id = 0;
+      step_result.is_last = is_finished;
+      if (options.return_scores)
+        step_result.score = score;
+      if (options.return_logits_vocab)
+        step_result.logits = std::move(logits_orig);
+      if (options.callback(std::move(step_result)))
+        is_finished = true;
+    }
+
+    sequence.step++;
+    sequence.next_id = word_id;
+    return is_finished;
+  }
+
+  static DecodingResult finalize_sequence(SingleSequence& sequence) {
+    const auto& options = sequence.options;
+    DecodingResult result = std::move(sequence.result);
+
+    finalize_result(result,
+                    1,
+                    options.length_penalty,
+                    /*coverage_penalty=*/0,
+                    options.return_scores,
+                    /*keep_attention=*/false,
+                    options.return_logits_vocab);
+    return result;
+  }
+
+  // Forwards ids in the decoder and returns the logits with shape [1, time, vocab].
+  static StorageView forward_ids(layers::Decoder& decoder,
+                                 layers::DecoderState& state,
+                                 const dim_t step,
+                                 const std::vector<size_t>& ids) {
+    const Device device = decoder.device();
+    StorageView logits(decoder.output_type(), device);
+
+    if (ids.size() == 1) {
+      decoder(step, StorageView({1}, int32_t(ids[0]), device), state, &logits);
+      logits.expand_dims(1);
+    } else {
+      decoder(step, layers::make_sequence_inputs({ids}, device), state, &logits);
+    }
+
+    return logits;
+  }
+
+  // Speculative decoding of a single sequence: the draft decoder proposes a few tokens with
+  // greedy search and the decoder verifies all of them in a single forward pass. The accepted
+  // tokens are the longest prefix of the proposal that matches the decoder predictions, so
+  // the result is the same as greedy search with the decoder alone.
+  static DecodingResult speculative_decode(layers::Decoder& decoder,
+                                           layers::DecoderState& state,
+                                           layers::Decoder& draft_decoder,
+                                           layers::DecoderState& draft_state,
+                                           const std::vector<size_t>& start_tokens,
+                                           std::vector<size_t> end_ids,
+                                           DecodingOptions options) {
+    PROFILE("speculative_decode");
+    const DataType dtype = decoder.output_type();
+    const Device device = decoder.device();
+    const dim_t start_step = options.start_step;
+    const dim_t num_draft_tokens = options.num_draft_tokens;
+    options.draft_decoder = nullptr;
+    options.draft_state = nullptr;
+
+    // Original ids of the sequence. The first "length" ids are in the decoder cache and the
+    // first "draft_length" ids are in the draft decoder cache.
+    std::vector<size_t> ids;
+    ids.reserve(start_tokens.size() + options.max_length);
+    for (const size_t id : start_tokens)
+      ids.emplace_back(decoder.to_original_word_id(id));
+    dim_t length = 0;
+    dim_t draft_length = 0;
+
+    SingleSequence sequence = make_single_sequence(start_tokens,
+                                                   std::move(end_ids),
+                                                   std::move(options));
+
+    const dim_t prefix_length = sequence.prefix_ids[0].size();
+    const dim_t max_step = (sequence.options.max_length
+                            + (sequence.options.return_prefix ? 0 : prefix_length));
+    const BestSampler draft_sampler;
+
+    while (true) {
+      const TraceArgScope trace_step(TraceArg::Step, start_step + length);
+      check_request_cancelled();
+
+      // Propose draft tokens, keeping one step for the token predicted by the decoder after
+      // the last accepted draft token.
+      const dim_t num_proposals = std::min(num_draft_tokens, max_step - sequence.step - 1);
+      std::vector<size_t> draft_ids;
+      std::vector<size_t> draft_inputs(ids.begin() + draft_length, ids.end());
+
+      for (dim_t i = 0; i < num_proposals; ++i) {
+        StorageView logits = forward_ids(draft_decoder,
+                                         draft_state,
+                                         start_step + draft_length,
+                                         draft_inputs);
+        draft_length += draft_inputs.size();
+
+        StorageView last_logits(logits.dtype(), logits.device());
+        TYPE_DISPATCH(logits.dtype(),
+                      last_logits.view(logits.index<T>({0, logits.dim(1) - 1, 0}),
+                                       {1, logits.dim(-1)}));
+
+        StorageView best_ids(DataType::INT32);
+        StorageView best_probs(logits.dtype());
+        draft_sampler(last_logits, best_ids, best_probs);
+
+        const size_t draft_id = draft_decoder.to_original_word_id(best_ids.at<int32_t>(0));
+        draft_ids.emplace_back(draft_id);
+        draft_inputs = {draft_id};
+        if ((decoder.output_layer_is_updated() && !decoder.is_in_output(draft_id))
+            || is_eos(decoder.to_output_word_id(draft_id), sequence.end_ids))
+          break;
+      }
+
+      // Verify all draft tokens in a single forward pass.
+      const dim_t num_ids = ids.size();
+      const dim_t num_pending = num_ids - length;
+      std::vector<size_t> inputs(ids.begin() + length, ids.end());
+      inputs.insert(inputs.end(), draft_ids.begin(), draft_ids.end());
+
+      StorageView logits = forward_ids(decoder, state, start_step + length, inputs);
+
+      if (length == 0 && prefix_length > 0)
+        process_prefix(sequence, logits);
+
+      const dim_t vocabulary_size = logits.dim(-1);
+      StorageView step_logits(dtype, device);
+      dim_t num_accepted = 0;
+      bool is_finished = false;
+
+      for (size_t i = 0; i <= draft_ids.size(); ++i) {
+        TYPE_DISPATCH(dtype,
+                      step_logits.view(logits.index<T>({0, num_pending - 1 + dim_t(i), 0}),
+                                       {1, vocabulary_size}));
+
+        is_finished = process_step(sequence, step_logits);
+        const size_t id = decoder.to_original_word_id(sequence.next_id);
+        ids.emplace_back(id);
+
+        if (is_finished || i == draft_ids.size() || id != draft_ids[i])
+          break;
+        ++num_accepted;
+      }
+
+      if (is_finished)
+        break;
+
+      // Remove the rejected draft tokens from the caches.
+      length = num_ids + num_accepted;
+      draft_length = std::min(draft_length, length);
+      decoder.truncate_state(state, start_step + length);
+      draft_decoder.truncate_state(draft_state, start_step + draft_length);
+    }
+
+    return finalize_sequence(sequence);
+  }
+
+
   std::vector<DecodingResult>
   decode(layers::Decoder& decoder,
          layers::DecoderState& state,
@@ -1312,27 +1755,50 @@ namespace ctranslate2 {
     validate_decoding_options(options, decoder.device());
     const size_t batch_size = start_tokens.size();
 
+    if (options.draft_decoder) {
+      validate_single_sequence_options(options, "Speculative decoding");
+      if (options.sampling_topk != 1)
+        throw std::invalid_argument("Speculative decoding only supports greedy search");
+      if (options.num_draft_tokens == 0)
+        throw std::invalid_argument("The number of draft tokens must be > 0");
+      if (!options.draft_state && options.start_step > 0)
+        throw std::invalid_argument("The draft decoder state should be set when the "
+                                    "decoding does not start at step 0");
+    }
+
     if (batch_size == 0)
       throw std::invalid_argument("No decoder start tokens are set");
 
     std::vector<DecodingResult> results;
 
     if (decoder.output_layer_is_updated()) {
-      end_ids = map_to_output_word_ids(decoder, end_ids);
-
       for (auto& ids : start_tokens)
         ids = map_to_output_word_ids(decoder, ids);
-      for (auto& ids : options.disable_sequences)
-        ids = map_to_output_word_ids(decoder, ids);
-
-      options.disable_ids = map_to_output_word_ids(decoder, options.disable_ids);
-      options.disable_ids_begin = map_to_output_word_ids(decoder, options.disable_ids_begin);
+      map_to_output_word_ids(decoder, end_ids, options);
     }
 
-    if (options.return_alternatives) {
+    if (options.draft_decoder) {
       results.reserve(batch_size);
       for (size_t i = 0; i < batch_size; ++i) {
-        layers::DecoderState batch_state = get_batch_state(state, i);
+        layers::DecoderState batch_state = get_batch_state(decoder, state, i);
+        layers::DecoderState draft_state = (options.draft_state
+                                            ? get_batch_state(*options.draft_decoder,
+                                                              *options.draft_state,
+                                                              i)
+                                            : options.draft_decoder->initial_state());
+        results.emplace_back(speculative_decode(decoder,
+                                                batch_state,
+                                                *options.draft_decoder,
+                                                draft_state,
+                                                start_tokens[i],
+                                                end_ids,
+                                                options));
+      }
+
+    } else if (options.return_alternatives) {
+      results.reserve(batch_size);
+      for (size_t i = 0; i < batch_size; ++i) {
+        layers::DecoderState batch_state = get_batch_state(decoder, state, i);
         results.emplace_back(decode_alternatives(decoder,
                                                  batch_state,
                                                  start_tokens[i],
@@ -1367,16 +1833,205 @@ namespace ctranslate2 {
     }
 
     if (decoder.output_layer_is_updated()) {
-      // Restore original word ids.
-      for (auto& result : results) {
-        for (auto& hypothesis : result.hypotheses) {
-          for (auto& id : hypothesis)
-            id = decoder.to_original_word_id(id);
-        }
-      }
+      for (auto& result : results)
+        restore_original_word_ids(decoder, result);
     }
 
     return results;
   }
 
+
+  struct ContinuousDecoding::Sequence {
+    size_t id;
+    dim_t position;
+    SingleSequence decoding;
+  };
+
+  static DecodingResult finalize_continuous_sequence(const layers::Decoder& decoder,
+                                                     SingleSequence& sequence) {
+    DecodingResult result = finalize_sequence(sequence);
+    if (decoder.output_layer_is_updated())
+      restore_original_word_ids(decoder, result);
+    return result;
+  }
+
+  ContinuousDecoding::ContinuousDecoding(layers::Decoder& decoder)
+    : _decoder(decoder)
+  {
+  }
+
+  ContinuousDecoding::~ContinuousDecoding() = default;
+
+  void ContinuousDecoding::add(size_t id,
+                               layers::DecoderState state,
+                               std::vector<size_t> start_tokens,
+                               std::vector<size_t> end_ids,
+                               DecodingOptions options) {
+    validate_decoding_options(options, _decoder.device());
+    validate_single_sequence_options(options, "Continuous batching");
+    if (start_tokens.empty())
+      throw std::invalid_argument("No decoder start tokens are set");
+
+    PROFILE("ContinuousDecoding::add");
+    const Device device = _decoder.device();
+
+    // All start tokens except the last one are forwarded in a single step.
+    StorageView prompt_logits(_decoder.output_type(), device);
+    if (start_tokens.size() > 1) {
+      const bool with_logits = (options.return_logits_vocab
+                                || (options.callback && options.return_prefix));
+      const std::vector<size_t> prompt(start_tokens.begin(), start_tokens.end() - 1);
+      _decoder(options.start_step,
+               layers::make_sequence_inputs({prompt}, device),
+               state,
+               with_logits ? &prompt_logits : nullptr);
+    }
+
+    const size_t last_id = start_tokens.back();
+    const dim_t position = options.start_step + start_tokens.size() - 1;
+
+    if (_decoder.output_layer_is_updated()) {
+      start_tokens = map_to_output_word_ids(_decoder, start_tokens);
+      map_to_output_word_ids(_decoder, end_ids, options);
+    }
+
+    Sequence sequence;
+    sequence.id = id;
+    sequence.position = position;
+    sequence.decoding = make_single_sequence(start_tokens, std::move(end_ids), std::move(options));
+
+    if (prompt_logits)
+      process_prefix(sequence.decoding, prompt_logits);
+
+    // The first step is run separately as it can also initialize the state (e.g. the
+    // projection of the encoder output).
+    StorageView logits(_decoder.output_type(), device);
+    _decoder(sequence.position, StorageView({1}, int32_t(last_id), device), state, &logits);
+    sequence.position++;
+
+    if (process_step(sequence.decoding, logits)) {
+      _finished.emplace_back(id, finalize_continuous_sequence(_decoder, sequence.decoding));
+    } else {
+      _decoder.append_state(_state, std::move(state));
+      _sequences.emplace_back(std::move(sequence));
+    }
+  }
+
+  std::vector<std::pair<size_t, DecodingResult>> ContinuousDecoding::step() {
+    std::vector<std::pair<size_t, DecodingResult>> finished = std::move(_finished);
+    _finished.clear();
+
+    if (_sequences.empty())
+      return finished;
+
+    PROFILE("ContinuousDecoding::step");
+    const Device device = _decoder.device();
+    const DataType dtype = _decoder.output_type();
+    const dim_t batch_size = _sequences.size();
+
+    // The decoder reads the position of each sequence from its state. The step is only
+    // used when all sequences are at the same position.
+    StorageView ids({batch_size}, DataType::INT32);
+    dim_t step = 0;
+    for (dim_t i = 0; i < batch_size; ++i) {
+      ids.at<int32_t>(i) = _decoder.to_original_word_id(_sequences[i].decoding.next_id);
+      step = std::max(step, _sequences[i].position);
+    }
+
+    const TraceArgScope trace_step(TraceArg::Step, step);
+
+    StorageView logits(dtype, device);
+    _decoder(step, ids.to(device), _state, &logits);
+
+    const dim_t vocabulary_size = logits.dim(-1);
+    StorageView batch_logits(dtype, device);
+    std::vector<Sequence> alive_sequences;
+    std::vector<int32_t> alive_index;
+    alive_sequences.reserve(batch_size);
+    alive_index.reserve(batch_size);
+
+    for (dim_t i = 0; i < batch_size; ++i) {
+      auto& sequence = _sequences[i];
+      sequence.position++;
+
+      TYPE_DISPATCH(dtype, batch_logits.view(logits.index<T>({i, 0}), {1, vocabulary_size}));
+
+      if (process_step(sequence.decoding, batch_logits)) {
+        finished.emplace_back(sequence.id, finalize_continuous_sequence(_decoder, sequence.decoding));
+      } else {
+        alive_sequences.emplace_back(std::move(sequence));
+        alive_index.emplace_back(i);
+      }
+    }
+
+    const dim_t count_alive = alive_index.size();
+    if (count_alive == 0) {
+      _state.clear();
+    } else if (count_alive != batch_size) {
+      const StorageView alive({count_alive}, alive_index);
+      _decoder.update_state(_state, alive.to(device));
+    }
+
+    _sequences = std::move(alive_sequences);
+    return finished;
+  }
+
+  void ContinuousDecoding::remove(const std::vector<size_t>& ids) {
+    const auto is_removed = [&ids](const size_t id) {
+      return std::find(ids.begin(), ids.end(), id) != ids.end();
+    };
+
+    _finished.erase(std::remove_if(_finished.begin(), _finished.end(),
+                                   [&is_removed](const std::pair<size_t, DecodingResult>& result) {
+                                     return is_removed(result.first);
+                                   }),
+                    _finished.end());
+
+    const dim_t batch_size = _sequences.size();
+    std::vector<Sequence> alive_sequences;
+    std::vector<int32_t> alive_index;
+    alive_sequences.reserve(batch_size);
+    alive_index.reserve(batch_size);
+
+    for (dim_t i = 0; i < batch_size; ++i) {
+      if (!is_removed(_sequences[i].id)) {
+        alive_sequences.emplace_back(std::move(_sequences[i]));
+        alive_index.emplace_back(i);
+      }
+    }
+
+    const dim_t count_alive = alive_index.size();
+    if (count_alive == batch_size) {
+      _sequences = std::move(alive_sequences);
+      return;
+    }
+
+    if (count_alive == 0) {
+      _state.clear();
+    } else {
+      const StorageView alive({count_alive}, alive_index);
+      _decoder.update_state(_state, alive.to(_decoder.device()));
+    }
+
+    _sequences = std::move(alive_sequences);
+  }
+
+  size_t ContinuousDecoding::size() const {
+    return _sequences.size() + _finished.size();
+  }
+
+  std::vector<size_t> ContinuousDecoding::clear() {
+    std::vector<size_t> ids;
+    ids.reserve(size());
+    for (const auto& sequence : _sequences)
+      ids.emplace_back(sequence.id);
+    for (const auto& result : _finished)
+      ids.emplace_back(result.first);
+
+    _sequences.clear();
+    _finished.clear();
+    _state.clear();
+    return ids;
+  }
+
 }
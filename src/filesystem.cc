@@ -1,9 +1,17 @@
 #include "ctranslate2/filesystem.h"
 
+#include <sstream>
 #include <stdexcept>
 
 #ifdef _WIN32
 #  include <windows.h>
+#else
+#  include <climits>
+#  include <cstdlib>
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
 #endif
 
 namespace ctranslate2 {
@@ -46,4 +54,158 @@ namespace ctranslate2 {
     return open_file<std::ofstream>(path, mode, check);
   }
 
+#ifdef _WIN32
+  class WindowsMappedFile : public MappedFile {
+  public:
+    WindowsMappedFile(HANDLE mapping, char* data, size_t size)
+      : _mapping(mapping)
+      , _data(data)
+      , _size(size)
+    {
+    }
+
+    ~WindowsMappedFile() {
+      UnmapViewOfFile(_data);
+      CloseHandle(_mapping);
+    }
+
+    char* data() const override {
+      return _data;
+    }
+
+    size_t size() const override {
+      return _size;
+    }
+
+  private:
+    HANDLE _mapping;
+    char* _data;
+    size_t _size;
+  };
+
+  std::shared_ptr<MappedFile> map_file_read(const std::string& path) {
+    const std::wstring wpath = convert_to_wstring(path);
+    HANDLE file = CreateFileW(wpath.c_str(),
+                              GENERIC_READ,
+                              FILE_SHARE_READ,
+                              nullptr,
+                              OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL,
+                              nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+      return nullptr;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+      CloseHandle(file);
+      return nullptr;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    CloseHandle(file);  // The mapping keeps a reference to the file.
+    if (!mapping)
+      return nullptr;
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    if (!data) {
+      CloseHandle(mapping);
+      return nullptr;
+    }
+
+    return std::make_shared<WindowsMappedFile>(mapping,
+                                               static_cast<char*>(data),
+                                               static_cast<size_t>(file_size.QuadPart));
+  }
+
+  std::string get_file_signature(const std::string& path) {
+    const std::wstring wpath = convert_to_wstring(path);
+    wchar_t full_path[MAX_PATH];
+    if (!GetFullPathNameW(wpath.c_str(), MAX_PATH, full_path, nullptr))
+      return "";
+
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExW(full_path, GetFileExInfoStandard, &attributes))
+      return "";
+
+    const int count = WideCharToMultiByte(CP_UTF8, 0, full_path, -1, nullptr, 0, nullptr, nullptr);
+    std::string canonical_path(count, 0);
+    WideCharToMultiByte(CP_UTF8, 0, full_path, -1, &canonical_path[0], count, nullptr, nullptr);
+
+    std::ostringstream signature;
+    signature << canonical_path.c_str()
+              << ':' << attributes.nFileSizeHigh << ':' << attributes.nFileSizeLow
+              << ':' << attributes.ftLastWriteTime.dwHighDateTime
+              << ':' << attributes.ftLastWriteTime.dwLowDateTime;
+    return signature.str();
+  }
+
+#else
+  class PosixMappedFile : public MappedFile {
+  public:
+    PosixMappedFile(char* data, size_t size)
+      : _data(data)
+      , _size(size)
+    {
+    }
+
+    ~PosixMappedFile() {
+      munmap(_data, _size);
+    }
+
+    char* data() const override {
+      return _data;
+    }
+
+    size_t size() const override {
+      return _size;
+    }
+
+  private:
+    char* _data;
+    size_t _size;
+  };
+
+  std::shared_ptr<MappedFile> map_file_read(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return nullptr;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+      close(fd);
+      return nullptr;
+    }
+
+    const size_t size = file_stat.st_size;
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);  // The mapping keeps a reference to the file.
+    if (data == MAP_FAILED)
+      return nullptr;
+
+    return std::make_shared<PosixMappedFile>(static_cast<char*>(data), size);
+  }
+
+  std::string get_file_signature(const std::string& path) {
+    char canonical_path[PATH_MAX];
+    if (!realpath(path.c_str(), canonical_path))
+      return "";
+
+    struct stat file_stat;
+    if (stat(canonical_path, &file_stat) != 0)
+      return "";
+
+#  ifdef __APPLE__
+    const auto& mtime = file_stat.st_mtimespec;
+#  else
+    const auto& mtime = file_stat.st_mtim;
+#  endif
+
+    std::ostringstream signature;
+    signature << canonical_path
+              << ':' << file_stat.st_size
+              << ':' << mtime.tv_sec << '.' << mtime.tv_nsec;
+    return signature.str();
+  }
+#endif
+
 }
@@ -0,0 +1,149 @@
+#include "ctranslate2/generation_stream.h"
+
+#include "ctranslate2/scheduling.h"
+
+namespace ctranslate2 {
+
+  static size_t round_up_to_power_of_2(size_t size) {
+    size_t power = 1;
+    while (power < size)
+      power *= 2;
+    return power;
+  }
+
+  GenerationStream::GenerationStream(size_t capacity)
+    : _buffer(round_up_to_power_of_2(capacity))
+    , _mask(_buffer.size() - 1)
+  {
+  }
+
+  std::shared_ptr<GenerationStream>
+  GenerationStream::make_consumer_handle(const std::shared_ptr<GenerationStream>& stream) {
+    return std::shared_ptr<GenerationStream>(stream.get(), [stream](GenerationStream*) {
+      stream->close();
+    });
+  }
+
+  bool GenerationStream::next(GenerationStepResult& step_result) {
+    while (true) {
+      // The finished flag is read first so that results pushed before the end are not missed.
+      const bool finished = _finished.load();
+
+      if (try_pop(step_result))
+        return true;
+
+      if (finished) {
+        if (_exception)
+          std::rethrow_exception(_exception);
+        return false;
+      }
+
+      std::unique_lock<std::mutex> lock(_wait_mutex);
+      _consumer_waiting.store(true);
+      _can_read.wait(lock, [this] { return readable() || _finished.load(); });
+      _consumer_waiting.store(false);
+    }
+  }
+
+  bool GenerationStream::try_next(GenerationStepResult& step_result) {
+    const bool finished = _finished.load();
+
+    if (try_pop(step_result))
+      return true;
+
+    if (finished && _exception)
+      std::rethrow_exception(_exception);
+    return false;
+  }
+
+  void GenerationStream::close() {
+    _closed.store(true, std::memory_order_relaxed);
+  }
+
+  bool GenerationStream::finished() const {
+    return _finished.load() && !readable();
+  }
+
+  bool GenerationStream::push(GenerationStepResult step_result) {
+    if (closed() || _overflowed)
+      return true;
+
+    if (!try_push(step_result)) {
+      _overflowed = true;
+      return true;
+    }
+
+    notify_consumer();
+    return false;
+  }
+
+  void GenerationStream::finish(std::exception_ptr exception) {
+    if (!exception && _overflowed)
+      exception = std::make_exception_ptr(GenerationStreamOverflow(
+        "The decoding was stopped because the stream queue was full ("
+        + std::to_string(_buffer.size()) + " step results)"));
+
+    _exception = std::move(exception);
+    _finished.store(true);
+
+    const std::lock_guard<std::mutex> lock(_wait_mutex);
+    _can_read.notify_all();
+  }
+
+  bool GenerationStream::try_push(GenerationStepResult& step_result) {
+    const size_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail - _head.load(std::memory_order_acquire) == _buffer.size())
+      return false;
+
+    _buffer[tail & _mask] = std::move(step_result);
+    _tail.store(tail + 1);
+    return true;
+  }
+
+  bool GenerationStream::try_pop(GenerationStepResult& step_result) {
+    const size_t head = _head.load(std::memory_order_relaxed);
+    if (_tail.load(std::memory_order_acquire) == head)
+      return false;
+
+    step_result = std::move(_buffer[head & _mask]);
+    _head.store(head + 1);
+    return true;
+  }
+
+  bool GenerationStream::readable() const {
+    return _tail.load() != _head.load();
+  }
+
+  void GenerationStream::notify_consumer() {
+    if (_consumer_waiting.load()) {
+      const std::lock_guard<std::mutex> lock(_wait_mutex);
+      _can_read.notify_one();
+    }
+  }
+
+
+
+  GenerationStreamProducer::GenerationStreamProducer(std::shared_ptr<GenerationStream> stream)
+    : _stream(std::move(stream))
+  {
+  }
+
+  GenerationStreamProducer::~GenerationStreamProducer() {
+    if (!_finished)
+      finish(std::make_exception_ptr(RequestCancelled("The request was not started")));
+  }
+
+  std::function<bool(GenerationStepResult)>
+  GenerationStreamProducer::make_callback(std::function<bool(GenerationStepResult)> callback) const {
+    return [stream = _stream, callback = std::move(callback)](GenerationStepResult step_result) {
+      const bool stop = callback && callback(step_result);
+      return stream->push(std::move(step_result)) || stop;
+    };
+  }
+
+  void GenerationStreamProducer::finish(std::exception_ptr exception) {
+    _stream->finish(std::move(exception));
+    _finished = true;
+  }
+
+}
@@ -9,10 +9,22 @@ namespace ctranslate2 {
                                   const GenerationOptions& options,
                                   const size_t max_batch_size,
                                   const BatchType batch_type) {
+    if (use_continuous_batching())
+      return post_continuous_examples<GenerationResult>(
+        load_examples({start_tokens}),
+        options,
+        _generation_requests,
+        [](models::SequenceGeneratorReplica& generator,
+           RequestQueue<models::GenerationRequest>& queue,
+           size_t max_batch_size) {
+          generator.generate_continuous(queue, max_batch_size);
+        });
+
     return post_examples<GenerationResult>(
       load_examples({start_tokens}),
       max_batch_size,
       batch_type,
+      std::max(options.beam_size, options.num_hypotheses),
       [options](models::SequenceGeneratorReplica& generator, const Batch& batch) {
         spdlog::debug("Running batch generation on {} examples", batch.num_examples());
         auto results = generator.generate(
@@ -20,7 +32,32 @@ namespace ctranslate2 {
           restore_batch_ids_in_callback(options, batch.example_index));
         spdlog::debug("Finished batch generation");
         return results;
-      });
+      },
+      options.scheduling);
+  }
+
+  std::shared_ptr<GenerationStream>
+  Generator::generate_tokens(const std::vector<std::string>& start_tokens,
+                             GenerationOptions options,
+                             const size_t stream_capacity) {
+    auto stream = std::make_shared<GenerationStream>(stream_capacity);
+    auto producer = std::make_shared<GenerationStreamProducer>(stream);
+    options.callback = producer->make_callback(std::move(options.callback));
+
+    // The stream is finished by the producer, so continuous batching is not used.
+    post_examples<GenerationResult>(
+      load_examples({{start_tokens}}),
+      /*max_batch_size=*/0,
+      BatchType::Examples,
+      std::max(options.beam_size, options.num_hypotheses),
+      [options, producer](models::SequenceGeneratorReplica& generator, const Batch& batch) {
+        return producer->run([&] {
+          return generator.generate(batch.get_stream(0), options);
+        });
+      },
+      options.scheduling);
+
+    return GenerationStream::make_consumer_handle(stream);
   }
 
   std::vector<std::future<ScoringResult>>
@@ -32,6 +69,7 @@ namespace ctranslate2 {
       load_examples({tokens}),
       max_batch_size,
       batch_type,
+      /*beam_size=*/1,
       [options](models::SequenceGeneratorReplica& generator, const Batch& batch) {
         spdlog::debug("Running batch scoring on {} examples", batch.num_examples());
         auto results = generator.score(batch.get_stream(0), options);
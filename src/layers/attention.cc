@@ -1,4 +1,5 @@
 #include "ctranslate2/layers/attention.h"
+#include "ctranslate2/ops/paged_attention.h"
 #include "ctranslate2/ops/split.h"
 #include "ctranslate2/utils.h"
 
@@ -177,6 +178,122 @@ namespace ctranslate2 {
       }
     }
 
+    // Number of cached time steps dequantized at once by the attention with an int8 cache.
+    constexpr dim_t quantized_cache_block_size = 256;
+
+    // The int8 cache has a capacity in the time dimension so that the new steps are written
+    // in place. The number of cached steps is the time dimension of the scales.
+    static dim_t get_quantized_cache_length(const StorageView& scale) {
+      return scale.empty() ? 0 : scale.dim(-1);
+    }
+
+    // Dequantizes rows of the int8 cache, with one scale per row.
+    static void dequantize_rows(const int8_t* x,
+                                const float* scale,
+                                const dim_t num_rows,
+                                const dim_t depth,
+                                float* y) {
+      for (dim_t i = 0; i < num_rows; ++i) {
+        float* y_row = y + i * depth;
+        primitives<Device::CPU>::convert(x + i * depth, y_row, depth);
+        primitives<Device::CPU>::mul(1.f / scale[i], y_row, depth);
+      }
+    }
+
+    // Computes alpha * queries x keys^T where keys is the int8 cache. The cache is dequantized
+    // by blocks of time steps into a small buffer, so the full float keys are never materialized.
+    // The batches (and heads) are processed in parallel.
+    static void matmul_quantized_keys(const StorageView& queries,
+                                      const StorageView& keys,
+                                      const StorageView& keys_scale,
+                                      const float alpha,
+                                      StorageView& output) {
+      const dim_t depth = keys.dim(-1);
+      const dim_t capacity = keys.dim(-2);
+      const dim_t time = get_quantized_cache_length(keys_scale);
+      const dim_t batch_size = keys_scale.size() / time;
+      const dim_t num_queries = queries.dim(-2);
+
+      Shape output_shape = queries.shape();
+      output_shape.back() = time;
+      output.resize(std::move(output_shape));
+
+      const dim_t block_size = std::min(time, quantized_cache_block_size);
+
+      cpu::parallel_for(0, batch_size, 1, [&](const dim_t batch_begin, const dim_t batch_end) {
+        std::vector<float> block(block_size * depth);
+
+        for (dim_t b = batch_begin; b < batch_end; ++b) {
+          const float* q = queries.data<float>() + b * num_queries * depth;
+          float* c = output.data<float>() + b * num_queries * time;
+
+          for (dim_t begin = 0; begin < time; begin += block_size) {
+            const dim_t size = std::min(block_size, time - begin);
+            dequantize_rows(keys.data<int8_t>() + (b * capacity + begin) * depth,
+                            keys_scale.data<float>() + b * time + begin,
+                            size,
+                            depth,
+                            block.data());
+
+            primitives<Device::CPU>::gemm(false, false,
+                                          false, true,
+                                          num_queries, size, depth,
+                                          alpha,
+                                          q, depth,
+                                          block.data(), depth,
+                                          0.f,
+                                          c + begin, time);
+          }
+        }
+      });
+    }
+
+    // Computes attention x values where values is the int8 cache, with the same block
+    // dequantization as matmul_quantized_keys.
+    static void matmul_quantized_values(const StorageView& attention,
+                                        const StorageView& values,
+                                        const StorageView& values_scale,
+                                        StorageView& output) {
+      const dim_t depth = values.dim(-1);
+      const dim_t capacity = values.dim(-2);
+      const dim_t time = get_quantized_cache_length(values_scale);
+      const dim_t batch_size = values_scale.size() / time;
+      const dim_t num_queries = attention.dim(-2);
+
+      Shape output_shape = attention.shape();
+      output_shape.back() = depth;
+      output.resize(std::move(output_shape));
+
+      const dim_t block_size = std::min(time, quantized_cache_block_size);
+
+      cpu::parallel_for(0, batch_size, 1, [&](const dim_t batch_begin, const dim_t batch_end) {
+        std::vector<float> block(block_size * depth);
+
+        for (dim_t b = batch_begin; b < batch_end; ++b) {
+          const float* a = attention.data<float>() + b * num_queries * time;
+          float* c = output.data<float>() + b * num_queries * depth;
+
+          for (dim_t begin = 0; begin < time; begin += block_size) {
+            const dim_t size = std::min(block_size, time - begin);
+            dequantize_rows(values.data<int8_t>() + (b * capacity + begin) * depth,
+                            values_scale.data<float>() + b * time + begin,
+                            size,
+                            depth,
+                            block.data());
+
+            primitives<Device::CPU>::gemm(false, false,
+                                          false, false,
+                                          num_queries, depth, size,
+                                          1.f,
+                                          a + begin, time,
+                                          block.data(), depth,
+                                          begin == 0 ? 0.f : 1.f,
+                                          c, depth);
+          }
+        }
+      });
+    }
+
     static void dot_product_attention(const StorageView& queries,
                                       const StorageView& keys,
                                       const StorageView& values,
@@ -196,13 +313,17 @@ namespace ctranslate2 {
                                       bool with_cache = false,
                                       dim_t beam_size = 1,
                                       Alibi* alibi = nullptr,
-                                      StorageView* position_bias = nullptr) {
+                                      StorageView* position_bias = nullptr,
+                                      const StorageView* keys_scale = nullptr,
+                                      const StorageView* values_scale = nullptr) {
       PROFILE("dot_product_attention");
 
+      // The int8 cache can have more time steps than the number of cached steps.
+      const dim_t key_length = keys_scale ? get_quantized_cache_length(*keys_scale) : keys.dim(2);
+
       std::unique_ptr<const StorageView> relative_positions;
       if (relative_position_keys || relative_position_values || relative_asymmetric_position_keys) {
         const dim_t query_length = queries.dim(2);
-        const dim_t key_length = keys.dim(2);
         if (relative_asymmetric_position_keys)
           relative_positions = std::make_unique<StorageView>(
             make_asymmetric_relative_positions(query_length,
@@ -216,7 +337,10 @@ namespace ctranslate2 {
       }
 
       const ops::MatMul keys_matmul(/*trans_a=*/false, /*trans_b=*/true, queries_scale);
-      keys_matmul(queries, keys, output);
+      if (keys_scale)
+        matmul_quantized_keys(queries, keys, *keys_scale, queries_scale, output);
+      else
+        keys_matmul(queries, keys, output);
       if (relative_position_keys)
         add_relative_representations(queries,
                                      *relative_positions,
@@ -238,7 +362,6 @@ namespace ctranslate2 {
 
         if (position_bias->empty()) {
           const dim_t query_length = queries.dim(2);
-          const dim_t key_length = keys.dim(2);
           *position_bias = compute_relative_bias(*relative_attention_bias,
                                                  query_length,
                                                  key_length,
@@ -266,14 +389,17 @@ namespace ctranslate2 {
       if (alibi)
         alibi->apply(output, queries_scale);
 
-      StorageView attn(values.dtype(), values.device());
+      StorageView attn(queries.dtype(), queries.device());
       ops::SoftMax()(output, values_lengths, attn);
 
       if (attention && !return_normalized_attention)
         save_attention(*attention, std::move(output), beam_size);
 
       const ops::MatMul values_matmul;
-      values_matmul(attn, values, output);
+      if (values_scale)
+        matmul_quantized_values(attn, values, *values_scale, output);
+      else
+        values_matmul(attn, values, output);
       if (relative_position_values)
         add_relative_representations(attn,
                                      *relative_positions,
@@ -293,6 +419,66 @@ namespace ctranslate2 {
       x.reshape({x.dim(0), x.dim(1) * x.dim(2), x.dim(3), x.dim(4)});
     }
 
+    // Quantizes x to int8 and appends it to the cache in the time dimension. The cache has
+    // one scale per time step and head, so the scales have the shape of x without the last
+    // dimension. The new steps are written in place in the cache, which grows its capacity
+    // geometrically. Only the scales are concatenated.
+    static void append_quantized(const StorageView& x,
+                                 StorageView& cache,
+                                 StorageView& cache_scale,
+                                 const dim_t time_dim) {
+      StorageView qx(DataType::INT8, x.device());
+      StorageView scale(DataType::FLOAT32, x.device());
+      ops::Quantize()(x, qx, scale);
+      scale.reshape(Shape(x.shape().begin(), x.shape().end() - 1));
+
+      const dim_t length = get_quantized_cache_length(cache_scale);
+      const dim_t capacity = cache.empty() ? 0 : cache.dim(time_dim);
+      const dim_t num_steps = x.dim(time_dim);
+      const dim_t depth = x.dim(-1);
+      const dim_t num_rows = x.size() / (num_steps * depth);
+      const dim_t copies_per_thread = cpu::get_minimum_batch_copies_per_thread<int8_t>(
+        num_steps * depth);
+
+      if (length + num_steps > capacity) {
+        const dim_t new_capacity = std::max(length + num_steps, 2 * capacity);
+        Shape new_shape = x.shape();
+        new_shape[time_dim] = new_capacity;
+        StorageView new_cache(std::move(new_shape), DataType::INT8, x.device());
+
+        if (length > 0) {
+          const auto* src = cache.data<int8_t>();
+          auto* dst = new_cache.data<int8_t>();
+          cpu::parallel_for(0, num_rows, copies_per_thread, [&](dim_t begin, dim_t end) {
+            for (dim_t i = begin; i < end; ++i)
+              primitives<Device::CPU>::copy(src + i * capacity * depth,
+                                            dst + i * new_capacity * depth,
+                                            length * depth);
+          });
+        }
+
+        cache = std::move(new_cache);
+      }
+
+      const dim_t cache_capacity = cache.dim(time_dim);
+      const auto* src = qx.data<int8_t>();
+      auto* dst = cache.data<int8_t>();
+      cpu::parallel_for(0, num_rows, copies_per_thread, [&](dim_t begin, dim_t end) {
+        for (dim_t i = begin; i < end; ++i)
+          primitives<Device::CPU>::copy(src + i * num_steps * depth,
+                                        dst + (i * cache_capacity + length) * depth,
+                                        num_steps * depth);
+      });
+
+      if (cache_scale.empty()) {
+        cache_scale = std::move(scale);
+      } else {
+        const ops::Concat concat_op(time_dim);
+        const StorageView prev_scale = std::move(cache_scale);
+        concat_op({&prev_scale, &scale}, cache_scale);
+      }
+    }
+
     MultiHeadAttention::MultiHeadAttention(const models::Model& model,
                                            const std::string& scope,
                                            dim_t num_heads,
@@ -334,6 +520,16 @@ namespace ctranslate2 {
       return _d_model;
     }
 
+    bool MultiHeadAttention::support_paged_cache() const {
+      return (_self_attention
+              && !_relative_position_keys
+              && !_relative_asymmetric_position_keys
+              && !_relative_position_values
+              && !_relative_attention_bias
+              && !_alibi
+              && _sliding_window == 0);
+    }
+
     void MultiHeadAttention::operator()(const StorageView& queries,
                                         const StorageView& values,
                                         const StorageView* values_lengths,
@@ -345,7 +541,10 @@ namespace ctranslate2 {
                                         const Padder* values_padder,
                                         bool return_normalized_attention,
                                         StorageView* position_bias,
-                                        dim_t offset) const {
+                                        dim_t offset,
+                                        const PagedKVCache* paged_cache,
+                                        StorageView* cached_keys_scale,
+                                        StorageView* cached_values_scale) const {
       PROFILE("MultiHeadAttention");
       const Device device = queries.device();
       const DataType dtype = queries.dtype();
@@ -354,15 +553,18 @@ namespace ctranslate2 {
       StorageView keys_proj(dtype, device);
       StorageView values_proj(dtype, device);
 
-      const StorageView* q = &queries;
-      if (_layer_norm && _pre_norm) {
-        (*_layer_norm)(queries, queries_proj);
-        q = &queries_proj;
-      }
-
       if (!_is_low_rank) {
-        _linear[0](*q, fused_proj);
+        if (_layer_norm && _pre_norm)
+          _linear[0](queries, *_layer_norm, fused_proj);
+        else
+          _linear[0](queries, fused_proj);
       } else {
+        const StorageView* q = &queries;
+        if (_layer_norm && _pre_norm) {
+          (*_layer_norm)(queries, queries_proj);
+          q = &queries_proj;
+        }
+
         // Low-rank attention does not fuse qkv.
         _linear[0](*q, queries_proj);
         _linear[1](*q, keys_proj);
@@ -372,6 +574,9 @@ namespace ctranslate2 {
       dim_t beam_size = 1;
 
       bool prefilling = (_sliding_window > 0 && values_lengths);
+      const bool paged = (paged_cache && cached_keys);
+      const bool quantized_cache = (_self_attention && cached_keys && cached_keys_scale);
+      bool read_quantized_cache = false;
 
       if (!_self_attention) {
         if (_is_low_rank)
@@ -425,8 +630,11 @@ namespace ctranslate2 {
             split_heads(keys_proj, _num_heads_kv);
             split_heads(values_proj, _num_heads_kv);
 
-            replicate_heads(keys_proj, _num_heads / _num_heads_kv);
-            replicate_heads(values_proj, _num_heads / _num_heads_kv);
+            // The paged cache stores the key/value heads without replication.
+            if (!paged) {
+              replicate_heads(keys_proj, _num_heads / _num_heads_kv);
+              replicate_heads(values_proj, _num_heads / _num_heads_kv);
+            }
           }
 
         } else {
@@ -446,8 +654,13 @@ namespace ctranslate2 {
             split_heads(queries_proj, _num_heads);
           }
 
-          _rotary_embeddings->apply(queries_proj, offset);
-          _rotary_embeddings->apply(keys_proj, offset);
+          if (paged && !paged_cache->aligned()) {
+            _rotary_embeddings->apply(queries_proj, paged_cache->offsets());
+            _rotary_embeddings->apply(keys_proj, paged_cache->offsets());
+          } else {
+            _rotary_embeddings->apply(queries_proj, offset);
+            _rotary_embeddings->apply(keys_proj, offset);
+          }
 
           if (_merge_time_and_head_dims) {
             combine_heads(queries_proj, _num_heads);
@@ -455,7 +668,15 @@ namespace ctranslate2 {
           }
         }
 
-        if (cached_keys != nullptr) {
+        if (paged) {
+          paged_cache->append(keys_proj, *cached_keys);
+          paged_cache->append(values_proj, *cached_values);
+        } else if (quantized_cache) {
+          // The first keys and values are used as is, otherwise the attention reads the cache.
+          read_quantized_cache = !cached_keys->empty();
+          append_quantized(keys_proj, *cached_keys, *cached_keys_scale, _cache_time_dim);
+          append_quantized(values_proj, *cached_values, *cached_values_scale, _cache_time_dim);
+        } else if (cached_keys != nullptr) {
           if (cached_keys->empty()) {
             *cached_keys = std::move(keys_proj);
             *cached_values = std::move(values_proj);
@@ -479,32 +700,51 @@ namespace ctranslate2 {
         }
       }
 
-      if (cached_keys) {
+      if (cached_keys && !paged && (!quantized_cache || read_quantized_cache)) {
         keys_proj.shallow_copy(*cached_keys);
         values_proj.shallow_copy(*cached_values);
       }
 
       StorageView& context = fused_proj;  // Reuse storage.
-      dot_product_attention(queries_proj,
-                            keys_proj,
-                            values_proj,
-                            values_lengths,
-                            _relative_position_keys,
-                            _relative_asymmetric_position_keys,
-                            _relative_position_values,
-                            _relative_attention_bias,
-                            _relative_left_max_position,
-                            _relative_right_max_position,
-                            _maximum_relative_position,
-                            context,
-                            attention,
-                            return_normalized_attention,
-                            _queries_scale,
-                            _is_decoder,
-                            bool(cached_keys),
-                            beam_size,
-                            _alibi,
-                            position_bias);
+      if (paged && !paged_cache->was_empty()) {
+        const ops::PagedAttention paged_attention_op(_queries_scale);
+        paged_attention_op(queries_proj,
+                           *cached_keys,
+                           *cached_values,
+                           paged_cache->page_table(),
+                           paged_cache->length(),
+                           values_lengths,
+                           context);
+      } else {
+        // When the cache was empty, the new keys and values are all the keys and values.
+        if (paged && _num_heads_kv < _num_heads && !_merge_time_and_head_dims) {
+          replicate_heads(keys_proj, _num_heads / _num_heads_kv);
+          replicate_heads(values_proj, _num_heads / _num_heads_kv);
+        }
+
+        dot_product_attention(queries_proj,
+                              keys_proj,
+                              values_proj,
+                              values_lengths,
+                              _relative_position_keys,
+                              _relative_asymmetric_position_keys,
+                              _relative_position_values,
+                              _relative_attention_bias,
+                              _relative_left_max_position,
+                              _relative_right_max_position,
+                              _maximum_relative_position,
+                              context,
+                              attention,
+                              return_normalized_attention,
+                              _queries_scale,
+                              _is_decoder,
+                              bool(cached_keys),
+                              beam_size,
+                              _alibi,
+                              position_bias,
+                              read_quantized_cache ? cached_keys_scale : nullptr,
+                              read_quantized_cache ? cached_values_scale : nullptr);
+      }
 
       if (prefilling && cached_keys && cached_keys->shape()[2] > _sliding_window) {
         // set only last sliding_window tokens to cached_keys and cached_values after computing attention
@@ -3,9 +3,11 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <numeric>
 
 #include "dispatch.h"
+#include "env.h"
 #include "cpu/parallel.h"
 
 namespace ctranslate2 {
@@ -265,6 +267,48 @@ namespace ctranslate2 {
       x = std::move(y);
     }
 
+    void RotaryEmbeddings::apply(StorageView& x, const std::vector<dim_t>& offsets) {
+      const Device device = x.device();
+      const DataType dtype = x.dtype();
+      const dim_t batch_size = x.dim(0);
+      const dim_t max_time = _transpose ? x.dim(-2) : x.dim(-3);
+      const dim_t dim = _dim == 0 ? x.dim(-1) : _dim;
+      const dim_t max_offset = *std::max_element(offsets.begin(), offsets.end());
+
+      if (!_sin || max_offset + max_time > _sin.dim(0)) {
+        const dim_t cur_num_positions = _sin ? _sin.dim(0) : 0;
+        const dim_t new_num_positions = std::max(max_offset + max_time,
+                                                 cur_num_positions + _num_initial_positions);
+        initialize(new_num_positions, dim, device, dtype);
+      }
+
+      StorageView y(dtype, device);
+      y.resize_as(x);
+
+      Shape batch_shape = x.shape();
+      batch_shape[0] = 1;
+      const dim_t batch_stride = x.size() / batch_size;
+
+      StorageView x_batch(dtype, device);
+      StorageView y_batch(dtype, device);
+      StorageView sin(dtype, device);
+      StorageView cos(dtype, device);
+
+      for (dim_t b = 0; b < batch_size; ++b) {
+        TYPE_DISPATCH(dtype,
+                      {
+                        x_batch.view(x.data<T>() + b * batch_stride, batch_shape);
+                        y_batch.view(y.data<T>() + b * batch_stride, batch_shape);
+                        sin.view(_sin.index<T>({offsets[b], 0}), {max_time, dim});
+                        cos.view(_cos.index<T>({offsets[b], 0}), {max_time, dim});
+                      });
+
+        _rotary_op(x_batch, sin, cos, y_batch, _transpose);
+      }
+
+      x = std::move(y);
+    }
+
     void RotaryEmbeddings::initialize(const dim_t num_positions,
                                       const dim_t dim,
                                       const Device device,
@@ -368,17 +412,174 @@ namespace ctranslate2 {
     }
 
     void Alibi::apply(StorageView& x, const float scale) {
+      const StorageView& alibi = get(x.dim(1), x.dim(-1), x.device(), x.dtype(), scale);
+      _alibi_op(x, alibi, x);
+    }
+
+    const StorageView& Alibi::get(const dim_t num_heads,
+                                  const dim_t key_length,
+                                  const Device device,
+                                  const DataType dtype,
+                                  const float scale) {
       const dim_t cur_length = _alibi ? _alibi.dim(-1) : 0;
-      const dim_t key_length = x.dim(-1);
 
       if (key_length > cur_length) {
-        const dim_t num_heads = x.dim(1);
-        const dim_t new_length = cur_length + _num_initial_positions;
+        const dim_t new_length = std::max(key_length, cur_length + _num_initial_positions);
         _alibi = build_alibi(num_heads, new_length, _use_positive_positions, _scale_alibi ? scale : 1);
-        _alibi.move_to(x.device(), x.dtype());
+        _alibi.move_to(device, dtype);
+      }
+
+      return _alibi;
+    }
+
+    dim_t PagedKVCache::default_page_size() {
+      static const dim_t page_size = std::max(read_int_from_env("CT2_KV_CACHE_PAGE_SIZE", 0), 0);
+      return page_size;
+    }
+
+    PagedKVCache::PagedKVCache(StorageView& page_table,
+                               StorageView& lengths,
+                               dim_t num_pages,
+                               dim_t batch_size,
+                               dim_t num_steps,
+                               dim_t page_size)
+      : _page_table(page_table)
+      , _page_size(page_size)
+      , _num_steps(num_steps)
+      , _offsets(batch_size, 0)
+      , _aligned(true)
+    {
+      if (!lengths.empty()) {
+        if (lengths.size() != batch_size)
+          throw std::invalid_argument("The cache lengths do not match the batch size");
+        const auto* lengths_data = lengths.data<int32_t>();
+        for (dim_t b = 0; b < batch_size; ++b) {
+          _offsets[b] = lengths_data[b];
+          _aligned = _aligned && _offsets[b] == _offsets[0];
+        }
+      }
+
+      const dim_t prev_max_length = *std::max_element(_offsets.begin(), _offsets.end());
+      const dim_t prev_max_pages = ceil_divide(prev_max_length, page_size);
+
+      if (prev_max_length > 0 && (page_table.dim(0) != batch_size
+                                  || page_table.dim(1) < prev_max_pages))
+        throw std::invalid_argument("The page table does not match the cache lengths");
+
+      _length = prev_max_length + num_steps;
+      const dim_t max_pages = ceil_divide(_length, page_size);
+      const dim_t prev_table_width = prev_max_length > 0 ? page_table.dim(1) : 0;
+
+      // Pages that are not referenced by any sequence can be reused. When the sequences have
+      // different lengths, the table entries after the last page of a sequence are unused.
+      std::vector<int32_t> ref_count(num_pages, 0);
+      const int32_t* prev_table = prev_max_length > 0 ? page_table.data<int32_t>() : nullptr;
+      for (dim_t b = 0; b < batch_size; ++b) {
+        const dim_t prev_pages = ceil_divide(_offsets[b], page_size);
+        for (dim_t p = 0; p < prev_pages; ++p)
+          ref_count[prev_table[b * prev_table_width + p]]++;
+      }
+
+      std::vector<int32_t> free_pages;
+      for (dim_t i = num_pages - 1; i >= 0; --i) {
+        if (ref_count[i] == 0)
+          free_pages.push_back(i);
+      }
+
+      _num_pages = num_pages;
+      dim_t next_page = num_pages;
+      const auto allocate_page = [&free_pages, &next_page]() -> int32_t {
+        if (free_pages.empty())
+          return next_page++;
+        const int32_t page = free_pages.back();
+        free_pages.pop_back();
+        return page;
+      };
+
+      StorageView table({batch_size, max_pages}, int32_t(0));
+      auto* table_data = table.data<int32_t>();
+
+      for (dim_t b = 0; b < batch_size; ++b) {
+        auto* row = table_data + b * max_pages;
+        const dim_t prev_length = _offsets[b];
+        const dim_t prev_pages = ceil_divide(prev_length, page_size);
+        const dim_t new_pages = ceil_divide(prev_length + num_steps, page_size);
+        if (prev_pages > 0)
+          std::copy_n(prev_table + b * prev_table_width, prev_pages, row);
+
+        if (prev_length % page_size != 0) {
+          // The last page will be written: copy it if it is shared with other sequences.
+          int32_t& page = row[prev_pages - 1];
+          if (ref_count[page] > 1) {
+            ref_count[page]--;
+            const int32_t new_page = allocate_page();
+            _copies.emplace_back(page, new_page);
+            page = new_page;
+          }
+        }
+
+        for (dim_t p = prev_pages; p < new_pages; ++p)
+          row[p] = allocate_page();
+      }
+
+      // Grow the pages to the next power of 2 to amortize the copy of the previous pages.
+      while (_num_pages < next_page)
+        _num_pages = std::max(2 * _num_pages, dim_t(1));
+
+      StorageView new_lengths({batch_size}, DataType::INT32);
+      for (dim_t b = 0; b < batch_size; ++b)
+        new_lengths.at<int32_t>(b) = _offsets[b] + num_steps;
+
+      page_table = std::move(table);
+      lengths = std::move(new_lengths);
+    }
+
+    void PagedKVCache::append(const StorageView& x, StorageView& pages) const {
+      const bool merged_heads = x.rank() == 3;
+      const dim_t batch_size = x.dim(0);
+      const dim_t num_heads = merged_heads ? 1 : x.dim(1);
+      const dim_t head_dim = x.dim(-1);
+      const dim_t page_stride = num_heads * _page_size * head_dim;
+
+      if (pages.empty() || pages.dim(0) < _num_pages) {
+        // Unused positions are set to 0 so that the cache content is deterministic.
+        StorageView new_pages({_num_pages, num_heads, _page_size, head_dim}, x.dtype(), x.device());
+        const dim_t prev_bytes = pages.empty() ? 0 : pages.size() * pages.item_size();
+        const dim_t new_bytes = new_pages.size() * new_pages.item_size();
+        auto* new_data = static_cast<int8_t*>(new_pages.buffer());
+        if (prev_bytes > 0)
+          std::memcpy(new_data, pages.buffer(), prev_bytes);
+        std::memset(new_data + prev_bytes, 0, new_bytes - prev_bytes);
+        pages = std::move(new_pages);
       }
 
-      _alibi_op(x, _alibi, x);
+      const dim_t item_size = x.item_size();
+      const dim_t step_bytes = head_dim * item_size;
+      const dim_t page_bytes = page_stride * item_size;
+      auto* dst = static_cast<int8_t*>(pages.buffer());
+      const auto* src = static_cast<const int8_t*>(x.buffer());
+
+      for (const auto& [src_page, dst_page] : _copies)
+        std::memcpy(dst + dst_page * page_bytes, dst + src_page * page_bytes, page_bytes);
+
+      const dim_t max_pages = _page_table.dim(1);
+      const auto* table = _page_table.data<int32_t>();
+
+      cpu::parallel_for(0, batch_size * num_heads, 1, [&](dim_t begin, dim_t end) {
+        for (dim_t i = begin; i < end; ++i) {
+          const dim_t b = i / num_heads;
+          const dim_t h = i % num_heads;
+          const auto* row = table + b * max_pages;
+
+          for (dim_t t = 0; t < _num_steps; ++t) {
+            const dim_t position = _offsets[b] + t;
+            const dim_t page = row[position / _page_size];
+            const dim_t offset = (page * num_heads + h) * _page_size + position % _page_size;
+            const dim_t x_offset = merged_heads ? b * _num_steps + t : i * _num_steps + t;
+            std::memcpy(dst + offset * step_bytes, src + x_offset * step_bytes, step_bytes);
+          }
+        }
+      });
     }
 
   }
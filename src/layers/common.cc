@@ -1,5 +1,6 @@
 #include "ctranslate2/layers/common.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include "ctranslate2/ops/activation.h"
@@ -148,10 +149,8 @@ namespace ctranslate2 {
     }
 
 
-    void PositionEncoder::operator()(StorageView& input, dim_t index) {
-      const dim_t time = input.dim(1);
-      const dim_t depth = input.dim(-1);
-      const dim_t max_time = time + index;
+    const StorageView& PositionEncoder::get_checked_position_encoding(dim_t max_time,
+                                                                      dim_t depth) {
       const StorageView& encodings = get_position_encoding(max_time);
       const dim_t num_encodings = encodings.dim(0);
 
@@ -166,6 +165,14 @@ namespace ctranslate2 {
                                     + ", but the input has depth "
                                     + std::to_string(depth));
 
+      return encodings;
+    }
+
+    void PositionEncoder::operator()(StorageView& input, dim_t index) {
+      const dim_t time = input.dim(1);
+      const dim_t depth = input.dim(-1);
+      const StorageView& encodings = get_checked_position_encoding(time + index, depth);
+
       DEVICE_AND_TYPE_DISPATCH(input.device(), input.dtype(),
                                primitives<D>::add_batch_broadcast(encodings.data<T>() + index * depth,
                                                                   input.data<T>(),
@@ -173,6 +180,25 @@ namespace ctranslate2 {
                                                                   input.size()));
     }
 
+    void PositionEncoder::operator()(StorageView& input, const std::vector<dim_t>& indices) {
+      const dim_t batch_size = input.dim(0);
+      const dim_t time = input.dim(1);
+      const dim_t depth = input.dim(-1);
+      const dim_t max_index = *std::max_element(indices.begin(), indices.end());
+      const StorageView& encodings = get_checked_position_encoding(time + max_index, depth);
+      const dim_t batch_stride = input.size() / batch_size;
+
+      for (dim_t b = 0; b < batch_size; ++b) {
+        DEVICE_AND_TYPE_DISPATCH(input.device(), input.dtype(),
+                                 primitives<D>::add_batch_broadcast(encodings.data<T>()
+                                                                    + indices[b] * depth,
+                                                                    input.data<T>()
+                                                                    + b * batch_stride,
+                                                                    time * depth,
+                                                                    batch_stride));
+      }
+    }
+
     void PositionEncoder::operator()(const StorageView& input, StorageView& output, dim_t index) {
       output = input;
       operator()(output, index);
@@ -283,16 +309,25 @@ namespace ctranslate2 {
       , _qzero(model.get_variable_if_exists(scope + "/weight_zero"))
       , _u8_shift_compensation((_weight.device() == Device::CPU
                                 && _weight.dtype() == DataType::INT8
+                                && model.quant_method() == models::QUANTIZATION_TYPE::CT2
                                 && cpu::prefer_u8s8s32_gemm())
                                ? &model.get_variable(scope + "/weight_compensation")
                                : nullptr)
       , _partial_weight(_weight.device(), _weight.dtype())
       , _partial_bias(_weight.device(), _bias ? _bias->dtype() : DataType::FLOAT32)
       , _partial_qscale(_weight.device(), DataType::FLOAT32)
+      , _partial_qzero(_weight.device(), DataType::FLOAT32)
       , _partial_u8_shift_compensation(_weight.device(), DataType::INT32)
+      , _partial_index(DataType::INT32)
       , _output_type(get_default_float_type(model.effective_compute_type()))
       , _quant_method(model.quant_method())
-      , _quantized_gemm(_weight.dtype() == DataType::INT16 || _weight.dtype() == DataType::INT8)
+      , _quantized_gemm(_quant_method == models::QUANTIZATION_TYPE::CT2
+                        && (_weight.dtype() == DataType::INT16 || _weight.dtype() == DataType::INT8))
+      , _use_indexed_gemm(_weight.device() == Device::CPU
+                          && !_packed_weight
+                          && !_is_low_rank
+                          && (_weight.dtype() == DataType::FLOAT32
+                              || (_quantized_gemm && _weight.dtype() == DataType::INT8)))
       , _gemm_op(/*alpha=*/1,
                  /*beta=*/0,
                  /*trans_a=*/false,
@@ -300,6 +335,7 @@ namespace ctranslate2 {
                  /*a_is_packed=*/false,
                  _packed_weight,
                  _quantized_gemm ? nullptr : activation_type)
+      , _indexed_gemm_op(_quantized_gemm ? nullptr : activation_type)
       , _quantize_op(model.use_global_int16_scale()
                      ? ops::Quantize::ScaleType::GLOBAL
                      : ops::Quantize::ScaleType::PER_LAYER,
@@ -322,6 +358,8 @@ namespace ctranslate2 {
         // weight is transposed when low_rank
         return _weight2->dim(1);
       }
+      if (!_partial_index.empty())
+        return _partial_index.size();
       return _partial_weight ? _partial_weight.dim(0) : _weight.dim(0);
     }
 
@@ -329,7 +367,10 @@ namespace ctranslate2 {
       if (index) {
         if (_packed_weight)
           throw std::runtime_error("Can't select pre-packed weight");
-        ops::Gather()(_weight, *index, _partial_weight);
+        if (_use_indexed_gemm)
+          _partial_index = *index;
+        else
+          ops::Gather()(_weight, *index, _partial_weight);
 
         if (_bias) {
           ops::Gather()(*_bias, *index, _partial_bias);
@@ -343,19 +384,35 @@ namespace ctranslate2 {
           ops::Gather()(*_u8_shift_compensation, *index, _partial_u8_shift_compensation);
         if (_qscale && !_qscale->is_scalar())
           ops::Gather()(*_qscale, *index, _partial_qscale);
+        if (_qzero)
+          ops::Gather()(*_qzero, *index, _partial_qzero);
       } else {
         _partial_weight.clear();
         _partial_bias.clear();
         _partial_qscale.clear();
+        _partial_qzero.clear();
         _partial_u8_shift_compensation.clear();
+        _partial_index.clear();
       }
     }
 
+    void Dense::gemm(const StorageView& input,
+                     const StorageView& weight,
+                     StorageView& output,
+                     const StorageView* compensation,
+                     const StorageView* bias) const {
+      if (_partial_index.empty())
+        _gemm_op(input, weight, output, compensation, bias);
+      else
+        _indexed_gemm_op(input, weight, _partial_index, output, compensation, bias);
+    }
+
     void Dense::operator()(const StorageView& input, StorageView& output) const {
       PROFILE("Dense");
       if (_is_low_rank && !_partial_weight.empty())
         throw std::runtime_error("Low rank dense layer does not support partial weights");
       const StorageView* qscale = _partial_qscale.empty() ? _qscale : &_partial_qscale;
+      const StorageView* qzero = _partial_qzero.empty() ? _qzero : &_partial_qzero;
       const StorageView* weight = _partial_weight.empty() ? &_weight : &_partial_weight;
       const StorageView* weight2 = _is_low_rank ? _weight2 : nullptr;
       const StorageView* bias = _partial_bias.empty() ? _bias : &_partial_bias;
@@ -407,7 +464,7 @@ namespace ctranslate2 {
           _quantize_op(input, qinput, qinput_scale);
         }
 
-        _gemm_op(qinput, *weight, qoutput, compensation);
+        gemm(qinput, *weight, qoutput, compensation);
         _dequantize_op(qoutput,
                        qinput_scale,
                        *qscale,
@@ -415,7 +472,7 @@ namespace ctranslate2 {
                        /*trans_b=*/true,
                        output,
                        bias);
-      } else if (_qzero && _qscale) {
+      } else if (qzero && qscale) {
         if (_is_low_rank)
           throw std::runtime_error("Low rank dense layer not supported with quantized gemm");
         switch (_quant_method) {
@@ -423,7 +480,7 @@ namespace ctranslate2 {
             if (input.dim(0) * input.dim(1) >= 1024) {
               StorageView weight_dequant(input.dtype(), input.device());
               ops::DequantizeAwq dequantize_awq_op;
-              dequantize_awq_op(*weight, *qscale, *_qzero, weight_dequant);
+              dequantize_awq_op(*weight, *qscale, *qzero, weight_dequant);
               ops::Gemm gemm_op(/*alpha=*/1,
                                 /*beta=*/0,
                                 /*trans_a=*/false,
@@ -435,23 +492,29 @@ namespace ctranslate2 {
             } else {
               ops::GemmAwq gemm_awq_op(/*alpha=*/1, /*beta=*/0, /*trans_a=*/false, /*trans_b=*/false,
                 /*a_is_packed=*/false, /*b_is_packed=*/false, _activation_type);
-              gemm_awq_op(input, *weight, *qscale, *_qzero, output, bias);
+              gemm_awq_op(input, *weight, *qscale, *qzero, output, bias);
             }
             break;
           case models::QUANTIZATION_TYPE::AWQ_GEMV:
           {
             ops::GemvAwq gemv_awq_op(/*alpha=*/1, /*beta=*/0, /*trans_a=*/false, /*trans_b=*/false,
               /*a_is_packed=*/false, /*b_is_packed=*/false, _activation_type);
-            gemv_awq_op(input, *weight, *qscale, *_qzero, output, bias);
+            gemv_awq_op(input, *weight, *qscale, *qzero, output, bias);
+            break;
+          }
+          case models::QUANTIZATION_TYPE::INT4:
+          {
+            const ops::GemmInt4 gemm_int4_op(_activation_type);
+            gemm_int4_op(input, *weight, *qscale, *qzero, output, bias);
             break;
           }
           default:
             throw std::invalid_argument("Dense forward: invalid quantized type,"
-                                        "support only ct2 and awq quantization");
+                                        "support only ct2, awq and int4 quantization");
         }
       } else {
         if (!_is_low_rank) {
-          _gemm_op(input, *weight, output, nullptr, bias);
+          gemm(input, *weight, output, nullptr, bias);
         } else {
           StorageView& intermediate_output = output;
           _gemm_op(input, *weight, intermediate_output, nullptr);
@@ -460,6 +523,62 @@ namespace ctranslate2 {
       }
     }
 
+    void Dense::operator()(const StorageView& input,
+                           const LayerNorm& input_norm,
+                           StorageView& output,
+                           const StorageView* residual,
+                           StorageView* residual_output) const {
+      const bool affected_by_tp = ScopedMPISetter::getNRanks() > 1 && _is_layer_out;
+      const bool fuse_input_norm = (_quantized_gemm
+                                    && _weight.dtype() == DataType::INT8
+                                    && input.device() == Device::CPU
+                                    && !_is_low_rank
+                                    && !affected_by_tp);
+
+      if (!fuse_input_norm) {
+        const StorageView* x = &input;
+        if (residual) {
+          ops::Add()(input, *residual, *residual_output);
+          x = residual_output;
+        }
+
+        StorageView normalized(input.dtype(), input.device());
+        input_norm(*x, normalized);
+        (*this)(normalized, output);
+        return;
+      }
+
+      PROFILE("Dense");
+      const StorageView* qscale = _partial_qscale.empty() ? _qscale : &_partial_qscale;
+      const StorageView* weight = _partial_weight.empty() ? &_weight : &_partial_weight;
+      const StorageView* bias = _partial_bias.empty() ? _bias : &_partial_bias;
+      const StorageView* compensation = (_partial_u8_shift_compensation.empty()
+                                         ? _u8_shift_compensation
+                                         : &_partial_u8_shift_compensation);
+
+      const auto device = input.device();
+      StorageView qinput(_weight.dtype(), device);
+      StorageView qinput_scale(_qscale->dtype(), device);
+      StorageView qoutput(DataType::INT32, device);
+
+      input_norm.quantize(input,
+                          qinput,
+                          qinput_scale,
+                          _quantize_op.shift_to_uint8(),
+                          _quantize_op.round_before_cast(),
+                          residual,
+                          residual_output);
+
+      gemm(qinput, *weight, qoutput, compensation);
+      _dequantize_op(qoutput,
+                     qinput_scale,
+                     *qscale,
+                     /*trans_a=*/false,
+                     /*trans_b=*/true,
+                     output,
+                     bias);
+    }
+
 
     LayerNorm::LayerNorm(const models::Model& model, const std::string& scope)
       : _beta(model.get_variable_if_exists(scope + "/beta"))
@@ -490,6 +609,20 @@ namespace ctranslate2 {
       }
     }
 
+    void LayerNorm::quantize(const StorageView& input,
+                             StorageView& output,
+                             StorageView& scale,
+                             bool shift_to_uint8,
+                             bool round_before_cast,
+                             const StorageView* residual,
+                             StorageView* residual_output) const {
+      const ops::NormQuantize norm_quantize_op(_epsilon,
+                                               /*use_residual=*/!_beta && _use_residual,
+                                               shift_to_uint8,
+                                               round_before_cast);
+      norm_quantize_op(_beta, _gamma, input, output, scale, residual, residual_output);
+    }
+
 
     Conv1D::Conv1D(const models::Model& model,
                    const std::string& scope,
@@ -30,10 +30,20 @@ namespace ctranslate2 {
       : _device(device) {
     }
 
+    static const std::string source_index_name = "source_index";
+
     void Decoder::update_state(DecoderState& state, const StorageView& alive_batches) const {
-      for (auto& pair : state) {
-        ops::Gather()(pair.second, alive_batches);
+      const bool has_source_index = source_index(state);
+
+      for (auto& [name, value] : state) {
+        if (shared_state(name))
+          continue;
+        if (!has_source_index || replicate_state(name))
+          ops::Gather()(value, alive_batches);
       }
+
+      if (has_source_index)
+        remove_unused_source_rows(state);
     }
 
     void Decoder::update_state(DecoderState& state,
@@ -46,29 +56,180 @@ namespace ctranslate2 {
         merge_batch_beam(beam_indices);
       }
 
+      const bool has_source_index = source_index(state);
+
       for (auto& [name, value] : state) {
+        if (shared_state(name))
+          continue;
         if (replicate_state(name))
           ops::Gather()(value, beam_indices);
-        else if (alive_batches)
+        else if (alive_batches && !has_source_index)
           ops::Gather()(value, *alive_batches);
       }
+
+      if (has_source_index)
+        remove_unused_source_rows(state);
     }
 
-    void Decoder::replicate_state(DecoderState& state, const dim_t beam_size) const {
+    void Decoder::replicate_state(DecoderState& state,
+                                  const dim_t beam_size,
+                                  const bool independent_replicas) const {
+      if (independent_replicas)
+        add_source_index(state);
+
       for (auto& [name, value] : state) {
-        if (value && replicate_state(name))
+        if (value && !shared_state(name) && replicate_state(name))
           repeat_batch(value, beam_size);
       }
     }
 
+    void Decoder::add_source_index(DecoderState& state) const {
+      if (source_index(state))
+        return;
+
+      dim_t batch_size = 0;
+      dim_t num_rows = 0;
+      for (const auto& [name, value] : state) {
+        if (!value || shared_state(name))
+          continue;
+        if (replicate_state(name))
+          batch_size = value.dim(0);
+        else
+          num_rows = value.dim(0);
+      }
+
+      if (num_rows == 0)
+        return;
+
+      // The replicated states can all be empty before the first step.
+      if (batch_size == 0)
+        batch_size = num_rows;
+      if (batch_size % num_rows != 0)
+        throw std::invalid_argument("The decoder state has "
+                                    + std::to_string(batch_size)
+                                    + " batches which cannot be mapped to "
+                                    + std::to_string(num_rows)
+                                    + " shared rows");
+
+      const dim_t batches_per_row = batch_size / num_rows;
+      std::vector<int32_t> index(batch_size);
+      for (dim_t i = 0; i < batch_size; ++i)
+        index[i] = i / batches_per_row;
+
+      state.emplace(source_index_name, StorageView({batch_size}, index, _device));
+    }
+
+    const StorageView* Decoder::source_index(const DecoderState& state) {
+      const auto it = state.find(source_index_name);
+      return it != state.end() ? &it->second : nullptr;
+    }
+
+    void Decoder::remove_unused_source_rows(DecoderState& state) const {
+      StorageView& source_index = state.at(source_index_name);
+
+      dim_t num_rows = 0;
+      for (const auto& [name, value] : state) {
+        if (value && !shared_state(name) && !replicate_state(name))
+          num_rows = value.dim(0);
+      }
+
+      StorageView index = source_index.to(Device::CPU);
+      auto* index_data = index.data<int32_t>();
+
+      // Rows are renumbered in order of first use.
+      std::vector<int32_t> new_rows(num_rows, -1);
+      std::vector<int32_t> used_rows;
+      used_rows.reserve(num_rows);
+      for (dim_t i = 0; i < index.size(); ++i) {
+        int32_t& row = index_data[i];
+        if (new_rows[row] < 0) {
+          new_rows[row] = used_rows.size();
+          used_rows.push_back(row);
+        }
+        row = new_rows[row];
+      }
+
+      if (dim_t(used_rows.size()) == num_rows
+          && std::is_sorted(used_rows.begin(), used_rows.end()))
+        return;
+
+      const StorageView rows({dim_t(used_rows.size())}, used_rows, _device);
+      for (auto& [name, value] : state) {
+        if (value && !shared_state(name) && !replicate_state(name))
+          ops::Gather()(value, rows);
+      }
+
+      source_index = index.to(_device);
+    }
+
+    bool Decoder::support_continuous_batching() const {
+      return false;
+    }
+
+    void Decoder::append_state(DecoderState& state, DecoderState other) const {
+      if (state.empty()) {
+        state = std::move(other);
+        return;
+      }
+
+      if (other.size() != state.size())
+        throw std::invalid_argument("Cannot append decoder states with different entries");
+
+      const ops::Concat concat_op(0);
+
+      for (auto& [name, value] : state) {
+        if (shared_state(name))
+          throw std::invalid_argument("The decoder state " + name + " cannot be appended");
+
+        const auto it = other.find(name);
+        if (it == other.end())
+          throw std::invalid_argument("Cannot append decoder states with different entries");
+
+        StorageView& other_value = it->second;
+        if (!other_value)
+          continue;
+        if (!value) {
+          value = std::move(other_value);
+          continue;
+        }
+
+        const StorageView cur_value = std::move(value);
+        concat_op({&cur_value, &other_value}, value);
+      }
+    }
+
+    void Decoder::truncate_state(DecoderState&, dim_t) const {
+      throw std::invalid_argument("This decoder does not support truncating its state");
+    }
+
+    bool Decoder::support_prefix_cache(dim_t) const {
+      return false;
+    }
+
+    DecoderState Decoder::get_cached_steps(const DecoderState&, dim_t, dim_t, dim_t) const {
+      throw std::invalid_argument("This decoder does not support exporting its cached steps");
+    }
+
+    void Decoder::set_cached_steps(DecoderState&, const std::vector<DecoderState>&) const {
+      throw std::invalid_argument("This decoder does not support importing cached steps");
+    }
+
     dim_t Decoder::batch_size(const DecoderState& state) const {
-      return state.begin()->second.dim(0);
+      for (const auto& [name, value] : state) {
+        if (!shared_state(name))
+          return value.dim(0);
+      }
+      return 0;
     }
 
     bool Decoder::replicate_state(const std::string&) const {
       return true;
     }
 
+    bool Decoder::shared_state(const std::string&) const {
+      return false;
+    }
+
     void Decoder::update_output_layer(const dim_t size_multiple,
                                       const std::vector<size_t>& restrict_ids) {
       const dim_t current_output_size = output_size();
@@ -132,22 +293,272 @@ namespace ctranslate2 {
 
       output_layer().select_weights(&index, extra_bias.get());
 
+      // Only reset the entries of the previous selection to avoid a pass over the vocabulary.
+      if (_to_output_word_id.empty())
+        _to_output_word_id.resize(_vocabulary_size, -1);
+      else {
+        for (const size_t id : _to_original_word_id)
+          _to_output_word_id[id] = -1;
+      }
+
       _to_original_word_id = std::move(ids);
-      _to_output_word_id.reserve(_to_original_word_id.size());
-      for (size_t i = 0; i < _to_original_word_id.size(); ++i)
-        _to_output_word_id.emplace(_to_original_word_id[i], i);
+      for (size_t i = 0; i < _to_original_word_id.size(); ++i) {
+        // Keep the first position of ids that appear multiple times (e.g. the padding).
+        auto& output_id = _to_output_word_id[_to_original_word_id[i]];
+        if (output_id < 0)
+          output_id = i;
+      }
+    }
+
+
+    struct PrefixCache::Node {
+      std::vector<size_t> tokens;
+      std::shared_ptr<const DecoderState> steps;  // The steps of tokens.
+      std::unordered_map<size_t, std::unique_ptr<Node>> children;  // Indexed by first token.
+      Node* parent = nullptr;
+      size_t last_access = 0;
+      size_t size = 0;
+    };
+
+    static size_t get_steps_size(const DecoderState& steps) {
+      size_t size = 0;
+      for (const auto& [name, value] : steps)
+        size += value.size() * value.item_size();
+      return size;
+    }
+
+    static DecoderState slice_steps(const DecoderState& steps, dim_t begin, dim_t length) {
+      DecoderState slice;
+      const ops::Slide slide_op(0, begin, length);
+      for (const auto& [name, value] : steps) {
+        StorageView& value_slice = slice.emplace(name, StorageView(value.dtype(),
+                                                                   value.device())).first->second;
+        slide_op(value, value_slice);
+      }
+      return slice;
     }
 
+    PrefixCache::PrefixCache(size_t max_size)
+      : _max_size(max_size)
+      , _root(std::make_unique<Node>())
+    {
+    }
+
+    PrefixCache::~PrefixCache() = default;
+
+    size_t PrefixCache::match_prefix(const std::vector<size_t>& prompt,
+                                     const size_t max_length,
+                                     std::vector<Node*>* path) const {
+      const size_t end = std::min(max_length, prompt.size());
+      size_t length = 0;
+      Node* node = _root.get();
+
+      while (length < end) {
+        const auto it = node->children.find(prompt[length]);
+        if (it == node->children.end())
+          break;
+
+        Node* child = it->second.get();
+        const size_t max_match = std::min(child->tokens.size(), end - length);
+        size_t match = 1;
+        while (match < max_match && child->tokens[match] == prompt[length + match])
+          ++match;
+
+        if (path)
+          path->push_back(child);
+        length += match;
+        if (match < child->tokens.size())
+          break;
+        node = child;
+      }
+
+      return length;
+    }
+
+    std::vector<DecoderState>
+    PrefixCache::get(const std::vector<std::vector<size_t>>& prompts,
+                     size_t max_length,
+                     size_t& length) {
+      // The steps are shared with the cache so the nodes can be evicted while they are used.
+      std::vector<std::vector<std::shared_ptr<const DecoderState>>> prompts_steps;
+      prompts_steps.reserve(prompts.size());
+
+      {
+        const std::lock_guard<std::mutex> lock(_mutex);
+
+        length = max_length;
+        for (const auto& prompt : prompts)
+          length = std::min(length, match_prefix(prompt, length));
+        if (length == 0)
+          return {};
+
+        ++_clock;
+        for (const auto& prompt : prompts) {
+          std::vector<Node*> path;
+          match_prefix(prompt, length, &path);
+
+          auto& prompt_steps = prompts_steps.emplace_back();
+          prompt_steps.reserve(path.size());
+          for (Node* node : path) {
+            node->last_access = _clock;
+            prompt_steps.emplace_back(node->steps);
+          }
+        }
+      }
+
+      std::vector<DecoderState> states;
+      states.reserve(prompts.size());
+
+      for (const auto& prompt_steps : prompts_steps) {
+        // The last node is only partially used if the prefix ends in the middle of its tokens.
+        size_t offset = 0;
+        std::vector<DecoderState> slices;
+        std::vector<const DecoderState*> parts;
+        slices.reserve(prompt_steps.size());
+        parts.reserve(prompt_steps.size());
+
+        for (const auto& steps : prompt_steps) {
+          const dim_t num_steps = steps->begin()->second.dim(0);
+          const dim_t num_used = std::min(num_steps, dim_t(length - offset));
+          if (num_used < num_steps) {
+            slices.emplace_back(slice_steps(*steps, 0, num_used));
+            parts.emplace_back(&slices.back());
+          } else {
+            parts.emplace_back(steps.get());
+          }
+          offset += num_used;
+        }
+
+        DecoderState& state = states.emplace_back();
+        const ops::Concat concat_op(0);
+
+        for (const auto& [name, value] : *parts.front()) {
+          std::vector<const StorageView*> inputs;
+          inputs.reserve(parts.size());
+          for (const auto* part : parts)
+            inputs.emplace_back(&part->at(name));
+
+          StorageView& output = state.emplace(name, StorageView(value.dtype(),
+                                                                value.device())).first->second;
+          if (inputs.size() == 1)
+            output.copy_from(value);
+          else
+            concat_op(inputs, output);
+        }
+      }
+
+      return states;
+    }
+
+    void PrefixCache::save(const std::vector<size_t>& prompt,
+                           size_t length,
+                           const std::function<DecoderState(dim_t, dim_t)>& get_steps) {
+      length = std::min(length, prompt.size());
+      if (length == 0)
+        return;
+
+      // The new steps are copied from the decoder state without holding the lock, so that
+      // the other replicas are not blocked during the copy.
+      size_t cached_length = 0;
+      {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        cached_length = match_prefix(prompt, length);
+      }
+
+      DecoderState new_steps;
+      if (cached_length < length)
+        new_steps = get_steps(cached_length, length);
 
-    void DecoderStateCache::save(std::vector<size_t> prompt, DecoderState state) {
       const std::lock_guard<std::mutex> lock(_mutex);
-      _cache.emplace(std::move(prompt), std::move(state));
+      ++_clock;
+
+      Node* node = _root.get();
+      size_t offset = 0;
+
+      while (offset < length) {
+        const auto it = node->children.find(prompt[offset]);
+
+        if (it == node->children.end()) {
+          // Another replica may have saved or evicted some steps in the meantime. The leaf is
+          // not inserted if the steps before cached_length are no longer in the cache.
+          if (offset < cached_length)
+            break;
+
+          auto leaf = std::make_unique<Node>();
+          leaf->tokens.assign(prompt.begin() + offset, prompt.begin() + length);
+          leaf->steps = std::make_shared<const DecoderState>(
+            offset == cached_length
+            ? std::move(new_steps)
+            : slice_steps(new_steps, offset - cached_length, length - offset));
+          leaf->size = get_steps_size(*leaf->steps);
+          leaf->parent = node;
+          leaf->last_access = _clock;
+          _size += leaf->size;
+          node->children.emplace(prompt[offset], std::move(leaf));
+          break;
+        }
+
+        Node* child = it->second.get();
+        const size_t max_match = std::min(child->tokens.size(), length - offset);
+        size_t match = 1;
+        while (match < max_match && child->tokens[match] == prompt[offset + match])
+          ++match;
+
+        if (match < child->tokens.size()) {
+          // Split the node: the unmatched tokens are moved to a new child.
+          auto suffix = std::make_unique<Node>();
+          const dim_t suffix_length = child->tokens.size() - match;
+          suffix->tokens.assign(child->tokens.begin() + match, child->tokens.end());
+          suffix->steps = std::make_shared<const DecoderState>(
+            slice_steps(*child->steps, match, suffix_length));
+          suffix->size = get_steps_size(*suffix->steps);
+          suffix->children = std::move(child->children);
+          for (auto& [token, grandchild] : suffix->children)
+            grandchild->parent = suffix.get();
+          suffix->parent = child;
+          suffix->last_access = child->last_access;
+
+          _size -= child->size;
+          child->tokens.resize(match);
+          child->steps = std::make_shared<const DecoderState>(slice_steps(*child->steps, 0, match));
+          child->size = get_steps_size(*child->steps);
+          child->children.clear();
+          child->children.emplace(suffix->tokens.front(), std::move(suffix));
+          _size += child->size + child->children.begin()->second->size;
+        }
+
+        child->last_access = _clock;
+        offset += match;
+        node = child;
+      }
+
+      evict();
+    }
+
+    void PrefixCache::evict() {
+      while (_size > _max_size && !_root->children.empty()) {
+        Node* lru_leaf = nullptr;
+        std::vector<Node*> nodes = {_root.get()};
+
+        while (!nodes.empty()) {
+          Node* node = nodes.back();
+          nodes.pop_back();
+          for (auto& [token, child] : node->children) {
+            if (!child->children.empty())
+              nodes.push_back(child.get());
+            else if (!lru_leaf || child->last_access < lru_leaf->last_access)
+              lru_leaf = child.get();
+          }
+        }
+
+        _size -= lru_leaf->size;
+        lru_leaf->parent->children.erase(lru_leaf->tokens.front());
+      }
     }
 
-    const DecoderState* DecoderStateCache::get(const std::vector<size_t>& prompt) const {
+    size_t PrefixCache::size() const {
       const std::lock_guard<std::mutex> lock(_mutex);
-      const auto it = _cache.find(prompt);
-      return it == _cache.end() ? nullptr : &it->second;
+      return _size;
     }
 
   }
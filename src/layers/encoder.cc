@@ -0,0 +1,133 @@
+#include "ctranslate2/layers/encoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "ctranslate2/primitives.h"
+#include "dispatch.h"
+
+namespace ctranslate2 {
+  namespace layers {
+
+    static size_t get_output_size(const StorageView& output) {
+      return output.size() * output.item_size();
+    }
+
+    EncoderCache::EncoderCache(size_t max_size)
+      : _max_size(max_size)
+    {
+    }
+
+    static inline uint64_t rotate_left(uint64_t x, int bits) {
+      return (x << bits) | (x >> (64 - bits));
+    }
+
+    void EncoderCache::hash(Key& key, const void* data, size_t size) {
+      // Two independent 64-bit hashes are computed to make collisions unlikely.
+      const auto* bytes = static_cast<const uint8_t*>(data);
+      uint64_t h1 = key[0] ^ 0xcbf29ce484222325ULL;
+      uint64_t h2 = key[1] ^ 0x9e3779b97f4a7c15ULL;
+
+      const auto update = [&h1, &h2](uint64_t word) {
+        h1 = (h1 ^ word) * 0x100000001b3ULL;
+        h2 = rotate_left(h2 + word * 0xc2b2ae3d27d4eb4fULL, 31) * 0x9e3779b97f4a7c15ULL;
+      };
+
+      size_t offset = 0;
+      for (; offset + sizeof (uint64_t) <= size; offset += sizeof (uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, bytes + offset, sizeof (word));
+        update(word);
+      }
+
+      if (offset < size) {
+        uint64_t tail = 0;
+        std::memcpy(&tail, bytes + offset, size - offset);
+        update(tail);
+      }
+      update(size);
+
+      key = {h1, h2};
+    }
+
+    std::shared_ptr<const StorageView> EncoderCache::get(const Key& key) {
+      const std::lock_guard<std::mutex> lock(_mutex);
+
+      const auto it = _entries.find(key);
+      if (it == _entries.end())
+        return nullptr;
+
+      auto& entry = it->second;
+      _lru.splice(_lru.begin(), _lru, entry.lru_position);
+      return entry.output;
+    }
+
+    std::shared_ptr<const StorageView> EncoderCache::save(const Key& key, StorageView output) {
+      auto cached_output = std::make_shared<const StorageView>(std::move(output));
+      const size_t output_size = get_output_size(*cached_output);
+      if (output_size > _max_size)
+        return cached_output;
+
+      const std::lock_guard<std::mutex> lock(_mutex);
+
+      // The output may have been cached by another replica in the meantime.
+      const auto it = _entries.find(key);
+      if (it != _entries.end())
+        return it->second.output;
+
+      _lru.push_front(key);
+      _entries.emplace(key, Entry{cached_output, _lru.begin()});
+      _size += output_size;
+
+      while (_size > _max_size) {
+        const auto last = _entries.find(_lru.back());
+        _size -= get_output_size(*last->second.output);
+        _entries.erase(last);
+        _lru.pop_back();
+      }
+
+      return cached_output;
+    }
+
+    size_t EncoderCache::size() const {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      return _size;
+    }
+
+    void EncoderCache::stack(const std::vector<std::shared_ptr<const StorageView>>& outputs,
+                             const dim_t time_multiple,
+                             StorageView& batch,
+                             StorageView* lengths) {
+      const StorageView& first = *outputs.front();
+      const dim_t batch_size = outputs.size();
+      const dim_t depth = first.dim(1);
+
+      dim_t max_time = 0;
+      std::vector<int32_t> lengths_vec;
+      lengths_vec.reserve(batch_size);
+      for (const auto& output : outputs) {
+        lengths_vec.emplace_back(output->dim(0));
+        max_time = std::max(max_time, output->dim(0));
+      }
+
+      if (max_time % time_multiple != 0)
+        max_time += time_multiple - (max_time % time_multiple);
+
+      batch = StorageView({batch_size, max_time, depth}, first.dtype(), first.device());
+      batch.zero();
+
+      DEVICE_AND_TYPE_DISPATCH(first.device(), first.dtype(), {
+        for (dim_t b = 0; b < batch_size; ++b) {
+          const StorageView& output = *outputs[b];
+          primitives<D>::copy(output.data<T>(),
+                              batch.data<T>() + b * max_time * depth,
+                              output.size());
+        }
+      });
+
+      if (lengths)
+        *lengths = StorageView({batch_size}, lengths_vec, first.device());
+    }
+
+  }
+}
@@ -26,7 +26,10 @@ namespace ctranslate2 {
                                              const Padder*,
                                              bool return_normalized_attention,
                                              StorageView*,
-                                             dim_t offset) const {
+                                             dim_t offset,
+                                             const PagedKVCache*,
+                                             StorageView*,
+                                             StorageView*) const {
       PROFILE("MultiHeadAttention");
       const Device device = queries.device();
       const DataType dtype = queries.dtype();
@@ -63,19 +66,29 @@ namespace ctranslate2 {
         ops::Split(2)(fused_proj, queries_proj, keys_proj, values_proj);
       }
 
+      // On GPU, the rotary embeddings of the next steps are applied in the attention kernel.
+      const bool fused_rotary = (device == Device::CUDA);
+
+      // On CPU, the cache is not truncated to the sliding window: the attention kernel only
+      // reads the keys in the window.
+      const bool slide_cache = (device == Device::CUDA);
+
       if (_rotary_embeddings) {
-        _rotary_embeddings->apply(queries_proj, offset, true);
-        _rotary_embeddings->apply(keys_proj, offset, true);
+        _rotary_embeddings->apply(queries_proj, offset, fused_rotary);
+        _rotary_embeddings->apply(keys_proj, offset, fused_rotary);
       }
 
       if (cached_keys != nullptr) {
+        const dim_t num_steps = keys_proj.dim(_cache_time_dim);
+
         if (cached_keys->empty()) {
           *cached_keys = std::move(keys_proj);
           *cached_values = std::move(values_proj);
-        } else if (cached_keys->dim(_cache_time_dim) <= offset) {
+        } else if (cached_keys->dim(_cache_time_dim) < offset + num_steps) {
           const ops::Concat concat_op(_cache_time_dim);
           auto shape = cached_keys->shape();
-          shape[_cache_time_dim] = _offset_free_space;
+          shape[_cache_time_dim] = std::max(_offset_free_space,
+                                            offset + num_steps - shape[_cache_time_dim]);
           StorageView empty_storage(std::move(shape), dtype, device);
           StorageView& tmp = fused_proj;  // Reuse storage.
           tmp = std::move(*cached_keys);
@@ -83,7 +96,10 @@ namespace ctranslate2 {
           tmp = std::move(*cached_values);
           concat_op({&tmp, &empty_storage}, *cached_values);
 
-          if (!prefilling && _sliding_window > 0 && (offset / (_sliding_window - 1)) >= 1) {
+          if (slide_cache
+              && !prefilling
+              && _sliding_window > 0
+              && (offset / (_sliding_window - 1)) >= 1) {
             // only for generation
             const ops::Slide slide_op(_cache_time_dim, 1, cached_keys->shape()[_cache_time_dim] - 1);
             slide_op(*cached_keys, tmp);
@@ -102,19 +118,29 @@ namespace ctranslate2 {
       StorageView* rotary_cos = nullptr;
       StorageView* rotary_sin = nullptr;
       bool rotary_interleaved = false;
-      if (_rotary_embeddings && offset > 0) {
+      if (_rotary_embeddings && offset > 0 && fused_rotary) {
         rotary_cos = &(_rotary_embeddings->get_cos_half());
         rotary_sin = &(_rotary_embeddings->get_sin_half());
         rotary_interleaved = _rotary_embeddings->get_interleave();
       }
 
+      // The CPU kernel adds the ALiBi bias to the attention scores.
+      const StorageView* alibi = nullptr;
+      if (_alibi && device == Device::CPU) {
+        const dim_t num_keys = offset + keys_proj.dim(_cache_time_dim);
+        alibi = &_alibi->get(_num_heads, num_keys, device, dtype, _queries_scale);
+      }
+
       // init output
       StorageView context(dtype, device);
       ops::FlashAttention fl_attn_ops(_queries_scale, _sliding_window);
       fl_attn_ops(queries_proj, keys_proj, values_proj, context, cached_keys, cached_values, attention,
-                  return_normalized_attention, rotary_cos, rotary_sin, rotary_interleaved, nullptr/*alibli*/, offset);
+                  return_normalized_attention, rotary_cos, rotary_sin, rotary_interleaved, alibi, offset);
 
-      if (prefilling && cached_keys && cached_keys->shape()[_cache_time_dim] > _sliding_window) {
+      if (slide_cache
+          && prefilling
+          && cached_keys
+          && cached_keys->shape()[_cache_time_dim] > _sliding_window) {
         // set only last sliding_window tokens to cached_keys and cached_values after computing attention
         const ops::Slide slide_op(_cache_time_dim, cached_keys->shape()[_cache_time_dim] - _sliding_window, _sliding_window);
         StorageView tmp(dtype, device);
@@ -1,10 +1,19 @@
 #include "ctranslate2/layers/transformer.h"
 
 #include <cmath>
+#include <cstring>
+
+#include "env.h"
 
 namespace ctranslate2 {
   namespace layers {
 
+    static bool has_fused_gate(const models::Model& model, const std::string& scope) {
+      // See Model::fuse_gated_linear_weights.
+      return (model.get_variable_if_exists(scope + "/linear_0_gated/weight")
+              || model.get_variable_if_exists(scope + "/linear_0_gated/weight_packed"));
+    }
+
     FeedForwardNetwork::FeedForwardNetwork(const models::Model& model,
                                            const std::string& scope,
                                            const bool pre_norm,
@@ -12,24 +21,73 @@ namespace ctranslate2 {
       : _layer_norm(build_optional_layer<LayerNorm>(model, scope + "/layer_norm"))
       , _pre_norm(pre_norm)
       , _activation_type(activation_type)
-      , _ff1(model, scope + "/linear_0", &_activation_type)
-      , _ff1_noact(build_optional_layer<Dense>(model, scope + "/linear_0_noact"))
+      , _fused_gate(has_fused_gate(model, scope))
+      , _ff1(model,
+             scope + (_fused_gate ? "/linear_0_gated" : "/linear_0"),
+             _fused_gate ? nullptr : &_activation_type)
+      , _ff1_noact(_fused_gate
+                   ? nullptr
+                   : build_optional_layer<Dense>(model, scope + "/linear_0_noact"))
+      , _gated_activation_op(activation_type)
       , _ff2(model, scope + "/linear_1", nullptr, true)
       , _tensor_parallel(model.tensor_parallel()) {
     }
 
     void FeedForwardNetwork::operator()(const StorageView& input, StorageView& output) const {
-      const StorageView* x = &input;
-      if (_layer_norm && _pre_norm) {
-        (*_layer_norm)(input, output);
-        x = &output;
+      forward(input, _pre_norm ? _layer_norm.get() : nullptr, nullptr, nullptr, output);
+
+      if (_layer_norm) {
+        ops::Add()(input, output, output);
+
+        if (!_pre_norm)
+          (*_layer_norm)(output, output);
       }
+    }
 
+    void FeedForwardNetwork::operator()(const StorageView& input,
+                                        const StorageView& residual,
+                                        const LayerNorm& input_norm,
+                                        StorageView& residual_output,
+                                        StorageView& output) const {
+      forward(input, &input_norm, &residual, &residual_output, output);
+    }
+
+    void FeedForwardNetwork::forward(const StorageView& input,
+                                     const LayerNorm* input_norm,
+                                     const StorageView* residual,
+                                     StorageView* residual_output,
+                                     StorageView& output) const {
       const Device device = input.device();
       const DataType dtype = input.dtype();
 
       StorageView inner(dtype, device);
-      _ff1(*x, inner);
+      StorageView gated(dtype, device);
+      StorageView& ff1_output = _fused_gate ? gated : inner;
+
+      StorageView normalized(dtype, device);
+      const StorageView* x = &input;
+
+      if (input_norm && !_ff1_noact) {
+        // The normalized input is only used by the first linear layer, so the normalization
+        // can be fused with its input quantization.
+        _ff1(input, *input_norm, ff1_output, residual, residual_output);
+      } else {
+        if (residual) {
+          ops::Add()(input, *residual, *residual_output);
+          x = residual_output;
+        }
+        if (input_norm) {
+          (*input_norm)(*x, normalized);
+          x = &normalized;
+        }
+        _ff1(*x, ff1_output);
+      }
+
+      if (_fused_gate) {
+        // Both input projections were computed by a single GEMM.
+        _gated_activation_op(gated, inner);
+      }
+
       if (_ff1_noact) {
         StorageView linear(dtype, device);
         (*_ff1_noact)(*x, linear);
@@ -45,13 +103,6 @@ namespace ctranslate2 {
         red_op(output, tmp);
         output = std::move(tmp);
       }
-
-      if (_layer_norm) {
-        ops::Add()(input, output, output);
-
-        if (!_pre_norm)
-          (*_layer_norm)(output, output);
-      }
     }
 
 
@@ -147,7 +198,11 @@ namespace ctranslate2 {
                                              const Padder* memory_padder,
                                              bool return_normalized_attention,
                                              StorageView* position_bias,
-                                             dim_t offset) const {
+                                             dim_t offset,
+                                             const PagedKVCache* paged_cache,
+                                             StorageView* cached_self_attn_keys_scale,
+                                             StorageView* cached_self_attn_values_scale,
+                                             const MemoryIndex* memory_index) const {
       PROFILE("TransformerDecoderLayer");
 
       const DataType dtype = input.dtype();
@@ -171,16 +226,16 @@ namespace ctranslate2 {
                              input_padder,
                              true,
                              position_bias,
-                             offset);
+                             offset,
+                             paged_cache,
+                             cached_self_attn_keys_scale,
+                             cached_self_attn_values_scale);
 
-        (*_post_attention_layer_norm)(context, output);
-        ops::Add()(output, input, output);
+        (*_post_attention_layer_norm)(context, hidden);
 
-        context = std::move(output);
-        (*_pre_feedforward_layer_norm)(context, output);
-        hidden = std::move(output);
-
-        _ff(hidden, output);
+        // The residual connection and the normalization are applied with the first
+        // feed-forward layer. The residual stream is returned in context.
+        _ff(hidden, input, *_pre_feedforward_layer_norm, context, output);
 
         hidden = std::move(output);
         (*_post_feedforward_layer_norm)(hidden, output);
@@ -212,7 +267,10 @@ namespace ctranslate2 {
                         input_padder,
                         true,
                         position_bias,
-                        offset);
+                        offset,
+                        paged_cache,
+                        cached_self_attn_keys_scale,
+                        cached_self_attn_values_scale);
 
         if (_post_attention_layer_norm)
           (*_post_attention_layer_norm)(input, hidden);
@@ -236,10 +294,36 @@ namespace ctranslate2 {
                       input_padder,
                       true,
                       position_bias,
-                      offset);
+                      offset,
+                      paged_cache,
+                      cached_self_attn_keys_scale,
+                      cached_self_attn_values_scale);
 
       StorageView context(dtype, device);
-      if (_encoder_attention) {
+      if (_encoder_attention && memory_index) {
+        if (input_padder)
+          throw std::invalid_argument("The cross attention with a memory index does not "
+                                      "support padded inputs");
+
+        StorageView queries(dtype, device);
+        StorageView grouped_context(dtype, device);
+        StorageView grouped_attention(dtype, device);
+        ops::Gather()(output, memory_index->group_queries, queries);
+        (*_encoder_attention)(queries,
+                              *memory,
+                              memory_lengths,
+                              grouped_context,
+                              cached_attn_keys,
+                              cached_attn_values,
+                              attention ? &grouped_attention : nullptr,
+                              nullptr,
+                              memory_padder,
+                              return_normalized_attention);
+        ops::Gather()(grouped_context, memory_index->ungroup_outputs, context);
+        if (attention)
+          ops::Gather()(grouped_attention, memory_index->ungroup_outputs, *attention);
+      }
+      else if (_encoder_attention) {
         (*_encoder_attention)(output,
                               *memory,
                               memory_lengths,
@@ -377,6 +461,37 @@ namespace ctranslate2 {
       return std::make_unique<Alibi>(use_positive_positions, scale_alibi);
     }
 
+    static bool support_paged_cache(const models::Model& model,
+                                    const std::vector<std::unique_ptr<const TransformerDecoderLayer>>& layers,
+                                    const bool use_flash_attention,
+                                    const dim_t sliding_window) {
+      // The paged cache is currently implemented for float32 on CPU.
+      if (model.device() != Device::CPU
+          || get_default_float_type(model.effective_compute_type()) != DataType::FLOAT32
+          || use_flash_attention
+          || sliding_window > 0)
+        return false;
+
+      for (const auto& layer : layers) {
+        if (!layer->get_self_attention().support_paged_cache())
+          return false;
+      }
+
+      return true;
+    }
+
+    static dim_t get_kv_cache_page_size(const models::Model& model,
+                                        const bool support_paged_cache) {
+      if (!support_paged_cache)
+        return 0;
+
+      // Continuous batching writes the sequences at different positions in the paged cache.
+      const dim_t page_size = PagedKVCache::default_page_size();
+      if (page_size == 0 && model.use_continuous_batching())
+        return 16;
+      return page_size;
+    }
+
     TransformerDecoder::TransformerDecoder(const models::Model& model, const std::string& scope)
       : Decoder(model.device())
       , _num_heads(model.get_attribute_with_default<int32_t>(scope + "/num_heads", 8))
@@ -405,7 +520,16 @@ namespace ctranslate2 {
       , _with_encoder_attention(_layers.front()->has_cross_attention())
       , _proj(model, scope + "/projection")
       , _sliding_window(model.get_attribute_with_default<int32_t>(scope + "/sliding_window", 0))
-      , _tensor_parallel(model.tensor_parallel()) {
+      , _tensor_parallel(model.tensor_parallel())
+      , _support_paged_cache(support_paged_cache(model,
+                                                 _layers,
+                                                 _use_flash_attention,
+                                                 _sliding_window))
+      , _kv_cache_page_size(get_kv_cache_page_size(model, _support_paged_cache))
+      , _kv_cache_int8(read_bool_from_env("CT2_KV_CACHE_INT8")
+                       && model.device() == Device::CPU
+                       && !_use_flash_attention
+                       && _sliding_window == 0) {
 
       dim_t alignment_layer = (
         model.get_attribute_with_default<int32_t>(scope + "/alignment_layer", -1));
@@ -437,13 +561,24 @@ namespace ctranslate2 {
 
         for (size_t i = 0; i < _layers.size(); ++i) {
           const std::string i_str = std::to_string(i);
-          state.emplace("self_keys_" + i_str, StorageView(dtype, _device));
-          state.emplace("self_values_" + i_str, StorageView(dtype, _device));
+          const DataType cache_dtype = quantize_kv_cache() ? DataType::INT8 : dtype;
+          state.emplace("self_keys_" + i_str, StorageView(cache_dtype, _device));
+          state.emplace("self_values_" + i_str, StorageView(cache_dtype, _device));
+          if (quantize_kv_cache()) {
+            state.emplace("self_keys_scale_" + i_str, StorageView(DataType::FLOAT32, _device));
+            state.emplace("self_values_scale_" + i_str, StorageView(DataType::FLOAT32, _device));
+          }
           if (_with_encoder_attention) {
             state.emplace("memory_keys_" + i_str, StorageView(dtype, _device));
             state.emplace("memory_values_" + i_str, StorageView(dtype, _device));
           }
         }
+
+        if (_kv_cache_page_size > 0) {
+          // With a paged cache, the self attention keys and values are the layer pages.
+          state.emplace("self_page_table", StorageView(DataType::INT32, _device));
+          state.emplace("self_cache_lengths", StorageView(DataType::INT32, _device));
+        }
       }
 
       return state;
@@ -454,6 +589,317 @@ namespace ctranslate2 {
       return !_with_encoder_attention || !starts_with(name, "memory");
     }
 
+    bool TransformerDecoder::shared_state(const std::string& name) const {
+      return _kv_cache_page_size > 0 && (starts_with(name, "self_keys")
+                                         || starts_with(name, "self_values"));
+    }
+
+    bool TransformerDecoder::support_continuous_batching() const {
+      // The sequences at different steps are written at different positions in the paged cache.
+      return _kv_cache_page_size > 0;
+    }
+
+    // Pads x with zeros in dimension dim.
+    static void pad_dimension(StorageView& x, const dim_t dim, const dim_t size) {
+      if (x.dim(dim) >= size)
+        return;
+
+      Shape padding_shape = x.shape();
+      padding_shape[dim] = size - x.dim(dim);
+      StorageView padding(std::move(padding_shape), x.dtype(), x.device());
+      padding.zero();
+
+      const ops::Concat concat_op(dim);
+      const StorageView cur_x = std::move(x);
+      concat_op({&cur_x, &padding}, x);
+    }
+
+    void TransformerDecoder::append_state(DecoderState& state, DecoderState other) const {
+      if (state.empty() || _kv_cache_page_size == 0) {
+        Decoder::append_state(state, std::move(other));
+        return;
+      }
+
+      if (other.size() != state.size())
+        throw std::invalid_argument("Cannot append decoder states with different entries");
+
+      // The pages of the other state are appended to the current pages, so the page indices
+      // of the other sequences are shifted. Only the pages that are referenced are copied.
+      const StorageView& pages = state.at("self_keys_0");
+      StorageView& other_page_table = other.at("self_page_table");
+      const int32_t page_offset = pages ? pages.dim(0) : 0;
+      dim_t num_other_pages = 0;
+      for (dim_t i = 0; i < other_page_table.size(); ++i) {
+        int32_t& page = other_page_table.data<int32_t>()[i];
+        num_other_pages = std::max(num_other_pages, dim_t(page) + 1);
+        page += page_offset;
+      }
+
+      const ops::Concat concat_op(0);
+
+      for (auto& [name, value] : state) {
+        const auto it = other.find(name);
+        if (it == other.end())
+          throw std::invalid_argument("Cannot append decoder states with different entries");
+
+        StorageView& other_value = it->second;
+
+        if (shared_state(name) && other_value.dim(0) > num_other_pages) {
+          StorageView used_pages(other_value.dtype(), other_value.device());
+          ops::Slide(0, 0, num_other_pages)(other_value, used_pages);
+          other_value = std::move(used_pages);
+
+        } else if (name == "self_page_table") {
+          const dim_t max_pages = std::max(value.dim(1), other_value.dim(1));
+          pad_dimension(value, 1, max_pages);
+          pad_dimension(other_value, 1, max_pages);
+
+        } else if (starts_with(name, "memory_keys") || starts_with(name, "memory_values")) {
+          // Memories of different lengths are padded and masked with "memory_lengths".
+          const dim_t time_dim = value.rank() == 4 ? 2 : 1;
+          const dim_t max_time = std::max(value.dim(time_dim), other_value.dim(time_dim));
+          if (value.dim(time_dim) != other_value.dim(time_dim) && !state.count("memory_lengths"))
+            throw std::invalid_argument("Cannot append decoder states with different memory "
+                                        "lengths when the state has no memory lengths");
+          pad_dimension(value, time_dim, max_time);
+          pad_dimension(other_value, time_dim, max_time);
+        }
+
+        if (!other_value)
+          continue;
+        if (!value) {
+          value = std::move(other_value);
+          continue;
+        }
+
+        const StorageView cur_value = std::move(value);
+        concat_op({&cur_value, &other_value}, value);
+      }
+    }
+
+    dim_t TransformerDecoder::get_cache_time_dim(const std::string& name,
+                                                 const StorageView& value) const {
+      // FlashAttention caches have the shape [batch, time, heads, head_dim]. The scales of
+      // the int8 cache have the shape of the cache without the last dimension.
+      if (_use_flash_attention)
+        return 1;
+      if (starts_with(name, "self_keys_scale") || starts_with(name, "self_values_scale"))
+        return value.rank() - 1;
+      return value.rank() == 4 ? 2 : 1;
+    }
+
+    void TransformerDecoder::truncate_state(DecoderState& state, dim_t length) const {
+      if (_sliding_window > 0)
+        throw std::invalid_argument("The state of a decoder with a sliding window "
+                                    "cannot be truncated");
+
+      if (_kv_cache_page_size > 0) {
+        // The pages after the truncated length are released on the next step.
+        StorageView& lengths = state.at("self_cache_lengths");
+        if (lengths.device() != Device::CPU)
+          throw std::invalid_argument("The paged cache can only be truncated on CPU");
+        auto* lengths_data = lengths.data<int32_t>();
+        for (dim_t i = 0; i < lengths.size(); ++i)
+          lengths_data[i] = std::min(lengths_data[i], int32_t(length));
+        return;
+      }
+
+      for (auto& [name, value] : state) {
+        if (!value || !(starts_with(name, "self_keys") || starts_with(name, "self_values")))
+          continue;
+
+        const dim_t time_dim = get_cache_time_dim(name, value);
+        if (value.dim(time_dim) <= length)
+          continue;
+
+        StorageView truncated_value(value.dtype(), value.device());
+        const ops::Slide slide_op(time_dim, 0, length);
+        slide_op(value, truncated_value);
+        value = std::move(truncated_value);
+      }
+    }
+
+    bool TransformerDecoder::support_prefix_cache(const dim_t length) const {
+      // With a sliding window, the cache only contains the last steps. With cross attention,
+      // the steps also depend on the encoder output.
+      return (_sliding_window == 0 || length <= _sliding_window) && !_with_encoder_attention;
+    }
+
+    // The cached steps have the shape [time, num_heads, head_dim], or [time, head_dim] when
+    // the heads are merged. The key/value heads are replicated like in the non paged cache.
+
+    DecoderState TransformerDecoder::get_cached_steps(const DecoderState& state,
+                                                      const dim_t batch_id,
+                                                      const dim_t begin,
+                                                      const dim_t end) const {
+      const dim_t num_steps = end - begin;
+      DecoderState steps;
+
+      for (size_t l = 0; l < _layers.size(); ++l) {
+        const auto& attention = _layers[l]->get_self_attention();
+
+        for (const char* prefix : {"self_keys_", "self_values_"}) {
+          const std::string name = prefix + std::to_string(l);
+          const StorageView& cache = state.at(name);
+          const DataType dtype = quantize_kv_cache() ? output_type() : cache.dtype();
+          StorageView& value = steps.emplace(name, StorageView(dtype,
+                                                               cache.device())).first->second;
+
+          if (_kv_cache_page_size > 0) {
+            // The pages have the shape [num_pages, num_heads_kv, page_size, head_dim].
+            const StorageView& page_table = state.at("self_page_table");
+            const dim_t max_pages = page_table.dim(1);
+            const dim_t num_heads_kv = cache.dim(1);
+            const dim_t num_heads = attention.multi_query() ? 1 : _num_heads;
+            const dim_t head_bytes = cache.dim(3) * cache.item_size();
+
+            if (attention.multi_query())
+              value.resize({num_steps, cache.dim(3)});
+            else
+              value.resize({num_steps, num_heads, cache.dim(3)});
+
+            const auto* table = page_table.data<int32_t>() + batch_id * max_pages;
+            const auto* src = static_cast<const int8_t*>(cache.buffer());
+            auto* dst = static_cast<int8_t*>(value.buffer());
+
+            for (dim_t t = 0; t < num_steps; ++t) {
+              const dim_t position = begin + t;
+              const dim_t page = table[position / _kv_cache_page_size];
+              for (dim_t h = 0; h < num_heads; ++h) {
+                const dim_t head_kv = h / (num_heads / num_heads_kv);
+                const dim_t offset = ((page * num_heads_kv + head_kv) * _kv_cache_page_size
+                                      + position % _kv_cache_page_size);
+                std::memcpy(dst + (t * num_heads + h) * head_bytes,
+                            src + offset * head_bytes,
+                            head_bytes);
+              }
+            }
+
+          } else {
+            const dim_t time_dim = get_cache_time_dim(name, cache);
+
+            StorageView batch(cache.dtype(), cache.device());
+            ops::Slide(0, batch_id, 1)(cache, batch);
+
+            if (quantize_kv_cache()) {
+              // The int8 cache can have more time steps than the scales, so the steps are
+              // sliced before the dequantization.
+              StorageView quantized_steps(DataType::INT8, cache.device());
+              ops::Slide(time_dim, begin, num_steps)(batch, quantized_steps);
+              StorageView batch_scale(DataType::FLOAT32, cache.device());
+              StorageView steps_scale(DataType::FLOAT32, cache.device());
+              ops::Slide(0, batch_id, 1)(state.at(prefix + std::string("scale_")
+                                                  + std::to_string(l)), batch_scale);
+              ops::Slide(time_dim, begin, num_steps)(batch_scale, steps_scale);
+              ops::Dequantize()(quantized_steps, steps_scale, value);
+            } else {
+              ops::Slide(time_dim, begin, num_steps)(batch, value);
+            }
+
+            if (time_dim == 2) {
+              const StorageView steps_value(std::move(value));
+              ops::Transpose({0, 2, 1, 3})(steps_value, value);
+            }
+
+            value.squeeze(0);
+          }
+        }
+      }
+
+      return steps;
+    }
+
+    void TransformerDecoder::set_cached_steps(DecoderState& state,
+                                              const std::vector<DecoderState>& steps) const {
+      const dim_t batch_size = steps.size();
+      const dim_t num_steps = steps[0].at("self_keys_0").dim(0);
+
+      std::unique_ptr<PagedKVCache> paged_cache;
+      if (_kv_cache_page_size > 0)
+        paged_cache = std::make_unique<PagedKVCache>(state.at("self_page_table"),
+                                                     state.at("self_cache_lengths"),
+                                                     /*num_pages=*/0,
+                                                     batch_size,
+                                                     num_steps,
+                                                     _kv_cache_page_size);
+
+      const ops::Concat concat_op(0);
+
+      for (size_t l = 0; l < _layers.size(); ++l) {
+        const auto& attention = _layers[l]->get_self_attention();
+
+        for (const char* prefix : {"self_keys_", "self_values_"}) {
+          const std::string name = prefix + std::to_string(l);
+
+          std::vector<const StorageView*> inputs;
+          inputs.reserve(batch_size);
+          for (const auto& batch_steps : steps) {
+            const StorageView& value = batch_steps.at(name);
+            if (value.dim(0) != num_steps)
+              throw std::invalid_argument("The cached steps have different lengths");
+            inputs.emplace_back(&value);
+          }
+
+          const StorageView& first_steps = *inputs.front();
+          StorageView value(first_steps.dtype(), first_steps.device());
+          if (batch_size == 1)
+            value.copy_from(first_steps);
+          else
+            concat_op(inputs, value);
+
+          Shape shape = first_steps.shape();
+          shape.insert(shape.begin(), batch_size);
+          value.reshape(std::move(shape));
+
+          if (paged_cache) {
+            if (!attention.multi_query()) {
+              // The pages only store the key/value heads: [batch, num_heads_kv, time, head_dim].
+              const dim_t num_heads = value.dim(2);
+              const dim_t num_heads_kv = attention.num_heads_kv();
+              const dim_t head_bytes = value.dim(3) * value.item_size();
+
+              StorageView heads({batch_size, num_heads_kv, num_steps, value.dim(3)},
+                                value.dtype(),
+                                value.device());
+              const auto* src = static_cast<const int8_t*>(value.buffer());
+              auto* dst = static_cast<int8_t*>(heads.buffer());
+
+              for (dim_t b = 0; b < batch_size; ++b) {
+                for (dim_t h = 0; h < num_heads_kv; ++h) {
+                  for (dim_t t = 0; t < num_steps; ++t) {
+                    const dim_t head = h * (num_heads / num_heads_kv);
+                    std::memcpy(dst + ((b * num_heads_kv + h) * num_steps + t) * head_bytes,
+                                src + ((b * num_steps + t) * num_heads + head) * head_bytes,
+                                head_bytes);
+                  }
+                }
+              }
+
+              value = std::move(heads);
+            }
+
+            paged_cache->append(value, state.at(name));
+
+          } else {
+            if (value.rank() == 4 && !_use_flash_attention) {
+              StorageView steps_value = std::move(value);
+              ops::Transpose({0, 2, 1, 3})(steps_value, value);
+            }
+
+            if (quantize_kv_cache()) {
+              StorageView& scale = state.at(prefix + std::string("scale_") + std::to_string(l));
+              StorageView& cache = state.at(name);
+              cache = StorageView(DataType::INT8, value.device());
+              ops::Quantize()(value, cache, scale);
+              scale.reshape(Shape(value.shape().begin(), value.shape().end() - 1));
+            } else {
+              state.at(name) = std::move(value);
+            }
+          }
+        }
+      }
+    }
+
     void TransformerDecoder::set_alignment_heads(const dim_t layer,
                                                  const dim_t num_heads_to_average) {
       std::vector<dim_t> range(num_heads_to_average);
@@ -494,6 +940,51 @@ namespace ctranslate2 {
       return std::make_unique<StorageView>(Shape{batch_size, num_heads}, indices, _device);
     }
 
+    // Returns nullptr if the batches are already grouped by memory row with the same number of
+    // batches per row, as in beam search. In this case the cross attention reads the memory
+    // rows without an index.
+    static std::unique_ptr<const MemoryIndex> make_memory_index(const StorageView& source_index,
+                                                                const dim_t num_rows) {
+      const StorageView index = source_index.to(Device::CPU);
+      const auto* rows = index.data<int32_t>();
+      const dim_t batch_size = index.size();
+
+      std::vector<dim_t> counts(num_rows, 0);
+      for (dim_t i = 0; i < batch_size; ++i)
+        counts[rows[i]]++;
+
+      const dim_t group_size = *std::max_element(counts.begin(), counts.end());
+
+      bool grouped = (batch_size == num_rows * group_size);
+      for (dim_t i = 0; grouped && i < batch_size; ++i)
+        grouped = (rows[i] == i / group_size);
+      if (grouped)
+        return nullptr;
+
+      std::vector<int32_t> group_queries(num_rows * group_size, 0);
+      std::vector<int32_t> ungroup_outputs(batch_size);
+      std::vector<dim_t> positions(num_rows, 0);
+
+      for (dim_t i = 0; i < batch_size; ++i) {
+        const dim_t slot = rows[i] * group_size + positions[rows[i]]++;
+        group_queries[slot] = i;
+        ungroup_outputs[i] = slot;
+      }
+
+      // The unused slots of a group repeat its first query.
+      for (dim_t r = 0; r < num_rows; ++r) {
+        for (dim_t s = counts[r]; s < group_size; ++s)
+          group_queries[r * group_size + s] = group_queries[r * group_size];
+      }
+
+      const Device device = source_index.device();
+      auto memory_index = std::make_unique<MemoryIndex>();
+      memory_index->group_queries = StorageView({num_rows * group_size}, group_queries, device);
+      memory_index->ungroup_outputs = StorageView({batch_size}, ungroup_outputs, device);
+      memory_index->group_size = group_size;
+      return memory_index;
+    }
+
     void TransformerDecoder::operator()(dim_t step,
                                         const StorageView& ids,
                                         DecoderState& state,
@@ -522,6 +1013,23 @@ namespace ctranslate2 {
       const Device device = ids.device();
       const bool is_sequence = ids.rank() > 1;
 
+      std::unique_ptr<const PagedKVCache> paged_cache;
+      if (_kv_cache_page_size > 0 && step >= 0) {
+        const StorageView& pages = state.at("self_keys_0");
+        paged_cache = std::make_unique<PagedKVCache>(state.at("self_page_table"),
+                                                     state.at("self_cache_lengths"),
+                                                     pages.empty() ? 0 : pages.dim(0),
+                                                     ids.dim(0),
+                                                     is_sequence ? ids.dim(1) : 1,
+                                                     _kv_cache_page_size);
+      }
+
+      // With continuous batching, the sequences can be at different positions which
+      // are defined by the paged cache.
+      const std::vector<dim_t>* positions = (paged_cache && !paged_cache->aligned()
+                                             ? &paged_cache->offsets()
+                                             : nullptr);
+
       StorageView layer_in(dtype, device);
       StorageView layer_out(dtype, device);
 
@@ -536,8 +1044,12 @@ namespace ctranslate2 {
       }
       if (layer_in.rank() == 2)
         layer_in.expand_dims(1);
-      if (_position_encoder)
-        (*_position_encoder)(layer_in, std::max(step, dim_t(0)));
+      if (_position_encoder) {
+        if (positions)
+          (*_position_encoder)(layer_in, *positions);
+        else
+          (*_position_encoder)(layer_in, std::max(step, dim_t(0)));
+      }
       if (_layernorm_embedding)
         (*_layernorm_embedding)(layer_in, layer_in);
 
@@ -555,7 +1067,7 @@ namespace ctranslate2 {
       std::unique_ptr<const StorageView> input_lengths;
       std::unique_ptr<const StorageView> input_lengths_mask;
 
-      if (is_sequence && !lengths) {
+      if ((is_sequence || positions) && !lengths) {
         input_lengths = std::make_unique<StorageView>(Shape{ids.dim(0)}, int32_t(max_time), device);
         lengths = input_lengths.get();
       }
@@ -581,8 +1093,16 @@ namespace ctranslate2 {
           multi_query);
 
 
-        if (step > 0)
+        if (positions) {
+          const dim_t batch_stride = lengths_mask.size() / batch_size;
+          auto* mask = lengths_mask.data<int32_t>();
+          for (dim_t b = 0; b < batch_size; ++b) {
+            for (dim_t i = 0; i < batch_stride; ++i)
+              mask[b * batch_stride + i] += (*positions)[b];
+          }
+        } else if (step > 0) {
           ops::Add()(lengths_mask, StorageView(int32_t(step)), lengths_mask);
+        }
 
         input_lengths_mask = std::make_unique<StorageView>(std::move(lengths_mask));
       }
@@ -590,10 +1110,19 @@ namespace ctranslate2 {
       StorageView* memory = nullptr;
       std::unique_ptr<const StorageView> memory_lengths_mask;
       std::unique_ptr<const Padder> memory_padder;
+      std::unique_ptr<const MemoryIndex> memory_index;
       if (_with_encoder_attention) {
         const auto it = state.find("memory_lengths");
         const StorageView* memory_lengths = it != state.end() ? &it->second : nullptr;
 
+        const StorageView* source_index = Decoder::source_index(state);
+        if (source_index) {
+          const StorageView& memory_rows = (step <= 0
+                                            ? state.at("memory")
+                                            : state.at("memory_keys_0"));
+          memory_index = make_memory_index(*source_index, memory_rows.dim(0));
+        }
+
         if (step <= 0) {
           memory = &state.at("memory");
 
@@ -608,7 +1137,9 @@ namespace ctranslate2 {
           if (_tensor_parallel) {
             num_heads = SAFE_DIVIDE(num_heads, ScopedMPISetter::getNRanks());
           }
-          const dim_t beam_size = batch_size / memory_lengths->dim(0);
+          const dim_t beam_size = (memory_index
+                                   ? memory_index->group_size
+                                   : batch_size / memory_lengths->dim(0));
           memory_lengths_mask = std::make_unique<StorageView>(
             layers::MultiHeadAttention::prepare_length_mask(*memory_lengths,
                                                             num_heads,
@@ -645,11 +1176,17 @@ namespace ctranslate2 {
           StorageView* cached_self_attn_values = nullptr;
           StorageView* cached_attn_keys = nullptr;
           StorageView* cached_attn_values = nullptr;
+          StorageView* cached_self_attn_keys_scale = nullptr;
+          StorageView* cached_self_attn_values_scale = nullptr;
 
           if (step >= 0) {
             const std::string l_str = std::to_string(l);
             cached_self_attn_keys = &state.at("self_keys_" + l_str);
             cached_self_attn_values = &state.at("self_values_" + l_str);
+            if (quantize_kv_cache()) {
+              cached_self_attn_keys_scale = &state.at("self_keys_scale_" + l_str);
+              cached_self_attn_values_scale = &state.at("self_values_scale_" + l_str);
+            }
             if (_with_encoder_attention) {
               cached_attn_keys = &state.at("memory_keys_" + l_str);
               cached_attn_values = &state.at("memory_values_" + l_str);
@@ -697,7 +1234,11 @@ namespace ctranslate2 {
                         memory_padder.get(),
                         return_normalized_attention(),
                         &position_bias,
-                        offset);
+                        offset,
+                        paged_cache.get(),
+                        cached_self_attn_keys_scale,
+                        cached_self_attn_values_scale,
+                        memory_index.get());
           *layer_in_chunk = std::move(layer_out);
 
           if (layer_attention) {
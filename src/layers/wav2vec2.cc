@@ -46,8 +46,8 @@ namespace ctranslate2 {
     }
 
     Wav2Vec2Encoder::Wav2Vec2Encoder(const models::Model& model, const std::string& scope)
-      : _return_logits(model.get_variable_if_exists(scope + "/lm_head/weight"))
-      , _upgraded_model(model.get_variable_if_exists(scope + "/fp_projection/weight"))
+      : _return_logits(model.layer_exists(scope + "/lm_head"))
+      , _upgraded_model(model.layer_exists(scope + "/fp_projection"))
       , _num_heads(model.get_attribute_with_default<int32_t>(scope + "/num_heads", 8))
       , _transpose({0, 2, 1})
       , _layers(build_layers_list<const TransformerEncoderLayer>(model,
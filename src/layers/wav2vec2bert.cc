@@ -164,7 +164,7 @@ namespace ctranslate2 {
     }
 
     Wav2Vec2BertEncoder::Wav2Vec2BertEncoder(const models::Model& model, const std::string& scope)
-      : _return_logits(model.get_variable_if_exists(scope + "/lm_head/weight"))
+      : _return_logits(model.layer_exists(scope + "/lm_head"))
       , _fp_layer_norm(model, scope + "/fp_layer_norm")
       , _fp_projection(model, scope + "/fp_projection", nullptr, true)
       , _encoder_layers(build_layers_list<const EncoderLayer>(model,
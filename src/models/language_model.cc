@@ -2,11 +2,18 @@
 
 #include "ctranslate2/decoding.h"
 
+#include "env.h"
+
 namespace ctranslate2 {
   namespace models {
 
+    static size_t get_prefix_cache_size() {
+      // The size is configured in MB.
+      return size_t(std::max(read_int_from_env("CT2_PREFIX_CACHE_SIZE", 1024), 0)) << 20;
+    }
+
     LanguageModel::LanguageModel()
-      : _state_cache(std::make_shared<layers::DecoderStateCache>())
+      : _prefix_cache(std::make_shared<layers::PrefixCache>(get_prefix_cache_size()))
     {
     }
 
@@ -14,8 +21,8 @@ namespace ctranslate2 {
       return *_vocabulary;
     }
 
-    layers::DecoderStateCache& LanguageModel::get_state_cache() const {
-      return *_state_cache;
+    layers::PrefixCache& LanguageModel::get_prefix_cache() const {
+      return *_prefix_cache;
     }
 
     void LanguageModel::initialize(ModelReader& model_reader) {
@@ -63,6 +70,34 @@ namespace ctranslate2 {
       return run_generation(start_tokens, options);
     }
 
+    void SequenceGeneratorReplica::generate_continuous(RequestQueue<GenerationRequest>& queue,
+                                                       const size_t max_batch_size) {
+      PROFILE("SequenceGeneratorReplica::generate_continuous");
+      const auto scoped_device_setter = model()->get_scoped_device_setter();
+      run_continuous_generation(queue, max_batch_size);
+    }
+
+    void
+    SequenceGeneratorReplica::run_continuous_generation(RequestQueue<GenerationRequest>& queue,
+                                                        const size_t max_batch_size) {
+      run_static_batching(
+        queue,
+        max_batch_size,
+        [this](const std::vector<GenerationRequest*>& batch) {
+          std::vector<std::vector<std::string>> start_tokens;
+          std::vector<size_t> example_index;
+          start_tokens.reserve(batch.size());
+          example_index.reserve(batch.size());
+          for (const auto* request : batch) {
+            start_tokens.emplace_back(request->example.streams[0]);
+            example_index.emplace_back(request->index);
+          }
+
+          return generate(start_tokens,
+                          restore_batch_ids_in_callback(*batch[0]->options, example_index));
+        });
+    }
+
     StorageView
     SequenceGeneratorReplica::forward(const std::vector<std::vector<std::string>>& tokens,
                                       const bool return_log_probs) {
@@ -132,26 +167,8 @@ namespace ctranslate2 {
       return tokens.size() < 2;
     }
 
-    static void copy_state(const layers::DecoderState& from,
-                           layers::DecoderState& to,
-                           dim_t batch_size) {
-      if (batch_size == 1) {
-        for (const auto& [name, value] : from)
-          to[name] = value;
-
-      } else {
-        const ops::Tile tile_op(/*axis=*/0, /*repeats=*/batch_size);
-        for (const auto& [name, value] : from)
-          tile_op(value, to[name]);
-      }
-    }
-
-    std::vector<GenerationResult>
-    DecoderReplica::run_generation(const std::vector<std::vector<std::string>>& start_tokens,
-                                   const GenerationOptions& options) {
-      const auto& vocabulary = _model->get_vocabulary();
-      _decoder->update_output_layer(_model->preferred_size_multiple());
-
+    static DecodingOptions make_decoding_options(const GenerationOptions& options,
+                                                 const Vocabulary& vocabulary) {
       DecodingOptions decoding_options;
       decoding_options.beam_size = options.beam_size;
       decoding_options.patience = options.patience;
@@ -176,66 +193,134 @@ namespace ctranslate2 {
 
       if (options.disable_unk)
         decoding_options.disable_ids.push_back(vocabulary.unk_id());
-      if (options.callback)
-        decoding_options.callback = [&options, &vocabulary](DecodingStepResult step_result) -> bool {
-          return options.callback(GenerationStepResult(step_result, vocabulary));
-        };
 
-      std::vector<std::vector<size_t>> start_ids = vocabulary.to_ids(start_tokens);
-      layers::DecoderState state = _decoder->initial_state();
+      return decoding_options;
+    }
 
-      if (!options.static_prompt.empty()) {
-        std::vector<size_t> static_prompt_ids;
-        static_prompt_ids.reserve(options.static_prompt.size());
-        for (const auto& token : options.static_prompt)
-          static_prompt_ids.emplace_back(vocabulary.to_id(token));
+    static GenerationResult make_generation_result(DecodingResult result,
+                                                   const std::vector<size_t>& start_ids,
+                                                   const std::vector<size_t>& end_ids,
+                                                   const GenerationOptions& options,
+                                                   const Vocabulary& vocabulary) {
+      // Remove EOS token.
+      if (!options.return_end_token) {
+        for (auto& sequence : result.hypotheses) {
+          while (!sequence.empty() && is_eos(sequence.back(), end_ids))
+            sequence.pop_back();
+        }
+      }
 
-        auto& cache = _model->get_state_cache();
-        const dim_t batch_size = start_ids.size();
-        const layers::DecoderState* cached_state = (options.cache_static_prompt
-                                                    ? cache.get(static_prompt_ids)
-                                                    : nullptr);
+      // Forward the start token to the output if it is not the special BOS token.
+      if (options.include_prompt_in_result
+          && !start_ids.empty()
+          && start_ids[0] != vocabulary.bos_id()) {
+        for (auto& sequence : result.hypotheses)
+          sequence.insert(sequence.begin(), start_ids[0]);
+      }
 
-        if (cached_state) {
-          copy_state(*cached_state, state, batch_size);
+      GenerationResult final_result;
+      final_result.sequences = vocabulary.to_tokens(result.hypotheses);
+      final_result.sequences_ids = std::move(result.hypotheses);
+      final_result.scores = std::move(result.scores);
+      final_result.logits = std::move(result.logits_vocab);
+      return final_result;
+    }
 
-        } else {
-          layers::DecoderState static_state = _decoder->initial_state();
-          StorageView static_prompt = layers::make_sequence_inputs({static_prompt_ids},
-                                                                   _decoder->device());
+    std::vector<size_t>
+    DecoderReplica::get_static_prompt_ids(const GenerationOptions& options) const {
+      const auto& vocabulary = _model->get_vocabulary();
+      std::vector<size_t> static_prompt_ids;
+      static_prompt_ids.reserve(options.static_prompt.size());
+      for (const auto& token : options.static_prompt)
+        static_prompt_ids.emplace_back(vocabulary.to_id(token));
+      return static_prompt_ids;
+    }
 
-          (*_decoder)(0, static_prompt, static_state);
-          copy_state(static_state, state, batch_size);
+    layers::DecoderState DecoderReplica::prefill(const std::vector<std::vector<size_t>>& prompts,
+                                                 const size_t length,
+                                                 const GenerationOptions& options) {
+      layers::DecoderState state = _decoder->initial_state();
+      if (length == 0)
+        return state;
+
+      size_t save_length = 0;
+      if (options.cache_prompt)
+        save_length = length;
+      else if (options.cache_static_prompt)
+        save_length = std::min(length, options.static_prompt.size());
+
+      auto& cache = _model->get_prefix_cache();
+      const bool use_cache = ((options.cache_static_prompt || options.cache_prompt)
+                              && _decoder->support_prefix_cache(length));
+      size_t cached_length = 0;
+
+      if (use_cache) {
+        const auto cached_steps = cache.get(prompts, length, cached_length);
+        if (cached_length > 0)
+          _decoder->set_cached_steps(state, cached_steps);
+      }
 
-          if (options.cache_static_prompt)
-            cache.save(static_prompt_ids, std::move(static_state));
-        }
+      if (cached_length < length) {
+        std::vector<std::vector<size_t>> ids;
+        ids.reserve(prompts.size());
+        for (const auto& prompt : prompts)
+          ids.emplace_back(prompt.begin() + cached_length, prompt.begin() + length);
 
-        decoding_options.start_step += static_prompt_ids.size();
+        StorageView inputs = layers::make_sequence_inputs(ids, _decoder->device());
+        (*_decoder)(cached_length, inputs, state);
       }
 
+      if (use_cache && save_length > 0) {
+        for (size_t i = 0; i < prompts.size(); ++i) {
+          cache.save(prompts[i], save_length, [this, &state, i](dim_t begin, dim_t end) {
+            return _decoder->get_cached_steps(state, i, begin, end);
+          });
+        }
+      }
+
+      return state;
+    }
+
+    std::vector<GenerationResult>
+    DecoderReplica::run_generation(const std::vector<std::vector<std::string>>& start_tokens,
+                                   const GenerationOptions& options) {
+      const auto& vocabulary = _model->get_vocabulary();
+      _decoder->update_output_layer(_model->preferred_size_multiple());
+
+      DecodingOptions decoding_options = make_decoding_options(options, vocabulary);
+      if (options.callback)
+        decoding_options.callback = [&options, &vocabulary](DecodingStepResult step_result) -> bool {
+          return options.callback(GenerationStepResult(step_result, vocabulary));
+        };
+
+      std::vector<std::vector<size_t>> start_ids = vocabulary.to_ids(start_tokens);
+      const std::vector<size_t> static_prompt_ids = get_static_prompt_ids(options);
+
+      // The static prompt and the start tokens up to the minimum length in the batch are
+      // forwarded at once to initialize the decoder state.
+      size_t forward_length = 0;
       if (!options.include_prompt_in_result) {
         size_t min_prompt_length = start_ids[0].size();
         for (const auto& start_sequence : start_ids)
           min_prompt_length = std::min(min_prompt_length, start_sequence.size());
 
-        size_t forward_length = min_prompt_length - 1;
+        if (min_prompt_length > 0)
+          forward_length = min_prompt_length - 1;
+      }
 
-        if (forward_length > 0) {
-          std::vector<std::vector<size_t>> prompt_ids;
-          prompt_ids.reserve(start_ids.size());
-          for (auto& start_sequence : start_ids) {
-            prompt_ids.emplace_back(start_sequence.begin(), start_sequence.begin() + forward_length);
-            start_sequence.erase(start_sequence.begin(), start_sequence.begin() + forward_length);
-          }
+      std::vector<std::vector<size_t>> prompts;
+      prompts.reserve(start_ids.size());
+      for (auto& start_sequence : start_ids) {
+        auto& prompt = prompts.emplace_back(static_prompt_ids);
+        prompt.insert(prompt.end(), start_sequence.begin(), start_sequence.begin() + forward_length);
+        start_sequence.erase(start_sequence.begin(), start_sequence.begin() + forward_length);
+      }
 
-          StorageView prompt = layers::make_sequence_inputs(prompt_ids, _decoder->device());
-          (*_decoder)(decoding_options.start_step, prompt, state);
+      layers::DecoderState state = prefill(prompts, static_prompt_ids.size() + forward_length, options);
 
-          decoding_options.start_step += prompt.dim(1);
-          decoding_options.return_prefix = false;
-        }
-      }
+      decoding_options.start_step = static_prompt_ids.size() + forward_length;
+      if (forward_length > 0)
+        decoding_options.return_prefix = false;
 
       const auto end_ids(std::visit(ResolveEndToken(vocabulary), options.end_token));
       std::vector<DecodingResult> results = decode(*_decoder,
@@ -246,34 +331,66 @@ namespace ctranslate2 {
 
       std::vector<GenerationResult> final_results;
       final_results.reserve(results.size());
-      for (size_t i = 0; i < results.size(); ++i) {
-        auto& result = results[i];
-
-        // Remove EOS token.
-        if (!options.return_end_token) {
-          for (auto& sequence : result.hypotheses) {
-            while (!sequence.empty() && is_eos(sequence.back(), end_ids))
-              sequence.pop_back();
-          }
-        }
+      for (size_t i = 0; i < results.size(); ++i)
+        final_results.emplace_back(make_generation_result(std::move(results[i]),
+                                                          start_ids[i],
+                                                          end_ids,
+                                                          options,
+                                                          vocabulary));
 
-        // Forward the start token to the output if it is not the special BOS token.
-        if (options.include_prompt_in_result
-            && !start_ids[i].empty()
-            && start_ids[i][0] != vocabulary.bos_id()) {
-          for (auto& sequence : result.hypotheses)
-            sequence.insert(sequence.begin(), start_ids[i][0]);
-        }
+      return final_results;
+    }
 
-        GenerationResult final_result;
-        final_result.sequences = vocabulary.to_tokens(result.hypotheses);
-        final_result.sequences_ids = std::move(result.hypotheses);
-        final_result.scores = std::move(result.scores);
-        final_result.logits = std::move(result.logits_vocab);
-        final_results.emplace_back(std::move(final_result));
+    void DecoderReplica::run_continuous_generation(RequestQueue<GenerationRequest>& queue,
+                                                   const size_t max_batch_size) {
+      if (!_decoder->support_continuous_batching()) {
+        SequenceGeneratorReplica::run_continuous_generation(queue, max_batch_size);
+        return;
       }
 
-      return final_results;
+      const auto& vocabulary = _model->get_vocabulary();
+      _decoder->update_output_layer(_model->preferred_size_multiple());
+
+      ContinuousDecoding decoding(*_decoder);
+
+      run_continuous_batching(
+        decoding,
+        queue,
+        max_batch_size,
+        [this, &vocabulary](ContinuousDecoding& decoding, size_t id, GenerationRequest& request) {
+          const auto& options = *request.options;
+
+          DecodingOptions decoding_options = make_decoding_options(options, vocabulary);
+          decoding_options.return_prefix = options.include_prompt_in_result;
+          if (options.callback)
+            decoding_options.callback = [options = request.options,
+                                         &vocabulary,
+                                         batch_id = request.index](DecodingStepResult step_result) {
+              step_result.batch_id = batch_id;
+              return options->callback(GenerationStepResult(step_result, vocabulary));
+            };
+
+          const std::vector<size_t> static_prompt_ids = get_static_prompt_ids(options);
+          layers::DecoderState state = prefill({static_prompt_ids},
+                                               static_prompt_ids.size(),
+                                               options);
+          decoding_options.start_step = static_prompt_ids.size();
+
+          decoding.add(id,
+                       std::move(state),
+                       vocabulary.to_ids({request.example.streams[0]})[0],
+                       std::visit(ResolveEndToken(vocabulary), options.end_token),
+                       std::move(decoding_options));
+          return true;
+        },
+        [&vocabulary](GenerationRequest& request, DecodingResult result) {
+          const auto& options = *request.options;
+          return make_generation_result(std::move(result),
+                                        vocabulary.to_ids({request.example.streams[0]})[0],
+                                        std::visit(ResolveEndToken(vocabulary), options.end_token),
+                                        options,
+                                        vocabulary);
+        });
     }
 
     StorageView DecoderReplica::forward(const StorageView& ids, const StorageView& lengths) {
@@ -2,16 +2,26 @@
 
 #include <spdlog/spdlog.h>
 
+#include "ctranslate2/layers/encoder.h"
 #include "ctranslate2/models/model_factory.h"
 #include "ctranslate2/ops/ops.h"
 #include "ctranslate2/utils.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <future>
 #include <regex>
+#include <sstream>
 
 #ifdef CT2_WITH_CUDA
 #  include "cuda/utils.h"
 #endif
 
 #include "cpu/backend.h"
+#include "cpu/cpu_isa.h"
+#include "cpu/numa.h"
+#include "env.h"
 
 namespace ctranslate2 {
   namespace models {
@@ -86,6 +96,25 @@ namespace ctranslate2 {
       return str;
     }
 
+    // Returns a pointer to the variable data in the mapped file, or nullptr if the variable
+    // should be copied. The stream is moved after the variable data when it is mapped.
+    static void* get_mapped_variable_data(const MappedFile& mapped_file,
+                                          std::istream& in,
+                                          const dim_t num_bytes,
+                                          const dim_t item_size) {
+      const std::streamoff offset = in.tellg();
+      if (offset < 0 || static_cast<size_t>(offset + num_bytes) > mapped_file.size())
+        return nullptr;
+
+      // The variable data should at least be aligned on the item size. Models converted
+      // by recent versions have all variables aligned on 64 bytes.
+      if (offset % item_size != 0)
+        return nullptr;
+
+      in.seekg(num_bytes, std::ios_base::cur);
+      return mapped_file.data() + offset;
+    }
+
     template <typename VariablesCollection>
     static void move_variables_to_device(VariablesCollection& variables, const Device device) {
       for (auto& pair : variables) {
@@ -122,9 +151,19 @@ namespace ctranslate2 {
 
     static StorageView copy_variable(const StorageView& variable,
                                      const Device device, const int device_index) {
-      if (variable.is_scalar() || (variable.device() == Device::CPU && device == Device::CPU))
+      if (variable.is_scalar())
         return variable;
 
+      if (variable.device() == Device::CPU && device == Device::CPU) {
+        // Packed weights can use more memory than their shape, so the full buffer is copied.
+        StorageView copy(variable.dtype(), Device::CPU);
+        copy.reserve(variable.reserved_memory() / variable.item_size());
+        copy.resize(variable.shape());
+        if (variable.reserved_memory() > 0)
+          std::memcpy(copy.buffer(), variable.buffer(), variable.reserved_memory());
+        return copy;
+      }
+
       StorageView copy;
 
       if (variable.device() != Device::CPU) {
@@ -156,7 +195,21 @@ namespace ctranslate2 {
       throw std::runtime_error("This model cannot be used as a sequence encoder");
     }
 
+    static std::shared_ptr<layers::EncoderCache> make_encoder_cache() {
+      // The size is configured in MB.
+      const int size = std::max(read_int_from_env("CT2_ENCODER_CACHE_SIZE", 0), 0);
+      return std::make_shared<layers::EncoderCache>(size_t(size) << 20);
+    }
+
+    Model::Model()
+      : _encoder_cache(make_encoder_cache())
+    {
+    }
+
     Model::~Model() {
+      // The cached outputs are released with the variables.
+      _encoder_cache.reset();
+
       if (!_variable_index.empty()) {
         _variable_index.clear();
         synchronize_device(_device, _device_index);  // Wait for asynchronous deallocations.
@@ -167,8 +220,14 @@ namespace ctranslate2 {
       return 1;
     }
 
+    layers::EncoderCache& Model::get_encoder_cache() const {
+      return *_encoder_cache;
+    }
+
     void Model::set_device(const Device device, const int index) {
       move_variables(_variable_index, _device, _device_index, device, index);
+      if (device != _device || index != _device_index)
+        _encoder_cache = make_encoder_cache();
       _device = device;
       _device_index = index;
     }
@@ -191,8 +250,12 @@ namespace ctranslate2 {
         DataType weight_dtype = DataType::FLOAT32;
         DataType float_dtype = DataType::FLOAT32;
         std::tie(weight_dtype, float_dtype) = compute_type_to_data_type(_effective_compute_type);
-        if (_use_flash_attention && (float_dtype != DataType::FLOAT16 && float_dtype != DataType::BFLOAT16))
+        if (_use_flash_attention
+            && device == Device::CUDA
+            && (float_dtype != DataType::FLOAT16 && float_dtype != DataType::BFLOAT16))
           throw std::runtime_error("FlashAttention only support fp16 and bf16 data type");
+        if (_use_flash_attention && device == Device::CPU && float_dtype != DataType::FLOAT32)
+          throw std::runtime_error("FlashAttention on CPU only supports the float32 data type");
 
         const auto variable_index = _variable_index;
         for (auto& variable_pair : variable_index) {
@@ -202,6 +265,10 @@ namespace ctranslate2 {
           // Convert "weight" variables to the expected compute type.
           // Other float variables (e.g. biases) may be converted to another float type.
           if (is_quantizable(name)) {
+            // Weights quantized by groups (e.g. int4) are used as is.
+            if (get_variable_if_exists(name + "_zero"))
+              continue;
+
             auto variable_weight_dtype = weight_dtype;
             // For conv layer, we need to reshape to ensure dtype as its weights are 3D.
             auto is_conv = name.find("conv") != std::string::npos;
@@ -383,11 +450,77 @@ namespace ctranslate2 {
       return data_type_to_compute_type(weight_type, other_type);
     }
 
+    static bool has_same_layout(const StorageView* a, const StorageView* b) {
+      if (!a || !b)
+        return !a && !b;
+      return a->dtype() == b->dtype() && a->shape() == b->shape();
+    }
+
+    // Concatenates the weights of the gated feed-forward layers (linear_0 and linear_0_noact)
+    // so that both input projections are computed by a single GEMM. The fused layer is read
+    // by layers::FeedForwardNetwork.
+    void Model::fuse_gated_linear_weights() {
+      static const std::string noact_suffix = "/linear_0_noact/weight";
+
+      const auto variable_index = _variable_index;
+      for (const auto& pair : variable_index) {
+        const std::string& name = pair.first;
+        if (!ends_with(name, noact_suffix) || !is_linear_weight(name))
+          continue;
+
+        const std::string scope = name.substr(0, name.size() - noact_suffix.size());
+        const std::string gate_scope = scope + "/linear_0";
+        const std::string linear_scope = scope + "/linear_0_noact";
+        const std::string fused_scope = scope + "/linear_0_gated";
+
+        const StorageView* gate_weight = get_variable_if_exists(gate_scope + "/weight");
+        const StorageView* linear_weight = pair.second.get();
+        if (!gate_weight
+            || gate_weight->rank() != 2
+            || !has_same_layout(gate_weight, linear_weight)
+            || get_variable_if_exists(gate_scope + "/weight_zero")
+            || get_variable_if_exists(linear_scope + "/weight_zero"))
+          continue;
+
+        const StorageView* gate_bias = get_variable_if_exists(gate_scope + "/bias");
+        const StorageView* linear_bias = get_variable_if_exists(linear_scope + "/bias");
+        const StorageView* gate_scale = get_variable_if_exists(gate_scope + "/weight_scale");
+        const StorageView* linear_scale = get_variable_if_exists(linear_scope + "/weight_scale");
+        if (!has_same_layout(gate_bias, linear_bias) || !has_same_layout(gate_scale, linear_scale))
+          continue;
+
+        // Per-layer scales (e.g. int16 weights) can not be concatenated.
+        if (gate_scale && gate_scale->is_scalar())
+          continue;
+
+        // The output of the fused layer is [activation input, gate]: the activation is applied
+        // to the first half and multiplied by the second half, see ops::GatedActivation.
+        const ops::Concat concat_op(0);
+        const auto fuse = [&](const std::string& suffix,
+                              const StorageView& gate,
+                              const StorageView& linear) {
+          StorageView fused(gate.dtype(), gate.device());
+          concat_op({&gate, &linear}, fused);
+          register_variable(fused_scope + suffix, std::move(fused));
+          remove_variable(gate_scope + suffix);
+          remove_variable(linear_scope + suffix);
+        };
+
+        if (gate_bias)
+          fuse("/bias", *gate_bias, *linear_bias);
+        if (gate_scale)
+          fuse("/weight_scale", *gate_scale, *linear_scale);
+        fuse("/weight", *gate_weight, *linear_weight);
+      }
+    }
+
     // This method runs some precomputations on linear weights when possible.
     void Model::process_linear_weights() {
       if (_device != Device::CPU)
         return;  // There is currently no processing for non CPU device.
 
+      fuse_gated_linear_weights();
+
       const bool pack_weights = cpu::pack_gemm_weights(_effective_compute_type);
       const bool transpose = true;
       const float alpha = 1;
@@ -395,7 +528,7 @@ namespace ctranslate2 {
       const auto variable_index = _variable_index;
       for (const auto& pair : variable_index) {
         const std::string& name = pair.first;
-        if (!is_linear_weight(name))
+        if (!is_linear_weight(name) || get_variable_if_exists(name + "_zero"))
           continue;
 
         const StorageView& weight = *pair.second;
@@ -413,7 +546,7 @@ namespace ctranslate2 {
         }
 
         // If requested, linear weights can be packed for the Gemm call.
-        if (pack_weights && is_packable(name)) {
+        if (pack_weights && weight.rank() == 2 && is_packable(name)) {
           StorageView packed_weight = ops::Gemm::pack_b_input(weight, transpose, k, n, alpha);
           register_variable(name + "_packed", std::move(packed_weight));
           remove_variable(name);  // The original weight is no longer needed.
@@ -474,6 +607,361 @@ namespace ctranslate2 {
                                  + "(Forward compatibility is not guaranteed.)");
     }
 
+    // The weight cache stores the model variables after they were converted to the compute
+    // type and packed, so that the next processes loading the same model can map them
+    // directly. See CT2_WEIGHT_CACHE_DIR.
+    //
+    // Format version of the cache files. It should be increased when the processing of the
+    // variables at load time changes.
+    static const uint32_t weight_cache_version = 1;
+    static const char weight_cache_magic[8] = {'C', 'T', '2', 'C', 'A', 'C', 'H', 'E'};
+    constexpr uint64_t weight_cache_alignment = 64;
+
+    static inline uint64_t rotate_left(uint64_t x, int bits) {
+      return (x << bits) | (x >> (64 - bits));
+    }
+
+    // Fast non-cryptographic hash of the stream content.
+    static uint64_t hash_stream(std::istream& in) {
+      constexpr uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+      constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+      constexpr size_t num_lanes = 4;
+
+      uint64_t lanes[num_lanes] = {prime1, prime2, prime1 ^ prime2, ~prime1};
+      uint64_t total_size = 0;
+      std::vector<char> buffer(1 << 20);
+
+      while (in) {
+        in.read(buffer.data(), buffer.size());
+        const size_t size = in.gcount();
+        size_t offset = 0;
+
+        for (; offset + num_lanes * sizeof (uint64_t) <= size; offset += num_lanes * sizeof (uint64_t)) {
+          for (size_t l = 0; l < num_lanes; ++l) {
+            uint64_t word;
+            std::memcpy(&word, buffer.data() + offset + l * sizeof (uint64_t), sizeof (word));
+            lanes[l] = rotate_left(lanes[l] + word * prime2, 31) * prime1;
+          }
+        }
+
+        // Only the last block can have remaining bytes.
+        for (; offset < size; ++offset)
+          lanes[0] = (lanes[0] ^ static_cast<uint8_t>(buffer[offset])) * prime1;
+
+        total_size += size;
+      }
+
+      uint64_t hash = total_size * prime1;
+      for (size_t l = 0; l < num_lanes; ++l)
+        hash = (hash ^ rotate_left(lanes[l], 27)) * prime1 + prime2;
+      hash ^= hash >> 33;
+      hash *= prime2;
+      hash ^= hash >> 29;
+      hash *= prime1;
+      hash ^= hash >> 32;
+      return hash;
+    }
+
+    static std::string hash_to_str(uint64_t hash) {
+      char str[17];
+      std::snprintf(str, sizeof (str), "%016llx", static_cast<unsigned long long>(hash));
+      return str;
+    }
+
+    // Returns the path of the cache file for this model and configuration, or an empty
+    // string if the cache is disabled.
+    static std::string get_weight_cache_path(ModelReader& model_reader,
+                                             const Model& model,
+                                             const Device device,
+                                             const ComputeType compute_type,
+                                             const bool use_flash_attention,
+                                             const bool tensor_parallel,
+                                             std::string& key) {
+      std::string cache_dir = read_string_from_env("CT2_WEIGHT_CACHE_DIR");
+      if (cache_dir.empty() || device != Device::CPU || tensor_parallel)
+        return "";
+
+      // The key covers everything that changes the processed variables: the model version,
+      // the optional model files used during processing, the requested compute type, and the
+      // CPU backends selected in this process.
+      //
+      // Model files are identified by their path, size, and modification time so that they
+      // are not read when the cache is used. Other models are identified by their content.
+      std::ostringstream key_stream;
+      const std::string model_signature = model_reader.get_file_signature(binary_file);
+      if (!model_signature.empty()) {
+        key_stream << "model_file=" << model_signature;
+      } else {
+        std::unique_ptr<std::istream> model_file = model_reader.get_required_file(binary_file,
+                                                                                  /*binary=*/true);
+        key_stream << "model=" << hash_to_str(hash_stream(*model_file));
+      }
+      {
+        std::istringstream config(model.config.dump());
+        key_stream << ";config=" << hash_to_str(hash_stream(config));
+      }
+      for (const auto& filename : model.get_processing_files()) {
+        key_stream << ";" << filename << "=";
+        const std::string signature = model_reader.get_file_signature(filename);
+        if (!signature.empty()) {
+          key_stream << signature;
+        } else {
+          std::unique_ptr<std::istream> file = model_reader.get_file(filename, /*binary=*/true);
+          key_stream << (file ? hash_to_str(hash_stream(*file)) : "none");
+        }
+      }
+      key_stream << ";compute_type=" << compute_type_to_str(compute_type)
+                 << ";flash_attention=" << use_flash_attention
+                 << ";isa=" << cpu::isa_to_str(cpu::get_cpu_isa());
+      for (const auto type : {ComputeType::FLOAT32, ComputeType::INT16, ComputeType::INT8}) {
+        key_stream << ";gemm_" << compute_type_to_str(type)
+                   << "=" << cpu::gemm_backend_to_str(cpu::get_gemm_backend(type))
+                   << (cpu::pack_gemm_weights(type) ? "/packed" : "");
+      }
+      key_stream << ";u8s8=" << cpu::prefer_u8s8s32_gemm()
+                 << ";bf16_gemm=" << cpu::use_bf16_gemm();
+
+      key = key_stream.str();
+
+      std::istringstream key_content(key);
+      if (cache_dir.back() != '/')
+        cache_dir += '/';
+      return cache_dir + hash_to_str(hash_stream(key_content)) + ".ct2cache";
+    }
+
+    template <typename T>
+    static void produce(std::ostream& out, const T value) {
+      out.write(reinterpret_cast<const char*>(&value), sizeof (T));
+    }
+
+    template<>
+    void produce(std::ostream& out, const std::string value) {
+      produce<uint32_t>(out, value.size());
+      out.write(value.data(), value.size());
+    }
+
+    // Reads values from the mapped cache file with bounds checking.
+    class WeightCacheReader {
+    public:
+      WeightCacheReader(const char* data, size_t size)
+        : _data(data)
+        , _size(size)
+      {
+      }
+
+      template <typename T>
+      T read() {
+        T value;
+        std::memcpy(&value, advance(sizeof (T)), sizeof (T));
+        return value;
+      }
+
+      std::string read_string() {
+        const size_t length = read<uint32_t>();
+        return std::string(advance(length), length);
+      }
+
+      const char* data_at(uint64_t offset, uint64_t size) const {
+        if (offset > _size || size > _size - offset)
+          throw std::runtime_error("the file is truncated");
+        return _data + offset;
+      }
+
+    private:
+      const char* advance(size_t size) {
+        const char* data = data_at(_offset, size);
+        _offset += size;
+        return data;
+      }
+
+      const char* _data;
+      size_t _size;
+      size_t _offset = 0;
+    };
+
+    void Model::save_weight_cache(const std::string& path, const std::string& key) const {
+      // Aliased variables share the same storage.
+      std::vector<const StorageView*> storages;
+      std::unordered_map<const StorageView*, uint32_t> storage_ids;
+      std::vector<std::pair<std::string, uint32_t>> names;
+      names.reserve(_variable_index.size());
+
+      for (const auto& pair : _variable_index) {
+        const StorageView* variable = pair.second.get();
+        if (variable->device() != Device::CPU)
+          return;
+
+        auto it = storage_ids.find(variable);
+        if (it == storage_ids.end()) {
+          it = storage_ids.emplace(variable, storages.size()).first;
+          storages.emplace_back(variable);
+        }
+
+        names.emplace_back(pair.first, it->second);
+      }
+
+      std::ostringstream header;
+      produce<std::string>(header, key);
+      produce<uint8_t>(header, static_cast<uint8_t>(_saved_compute_type));
+      produce<uint8_t>(header, static_cast<uint8_t>(_effective_compute_type));
+
+      // The data offsets are relative to the data section.
+      uint64_t data_size = 0;
+      produce<uint32_t>(header, storages.size());
+      for (const StorageView* variable : storages) {
+        const uint64_t num_bytes = variable->reserved_memory();
+        produce<uint8_t>(header, static_cast<uint8_t>(variable->dtype()));
+        produce<uint8_t>(header, variable->rank());
+        for (const dim_t dim : variable->shape())
+          produce<uint64_t>(header, dim);
+        produce<uint64_t>(header, data_size);
+        produce<uint64_t>(header, num_bytes);
+        data_size += ceil_divide(num_bytes, weight_cache_alignment) * weight_cache_alignment;
+      }
+
+      produce<uint32_t>(header, names.size());
+      for (const auto& name : names) {
+        produce<std::string>(header, name.first);
+        produce<uint32_t>(header, name.second);
+      }
+
+      const std::string header_data = header.str();
+      const uint64_t prefix_size = sizeof (weight_cache_magic) + sizeof (uint32_t) + sizeof (uint64_t);
+      const uint64_t data_offset = ceil_divide<uint64_t>(prefix_size + header_data.size(),
+                                                         weight_cache_alignment) * weight_cache_alignment;
+
+      // Write to a temporary file first so that concurrent processes never read a partial file.
+      const std::string tmp_path = (path + ".tmp"
+                                    + std::to_string(std::chrono::steady_clock::now()
+                                                     .time_since_epoch().count()));
+      {
+        std::ofstream out = open_file_write(tmp_path, std::ios_base::out | std::ios_base::binary,
+                                            /*check=*/false);
+        if (!out) {
+          spdlog::warn("Unable to write the weight cache file {}", tmp_path);
+          return;
+        }
+
+        const std::vector<char> padding(weight_cache_alignment, 0);
+        out.write(weight_cache_magic, sizeof (weight_cache_magic));
+        produce<uint32_t>(out, weight_cache_version);
+        produce<uint64_t>(out, data_offset);
+        out.write(header_data.data(), header_data.size());
+        out.write(padding.data(), data_offset - prefix_size - header_data.size());
+
+        for (const StorageView* variable : storages) {
+          const uint64_t num_bytes = variable->reserved_memory();
+          out.write(static_cast<const char*>(variable->buffer()), num_bytes);
+          out.write(padding.data(), (weight_cache_alignment - num_bytes % weight_cache_alignment)
+                    % weight_cache_alignment);
+        }
+
+        if (!out) {
+          spdlog::warn("Unable to write the weight cache file {}", tmp_path);
+          out.close();
+          std::remove(tmp_path.c_str());
+          return;
+        }
+      }
+
+      if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        spdlog::warn("Unable to write the weight cache file {}", path);
+        std::remove(tmp_path.c_str());
+        return;
+      }
+
+      spdlog::info("Saved the converted model weights to {}", path);
+    }
+
+    bool Model::load_weight_cache(const std::string& path,
+                                  const std::string& key,
+                                  const ComputeType compute_type,
+                                  const Device device,
+                                  const int device_index) {
+      std::shared_ptr<MappedFile> mapped_file = map_file_read(path);
+      if (!mapped_file)
+        return false;
+
+      std::unordered_map<std::string, std::shared_ptr<StorageView>> variable_index;
+      ComputeType saved_compute_type = ComputeType::DEFAULT;
+      ComputeType effective_compute_type = ComputeType::DEFAULT;
+
+      try {
+        WeightCacheReader reader(mapped_file->data(), mapped_file->size());
+
+        char magic[sizeof (weight_cache_magic)];
+        for (char& c : magic)
+          c = reader.read<char>();
+        if (std::memcmp(magic, weight_cache_magic, sizeof (magic)) != 0
+            || reader.read<uint32_t>() != weight_cache_version)
+          throw std::runtime_error("the file format is not supported");
+
+        const uint64_t data_offset = reader.read<uint64_t>();
+        if (reader.read_string() != key)
+          throw std::runtime_error("the file was created for another model or configuration");
+
+        saved_compute_type = static_cast<ComputeType>(reader.read<uint8_t>());
+        effective_compute_type = static_cast<ComputeType>(reader.read<uint8_t>());
+
+        const size_t num_storages = reader.read<uint32_t>();
+        std::vector<std::shared_ptr<StorageView>> storages;
+        storages.reserve(num_storages);
+
+        for (size_t i = 0; i < num_storages; ++i) {
+          const auto dtype = static_cast<DataType>(reader.read<uint8_t>());
+          const size_t rank = reader.read<uint8_t>();
+          Shape shape;
+          shape.reserve(rank);
+          for (size_t d = 0; d < rank; ++d)
+            shape.emplace_back(reader.read<uint64_t>());
+          const uint64_t offset = reader.read<uint64_t>();
+          const uint64_t num_bytes = reader.read<uint64_t>();
+
+          auto variable = std::make_shared<StorageView>(dtype);
+          const dim_t item_size = variable->item_size();
+          if (num_bytes % item_size != 0
+              || static_cast<dim_t>(num_bytes / item_size) < compute_size(shape))
+            throw std::runtime_error("the file is invalid");
+
+          if (num_bytes == 0) {
+            *variable = StorageView(std::move(shape), dtype);
+          } else {
+            // View the full buffer which can be larger than the shape for packed weights.
+            void* data = const_cast<char*>(reader.data_at(data_offset + offset, num_bytes));
+            variable->view(data, {static_cast<dim_t>(num_bytes / item_size)});
+            variable->resize(std::move(shape));
+          }
+
+          storages.emplace_back(std::move(variable));
+        }
+
+        const size_t num_names = reader.read<uint32_t>();
+        variable_index.reserve(num_names);
+        for (size_t i = 0; i < num_names; ++i) {
+          std::string name = reader.read_string();
+          const size_t storage_id = reader.read<uint32_t>();
+          if (storage_id >= storages.size())
+            throw std::runtime_error("the file is invalid");
+          variable_index.emplace(std::move(name), storages[storage_id]);
+        }
+      } catch (const std::exception& e) {
+        spdlog::warn("Ignoring the weight cache file {}: {}", path, e.what());
+        return false;
+      }
+
+      _variable_index = std::move(variable_index);
+      _mapped_file = std::move(mapped_file);
+      _saved_compute_type = saved_compute_type;
+      _requested_compute_type = compute_type;
+      _effective_compute_type = effective_compute_type;
+      _preferred_size_multiple = get_preferred_size_multiple(_effective_compute_type,
+                                                             device,
+                                                             device_index);
+
+      spdlog::info("Loaded the converted model weights from {}", path);
+      return true;
+    }
+
     static VARIABLE_TYPE classify_variable(const std::string& name) {
       std::regex pattern_self_attn("/self_attention/linear_(\\d+)/(\\w+)");
       std::regex pattern_attn("/attention/linear_(\\d+)/(\\w+)");
@@ -558,9 +1046,11 @@ namespace ctranslate2 {
                                              int device_index,
                                              ComputeType compute_type,
                                              bool use_flash_attention,
-                                             bool tensor_parallel) {
+                                             bool tensor_parallel,
+                                             bool use_mmap) {
       ModelFileReader model_reader(path);
-      return load(model_reader, device, device_index, compute_type, use_flash_attention, tensor_parallel);
+      return load(model_reader, device, device_index, compute_type,
+                  use_flash_attention, tensor_parallel, use_mmap);
     }
 
     std::shared_ptr<const Model> Model::load(ModelReader& model_reader,
@@ -568,7 +1058,8 @@ namespace ctranslate2 {
                                              int device_index,
                                              ComputeType compute_type,
                                              bool use_flash_attention,
-                                             bool tensor_parallel) {
+                                             bool tensor_parallel,
+                                             bool use_mmap) {
       {
         // Log the system configuration the first time a model is loaded.
         static std::once_flag log_once;
@@ -593,6 +1084,14 @@ namespace ctranslate2 {
                                                                                     /*binary=*/true);
       std::istream& model_file = *model_file_ptr;
 
+      std::shared_ptr<MappedFile> mapped_file;
+      if (use_mmap) {
+        mapped_file = model_reader.get_mapped_file(binary_file);
+        if (!mapped_file)
+          spdlog::warn("Unable to map the file {} in memory: the model variables will be copied",
+                       binary_file);
+      }
+
       // See the model serialization in python/ctranslate2/specs/model_spec.py.
 
       // Check the binary version and spec revision.
@@ -642,6 +1141,27 @@ namespace ctranslate2 {
       if (model->config.contains("quantization_type"))
         model->set_quant_method(model->config["quantization_type"]);
 
+      // Reuse the variables converted and packed by a previous process, if any.
+      std::string weight_cache_key;
+      const std::string weight_cache_path = get_weight_cache_path(model_reader,
+                                                                  *model,
+                                                                  device,
+                                                                  compute_type,
+                                                                  use_flash_attention,
+                                                                  tensor_parallel,
+                                                                  weight_cache_key);
+      if (!weight_cache_path.empty()
+          && model->load_weight_cache(weight_cache_path,
+                                      weight_cache_key,
+                                      compute_type,
+                                      device,
+                                      device_index)) {
+        model->set_device(device, device_index);
+        const ScopedDeviceSetter scoped_device_setter(device, device_index);
+        model->initialize(model_reader);
+        return model;
+      }
+
       for (uint32_t i = 0; i < num_variables; ++i) {
         auto name = consume<std::string>(model_file);
         const size_t rank = consume<uint8_t>(model_file);
@@ -661,8 +1181,21 @@ namespace ctranslate2 {
           num_bytes = consume<uint32_t>(model_file) * item_size;
         }
 
-        StorageView variable(std::move(shape), dtype);
-        consume<char>(model_file, num_bytes, static_cast<char*>(variable.buffer()));
+        StorageView variable(dtype);
+        void* mapped_data = nullptr;
+        if (mapped_file && num_bytes == compute_size(shape) * variable.item_size())
+          mapped_data = get_mapped_variable_data(*mapped_file,
+                                                 model_file,
+                                                 num_bytes,
+                                                 variable.item_size());
+
+        if (mapped_data) {
+          variable.view(mapped_data, std::move(shape));
+          model->_mapped_file = mapped_file;
+        } else {
+          variable = StorageView(std::move(shape), dtype);
+          consume<char>(model_file, num_bytes, static_cast<char*>(variable.buffer()));
+        }
         if (tensor_parallel) {
           int outer_dim = 0;
           int inner_dim = 1;
@@ -759,6 +1292,12 @@ namespace ctranslate2 {
         case QUANTIZATION_TYPE::AWQ_GEMV:
           model->set_compute_type(ComputeType::FLOAT16, device, device_index, false);
           break;
+        case QUANTIZATION_TYPE::INT4:
+          // The int4 weights are only supported on CPU with float32 activations.
+          if (device != Device::CPU)
+            throw std::invalid_argument("Models quantized to int4 can only be executed on CPU");
+          model->set_compute_type(ComputeType::FLOAT32, device, device_index);
+          break;
         default:
           throw std::invalid_argument("Quantization type is not supported");
           break;
@@ -780,10 +1319,24 @@ namespace ctranslate2 {
         }
       }
 
-      // Run additional model initialization.
+      // Run additional model initialization. The model files (e.g. the vocabulary map) are
+      // loaded first since they can change which weights are packed.
       const ScopedDeviceSetter scoped_device_setter(device, device_index);
-      model->process_linear_weights();
       model->initialize(model_reader);
+      model->process_linear_weights();
+      if (!weight_cache_path.empty())
+        model->save_weight_cache(weight_cache_path, weight_cache_key);
+
+      // Unmap the model file if all mapped variables were converted, packed, or moved.
+      if (model->_mapped_file) {
+        const bool has_mapped_variables = std::any_of(
+          model->_variable_index.begin(),
+          model->_variable_index.end(),
+          [](const auto& pair) { return !pair.second->owns_data() && !pair.second->empty(); });
+        if (!has_mapped_variables)
+          model->_mapped_file.reset();
+      }
+
       return model;
     }
 
@@ -809,6 +1362,9 @@ namespace ctranslate2 {
         }
       }
 
+      // The cached encoder outputs are only shared by models on the same device.
+      if (device != _device || device_index != _device_index)
+        model->_encoder_cache = make_encoder_cache();
       model->_device = device;
       model->_device_index = device_index;
       return model;
@@ -818,6 +1374,27 @@ namespace ctranslate2 {
       return bool(ModelFileReader(path).get_file(binary_file));
     }
 
+    static void log_loaded_model(const ModelReader& model_reader, const Model& model) {
+      spdlog::info("Loaded model {} on device {}:{}",
+                   model_reader.get_model_id(),
+                   device_to_str(model.device()),
+                   model.device_index());
+      spdlog::info(" - Binary version: {}", model.binary_version());
+      spdlog::info(" - Model specification revision: {}", model.spec_revision());
+      spdlog::info(" - Selected compute type: {}",
+                   compute_type_to_str(model.effective_compute_type()));
+
+      if (model.requested_compute_type() == ComputeType::DEFAULT
+          && model.effective_compute_type() != model.saved_compute_type())
+        spdlog::warn("The compute type inferred from the saved model is {}, "
+                     "but the target device or backend do not support efficient {} computation. "
+                     "The model weights have been automatically converted to use "
+                     "the {} compute type instead.",
+                     compute_type_to_str(model.saved_compute_type()),
+                     compute_type_to_str(model.saved_compute_type()),
+                     compute_type_to_str(model.effective_compute_type()));
+    }
+
     ModelLoader::ModelLoader(const std::string& model_path)
       : model_reader(std::make_shared<ModelFileReader>(model_path))
     {
@@ -852,11 +1429,14 @@ namespace ctranslate2 {
         is_sm8x = dprops.major == 8 && dprops.minor >= 0;
         is_sm90 = dprops.major == 9 && dprops.minor == 0;
       }
-      if (use_flash_attention && (device != Device::CUDA || (!is_sm8x && !is_sm90))) {
+      if (use_flash_attention && device == Device::CUDA && !is_sm8x && !is_sm90) {
         throw std::invalid_argument("FlashAttention only supports Ampere GPUs or newer.");
       }
 #endif
 
+      if (numa_aware && device == Device::CPU && cpu::get_numa_nodes().size() > 1)
+        return load_numa_replicas();
+
       std::vector<std::shared_ptr<const Model>> models;
 
       models.reserve(device_indices.size() * num_replicas_per_device);
@@ -864,30 +1444,15 @@ namespace ctranslate2 {
       for (const size_t device_index : device_indices) {
         std::shared_ptr<const Model> model;
 
-        if (models.empty())
+        if (models.empty()) {
           model = Model::load(*model_reader, device, device_index, compute_type,
-                              use_flash_attention, tensor_parallel);
-        else
+                              use_flash_attention, tensor_parallel, use_mmap);
+          std::const_pointer_cast<Model>(model)->_continuous_batching = continuous_batching;
+        } else {
           model = models.back()->copy_to(device, device_index);
+        }
 
-        spdlog::info("Loaded model {} on device {}:{}",
-                     model_reader->get_model_id(),
-                     device_to_str(device),
-                     device_index);
-        spdlog::info(" - Binary version: {}", model->binary_version());
-        spdlog::info(" - Model specification revision: {}", model->spec_revision());
-        spdlog::info(" - Selected compute type: {}",
-                     compute_type_to_str(model->effective_compute_type()));
-
-        if (model->requested_compute_type() == ComputeType::DEFAULT
-            && model->effective_compute_type() != model->saved_compute_type())
-          spdlog::warn("The compute type inferred from the saved model is {}, "
-                       "but the target device or backend do not support efficient {} computation. "
-                       "The model weights have been automatically converted to use "
-                       "the {} compute type instead.",
-                       compute_type_to_str(model->saved_compute_type()),
-                       compute_type_to_str(model->saved_compute_type()),
-                       compute_type_to_str(model->effective_compute_type()));
+        log_loaded_model(*model_reader, *model);
 
         for (size_t i = 0; i < num_replicas_per_device; ++i)
           models.emplace_back(model);
@@ -896,5 +1461,46 @@ namespace ctranslate2 {
       return models;
     }
 
+    std::vector<std::shared_ptr<const Model>> ModelLoader::load_numa_replicas() const {
+      const auto& nodes = cpu::get_numa_nodes();
+      const size_t num_replicas = device_indices.size() * num_replicas_per_device;
+      const size_t num_nodes = std::min(nodes.size(), num_replicas);
+
+      std::vector<std::shared_ptr<const Model>> models;
+      models.reserve(num_replicas);
+
+      for (size_t n = 0; n < num_nodes; ++n) {
+        const auto& node = nodes[n];
+
+        // The weights are written from a thread bound to the node so that the memory pages
+        // are allocated on this node.
+        auto model = std::async(std::launch::async, [this, &node, &models]() {
+          set_thread_numa_node(node.id);
+          auto model = (models.empty()
+                        ? Model::load(*model_reader, device, 0, compute_type,
+                                      use_flash_attention, tensor_parallel, use_mmap)
+                        : models.back()->copy_to(device, 0));
+          std::const_pointer_cast<Model>(model)->_numa_node = node.id;
+          std::const_pointer_cast<Model>(model)->_continuous_batching = continuous_batching;
+          return model;
+        }).get();
+
+        if (models.empty())
+          log_loaded_model(*model_reader, *model);
+        spdlog::info("Loaded model {} on NUMA node {} (CPUs: {})",
+                     model_reader->get_model_id(),
+                     node.id,
+                     node.cpus.size());
+
+        // Replicas are split in contiguous groups of (almost) equal size.
+        const size_t begin = n * num_replicas / num_nodes;
+        const size_t end = (n + 1) * num_replicas / num_nodes;
+        for (size_t i = begin; i < end; ++i)
+          models.emplace_back(model);
+      }
+
+      return models;
+    }
+
   }
 }
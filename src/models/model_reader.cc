@@ -14,6 +14,14 @@ namespace ctranslate2 {
       return file;
     }
 
+    std::shared_ptr<MappedFile> ModelReader::get_mapped_file(const std::string&) {
+      return nullptr;
+    }
+
+    std::string ModelReader::get_file_signature(const std::string&) {
+      return "";
+    }
+
 
     ModelFileReader::ModelFileReader(std::string model_dir)
       : _model_dir(std::move(model_dir))
@@ -34,6 +42,14 @@ namespace ctranslate2 {
       return stream;
     }
 
+    std::shared_ptr<MappedFile> ModelFileReader::get_mapped_file(const std::string& filename) {
+      return map_file_read(_model_dir + "/" + filename);
+    }
+
+    std::string ModelFileReader::get_file_signature(const std::string& filename) {
+      return ctranslate2::get_file_signature(_model_dir + "/" + filename);
+    }
+
 
     struct membuf : std::streambuf {
       membuf(const char* base, size_t size) {
@@ -92,6 +92,11 @@ namespace ctranslate2 {
       return _vocabulary_map.get();
     }
 
+    std::vector<std::string> SequenceToSequenceModel::get_processing_files() const {
+      // The output projection is not packed when a vocabulary map exists.
+      return {vmap_file};
+    }
+
 
     std::vector<ScoringResult>
     SequenceToSequenceReplica::score(const std::vector<std::vector<std::string>>& source,
@@ -129,6 +134,40 @@ namespace ctranslate2 {
         });
     }
 
+    void SequenceToSequenceReplica::translate_continuous(RequestQueue<TranslationRequest>& queue,
+                                                         const size_t max_batch_size) {
+      PROFILE("SequenceToSequenceReplica::translate_continuous");
+      run_continuous_translation(queue, max_batch_size);
+    }
+
+    void
+    SequenceToSequenceReplica::run_continuous_translation(RequestQueue<TranslationRequest>& queue,
+                                                          const size_t max_batch_size) {
+      run_static_batching(
+        queue,
+        max_batch_size,
+        [this](const std::vector<TranslationRequest*>& batch) {
+          std::vector<std::vector<std::string>> source;
+          std::vector<std::vector<std::string>> target_prefix;
+          std::vector<size_t> example_index;
+          source.reserve(batch.size());
+          target_prefix.reserve(batch.size());
+          example_index.reserve(batch.size());
+          for (const auto* request : batch) {
+            const auto& streams = request->example.streams;
+            source.emplace_back(streams[0]);
+            target_prefix.emplace_back(streams.size() > 1
+                                       ? streams[1]
+                                       : std::vector<std::string>());
+            example_index.emplace_back(request->index);
+          }
+
+          return translate(source,
+                           target_prefix,
+                           restore_batch_ids_in_callback(*batch[0]->options, example_index));
+        });
+    }
+
 
     EncoderDecoderReplica::EncoderDecoderReplica(const std::shared_ptr<const SequenceToSequenceModel>& model,
                                                  std::unique_ptr<layers::Encoder> encoder,
@@ -217,6 +256,63 @@ namespace ctranslate2 {
     EncoderDecoderReplica::encode(const std::vector<std::vector<std::vector<size_t>>>& features_ids,
                                   StorageView& memory,
                                   StorageView& memory_lengths) {
+      auto& cache = _model->get_encoder_cache();
+      if (!cache.enabled()) {
+        run_encoder(features_ids, memory, memory_lengths);
+        return;
+      }
+
+      // Only the examples that are not cached are encoded.
+      const size_t batch_size = features_ids[0].size();
+      std::vector<layers::EncoderCache::Key> keys(batch_size);
+      std::vector<std::shared_ptr<const StorageView>> outputs(batch_size);
+      std::vector<size_t> missing;
+
+      for (size_t b = 0; b < batch_size; ++b) {
+        for (const auto& ids : features_ids)
+          layers::EncoderCache::hash(keys[b], ids[b].data(), ids[b].size() * sizeof (size_t));
+        outputs[b] = cache.get(keys[b]);
+        if (!outputs[b])
+          missing.emplace_back(b);
+      }
+
+      if (!missing.empty()) {
+        std::vector<std::vector<std::vector<size_t>>> missing_ids;
+        missing_ids.reserve(features_ids.size());
+        for (const auto& ids : features_ids)
+          missing_ids.emplace_back(index_vector(ids, missing));
+
+        StorageView missing_memory(memory.dtype(), memory.device());
+        StorageView missing_lengths(memory_lengths.dtype(), memory_lengths.device());
+        run_encoder(missing_ids, missing_memory, missing_lengths);
+
+        const StorageView lengths = missing_lengths.to(Device::CPU);
+        for (size_t i = 0; i < missing.size(); ++i) {
+          StorageView example(missing_memory.dtype(), missing_memory.device());
+          StorageView output(missing_memory.dtype(), missing_memory.device());
+          ops::Slide(0, i, 1)(missing_memory, example);
+          ops::Slide(1, 0, lengths.at<int32_t>(i))(example, output);
+          output.squeeze(0);
+          outputs[missing[i]] = cache.save(keys[missing[i]], std::move(output));
+        }
+
+        if (missing.size() == batch_size) {
+          memory = std::move(missing_memory);
+          memory_lengths = std::move(missing_lengths);
+          return;
+        }
+      }
+
+      layers::EncoderCache::stack(outputs,
+                                  _model->preferred_size_multiple(),
+                                  memory,
+                                  &memory_lengths);
+    }
+
+    void
+    EncoderDecoderReplica::run_encoder(const std::vector<std::vector<std::vector<size_t>>>& features_ids,
+                                       StorageView& memory,
+                                       StorageView& memory_lengths) {
       const size_t num_input_features = features_ids.size();
       std::vector<StorageView> ids;
       ids.reserve(num_input_features);
@@ -301,6 +397,39 @@ namespace ctranslate2 {
       }
     }
 
+    static DecodingOptions make_decoding_options(const TranslationOptions& options,
+                                                 const Vocabulary& vocabulary) {
+      DecodingOptions decoding_options;
+      decoding_options.beam_size = options.beam_size;
+      decoding_options.patience = options.patience;
+      decoding_options.length_penalty = options.length_penalty;
+      decoding_options.coverage_penalty = options.coverage_penalty;
+      decoding_options.repetition_penalty = options.repetition_penalty;
+      decoding_options.no_repeat_ngram_size = options.no_repeat_ngram_size;
+      decoding_options.prefix_bias_beta = options.prefix_bias_beta;
+      decoding_options.max_length = options.max_decoding_length;
+      decoding_options.min_length = options.min_decoding_length;
+      decoding_options.sampling_topk = options.sampling_topk;
+      decoding_options.sampling_topp = options.sampling_topp;
+      decoding_options.sampling_temperature = options.sampling_temperature;
+      decoding_options.num_hypotheses = options.num_hypotheses;
+      decoding_options.return_scores = options.return_scores;
+      decoding_options.return_logits_vocab = options.return_logits_vocab;
+      decoding_options.return_attention = options.return_attention || options.replace_unknowns;
+      decoding_options.return_alternatives = options.return_alternatives;
+      decoding_options.min_alternative_expansion_prob = options.min_alternative_expansion_prob;
+      decoding_options.disable_sequences = vocabulary.to_ids(options.suppress_sequences,
+                                                             /*max_length=*/0,
+                                                             /*prefix=*/nullptr,
+                                                             /*suffix=*/nullptr,
+                                                             /*allow_unk=*/false);
+
+      if (options.disable_unk)
+        decoding_options.disable_ids.push_back(vocabulary.unk_id());
+
+      return decoding_options;
+    }
+
     std::vector<TranslationResult>
     EncoderDecoderReplica::run_translation(const std::vector<std::vector<std::string>>& source,
                                            const std::vector<std::vector<std::string>>& target_prefix,
@@ -333,33 +462,7 @@ namespace ctranslate2 {
       _decoder->update_output_layer(_model->preferred_size_multiple(), restrict_ids);
 
       // Decode.
-      DecodingOptions decoding_options;
-      decoding_options.beam_size = options.beam_size;
-      decoding_options.patience = options.patience;
-      decoding_options.length_penalty = options.length_penalty;
-      decoding_options.coverage_penalty = options.coverage_penalty;
-      decoding_options.repetition_penalty = options.repetition_penalty;
-      decoding_options.no_repeat_ngram_size = options.no_repeat_ngram_size;
-      decoding_options.prefix_bias_beta = options.prefix_bias_beta;
-      decoding_options.max_length = options.max_decoding_length;
-      decoding_options.min_length = options.min_decoding_length;
-      decoding_options.sampling_topk = options.sampling_topk;
-      decoding_options.sampling_topp = options.sampling_topp;
-      decoding_options.sampling_temperature = options.sampling_temperature;
-      decoding_options.num_hypotheses = options.num_hypotheses;
-      decoding_options.return_scores = options.return_scores;
-      decoding_options.return_logits_vocab = options.return_logits_vocab;
-      decoding_options.return_attention = options.return_attention || options.replace_unknowns;
-      decoding_options.return_alternatives = options.return_alternatives;
-      decoding_options.min_alternative_expansion_prob = options.min_alternative_expansion_prob;
-      decoding_options.disable_sequences = target_vocabulary.to_ids(options.suppress_sequences,
-                                                                    /*max_length=*/0,
-                                                                    /*prefix=*/nullptr,
-                                                                    /*suffix=*/nullptr,
-                                                                    /*allow_unk=*/false);
-
-      if (options.disable_unk)
-        decoding_options.disable_ids.push_back(target_vocabulary.unk_id());
+      DecodingOptions decoding_options = make_decoding_options(options, target_vocabulary);
       if (options.callback)
         decoding_options.callback = [&options, &target_vocabulary](DecodingStepResult step_result) -> bool {
           return options.callback(GenerationStepResult(step_result, target_vocabulary));
@@ -431,6 +534,94 @@ namespace ctranslate2 {
       return final_results;
     }
 
+    void
+    EncoderDecoderReplica::run_continuous_translation(RequestQueue<TranslationRequest>& queue,
+                                                      const size_t max_batch_size) {
+      const auto scoped_device_setter = _model->get_scoped_device_setter();
+      if (!_decoder->support_continuous_batching()) {
+        SequenceToSequenceReplica::run_continuous_translation(queue, max_batch_size);
+        return;
+      }
+
+      const auto device = _model->device();
+      const auto& target_vocabulary = _model->get_target_vocabulary();
+      _decoder->update_output_layer(_model->preferred_size_multiple());
+
+      ContinuousDecoding decoding(*_decoder);
+
+      run_continuous_batching(
+        decoding,
+        queue,
+        max_batch_size,
+        [this, device, &target_vocabulary](ContinuousDecoding& decoding,
+                                           size_t id,
+                                           TranslationRequest& request) {
+          const auto& options = *request.options;
+          const auto& streams = request.example.streams;
+          const auto& source = streams[0];
+          const auto target_prefix = streams.size() > 1 ? streams[1] : std::vector<std::string>();
+
+          TranslationResult result;
+          if (skip_translation(source, target_prefix, options, result)) {
+            request.promise.set_value(std::move(result));
+            return false;
+          }
+
+          // The output layer is shared by all requests of the batch.
+          if (options.use_vmap && _model->get_vocabulary_map())
+            throw std::invalid_argument("Continuous batching does not support use_vmap");
+          if (options.replace_unknowns)
+            throw std::invalid_argument("Continuous batching does not support replace_unknowns");
+
+          const auto source_features = extract_features({source}, _encoder->num_input_features());
+          const auto source_ids = make_source_ids(source_features, options.max_input_length);
+          auto target_ids = make_target_ids({target_prefix},
+                                            options.max_input_length,
+                                            /*is_prefix=*/true);
+
+          StorageView memory(_encoder->output_type(), device);
+          StorageView memory_lengths(DataType::INT32, device);
+          encode(source_ids, memory, memory_lengths);
+
+          layers::DecoderState state = _decoder->initial_state();
+          state.emplace("memory", std::move(memory));
+          state.emplace("memory_lengths", std::move(memory_lengths));
+
+          DecodingOptions decoding_options = make_decoding_options(options, target_vocabulary);
+          if (options.callback)
+            decoding_options.callback = [options = request.options,
+                                         &target_vocabulary,
+                                         batch_id = request.index](DecodingStepResult step_result) {
+              step_result.batch_id = batch_id;
+              return options->callback(GenerationStepResult(step_result, target_vocabulary));
+            };
+
+          decoding.add(id,
+                       std::move(state),
+                       std::move(target_ids[0]),
+                       std::visit(ResolveEndToken(target_vocabulary), options.end_token),
+                       std::move(decoding_options));
+          return true;
+        },
+        [&target_vocabulary](TranslationRequest& request, DecodingResult result) {
+          const auto& options = *request.options;
+          const auto end_ids(std::visit(ResolveEndToken(target_vocabulary), options.end_token));
+
+          // Remove EOS token.
+          if (!options.return_end_token) {
+            for (auto& hypothesis : result.hypotheses) {
+              while (!hypothesis.empty() && is_eos(hypothesis.back(), end_ids))
+                hypothesis.pop_back();
+            }
+          }
+
+          return TranslationResult(target_vocabulary.to_tokens(result.hypotheses),
+                                   std::move(result.scores),
+                                   {},
+                                   std::move(result.logits_vocab));
+        });
+    }
+
     bool EncoderDecoderReplica::skip_translation(const std::vector<std::string>& source,
                                                  const std::vector<std::string>& target,
                                                  const TranslationOptions& options,
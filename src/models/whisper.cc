@@ -1,8 +1,13 @@
 #include "ctranslate2/models/whisper.h"
 
 #include <algorithm>
+#include <cmath>
+#include <map>
+#include <numeric>
 
 #include "ctranslate2/decoding.h"
+#include "ctranslate2/primitives.h"
+#include "ctranslate2/utils.h"
 
 #include "dispatch.h"
 #include "dtw.h"
@@ -83,11 +88,7 @@ namespace ctranslate2 {
 
       const auto scoped_device_setter = _model->get_scoped_device_setter();
       const Device device = _model->device();
-      const DataType dtype = _encoder->output_type();
-      features.move_to(device, dtype);
-
-      StorageView encoder_output(dtype, device);
-      (*_encoder)(features, encoder_output);
+      StorageView encoder_output = run_encoder(std::move(features));
 
       if (to_cpu) {
         if (device != Device::CPU)
@@ -102,16 +103,80 @@ namespace ctranslate2 {
     }
 
     StorageView WhisperReplica::maybe_encode(StorageView features) {
+      if (_encoder->is_encoded(features)) {
+        features.move_to(_model->device(), _encoder->output_type());
+        return features;
+      }
+
+      return run_encoder(std::move(features));
+    }
+
+    StorageView WhisperReplica::run_encoder(StorageView features) {
       const Device device = _model->device();
       const DataType dtype = _encoder->output_type();
 
-      features.move_to(device, dtype);
+      auto& cache = _model->get_encoder_cache();
+      if (!cache.enabled()) {
+        features.move_to(device, dtype);
+        StorageView encoder_output(dtype, device);
+        (*_encoder)(features, encoder_output);
+        return encoder_output;
+      }
 
-      if (_encoder->is_encoded(features))
-        return features;
+      // The examples are hashed from their features on the host.
+      StorageView host_copy;
+      const StorageView* host_features = &features;
+      if (features.device() != Device::CPU) {
+        host_copy = features.to(Device::CPU);
+        host_features = &host_copy;
+      }
+
+      const dim_t batch_size = features.dim(0);
+      const size_t example_bytes = features.size() / batch_size * features.item_size();
+      const auto* data = static_cast<const uint8_t*>(host_features->buffer());
+      const Shape example_shape(features.shape().begin() + 1, features.shape().end());
+      const int32_t features_dtype = static_cast<int32_t>(features.dtype());
+
+      std::vector<layers::EncoderCache::Key> keys(batch_size);
+      std::vector<std::shared_ptr<const StorageView>> outputs(batch_size);
+      std::vector<int32_t> missing;
+
+      for (dim_t b = 0; b < batch_size; ++b) {
+        layers::EncoderCache::hash(keys[b], &features_dtype, sizeof (features_dtype));
+        layers::EncoderCache::hash(keys[b],
+                                   example_shape.data(),
+                                   example_shape.size() * sizeof (dim_t));
+        layers::EncoderCache::hash(keys[b], data + b * example_bytes, example_bytes);
+        outputs[b] = cache.get(keys[b]);
+        if (!outputs[b])
+          missing.emplace_back(b);
+      }
+
+      if (!missing.empty()) {
+        if (missing.size() != static_cast<size_t>(batch_size)) {
+          const StorageView indices({dim_t(missing.size())}, missing, features.device());
+          StorageView missing_features(features.dtype(), features.device());
+          ops::Gather()(features, indices, missing_features);
+          features = std::move(missing_features);
+        }
+
+        features.move_to(device, dtype);
+        StorageView encoder_output(dtype, device);
+        (*_encoder)(features, encoder_output);
+
+        for (size_t i = 0; i < missing.size(); ++i) {
+          StorageView output(dtype, device);
+          ops::Slide(0, i, 1)(encoder_output, output);
+          output.squeeze(0);
+          outputs[missing[i]] = cache.save(keys[missing[i]], std::move(output));
+        }
+
+        if (missing.size() == static_cast<size_t>(batch_size))
+          return encoder_output;
+      }
 
       StorageView encoder_output(dtype, device);
-      (*_encoder)(features, encoder_output);
+      layers::EncoderCache::stack(outputs, 1, encoder_output);
       return encoder_output;
     }
 
@@ -638,6 +703,472 @@ namespace ctranslate2 {
     }
 
 
+    // Transcription state of a contiguous region of audio.
+    struct WhisperRegion {
+      size_t audio_index;
+      dim_t seek;
+      dim_t end;
+      std::string language;
+      std::vector<size_t> previous_tokens;
+      std::vector<WhisperSegment> segments;
+    };
+
+    static StorageView gather_rows(const StorageView& x, const std::vector<size_t>& rows) {
+      const std::vector<int32_t> indices(rows.begin(), rows.end());
+      const StorageView indices_view({dim_t(indices.size())}, indices, x.device());
+      StorageView y(x.dtype(), x.device());
+      ops::Gather()(x, indices_view, y);
+      return y;
+    }
+
+    static float get_avg_log_prob(const WhisperGenerationResult& result,
+                                  const float length_penalty) {
+      // The score is normalized by the length without the end token.
+      const float length = result.sequences_ids[0].size();
+      const float cum_log_prob = result.scores[0] * std::pow(length, length_penalty);
+      return cum_log_prob / (length + 1);
+    }
+
+    std::vector<WhisperGenerationResult>
+    WhisperReplica::generate_windows(const StorageView& encoder_output,
+                                     const std::vector<size_t>& windows,
+                                     const std::vector<std::vector<size_t>>& prompts,
+                                     const WhisperOptions& options) {
+      // generate requires the SOT token at the same position in all prompts, so the windows
+      // with and without previous text are decoded separately.
+      std::map<size_t, std::vector<size_t>> groups;
+      for (size_t i = 0; i < prompts.size(); ++i)
+        groups[get_sot_index(prompts[i], _sot_id)].emplace_back(i);
+
+      std::vector<WhisperGenerationResult> results(windows.size());
+
+      for (const auto& pair : groups) {
+        const auto& positions = pair.second;
+        std::vector<size_t> rows;
+        std::vector<std::vector<size_t>> group_prompts;
+        rows.reserve(positions.size());
+        group_prompts.reserve(positions.size());
+        for (const size_t position : positions) {
+          rows.emplace_back(windows[position]);
+          group_prompts.emplace_back(prompts[position]);
+        }
+
+        auto group_results = generate(gather_rows(encoder_output, rows), group_prompts, options);
+        for (size_t i = 0; i < positions.size(); ++i)
+          results[positions[i]] = std::move(group_results[i]);
+      }
+
+      return results;
+    }
+
+    std::vector<WhisperTranscriptionResult>
+    WhisperReplica::transcribe(const std::vector<StorageView>& features,
+                               const WhisperTranscriptionOptions& options) {
+      PROFILE("WhisperReplica::transcribe");
+
+#ifdef CT2_WITH_CUDA
+      const cuda::UseTrueFp16GemmInScope use_true_fp16_gemm(false);
+#endif
+
+      const auto& vocabulary = _model->get_vocabulary();
+      const auto scoped_device_setter = _model->get_scoped_device_setter();
+
+      const auto get_token_id = [&vocabulary](const std::string& token) {
+        const size_t id = vocabulary.to_id(token);
+        if (id == vocabulary.unk_id())
+          throw std::invalid_argument("Token " + token + " is not in the vocabulary");
+        return id;
+      };
+
+      const size_t sot_prev_id = get_token_id("<|startofprev|>");
+      const size_t task_id = _is_multilingual ? get_token_id(options.task) : 0;
+      if (_is_multilingual && !options.language.empty())
+        get_token_id(options.language);
+
+      const size_t timestamp_begin_id = _no_timestamps_id + 1;
+      const size_t max_previous_tokens = options.decoding_options.max_length / 2 - 1;
+      const dim_t window_frames = _encoder->max_input_time();
+      const dim_t frames_per_timestamp = 2;
+      const float frame_duration = 0.01;
+      const float timestamp_duration = frame_duration * frames_per_timestamp;
+
+      // The windows are sliced from a host copy of the features.
+      std::vector<StorageView> host_features;
+      std::vector<WhisperRegion> regions;
+      host_features.reserve(features.size());
+
+      for (size_t i = 0; i < features.size(); ++i) {
+        const StorageView& audio_features = features[i];
+        if (audio_features.rank() != 2 || audio_features.dim(0) != dim_t(_n_mels))
+          throw std::invalid_argument("Expected the features of each audio to have the shape ["
+                                      + std::to_string(_n_mels) + ", num_frames]");
+
+        StorageView host_copy = audio_features.to(Device::CPU);
+        if (host_copy.dtype() != DataType::FLOAT32)
+          host_copy = host_copy.to_float32();
+        host_features.emplace_back(std::move(host_copy));
+
+        const dim_t num_frames = audio_features.dim(1);
+        const dim_t region_frames = (options.region_frames > 0
+                                     ? dim_t(options.region_frames)
+                                     : num_frames);
+
+        for (dim_t begin = 0; begin < num_frames; begin += region_frames) {
+          WhisperRegion region;
+          region.audio_index = i;
+          region.seek = begin;
+          region.end = std::min(begin + region_frames, num_frames);
+          region.language = options.language;
+          regions.emplace_back(std::move(region));
+        }
+      }
+
+      WhisperOptions decoding_options = options.decoding_options;
+      decoding_options.num_hypotheses = 1;
+      decoding_options.return_scores = true;
+      decoding_options.return_logits_vocab = false;
+      decoding_options.return_no_speech_prob = true;
+
+      std::vector<float> temperatures = options.temperatures;
+      if (temperatures.empty())
+        temperatures.emplace_back(decoding_options.sampling_temperature);
+
+      const size_t max_batch_size = (options.max_batch_size > 0
+                                     ? options.max_batch_size
+                                     : regions.size());
+      std::vector<size_t> active;
+      size_t next_region = 0;
+
+      while (true) {
+        // A region joins the batch as soon as another one is finished.
+        while (active.size() < max_batch_size && next_region < regions.size())
+          active.emplace_back(next_region++);
+        if (active.empty())
+          break;
+
+        const size_t batch_size = active.size();
+
+        // The windows are padded with zeros as in Whisper.
+        StorageView windows({dim_t(batch_size), dim_t(_n_mels), window_frames}, 0.f);
+        for (size_t b = 0; b < batch_size; ++b) {
+          const auto& region = regions[active[b]];
+          const StorageView& audio_features = host_features[region.audio_index];
+          const dim_t num_frames = audio_features.dim(1);
+          const dim_t size = std::min(window_frames, region.end - region.seek);
+
+          for (dim_t m = 0; m < dim_t(_n_mels); ++m)
+            std::copy_n(audio_features.data<float>() + m * num_frames + region.seek,
+                        size,
+                        windows.data<float>() + (b * _n_mels + m) * window_frames);
+        }
+
+        const StorageView encoder_output = run_encoder(std::move(windows));
+
+        if (_is_multilingual) {
+          std::vector<size_t> undetected;
+          for (size_t b = 0; b < batch_size; ++b) {
+            if (regions[active[b]].language.empty())
+              undetected.emplace_back(b);
+          }
+
+          if (!undetected.empty()) {
+            const auto languages = detect_language(gather_rows(encoder_output, undetected));
+            for (size_t i = 0; i < undetected.size(); ++i)
+              regions[active[undetected[i]]].language = languages[i][0].first;
+          }
+        }
+
+        std::vector<std::vector<size_t>> prompts(batch_size);
+        for (size_t b = 0; b < batch_size; ++b) {
+          const auto& region = regions[active[b]];
+          auto& prompt = prompts[b];
+
+          // The previous text of each region is already truncated to max_previous_tokens.
+          // The prompts with different lengths are decoded separately by generate_windows.
+          if (options.condition_on_previous_text && !region.previous_tokens.empty()) {
+            prompt.emplace_back(sot_prev_id);
+            prompt.insert(prompt.end(),
+                          region.previous_tokens.begin(),
+                          region.previous_tokens.end());
+          }
+
+          prompt.emplace_back(_sot_id);
+          if (_is_multilingual) {
+            prompt.emplace_back(vocabulary.to_id(region.language));
+            prompt.emplace_back(task_id);
+          }
+          if (!options.with_timestamps)
+            prompt.emplace_back(_no_timestamps_id);
+        }
+
+        // The windows with a low average log probability are decoded again with
+        // the next temperature.
+        std::vector<WhisperGenerationResult> results(batch_size);
+        std::vector<float> window_temperatures(batch_size);
+        std::vector<float> avg_log_probs(batch_size);
+        std::vector<size_t> pending(batch_size);
+        std::iota(pending.begin(), pending.end(), size_t(0));
+
+        for (size_t t = 0; t < temperatures.size() && !pending.empty(); ++t) {
+          const float temperature = temperatures[t];
+
+          WhisperOptions window_options = decoding_options;
+          if (temperature > 0) {
+            window_options.sampling_temperature = temperature;
+            window_options.sampling_topk = 0;
+            window_options.beam_size = 1;
+          }
+
+          std::vector<std::vector<size_t>> pending_prompts;
+          pending_prompts.reserve(pending.size());
+          for (const size_t b : pending)
+            pending_prompts.emplace_back(prompts[b]);
+
+          auto pending_results = generate_windows(encoder_output,
+                                                  pending,
+                                                  pending_prompts,
+                                                  window_options);
+
+          std::vector<size_t> fallback;
+          for (size_t i = 0; i < pending.size(); ++i) {
+            const size_t b = pending[i];
+            results[b] = std::move(pending_results[i]);
+            window_temperatures[b] = temperature;
+            avg_log_probs[b] = get_avg_log_prob(results[b], window_options.length_penalty);
+
+            const bool is_silence = (results[b].no_speech_prob > options.no_speech_threshold
+                                     && avg_log_probs[b] < options.log_prob_threshold);
+            if (avg_log_probs[b] < options.log_prob_threshold && !is_silence)
+              fallback.emplace_back(b);
+          }
+
+          pending = std::move(fallback);
+        }
+
+        for (size_t b = 0; b < batch_size; ++b) {
+          auto& region = regions[active[b]];
+          const auto& result = results[b];
+          const auto& tokens = result.sequences_ids[0];
+          const dim_t previous_seek = region.seek;
+          const dim_t segment_size = std::min(window_frames, region.end - region.seek);
+          const float time_offset = region.seek * frame_duration;
+
+          if (result.no_speech_prob > options.no_speech_threshold
+              && avg_log_probs[b] < options.log_prob_threshold) {
+            region.seek += segment_size;
+            continue;
+          }
+
+          const auto is_timestamp = [timestamp_begin_id](const size_t id) {
+            return id >= timestamp_begin_id;
+          };
+
+          const auto get_time = [&](const size_t id) {
+            return time_offset + (id - timestamp_begin_id) * timestamp_duration;
+          };
+
+          const auto add_segment = [&](const float start,
+                                       const float end,
+                                       const size_t begin,
+                                       const size_t end_index) {
+            WhisperSegment segment;
+            segment.start = start;
+            segment.end = end;
+            segment.avg_log_prob = avg_log_probs[b];
+            segment.no_speech_prob = result.no_speech_prob;
+            segment.temperature = window_temperatures[b];
+            for (size_t i = begin; i < end_index; ++i) {
+              if (tokens[i] < _eot_id) {
+                segment.tokens_ids.emplace_back(tokens[i]);
+                segment.tokens.emplace_back(vocabulary.to_token(tokens[i]));
+              }
+            }
+            if (!segment.tokens_ids.empty())
+              region.segments.emplace_back(std::move(segment));
+          };
+
+          if (!options.with_timestamps) {
+            add_segment(time_offset, time_offset + segment_size * frame_duration, 0, tokens.size());
+            region.seek += segment_size;
+
+          } else {
+            // Each pair of consecutive timestamps ends a segment.
+            std::vector<size_t> slices;
+            for (size_t i = 1; i < tokens.size(); ++i) {
+              if (is_timestamp(tokens[i - 1]) && is_timestamp(tokens[i]))
+                slices.emplace_back(i);
+            }
+
+            const size_t num_tokens = tokens.size();
+            const bool single_timestamp_ending = (num_tokens >= 2
+                                                  && !is_timestamp(tokens[num_tokens - 2])
+                                                  && is_timestamp(tokens[num_tokens - 1]));
+
+            if (!slices.empty()) {
+              if (single_timestamp_ending)
+                slices.emplace_back(num_tokens);
+
+              size_t last_slice = 0;
+              for (const size_t slice : slices) {
+                const size_t start_id = tokens[last_slice];
+                const size_t end_id = tokens[slice - 1];
+                add_segment(is_timestamp(start_id) ? get_time(start_id) : time_offset,
+                            is_timestamp(end_id) ? get_time(end_id) : time_offset,
+                            last_slice,
+                            slice);
+                last_slice = slice;
+              }
+
+              if (single_timestamp_ending)
+                region.seek += segment_size;
+              else
+                region.seek += (tokens[last_slice - 1] - timestamp_begin_id) * frames_per_timestamp;
+
+            } else {
+              float end = time_offset + segment_size * frame_duration;
+              for (auto it = tokens.rbegin(); it != tokens.rend(); ++it) {
+                if (is_timestamp(*it)) {
+                  if (*it != timestamp_begin_id)
+                    end = get_time(*it);
+                  break;
+                }
+              }
+
+              add_segment(time_offset, end, 0, num_tokens);
+              region.seek += segment_size;
+            }
+          }
+
+          // Always move forward, even if the last timestamp is at the window start.
+          if (region.seek <= previous_seek)
+            region.seek = previous_seek + segment_size;
+
+          if (options.condition_on_previous_text) {
+            if (window_temperatures[b] > 0.5f) {
+              // The text sampled with a high temperature is not used as a prompt.
+              region.previous_tokens.clear();
+            } else {
+              auto& previous_tokens = region.previous_tokens;
+              previous_tokens.insert(previous_tokens.end(), tokens.begin(), tokens.end());
+              if (previous_tokens.size() > max_previous_tokens)
+                previous_tokens.erase(previous_tokens.begin(),
+                                      previous_tokens.end() - max_previous_tokens);
+            }
+          }
+        }
+
+        active.erase(std::remove_if(active.begin(), active.end(),
+                                    [&regions](const size_t r) {
+                                      return regions[r].seek >= regions[r].end;
+                                    }),
+                     active.end());
+      }
+
+      std::vector<WhisperTranscriptionResult> final_results(features.size());
+      for (auto& region : regions) {
+        auto& result = final_results[region.audio_index];
+        if (result.language.empty())
+          result.language = std::move(region.language);
+        result.segments.insert(result.segments.end(),
+                               std::make_move_iterator(region.segments.begin()),
+                               std::make_move_iterator(region.segments.end()));
+      }
+
+      return final_results;
+    }
+
+    WhisperFeatureStream::WhisperFeatureStream(size_t n_mels, dim_t window_frames)
+      : _log_mel_spectrogram(n_mels)
+      , _window_frames(window_frames)
+    {
+    }
+
+    void WhisperFeatureStream::push(const float* samples, size_t num_samples) {
+      if (_max_frames >= 0)
+        throw std::runtime_error("Cannot push audio samples after the end of the stream");
+
+      _signal.insert(_signal.end(), samples, samples + num_samples);
+      _num_samples += num_samples;
+      compute_frames();
+    }
+
+    void WhisperFeatureStream::push(const std::vector<float>& samples) {
+      push(samples.data(), samples.size());
+    }
+
+    void WhisperFeatureStream::finish() {
+      if (_max_frames >= 0)
+        return;
+
+      const dim_t n_fft = _log_mel_spectrogram.n_fft();
+      const dim_t hop_length = _log_mel_spectrogram.hop_length();
+      _max_frames = ceil_divide(num_frames(), _window_frames) * _window_frames;
+
+      // The audio is followed by silence, as when Whisper pads the audio with 30 seconds
+      // of zeros before computing the features.
+      if (!_started)
+        _signal.resize(std::max(_signal.size(), size_t(n_fft / 2 + 1)), 0.f);
+      compute_frames();
+
+      if (_max_frames > _num_computed_frames) {
+        const dim_t padded_size = (_max_frames - _num_computed_frames - 1) * hop_length + n_fft;
+        _signal.resize(std::max(_signal.size(), size_t(padded_size)), 0.f);
+        compute_frames();
+      }
+    }
+
+    bool WhisperFeatureStream::next(StorageView& features) {
+      const dim_t n_mels = _log_mel_spectrogram.num_mels();
+      if (dim_t(_frames.size()) < _window_frames * n_mels)
+        return false;
+
+      features = StorageView({n_mels, _window_frames}, DataType::FLOAT32);
+      const dim_t dims[2] = {_window_frames, n_mels};
+      primitives<Device::CPU>::transpose_2d(_frames.data(), dims, features.data<float>());
+      ops::LogMelSpectrogram::normalize(features.data<float>(), features.size());
+
+      _frames.erase(_frames.begin(), _frames.begin() + _window_frames * n_mels);
+      return true;
+    }
+
+    dim_t WhisperFeatureStream::num_frames() const {
+      return _num_samples / _log_mel_spectrogram.hop_length();
+    }
+
+    void WhisperFeatureStream::compute_frames() {
+      const dim_t n_mels = _log_mel_spectrogram.num_mels();
+      const dim_t n_fft = _log_mel_spectrogram.n_fft();
+      const dim_t hop_length = _log_mel_spectrogram.hop_length();
+      const dim_t padding = n_fft / 2;
+
+      // The beginning of the signal is padded by reflection as in torch.stft.
+      if (!_started) {
+        if (dim_t(_signal.size()) <= padding)
+          return;
+
+        std::vector<float> reflection(padding);
+        for (dim_t i = 0; i < padding; ++i)
+          reflection[i] = _signal[padding - i];
+        _signal.insert(_signal.begin(), reflection.begin(), reflection.end());
+        _started = true;
+      }
+
+      const dim_t signal_size = _signal.size();
+      dim_t num_frames = signal_size >= n_fft ? (signal_size - n_fft) / hop_length + 1 : 0;
+      if (_max_frames >= 0)
+        num_frames = std::min(num_frames, _max_frames - _num_computed_frames);
+      if (num_frames <= 0)
+        return;
+
+      const size_t offset = _frames.size();
+      _frames.resize(offset + num_frames * n_mels);
+      _log_mel_spectrogram.compute_frames(_signal.data(), num_frames, _frames.data() + offset);
+
+      _signal.erase(_signal.begin(), _signal.begin() + num_frames * hop_length);
+      _num_computed_frames += num_frames;
+    }
+
+
     bool Whisper::is_multilingual() const {
       const auto& replica = get_first_replica();
       return replica.is_multilingual();
@@ -723,6 +1254,21 @@ namespace ctranslate2 {
         batch_size);
     }
 
+    std::vector<std::future<WhisperTranscriptionResult>>
+    Whisper::transcribe(std::vector<StorageView> features, WhisperTranscriptionOptions options) {
+      const size_t num_audio = features.size();
+      for (auto& audio_features : features)
+        audio_features = audio_features.sync_copy();
+
+      return post_batch<WhisperTranscriptionResult>(
+        [features = std::move(features),
+         options = std::move(options)]
+        (WhisperReplica& replica) {
+          return replica.transcribe(features, options);
+        },
+        num_audio);
+    }
+
 
     class ApplyTimestampRules : public LogitsProcessor {
     private:
@@ -21,7 +21,7 @@ namespace ctranslate2 {
                                     StorageView* rotary_cos,
                                     StorageView* rotary_sin,
                                     const bool rotary_interleave,
-                                    StorageView* alibi,
+                                    const StorageView* alibi,
                                     dim_t offset) const {
       PROFILE("FlashAttention");
       DEVICE_DISPATCH(queries.device(), compute<D>(queries, keys, values, output, cached_keys, cached_values,
@@ -1,24 +1,256 @@
 #include "ctranslate2/ops/flash_attention.h"
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "ctranslate2/primitives.h"
+
+#include "cpu/kernels.h"
+#include "cpu/parallel.h"
 #include "dispatch.h"
 
 namespace ctranslate2 {
   namespace ops {
+
+    // Number of query rows and keys processed at once. The scores of a block of queries with
+    // a tile of keys should fit in the L2 cache.
+    constexpr dim_t query_block_size = 32;
+    constexpr dim_t key_tile_size = 256;
+
+    // Computes the attention of num_queries rows attending to the same keys and values. Each
+    // query row i attends to the keys in [begins[i], ends[i]). The keys are processed in tiles
+    // and the softmax is computed online, so the attention matrix is never materialized.
+    static void attention_block(const float* queries,
+                                const float* keys,
+                                const float* values,
+                                const float* bias,
+                                float* output,
+                                float* scores,
+                                float* row_max,
+                                float* row_sum,
+                                float* correction,
+                                int32_t* tile_begins,
+                                int32_t* tile_ends,
+                                const int32_t* begins,
+                                const int32_t* ends,
+                                const dim_t num_queries,
+                                const dim_t depth,
+                                const dim_t keys_stride,
+                                const float queries_scale) {
+      const dim_t keys_begin = *std::min_element(begins, begins + num_queries);
+      const dim_t keys_end = *std::max_element(ends, ends + num_queries);
+
+      std::fill(row_max, row_max + num_queries, -std::numeric_limits<float>::infinity());
+      std::fill(row_sum, row_sum + num_queries, 0.f);
+      std::fill(output, output + num_queries * depth, 0.f);
+
+      for (dim_t tile_begin = keys_begin; tile_begin < keys_end; tile_begin += key_tile_size) {
+        const dim_t tile_size = std::min(key_tile_size, keys_end - tile_begin);
+
+        primitives<Device::CPU>::gemm(false, false,
+                                      false, true,
+                                      num_queries, tile_size, depth,
+                                      queries_scale,
+                                      queries, depth,
+                                      keys + tile_begin * keys_stride, keys_stride,
+                                      0.f,
+                                      scores, key_tile_size);
+
+        for (dim_t i = 0; i < num_queries; ++i) {
+          tile_begins[i] = begins[i] - tile_begin;
+          tile_ends[i] = ends[i] - tile_begin;
+        }
+
+        CPU_ISA_DISPATCH((cpu::online_softmax<ISA>(scores,
+                                                   bias ? bias + tile_begin : nullptr,
+                                                   tile_begins,
+                                                   tile_ends,
+                                                   row_max,
+                                                   row_sum,
+                                                   correction,
+                                                   num_queries,
+                                                   tile_size,
+                                                   key_tile_size)));
+
+        for (dim_t i = 0; i < num_queries; ++i) {
+          if (correction[i] != 1)
+            primitives<Device::CPU>::mul(correction[i],
+                                         output + i * depth,
+                                         output + i * depth,
+                                         depth);
+        }
+
+        primitives<Device::CPU>::gemm(false, false,
+                                      false, false,
+                                      num_queries, depth, tile_size,
+                                      1.f,
+                                      scores, key_tile_size,
+                                      values + tile_begin * keys_stride, keys_stride,
+                                      1.f,
+                                      output, depth);
+      }
+
+      for (dim_t i = 0; i < num_queries; ++i) {
+        if (row_sum[i] > 0)
+          primitives<Device::CPU>::mul(1.f / row_sum[i],
+                                       output + i * depth,
+                                       output + i * depth,
+                                       depth);
+      }
+    }
+
     template<>
-    void FlashAttention::compute<Device::CPU>(StorageView&,
-                                               StorageView&,
-                                               StorageView&,
-                                               StorageView&,
-                                               StorageView*,
-                                               StorageView*,
-                                               StorageView*,
-                                               bool,
-                                               StorageView*,
-                                               StorageView*,
-                                               const bool,
-                                               StorageView*,
-                                               dim_t) const {
-      throw std::runtime_error("FlashAttention do not support for CPU");
+    void FlashAttention::compute<Device::CPU>(StorageView& queries,
+                                              StorageView& keys,
+                                              StorageView& values,
+                                              StorageView& output,
+                                              StorageView* cached_keys,
+                                              StorageView* cached_values,
+                                              StorageView* attention,
+                                              bool,
+                                              StorageView* rotary_cos,
+                                              StorageView* rotary_sin,
+                                              const bool,
+                                              const StorageView* alibi,
+                                              dim_t offset) const {
+      if (queries.dtype() != DataType::FLOAT32)
+        throw std::invalid_argument("FlashAttention on CPU only supports float32 inputs");
+      if (attention)
+        throw std::invalid_argument("FlashAttention on CPU does not return attention weights");
+      if (rotary_cos || rotary_sin)
+        throw std::invalid_argument("FlashAttention on CPU expects the rotary embeddings to be "
+                                    "already applied");
+
+      // The inputs have the shape [batch, time, heads, head_dim].
+      const dim_t batch_size = queries.dim(0);
+      const dim_t num_queries = queries.dim(1);
+      const dim_t num_heads = queries.dim(2);
+      const dim_t depth = queries.dim(3);
+
+      const StorageView* all_keys = &keys;
+      const StorageView* all_values = &values;
+      dim_t num_keys = keys.dim(1);
+
+      if (offset > 0) {
+        // The new keys and values are written in the cache at the offset position.
+        num_keys = offset + keys.dim(1);
+        if (!cached_keys || !cached_values || cached_keys->dim(1) < num_keys)
+          throw std::invalid_argument("FlashAttention: the cache cannot contain the new keys");
+
+        const dim_t new_size = keys.size() / batch_size;
+        const dim_t cache_size = cached_keys->size() / batch_size;
+        const dim_t cache_offset = offset * cached_keys->stride(1);
+
+        for (dim_t b = 0; b < batch_size; ++b) {
+          primitives<Device::CPU>::copy(keys.data<float>() + b * new_size,
+                                        cached_keys->data<float>() + b * cache_size + cache_offset,
+                                        new_size);
+          primitives<Device::CPU>::copy(values.data<float>() + b * new_size,
+                                        cached_values->data<float>() + b * cache_size + cache_offset,
+                                        new_size);
+        }
+
+        all_keys = cached_keys;
+        all_values = cached_values;
+      }
+
+      const dim_t num_heads_kv = all_keys->dim(2);
+      const dim_t keys_stride = num_heads_kv * depth;
+      const dim_t keys_batch_stride = all_keys->dim(1) * keys_stride;
+      const dim_t queries_stride = num_heads * depth;
+      const dim_t group_size = num_heads / num_heads_kv;
+
+      const float* alibi_data = nullptr;
+      dim_t alibi_stride = 0;
+      if (alibi) {
+        // The softmax is invariant to a constant bias so the table can be read from any offset.
+        alibi_stride = alibi->dim(-1);
+        alibi_data = alibi->data<float>() + alibi_stride - num_keys;
+      }
+
+      // The query heads attending to the same key/value head are processed together, except
+      // with ALiBi where each head has a different bias.
+      const dim_t heads_per_item = alibi ? 1 : group_size;
+      const dim_t rows_per_item = num_queries * heads_per_item;
+      const dim_t num_blocks = ceil_divide(rows_per_item, query_block_size);
+      const dim_t num_items = batch_size * (num_heads / heads_per_item) * num_blocks;
+
+      output.resize_as(queries);
+
+      const auto* q = queries.data<float>();
+      const auto* k = all_keys->data<float>();
+      const auto* v = all_values->data<float>();
+      auto* o = output.data<float>();
+
+      cpu::parallel_for(0, num_items, 1, [&](dim_t begin, dim_t end) {
+        StorageView buffers({2 * query_block_size * depth
+                             + query_block_size * key_tile_size
+                             + 3 * query_block_size},
+                            DataType::FLOAT32);
+        StorageView ranges({4 * query_block_size}, DataType::INT32);
+
+        float* block_queries = buffers.data<float>();
+        float* block_output = block_queries + query_block_size * depth;
+        float* scores = block_output + query_block_size * depth;
+        float* row_max = scores + query_block_size * key_tile_size;
+        float* row_sum = row_max + query_block_size;
+        float* correction = row_sum + query_block_size;
+        int32_t* begins = ranges.data<int32_t>();
+        int32_t* ends = begins + query_block_size;
+        int32_t* tile_begins = ends + query_block_size;
+        int32_t* tile_ends = tile_begins + query_block_size;
+
+        for (dim_t item = begin; item < end; ++item) {
+          const dim_t block = item % num_blocks;
+          const dim_t first_head = (item / num_blocks) % (num_heads / heads_per_item) * heads_per_item;
+          const dim_t b = item / num_blocks / (num_heads / heads_per_item);
+          const dim_t head_kv = first_head / group_size;
+
+          const dim_t first_row = block * query_block_size;
+          const dim_t num_rows = std::min(query_block_size, rows_per_item - first_row);
+
+          // Pack the query rows in the order (time, head).
+          for (dim_t r = 0; r < num_rows; ++r) {
+            const dim_t t = (first_row + r) / heads_per_item;
+            const dim_t h = first_head + (first_row + r) % heads_per_item;
+            std::memcpy(block_queries + r * depth,
+                        q + (b * num_queries + t) * queries_stride + h * depth,
+                        depth * sizeof (float));
+
+            // Queries are aligned with the last keys and do not attend to future positions.
+            const dim_t position = num_keys - num_queries + t;
+            ends[r] = position + 1;
+            begins[r] = _sliding_window > 0 ? std::max(position - _sliding_window, dim_t(0)) : 0;
+          }
+
+          attention_block(block_queries,
+                          k + b * keys_batch_stride + head_kv * depth,
+                          v + b * keys_batch_stride + head_kv * depth,
+                          alibi_data ? alibi_data + first_head * alibi_stride : nullptr,
+                          block_output,
+                          scores,
+                          row_max,
+                          row_sum,
+                          correction,
+                          tile_begins,
+                          tile_ends,
+                          begins,
+                          ends,
+                          num_rows,
+                          depth,
+                          keys_stride,
+                          _queries_scale);
+
+          for (dim_t r = 0; r < num_rows; ++r) {
+            const dim_t t = (first_row + r) / heads_per_item;
+            const dim_t h = first_head + (first_row + r) % heads_per_item;
+            std::memcpy(o + (b * num_queries + t) * queries_stride + h * depth,
+                        block_output + r * depth,
+                        depth * sizeof (float));
+          }
+        }
+      });
     }
   }
-}
\ No newline at end of file
+}
@@ -203,7 +203,7 @@ namespace ctranslate2 {
                                                StorageView* rotary_cos,
                                                StorageView* rotary_sin,
                                                const bool rotary_interleave,
-                                               StorageView* alibi,
+                                               const StorageView* alibi,
                                                dim_t offset) const {
 #ifdef CT2_WITH_FLASH_ATTN
       const Device device = queries.device();
@@ -0,0 +1,78 @@
+#include "ctranslate2/ops/gated_activation.h"
+
+#include "cpu/kernels.h"
+#include "cpu/parallel.h"
+
+namespace ctranslate2 {
+  namespace ops {
+
+    template <cpu::CpuIsa ISA>
+    static void apply_activation(const ActivationType type, const float* x, float* y, dim_t size) {
+      switch (type) {
+      case ActivationType::ReLU:
+        cpu::max<ISA>(0.f, x, y, size);
+        break;
+      case ActivationType::GELUTanh:
+        cpu::gelu_tanh<ISA>(x, y, size);
+        break;
+      case ActivationType::Swish:
+        cpu::swish<ISA>(x, y, size);
+        break;
+      case ActivationType::GELU:
+        cpu::gelu<ISA>(x, y, size);
+        break;
+      case ActivationType::GELUSigmoid:
+        cpu::gelu_sigmoid<ISA>(x, y, size);
+        break;
+      case ActivationType::Tanh:
+        cpu::tanh<ISA>(x, y, size);
+        break;
+      case ActivationType::Sigmoid:
+        cpu::sigmoid<ISA>(x, y, size);
+        break;
+      }
+    }
+
+    GatedActivation::GatedActivation(const ActivationType activation_type)
+      : _activation_type(activation_type)
+    {
+    }
+
+    void GatedActivation::operator()(const StorageView& x, StorageView& y) const {
+      PROFILE("GatedActivation");
+
+      if (x.device() != Device::CPU)
+        throw std::invalid_argument("GatedActivation currently only supports CPU execution");
+      if (x.dtype() != DataType::FLOAT32)
+        throw std::invalid_argument("GatedActivation only supports float32 inputs");
+
+      const dim_t input_depth = x.dim(-1);
+      if (input_depth % 2 != 0)
+        throw std::invalid_argument("GatedActivation: the last dimension of the input should "
+                                    "be even, but got " + std::to_string(input_depth));
+
+      const dim_t depth = input_depth / 2;
+      const dim_t batch_size = x.size() / input_depth;
+
+      Shape output_shape = x.shape();
+      output_shape.back() = depth;
+      y.resize(std::move(output_shape));
+
+      const auto* src = x.data<float>();
+      auto* dst = y.data<float>();
+      const ActivationType activation_type = _activation_type;
+
+      // Each row is read once: the activation is written to the output row which is then
+      // scaled in place by the gate while still in cache.
+      cpu::parallel_for(0, batch_size, cpu::GRAIN_SIZE / input_depth, [&](dim_t begin, dim_t end) {
+        for (dim_t i = begin; i < end; ++i) {
+          const auto* in = src + i * input_depth;
+          auto* out = dst + i * depth;
+          CPU_ISA_DISPATCH((apply_activation<ISA>(activation_type, in, out, depth)));
+          CPU_ISA_DISPATCH((cpu::mul<ISA>(in + depth, out, out, depth)));
+        }
+      });
+    }
+
+  }
+}
@@ -1,7 +1,10 @@
 #include "ctranslate2/ops/gemm.h"
 
+#include <cstring>
+
 #include "ctranslate2/ops/bias_add.h"
 
+#include "cpu/backend.h"
 #include "dispatch.h"
 
 namespace ctranslate2 {
@@ -92,13 +95,16 @@ namespace ctranslate2 {
                           m, n, k,
                           _alpha,
                           a.data<In>(), lda,
-                          b.data<In>(), ldb,
+                          // The packed weight can have a different type, see pack_b.
+                          _b_is_packed ? static_cast<const In*>(b.buffer()) : b.data<In>(), ldb,
                           _beta,
                           c.data<Out>(), ldc,
                           a_shift_compensation ? a_shift_compensation->data<Out>() : nullptr);
     }
 
-    template <typename T>
+    // The packed data can have a different type than the weight, for example when float32
+    // weights are packed in bfloat16. The packed storage then has this type.
+    template <typename T, typename PackedT = T>
     static void pack_b(const StorageView& b,
                        const bool transpose,
                        const dim_t k,
@@ -114,7 +120,7 @@ namespace ctranslate2 {
       if (pack_bytes == 0)  // Packed Gemm is not supported.
         throw std::runtime_error("Packed GEMM APIs are not supported by this GEMM backend");
 
-      const dim_t pack_size = pack_bytes / sizeof (T);
+      const dim_t pack_size = ceil_divide(pack_bytes, dim_t(sizeof (PackedT)));
       const dim_t b_size = b.size();
 
       // We want the packed storage to have the same shape as the original weight
@@ -123,11 +129,17 @@ namespace ctranslate2 {
       packed.reserve(std::max(b_size, pack_size));
       packed.resize_as(b);
 
+      // Clear the bytes after the packed data so that the storage content is deterministic.
+      auto* packed_data = static_cast<char*>(packed.buffer());
+      const dim_t reserved_bytes = packed.reserved_memory();
+      if (pack_bytes < reserved_bytes)
+        std::memset(packed_data + pack_bytes, 0, reserved_bytes - pack_bytes);
+
       primitives<Device::CPU>::gemm_pack_b(src,
                                            transpose,
                                            k, n,
                                            alpha,
-                                           packed.data<T>());
+                                           reinterpret_cast<T*>(packed_data));
     }
 
     StorageView Gemm::pack_b_input(const StorageView& b,
@@ -143,7 +155,12 @@ namespace ctranslate2 {
 
       switch (dtype) {
       case DataType::FLOAT32:
-        pack_b<float>(b, transpose, k, n, alpha, packed);
+        if (cpu::use_bf16_gemm()) {
+          packed = StorageView(DataType::BFLOAT16);
+          pack_b<float, bfloat16_t>(b, transpose, k, n, alpha, packed);
+        } else {
+          pack_b<float>(b, transpose, k, n, alpha, packed);
+        }
         break;
       case DataType::INT16:
         pack_b<int16_t>(b, transpose, k, n, alpha, packed);
@@ -0,0 +1,100 @@
+#include "ctranslate2/ops/gemm_int4.h"
+
+#include <algorithm>
+
+#include "ctranslate2/ops/gemm.h"
+#include "ctranslate2/primitives.h"
+
+#include "cpu/kernels.h"
+#include "dispatch.h"
+
+namespace ctranslate2 {
+  namespace ops {
+
+    // Above this number of input rows, blocks of weights are dequantized and multiplied with
+    // the regular GEMM which has a better compute efficiency.
+    constexpr dim_t max_rows_for_int4_kernel = 16;
+    constexpr dim_t int4_dequantize_block_size = 256;
+
+    GemmInt4::GemmInt4(const ActivationType* activation_type)
+      : _activation_type(activation_type)
+    {
+    }
+
+    void GemmInt4::operator()(const StorageView& a,
+                              const StorageView& b,
+                              const StorageView& scale,
+                              const StorageView& zero,
+                              StorageView& c,
+                              const StorageView* bias) const {
+      PROFILE("GemmInt4");
+
+      if (a.device() != Device::CPU)
+        throw std::invalid_argument("GemmInt4 currently only supports CPU execution");
+      if (a.dtype() != DataType::FLOAT32 || b.dtype() != DataType::INT8)
+        throw std::invalid_argument("GemmInt4 expects float32 inputs and packed int8 weights");
+
+      const dim_t k = a.dim(-1);
+      const dim_t n = b.dim(0);
+      const dim_t m = a.size() / k;
+      const dim_t num_groups = scale.dim(-1);
+
+      if (b.dim(1) * 2 != k)
+        throw std::invalid_argument("GemmInt4: the packed weight has "
+                                    + std::to_string(b.dim(1) * 2)
+                                    + " input features but the input has "
+                                    + std::to_string(k));
+      if (scale.size() != n * num_groups || zero.size() != scale.size() || k % num_groups != 0)
+        throw std::invalid_argument("GemmInt4: invalid shape for the scales or zero points");
+
+      const dim_t group_size = k / num_groups;
+      if (group_size % 32 != 0)
+        throw std::invalid_argument("GemmInt4: the group size should be a multiple of 32");
+
+      Shape output_shape(a.shape());
+      output_shape.back() = n;
+      c.resize(std::move(output_shape));
+
+      const auto* a_data = a.data<float>();
+      const auto* b_data = reinterpret_cast<const uint8_t*>(b.data<int8_t>());
+      const auto* scale_data = scale.data<float>();
+      const auto* zero_data = zero.data<float>();
+      auto* c_data = c.data<float>();
+
+      if (m <= max_rows_for_int4_kernel) {
+        CPU_ISA_DISPATCH((cpu::gemm_int4<ISA>(a_data,
+                                              b_data,
+                                              scale_data,
+                                              zero_data,
+                                              c_data,
+                                              m, n, k,
+                                              group_size)));
+      } else {
+        const dim_t block_size = std::min(n, int4_dequantize_block_size);
+        StorageView weight({block_size, k}, DataType::FLOAT32);
+        auto* weight_data = weight.data<float>();
+
+        for (dim_t begin = 0; begin < n; begin += block_size) {
+          const dim_t size = std::min(block_size, n - begin);
+          CPU_ISA_DISPATCH((cpu::dequantize_int4<ISA>(b_data + begin * (k / 2),
+                                                      scale_data + begin * num_groups,
+                                                      zero_data + begin * num_groups,
+                                                      weight_data,
+                                                      size, k,
+                                                      group_size)));
+          primitives<Device::CPU>::gemm(false, false,
+                                        false, true,
+                                        m, size, k,
+                                        1.f,
+                                        a_data, k,
+                                        weight_data, k,
+                                        0.f,
+                                        c_data + begin, n);
+        }
+      }
+
+      apply_bias_and_activation(c, bias, _activation_type);
+    }
+
+  }
+}
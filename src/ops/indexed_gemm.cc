@@ -0,0 +1,140 @@
+#include "ctranslate2/ops/indexed_gemm.h"
+
+#include <algorithm>
+
+#include "ctranslate2/ops/gemm.h"
+#include "ctranslate2/primitives.h"
+
+#include "cpu/kernels.h"
+#include "cpu/parallel.h"
+#include "dispatch.h"
+
+namespace ctranslate2 {
+  namespace ops {
+
+    // Above this number of input rows, blocks of selected rows are copied and multiplied
+    // with the regular GEMM which has a better compute efficiency.
+    constexpr dim_t max_rows_for_indexed_kernel = 16;
+    constexpr dim_t indexed_gemm_block_size = 256;
+
+    template <typename In, typename Out>
+    static void indexed_gemm_by_blocks(const In* a,
+                                       const In* b,
+                                       const int32_t* index,
+                                       Out* c,
+                                       dim_t m,
+                                       dim_t n,
+                                       dim_t k,
+                                       const Out* compensation) {
+      const dim_t block_size = std::min(n, indexed_gemm_block_size);
+      std::vector<In> weight(block_size * k);
+
+      for (dim_t begin = 0; begin < n; begin += block_size) {
+        const dim_t size = std::min(block_size, n - begin);
+        cpu::parallel_for(0, size, 1, [&](dim_t row_begin, dim_t row_end) {
+          for (dim_t i = row_begin; i < row_end; ++i)
+            std::copy_n(b + dim_t(index[begin + i]) * k, k, weight.data() + i * k);
+        });
+
+        primitives<Device::CPU>::gemm(false, false,
+                                      false, true,
+                                      m, size, k,
+                                      1.f,
+                                      a, k,
+                                      weight.data(), k,
+                                      0.f,
+                                      c + begin, n,
+                                      compensation ? compensation + begin : nullptr);
+      }
+    }
+
+    IndexedGemm::IndexedGemm(const ActivationType* activation_type)
+      : _activation_type(activation_type)
+    {
+    }
+
+    void IndexedGemm::operator()(const StorageView& a,
+                                 const StorageView& b,
+                                 const StorageView& index,
+                                 StorageView& c,
+                                 const StorageView* a_shift_compensation,
+                                 const StorageView* bias) const {
+      PROFILE("IndexedGemm");
+
+      if (a.device() != Device::CPU)
+        throw std::invalid_argument("IndexedGemm currently only supports CPU execution");
+      if (a.dtype() != b.dtype())
+        throw std::invalid_argument("IndexedGemm: the input and weight types should match");
+      if (index.dtype() != DataType::INT32)
+        throw std::invalid_argument("IndexedGemm: the index should be int32");
+
+      const dim_t k = a.dim(-1);
+      const dim_t n = index.size();
+      const dim_t m = a.size() / k;
+
+      if (b.dim(-1) != k)
+        throw std::invalid_argument("IndexedGemm: the weight has "
+                                    + std::to_string(b.dim(-1))
+                                    + " input features but the input has "
+                                    + std::to_string(k));
+
+      Shape output_shape(a.shape());
+      output_shape.back() = n;
+
+      const auto* index_data = index.data<int32_t>();
+
+      switch (a.dtype()) {
+      case DataType::FLOAT32: {
+        c.resize(std::move(output_shape));
+        const auto* a_data = a.data<float>();
+        const auto* b_data = b.data<float>();
+        auto* c_data = c.data<float>();
+
+        if (m <= max_rows_for_indexed_kernel) {
+          CPU_ISA_DISPATCH((cpu::gemm_indexed<ISA>(a_data, b_data, index_data, c_data,
+                                                   m, n, k)));
+        } else {
+          indexed_gemm_by_blocks<float, float>(a_data, b_data, index_data, c_data,
+                                               m, n, k, nullptr);
+        }
+
+        apply_bias_and_activation(c, bias, _activation_type);
+        break;
+      }
+
+      case DataType::INT8: {
+        if (bias || _activation_type)
+          throw std::invalid_argument("IndexedGemm: bias and activation are not supported "
+                                      "with int8 inputs");
+
+        c.resize(std::move(output_shape));
+        const auto* a_data = a.data<int8_t>();
+        const auto* b_data = b.data<int8_t>();
+        const auto* compensation = (a_shift_compensation
+                                    ? a_shift_compensation->data<int32_t>()
+                                    : nullptr);
+        auto* c_data = c.data<int32_t>();
+
+        if (m <= max_rows_for_indexed_kernel) {
+          CPU_ISA_DISPATCH((cpu::gemm_indexed_s8<ISA>(a_data,
+                                                      /*a_is_shifted=*/bool(compensation),
+                                                      b_data,
+                                                      index_data,
+                                                      c_data,
+                                                      m, n, k,
+                                                      compensation)));
+        } else {
+          indexed_gemm_by_blocks<int8_t, int32_t>(a_data, b_data, index_data, c_data,
+                                                  m, n, k, compensation);
+        }
+        break;
+      }
+
+      default:
+        throw std::invalid_argument("IndexedGemm: unsupported type "
+                                    + dtype_name(a.dtype()));
+      }
+    }
+
+  }
+}
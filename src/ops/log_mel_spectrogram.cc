@@ -0,0 +1,219 @@
+#include "ctranslate2/ops/log_mel_spectrogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "ctranslate2/primitives.h"
+
+#include "cpu/parallel.h"
+
+namespace ctranslate2 {
+  namespace ops {
+
+    // Number of frames transformed by each GEMM.
+    constexpr dim_t frames_block_size = 1024;
+
+    static double hz_to_mel(const double frequency) {
+      // Slaney scale: linear below 1 kHz and logarithmic above.
+      constexpr double f_sp = 200.0 / 3.0;
+      constexpr double min_log_hz = 1000.0;
+      constexpr double min_log_mel = min_log_hz / f_sp;
+      static const double log_step = std::log(6.4) / 27.0;
+
+      if (frequency >= min_log_hz)
+        return min_log_mel + std::log(frequency / min_log_hz) / log_step;
+      return frequency / f_sp;
+    }
+
+    static double mel_to_hz(const double mel) {
+      constexpr double f_sp = 200.0 / 3.0;
+      constexpr double min_log_hz = 1000.0;
+      constexpr double min_log_mel = min_log_hz / f_sp;
+      static const double log_step = std::log(6.4) / 27.0;
+
+      if (mel >= min_log_mel)
+        return min_log_hz * std::exp(log_step * (mel - min_log_mel));
+      return mel * f_sp;
+    }
+
+    static std::vector<float> make_mel_filters(const dim_t num_mels,
+                                               const dim_t n_fft,
+                                               const dim_t sample_rate) {
+      // Same filterbank as librosa.filters.mel with the default Slaney normalization.
+      const dim_t num_bins = n_fft / 2 + 1;
+      const double max_mel = hz_to_mel(sample_rate / 2.0);
+
+      std::vector<double> mel_frequencies(num_mels + 2);
+      for (dim_t i = 0; i < num_mels + 2; ++i)
+        mel_frequencies[i] = mel_to_hz(max_mel * i / (num_mels + 1));
+
+      std::vector<float> filters(num_mels * num_bins);
+
+      for (dim_t i = 0; i < num_mels; ++i) {
+        const double lower_width = mel_frequencies[i + 1] - mel_frequencies[i];
+        const double upper_width = mel_frequencies[i + 2] - mel_frequencies[i + 1];
+        const double norm = 2.0 / (mel_frequencies[i + 2] - mel_frequencies[i]);
+
+        for (dim_t k = 0; k < num_bins; ++k) {
+          const double frequency = double(k) * sample_rate / n_fft;
+          const double lower = (frequency - mel_frequencies[i]) / lower_width;
+          const double upper = (mel_frequencies[i + 2] - frequency) / upper_width;
+          filters[i * num_bins + k] = std::max(0.0, std::min(lower, upper)) * norm;
+        }
+      }
+
+      return filters;
+    }
+
+    static std::vector<float> make_dft_basis(const dim_t n_fft) {
+      // The real and imaginary parts are concatenated on the last dimension and the
+      // periodic Hann window is applied to the basis.
+      const dim_t num_bins = n_fft / 2 + 1;
+      const double pi = std::acos(-1.0);
+      std::vector<float> basis(n_fft * 2 * num_bins);
+
+      for (dim_t n = 0; n < n_fft; ++n) {
+        const double window = 0.5 - 0.5 * std::cos(2.0 * pi * n / n_fft);
+
+        for (dim_t k = 0; k < num_bins; ++k) {
+          // Reduce the angle modulo n_fft to keep the basis accurate for large indices.
+          const double angle = 2.0 * pi * ((n * k) % n_fft) / n_fft;
+          basis[n * 2 * num_bins + k] = window * std::cos(angle);
+          basis[n * 2 * num_bins + num_bins + k] = -window * std::sin(angle);
+        }
+      }
+
+      return basis;
+    }
+
+    LogMelSpectrogram::LogMelSpectrogram(const dim_t num_mels,
+                                         const dim_t n_fft,
+                                         const dim_t hop_length,
+                                         const dim_t sample_rate)
+      : _num_mels(num_mels)
+      , _n_fft(n_fft)
+      , _hop_length(hop_length)
+      , _num_bins(n_fft / 2 + 1)
+      , _dft_basis(make_dft_basis(n_fft))
+      , _mel_filters(make_mel_filters(num_mels, n_fft, sample_rate))
+    {
+    }
+
+    void LogMelSpectrogram::operator()(const StorageView& audio, StorageView& features) const {
+      PROFILE("LogMelSpectrogram");
+
+      if (audio.device() != Device::CPU)
+        throw std::invalid_argument("LogMelSpectrogram currently only supports CPU execution");
+      if (audio.dtype() != DataType::FLOAT32)
+        throw std::invalid_argument("LogMelSpectrogram expects float32 audio samples");
+      if (audio.rank() != 2)
+        throw std::invalid_argument("LogMelSpectrogram expects audio with shape "
+                                    "[batch_size, num_samples]");
+
+      const dim_t batch_size = audio.dim(0);
+      const dim_t num_samples = audio.dim(1);
+      const dim_t padding = _n_fft / 2;
+      const dim_t num_frames = num_samples / _hop_length;
+
+      if (num_samples <= padding)
+        throw std::invalid_argument("LogMelSpectrogram expects more than "
+                                    + std::to_string(padding)
+                                    + " audio samples, but got "
+                                    + std::to_string(num_samples));
+
+      features.resize({batch_size, _num_mels, num_frames});
+      if (num_frames == 0)
+        return;
+
+      // The signal is padded by reflection as torch.stft with center=True. The last frame
+      // is dropped as in Whisper.
+      const dim_t padded_size = (num_frames - 1) * _hop_length + _n_fft;
+      std::vector<float> signal(padded_size);
+      std::vector<float> frames(num_frames * _num_mels);
+
+      for (dim_t b = 0; b < batch_size; ++b) {
+        const float* samples = audio.data<float>() + b * num_samples;
+
+        for (dim_t i = 0; i < padded_size; ++i) {
+          dim_t index = std::abs(i - padding);
+          if (index >= num_samples)
+            index = 2 * (num_samples - 1) - index;
+          signal[i] = samples[index];
+        }
+
+        compute_frames(signal.data(), num_frames, frames.data());
+
+        float* output = features.data<float>() + b * _num_mels * num_frames;
+        const dim_t dims[2] = {num_frames, _num_mels};
+        primitives<Device::CPU>::transpose_2d(frames.data(), dims, output);
+        normalize(output, _num_mels * num_frames);
+      }
+    }
+
+    void LogMelSpectrogram::compute_frames(const float* signal,
+                                           const dim_t num_frames,
+                                           float* output) const {
+      const dim_t block_size = std::min(num_frames, frames_block_size);
+      const dim_t spectrum_size = 2 * _num_bins;
+      std::vector<float> frames(block_size * _n_fft);
+      std::vector<float> spectrum(block_size * spectrum_size);
+      std::vector<float> power(block_size * _num_bins);
+
+      for (dim_t begin = 0; begin < num_frames; begin += block_size) {
+        const dim_t size = std::min(block_size, num_frames - begin);
+        float* mel = output + begin * _num_mels;
+
+        // The frames overlap so they are copied to a contiguous matrix.
+        const dim_t copies_per_thread = cpu::get_minimum_batch_copies_per_thread<float>(_n_fft);
+        cpu::parallel_for(0, size, copies_per_thread, [&](dim_t frame_begin, dim_t frame_end) {
+          for (dim_t t = frame_begin; t < frame_end; ++t)
+            std::copy_n(signal + (begin + t) * _hop_length, _n_fft, frames.data() + t * _n_fft);
+        });
+
+        primitives<Device::CPU>::gemm(false, false,
+                                      false, false,
+                                      size, spectrum_size, _n_fft,
+                                      1.f,
+                                      frames.data(), _n_fft,
+                                      _dft_basis.data(), spectrum_size,
+                                      0.f,
+                                      spectrum.data(), spectrum_size);
+
+        cpu::parallel_for(0, size, cpu::GRAIN_SIZE / _num_bins, [&](dim_t frame_begin,
+                                                                    dim_t frame_end) {
+          for (dim_t t = frame_begin; t < frame_end; ++t) {
+            const float* real = spectrum.data() + t * spectrum_size;
+            const float* imag = real + _num_bins;
+            float* frame_power = power.data() + t * _num_bins;
+            for (dim_t k = 0; k < _num_bins; ++k)
+              frame_power[k] = real[k] * real[k] + imag[k] * imag[k];
+          }
+        });
+
+        primitives<Device::CPU>::gemm(false, false,
+                                      false, true,
+                                      size, _num_mels, _num_bins,
+                                      1.f,
+                                      power.data(), _num_bins,
+                                      _mel_filters.data(), _num_bins,
+                                      0.f,
+                                      mel, _num_mels);
+
+        cpu::parallel_for(0, size * _num_mels, cpu::GRAIN_SIZE / 10, [&](dim_t i_begin, dim_t i_end) {
+          for (dim_t i = i_begin; i < i_end; ++i)
+            mel[i] = std::log10(std::max(mel[i], 1e-10f));
+        });
+      }
+    }
+
+    void LogMelSpectrogram::normalize(float* features, const dim_t size) {
+      if (size == 0)
+        return;
+
+      const float min_value = primitives<Device::CPU>::max(features, size) - 8.f;
+      for (dim_t i = 0; i < size; ++i)
+        features[i] = (std::max(features[i], min_value) + 4.f) / 4.f;
+    }
+
+  }
+}
@@ -0,0 +1,59 @@
+#include "ctranslate2/ops/norm_quantize.h"
+
+#include "cpu/kernels.h"
+
+namespace ctranslate2 {
+  namespace ops {
+
+    NormQuantize::NormQuantize(const float epsilon,
+                               const bool use_residual,
+                               const bool shift_to_uint8,
+                               const bool round_before_cast)
+      : _epsilon(epsilon)
+      , _use_residual(use_residual)
+      , _shift_to_uint8(shift_to_uint8)
+      , _round_before_cast(round_before_cast)
+    {
+    }
+
+    void NormQuantize::operator()(const StorageView* beta,
+                                  const StorageView& gamma,
+                                  const StorageView& input,
+                                  StorageView& output,
+                                  StorageView& scale,
+                                  const StorageView* residual,
+                                  StorageView* sum) const {
+      PROFILE("NormQuantize");
+
+      if (input.device() != Device::CPU)
+        throw std::invalid_argument("NormQuantize currently only supports CPU execution");
+      if (input.dtype() != DataType::FLOAT32 || output.dtype() != DataType::INT8)
+        throw std::invalid_argument("NormQuantize only supports float32 inputs and int8 outputs");
+      if (residual && !sum)
+        throw std::invalid_argument("NormQuantize: an output for the residual sum is required");
+
+      const dim_t depth = input.dim(-1);
+      const dim_t batch_size = input.size() / depth;
+
+      output.resize_as(input);
+      scale.resize({batch_size});
+      if (residual)
+        sum->resize_as(input);
+
+      CPU_ISA_DISPATCH((cpu::norm_quantize_s8<ISA>(input.data<float>(),
+                                                   residual ? residual->data<float>() : nullptr,
+                                                   residual ? sum->data<float>() : nullptr,
+                                                   gamma.data<float>(),
+                                                   beta ? beta->data<float>() : nullptr,
+                                                   output.data<int8_t>(),
+                                                   scale.data<float>(),
+                                                   batch_size,
+                                                   depth,
+                                                   _epsilon,
+                                                   _use_residual,
+                                                   _shift_to_uint8,
+                                                   _round_before_cast)));
+    }
+
+  }
+}
@@ -0,0 +1,111 @@
+#include "ctranslate2/ops/paged_attention.h"
+
+#include <algorithm>
+
+#include "ctranslate2/primitives.h"
+
+#include "cpu/kernels.h"
+#include "cpu/parallel.h"
+
+namespace ctranslate2 {
+  namespace ops {
+
+    PagedAttention::PagedAttention(const float queries_scale)
+      : _queries_scale(queries_scale)
+    {
+    }
+
+    void PagedAttention::operator()(const StorageView& queries,
+                                    const StorageView& key_pages,
+                                    const StorageView& value_pages,
+                                    const StorageView& page_table,
+                                    const dim_t keys_length,
+                                    const StorageView* lengths,
+                                    StorageView& output) const {
+      PROFILE("PagedAttention");
+
+      if (queries.device() != Device::CPU)
+        throw std::invalid_argument("PagedAttention currently only supports CPU execution");
+      if (queries.dtype() != DataType::FLOAT32)
+        throw std::invalid_argument("PagedAttention currently only supports float32 inputs");
+
+      output.resize_as(queries);
+
+      const dim_t batch_size = queries.dim(0);
+      const dim_t head_dim = queries.dim(-1);
+      const dim_t num_rows = queries.size() / (batch_size * head_dim);
+      const dim_t num_heads_kv = key_pages.dim(1);
+      const dim_t page_size = key_pages.dim(2);
+      const dim_t max_pages = page_table.dim(1);
+      const dim_t num_pages = ceil_divide(keys_length, page_size);
+
+      if (num_pages > max_pages)
+        throw std::invalid_argument("The page table does not cover all keys");
+
+      // Rows attending to the same key/value head are contiguous.
+      const dim_t group_size = num_rows / num_heads_kv;
+      const dim_t page_stride = page_size * head_dim;
+
+      const auto* q = queries.data<float>();
+      const auto* k = key_pages.data<float>();
+      const auto* v = value_pages.data<float>();
+      const auto* table = page_table.data<int32_t>();
+      const auto* rows_length = lengths ? lengths->data<int32_t>() : nullptr;
+      auto* o = output.data<float>();
+
+      cpu::parallel_for(0, batch_size * num_heads_kv, 1, [&](dim_t begin, dim_t end) {
+        StorageView scores_storage({group_size, keys_length}, DataType::FLOAT32);
+        auto* scores = scores_storage.data<float>();
+
+        for (dim_t i = begin; i < end; ++i) {
+          const dim_t b = i / num_heads_kv;
+          const dim_t h = i % num_heads_kv;
+          const dim_t offset = i * group_size;
+          const auto* pages = table + b * max_pages;
+
+          // Skip the pages after the longest row of the group (e.g. when the sequences of
+          // the batch are at different decoding positions).
+          const dim_t group_length = (rows_length
+                                      ? *std::max_element(rows_length + offset,
+                                                          rows_length + offset + group_size)
+                                      : keys_length);
+          const dim_t group_pages = std::min(ceil_divide(group_length, page_size), num_pages);
+
+          for (dim_t p = 0; p < group_pages; ++p) {
+            const dim_t size = std::min(page_size, group_length - p * page_size);
+            const auto* page = k + (dim_t(pages[p]) * num_heads_kv + h) * page_stride;
+            primitives<Device::CPU>::gemm(false, false,
+                                          false, true,
+                                          group_size, size, head_dim,
+                                          _queries_scale,
+                                          q + offset * head_dim, head_dim,
+                                          page, head_dim,
+                                          0.f,
+                                          scores + p * page_size, keys_length);
+          }
+
+          CPU_ISA_DISPATCH((cpu::softmax<ISA>(scores,
+                                              rows_length ? rows_length + offset : nullptr,
+                                              scores,
+                                              group_size,
+                                              keys_length,
+                                              /*log=*/false)));
+
+          for (dim_t p = 0; p < group_pages; ++p) {
+            const dim_t size = std::min(page_size, group_length - p * page_size);
+            const auto* page = v + (dim_t(pages[p]) * num_heads_kv + h) * page_stride;
+            primitives<Device::CPU>::gemm(false, false,
+                                          false, false,
+                                          group_size, head_dim, size,
+                                          1.f,
+                                          scores + p * page_size, keys_length,
+                                          page, head_dim,
+                                          p == 0 ? 0.f : 1.f,
+                                          o + offset * head_dim, head_dim);
+          }
+        }
+      });
+    }
+
+  }
+}
@@ -1,168 +1,526 @@
 #include "ctranslate2/profiler.h"
 
-#ifndef CT2_ENABLE_PROFILING
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <spdlog/spdlog.h>
 
-#include <stdexcept>
+#include "env.h"
 
 namespace ctranslate2 {
 
-  void init_profiling(Device, size_t) {
-    throw std::runtime_error("CTranslate2 was not compiled with profiling support, "
-                             "enable it with -DENABLE_PROFILING=ON during cmake configuration.");
-  }
+  constexpr size_t default_trace_buffer_size = 1 << 16;
+  constexpr size_t num_trace_args = 3;
+  static const char* trace_arg_names[num_trace_args] = {"replica", "batch", "step"};
 
-  void dump_profiling(std::ostream&) {
-  }
+  struct ScopeProfile {
+    int64_t time_in_scope = 0;
+    int64_t time_in_scope_and_callees = 0;
+  };
 
-}
+  struct TraceEvent {
+    const char* name;
+    int64_t start;
+    int64_t end;
+    int64_t args[num_trace_args];
+  };
 
-#else
+  // Ring buffer of events written by a single thread. The writer never waits: the readers
+  // discard the events that were possibly overwritten while they were copied.
+  class ThreadTraceBuffer {
+  public:
+    ThreadTraceBuffer(size_t capacity, size_t thread_id)
+      : _events(capacity)
+      , _thread_id(thread_id)
+      , _head(0)
+      , _tail(0)
+      , _retired(false)
+    {
+    }
 
-#include <algorithm>
-#include <iomanip>
-#include <memory>
-#include <mutex>
-#include <vector>
-#include <unordered_map>
+    // Buffer holding the events of a thread that exited. It has one more slot than the
+    // number of events so that none of them is considered overwritten by a pending write.
+    ThreadTraceBuffer(std::vector<TraceEvent> events,
+                      std::unordered_map<const char*, ScopeProfile> profile,
+                      size_t thread_id)
+      : _events(std::move(events))
+      , _profile(std::move(profile))
+      , _thread_id(thread_id)
+      , _head(_events.size())
+      , _tail(0)
+      , _retired(true)
+    {
+      _events.emplace_back();
+    }
 
-namespace ctranslate2 {
+    bool retired() const {
+      return _retired;
+    }
 
-  static void print_as_percentage(std::ostream& os, double ratio) {
-    os << std::right << std::setw(6) << std::fixed << std::setprecision(2)
-       << ratio * 100 << '%';
-  }
+    bool empty() const {
+      return (_head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire)
+              && _profile.empty());
+    }
 
+    size_t thread_id() const {
+      return _thread_id;
+    }
 
-  class ScopeProfile {
-  public:
-    std::chrono::microseconds time_in_scope;
-    std::chrono::microseconds time_in_scope_and_callees;
-  };
+    void push(const TraceEvent& event) {
+      const size_t head = _head.load(std::memory_order_relaxed);
+      _events[head % _events.size()] = event;
+      _head.store(head + 1, std::memory_order_release);
+    }
 
-  class Profiler {
-  private:
-    Device _device;
-    size_t _num_threads;
-    std::chrono::high_resolution_clock::time_point _global_start;
-    std::unordered_map<std::string, ScopeProfile> _cumulated;
-    std::mutex _mutex;
+    // Discards the events recorded so far.
+    void clear() {
+      _tail.store(_head.load(std::memory_order_acquire), std::memory_order_release);
+    }
 
-    ScopeProfile& get_scope_profile(const std::string& name) {
-      auto it = _cumulated.find(name);
-      if (it == _cumulated.end())
-        it = _cumulated.emplace(name, ScopeProfile()).first;
-      return it->second;
+    // The profile is only updated by the thread owning the buffer.
+    void add_profile(const char* name, int64_t elapsed, const char* parent_name) {
+      auto& scope_profile = _profile[name];
+      scope_profile.time_in_scope += elapsed;
+      scope_profile.time_in_scope_and_callees += elapsed;
+      if (parent_name)
+        _profile[parent_name].time_in_scope -= elapsed;
+    }
+
+    std::unordered_map<const char*, ScopeProfile> release_profile() {
+      return std::move(_profile);
     }
 
+    std::vector<TraceEvent> get_events() const {
+      const size_t capacity = _events.size();
+      const size_t head = _head.load(std::memory_order_acquire);
+      size_t begin = std::max(_tail.load(std::memory_order_acquire),
+                              head > capacity ? head - capacity : 0);
+
+      std::vector<TraceEvent> events;
+      events.reserve(head - begin);
+      for (size_t i = begin; i < head; ++i)
+        events.emplace_back(_events[i % capacity]);
+
+      // Remove the events that were overwritten during the copy. The writer overwrites the
+      // slot of index new_head - capacity before it increments the head, so this event is
+      // possibly being overwritten as well.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      const size_t new_head = _head.load(std::memory_order_relaxed);
+      const size_t first_valid = new_head + 1 > capacity ? new_head + 1 - capacity : 0;
+      if (first_valid > begin) {
+        const size_t num_overwritten = std::min(first_valid - begin, events.size());
+        events.erase(events.begin(), events.begin() + num_overwritten);
+      }
+
+      return events;
+    }
+
+  private:
+    std::vector<TraceEvent> _events;
+    std::unordered_map<const char*, ScopeProfile> _profile;
+    const size_t _thread_id;
+    std::atomic<size_t> _head;
+    std::atomic<size_t> _tail;
+    const bool _retired;
+  };
+
+  class Tracer {
   public:
-    Profiler(Device device, size_t num_threads)
-      : _device(device)
-      , _num_threads(num_threads)
-      , _global_start(std::chrono::high_resolution_clock::now()) {
+    Tracer()
+      : _enabled(false)
+      , _profiling(false)
+      , _device(Device::CPU)
+      , _buffer_size(default_trace_buffer_size)
+      , _epoch(std::chrono::steady_clock::now())
+      , _start_time(0)
+      , _next_batch_id(0)
+      , _next_thread_id(0)
+    {
+    }
+
+    bool enabled() const {
+      return _enabled.load(std::memory_order_relaxed);
+    }
+
+    bool profiling() const {
+      return _profiling.load(std::memory_order_relaxed);
+    }
+
+    void set_profiling(bool profiling) {
+      _profiling.store(profiling, std::memory_order_relaxed);
     }
 
     Device device() const {
       return _device;
     }
 
-    void add_scope_time(const std::string& name,
-                        const std::chrono::microseconds& elapsed,
-                        const std::string* parent_name) {
-      std::lock_guard<std::mutex> lock(_mutex);
-      auto& scope_profile = get_scope_profile(name);
-      scope_profile.time_in_scope += elapsed;
-      scope_profile.time_in_scope_and_callees += elapsed;
-      if (parent_name) {
-        auto& parent_scope_profile = get_scope_profile(*parent_name);
-        parent_scope_profile.time_in_scope -= elapsed;
-      }
+    int64_t now() const {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - _epoch).count();
     }
 
-    void dump(std::ostream& os) const {
-      if (_cumulated.empty())
-        return;
+    void start(Device device, size_t buffer_size) {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      _device = device;
+      _buffer_size = buffer_size > 0 ? buffer_size : default_trace_buffer_size;
+      _start_time = now();
+      // The events of the threads that exited are no longer needed.
+      _buffers.erase(std::remove_if(_buffers.begin(), _buffers.end(),
+                                    [](const std::shared_ptr<ThreadTraceBuffer>& buffer) {
+                                      return buffer->retired();
+                                    }),
+                     _buffers.end());
+      for (auto& buffer : _buffers)
+        buffer->clear();
+      _enabled.store(true, std::memory_order_relaxed);
+    }
+
+    void stop() {
+      _enabled.store(false, std::memory_order_relaxed);
+    }
+
+    int64_t start_time() const {
+      return _start_time;
+    }
+
+    int64_t new_batch_id() {
+      return _next_batch_id.fetch_add(1, std::memory_order_relaxed);
+    }
 
-      auto total_time = std::chrono::duration_cast<std::chrono::microseconds>(
-        std::chrono::high_resolution_clock::now() - _global_start);
-      total_time *= _num_threads;
-
-      // Sort from largest to smallest accumulated time.
-      std::vector<std::pair<std::string, ScopeProfile>> sorted_cumulated(_cumulated.begin(),
-                                                                         _cumulated.end());
-      std::sort(sorted_cumulated.begin(), sorted_cumulated.end(),
-                [] (const std::pair<std::string, ScopeProfile>& a,
-                    const std::pair<std::string, ScopeProfile>& b) {
-                  return a.second.time_in_scope > b.second.time_in_scope;
-                });
-
-      // Get the longest profiler name to pretty print the output.
-      size_t longest_name = 0;
-      for (const auto& pair : sorted_cumulated)
-        longest_name = std::max(longest_name, pair.first.length());
-
-      double total_time_us = total_time.count();
-      double ratio_printed_so_far = 0;
-      for (const auto& pair : sorted_cumulated) {
-        const auto& name = pair.first;
-        const auto& result = pair.second;
-
-        double time_in_scope_us = result.time_in_scope.count();
-        double time_in_scope_and_callees_us = result.time_in_scope_and_callees.count();
-        double time_in_scope_ratio = time_in_scope_us / total_time_us;
-        double time_in_scope_and_callees_ratio = time_in_scope_and_callees_us / total_time_us;
-        ratio_printed_so_far += time_in_scope_ratio;
-
-        print_as_percentage(os, time_in_scope_ratio);
-        os << ' ';
-        print_as_percentage(os, time_in_scope_and_callees_ratio);
-        os << ' ';
-        print_as_percentage(os, ratio_printed_so_far);
-        os << ' ' << std::left << std::setw(longest_name) << name
-           << ' ' << (time_in_scope_us / 1000) << "ms"
-           << std::endl;
+    // Returns nullptr when the thread is exiting and its buffer was already released.
+    ThreadTraceBuffer* get_thread_buffer() {
+      if (ThreadBufferOwner::released)
+        return nullptr;
+      static thread_local ThreadBufferOwner owner;
+      if (!owner.buffer) {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        _buffers.emplace_back(std::make_shared<ThreadTraceBuffer>(_buffer_size, _next_thread_id++));
+        owner.buffer = _buffers.back().get();
       }
+      return owner.buffer;
     }
-  };
 
+    std::vector<std::shared_ptr<ThreadTraceBuffer>> get_buffers() {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      return _buffers;
+    }
 
-  static std::unique_ptr<Profiler> profiler;
+  private:
+    // Releases the ring buffer of the thread when it exits. The events recorded by the thread
+    // are moved to a buffer of their size so that they can still be dumped.
+    struct ThreadBufferOwner {
+      ~ThreadBufferOwner();
+
+      ThreadTraceBuffer* buffer = nullptr;
+      static thread_local bool released;
+    };
+
+    void release_thread_buffer(ThreadTraceBuffer* buffer) {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      auto it = std::find_if(_buffers.begin(), _buffers.end(),
+                             [buffer](const std::shared_ptr<ThreadTraceBuffer>& other) {
+                               return other.get() == buffer;
+                             });
+      if (it == _buffers.end())
+        return;
+      if (buffer->empty())
+        _buffers.erase(it);
+      else
+        *it = std::make_shared<ThreadTraceBuffer>(buffer->get_events(),
+                                                  buffer->release_profile(),
+                                                  buffer->thread_id());
+    }
 
+    std::atomic<bool> _enabled;
+    std::atomic<bool> _profiling;
+    Device _device;
+    size_t _buffer_size;
+    const std::chrono::steady_clock::time_point _epoch;
+    std::atomic<int64_t> _start_time;
+    std::atomic<int64_t> _next_batch_id;
+    size_t _next_thread_id;
+    std::mutex _mutex;
+    std::vector<std::shared_ptr<ThreadTraceBuffer>> _buffers;
+  };
 
-  void init_profiling(Device device, size_t num_threads) {
-    profiler = std::make_unique<Profiler>(device, num_threads);
+  static Tracer& get_tracer() {
+    static Tracer tracer;
+    return tracer;
   }
 
-  void dump_profiling(std::ostream& os) {
-    if (profiler) {
-      profiler->dump(os);
-      profiler.reset();
-    }
+  thread_local bool Tracer::ThreadBufferOwner::released = false;
+
+  Tracer::ThreadBufferOwner::~ThreadBufferOwner() {
+    released = true;
+    if (buffer)
+      get_tracer().release_thread_buffer(buffer);
   }
 
+  static thread_local int64_t thread_trace_args[num_trace_args] = {-1, -1, -1};
 
   // Track active scope in the current thread.
-  static thread_local ScopeProfiler* current_scope = nullptr;
+  static thread_local TraceScope* current_scope = nullptr;
+
+  static void record_event(const char* name, int64_t start, int64_t end) {
+    TraceEvent event;
+    event.name = name;
+    event.start = start;
+    event.end = end;
+    std::copy(thread_trace_args, thread_trace_args + num_trace_args, event.args);
+    ThreadTraceBuffer* buffer = get_tracer().get_thread_buffer();
+    if (buffer)
+      buffer->push(event);
+  }
+
 
-  ScopeProfiler::ScopeProfiler(const std::string& name) {
-    if (!profiler)
+  TraceScope::TraceScope(const char* name)
+    : _name(nullptr)
+    , _start(0)
+    , _parent(nullptr)
+  {
+    auto& tracer = get_tracer();
+    if (!tracer.enabled())
       return;
-    _parent = current_scope;
+    synchronize_stream(tracer.device());
     _name = name;
-    synchronize_stream(profiler->device());
-    _start = std::chrono::high_resolution_clock::now();
+    _parent = current_scope;
     current_scope = this;
+    _start = tracer.now();
   }
 
-  ScopeProfiler::~ScopeProfiler() {
-    if (!profiler)
+  TraceScope::~TraceScope() {
+    if (!_name)
       return;
-    synchronize_stream(profiler->device());
-    auto diff = std::chrono::high_resolution_clock::now() - _start;
-    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(diff);
-    profiler->add_scope_time(_name, elapsed, _parent ? &_parent->_name : nullptr);
     current_scope = _parent;
+    auto& tracer = get_tracer();
+    // The tracing may have been stopped while the scope was open.
+    if (!tracer.enabled())
+      return;
+    synchronize_stream(tracer.device());
+    const int64_t end = tracer.now();
+    record_event(_name, _start, end);
+    ThreadTraceBuffer* buffer = tracer.get_thread_buffer();
+    if (buffer && tracer.profiling())
+      buffer->add_profile(_name, end - _start, _parent ? _parent->_name : nullptr);
   }
 
-}
+  void set_trace_arg(TraceArg arg, int64_t value) {
+    thread_trace_args[static_cast<size_t>(arg)] = value;
+  }
+
+  TraceArgScope::TraceArgScope(TraceArg arg, int64_t value)
+    : _arg(arg)
+    , _previous(thread_trace_args[static_cast<size_t>(arg)])
+  {
+    set_trace_arg(_arg, value);
+  }
+
+  TraceArgScope::~TraceArgScope() {
+    set_trace_arg(_arg, _previous);
+  }
+
+  void start_tracing(Device device, size_t buffer_size) {
+    get_tracer().start(device, buffer_size);
+  }
+
+  void stop_tracing() {
+    get_tracer().stop();
+  }
+
+  bool is_tracing_enabled() {
+    return get_tracer().enabled();
+  }
+
+  int64_t get_trace_time() {
+    return get_tracer().now();
+  }
+
+  void add_trace_event(const char* name, int64_t start, int64_t end) {
+    if (get_tracer().enabled())
+      record_event(name, start, end);
+  }
+
+  int64_t new_trace_batch_id() {
+    return get_tracer().new_batch_id();
+  }
+
+  static void write_json_string(std::ostream& os, const char* str) {
+    os << '"';
+    for (; *str; ++str) {
+      if (*str == '"' || *str == '\\')
+        os << '\\';
+      os << *str;
+    }
+    os << '"';
+  }
+
+  static void write_trace_time(std::ostream& os, int64_t time) {
+    // The Chrome trace format uses microseconds.
+    os << time / 1000 << '.' << std::setw(3) << std::setfill('0') << time % 1000
+       << std::setfill(' ');
+  }
+
+  void dump_trace(std::ostream& os) {
+    auto& tracer = get_tracer();
+    const int64_t start_time = tracer.start_time();
+    bool first = true;
+
+    os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+    for (const auto& buffer : tracer.get_buffers()) {
+      const auto events = buffer->get_events();
+      if (events.empty())
+        continue;
+
+      os << (first ? "\n" : ",\n");
+      first = false;
+      os << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":" << buffer->thread_id()
+         << ",\"args\":{\"name\":\"thread " << buffer->thread_id() << "\"}}";
+
+      for (const auto& event : events) {
+        if (event.start < start_time)
+          continue;
+
+        os << ",\n{\"ph\":\"X\",\"cat\":\"ctranslate2\",\"name\":";
+        write_json_string(os, event.name);
+        os << ",\"pid\":0,\"tid\":" << buffer->thread_id() << ",\"ts\":";
+        write_trace_time(os, event.start - start_time);
+        os << ",\"dur\":";
+        write_trace_time(os, event.end - event.start);
+        os << ",\"args\":{";
+        bool first_arg = true;
+        for (size_t i = 0; i < num_trace_args; ++i) {
+          if (event.args[i] < 0)
+            continue;
+          if (!first_arg)
+            os << ',';
+          first_arg = false;
+          os << '"' << trace_arg_names[i] << "\":" << event.args[i];
+        }
+        os << "}}";
+      }
+    }
+
+    os << "\n]}" << std::endl;
+  }
 
-#endif
+
+  // When CT2_TRACE_FILE is set, tracing is enabled on load and the trace is written on exit.
+  class TraceFileWriter {
+  public:
+    TraceFileWriter()
+      : _path(read_string_from_env("CT2_TRACE_FILE"))
+    {
+      // Construct the tracer first so that it is destroyed after the writer.
+      get_tracer();
+      if (_path.empty())
+        return;
+      start_tracing(Device::CPU, std::max(read_int_from_env("CT2_TRACE_BUFFER_SIZE", 0), 0));
+    }
+
+    ~TraceFileWriter() {
+      if (_path.empty())
+        return;
+      stop_tracing();
+      std::ofstream file(_path);
+      if (!file) {
+        spdlog::warn("Unable to write the trace file {}", _path);
+        return;
+      }
+      dump_trace(file);
+    }
+
+  private:
+    const std::string _path;
+  };
+
+  static TraceFileWriter trace_file_writer;
+
+
+  static void print_as_percentage(std::ostream& os, double ratio) {
+    os << std::right << std::setw(6) << std::fixed << std::setprecision(2)
+       << ratio * 100 << '%';
+  }
+
+  static size_t profiling_num_threads = 0;
+  static int64_t profiling_start_time = 0;
+
+  void init_profiling(Device device, size_t num_threads) {
+    auto& tracer = get_tracer();
+    for (auto& buffer : tracer.get_buffers())
+      buffer->release_profile();
+    profiling_num_threads = num_threads;
+    profiling_start_time = tracer.now();
+    tracer.set_profiling(true);
+    start_tracing(device);
+  }
+
+  void dump_profiling(std::ostream& os) {
+    if (profiling_num_threads == 0)
+      return;
+
+    auto& tracer = get_tracer();
+    stop_tracing();
+    tracer.set_profiling(false);
+    const int64_t total_time = (tracer.now() - profiling_start_time) * profiling_num_threads;
+    profiling_num_threads = 0;
+
+    // Scopes with the same name are accumulated, including scopes from different threads.
+    std::unordered_map<std::string, ScopeProfile> cumulated;
+    for (auto& buffer : tracer.get_buffers()) {
+      for (const auto& pair : buffer->release_profile()) {
+        auto& scope_profile = cumulated[pair.first];
+        scope_profile.time_in_scope += pair.second.time_in_scope;
+        scope_profile.time_in_scope_and_callees += pair.second.time_in_scope_and_callees;
+      }
+    }
+
+    if (cumulated.empty())
+      return;
+
+    // Sort from largest to smallest accumulated time.
+    std::vector<std::pair<std::string, ScopeProfile>> sorted_cumulated(cumulated.begin(),
+                                                                       cumulated.end());
+    std::sort(sorted_cumulated.begin(), sorted_cumulated.end(),
+              [] (const std::pair<std::string, ScopeProfile>& a,
+                  const std::pair<std::string, ScopeProfile>& b) {
+                return a.second.time_in_scope > b.second.time_in_scope;
+              });
+
+    // Get the longest profiler name to pretty print the output.
+    size_t longest_name = 0;
+    for (const auto& pair : sorted_cumulated)
+      longest_name = std::max(longest_name, pair.first.length());
+
+    const double total_time_ns = total_time;
+    double ratio_printed_so_far = 0;
+    for (const auto& pair : sorted_cumulated) {
+      const auto& name = pair.first;
+      const auto& result = pair.second;
+
+      double time_in_scope_ns = result.time_in_scope;
+      double time_in_scope_and_callees_ns = result.time_in_scope_and_callees;
+      double time_in_scope_ratio = time_in_scope_ns / total_time_ns;
+      double time_in_scope_and_callees_ratio = time_in_scope_and_callees_ns / total_time_ns;
+      ratio_printed_so_far += time_in_scope_ratio;
+
+      print_as_percentage(os, time_in_scope_ratio);
+      os << ' ';
+      print_as_percentage(os, time_in_scope_and_callees_ratio);
+      os << ' ';
+      print_as_percentage(os, ratio_printed_so_far);
+      os << ' ' << std::left << std::setw(longest_name) << name
+         << ' ' << (time_in_scope_ns / 1000000) << "ms"
+         << std::endl;
+    }
+  }
+
+}
@@ -0,0 +1,29 @@
+#include "ctranslate2/scheduling.h"
+
+namespace ctranslate2 {
+
+  void SchedulingOptions::check() const {
+    if (is_cancelled())
+      throw RequestCancelled("The request was cancelled");
+    if (is_expired())
+      throw RequestCancelled("The request deadline was reached");
+  }
+
+  static thread_local const SchedulingOptions* current_options = nullptr;
+
+  SchedulingScope::SchedulingScope(const SchedulingOptions& options)
+    : _previous(current_options)
+  {
+    current_options = &options;
+  }
+
+  SchedulingScope::~SchedulingScope() {
+    current_options = _previous;
+  }
+
+  void check_request_cancelled() {
+    if (current_options)
+      current_options->check();
+  }
+
+}
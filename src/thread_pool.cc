@@ -1,5 +1,7 @@
 #include "ctranslate2/thread_pool.h"
 
+#include <algorithm>
+
 #include "ctranslate2/utils.h"
 
 namespace ctranslate2 {
@@ -15,6 +17,14 @@ namespace ctranslate2 {
   }
 
 
+  bool JobQueue::QueuedJob::operator<(const QueuedJob& other) const {
+    if (priority != other.priority)
+      return priority < other.priority;
+    if (deadline != other.deadline)
+      return deadline > other.deadline;
+    return index > other.index;
+  }
+
   JobQueue::JobQueue(size_t maximum_size)
     : _maximum_size(maximum_size)
     , _request_end(false)
@@ -38,7 +48,14 @@ namespace ctranslate2 {
     std::unique_lock<std::mutex> lock(_mutex);
     _can_put_job.wait(lock, [this]{ return _queue.size() < _maximum_size; });
 
-    _queue.emplace(std::move(job));
+    QueuedJob queued_job;
+    queued_job.priority = job->priority();
+    queued_job.deadline = job->deadline();
+    queued_job.index = _num_put_jobs++;
+    queued_job.job = std::move(job);
+
+    _queue.emplace_back(std::move(queued_job));
+    std::push_heap(_queue.begin(), _queue.end());
     lock.unlock();
     _can_get_job.notify_one();
   }
@@ -53,8 +70,9 @@ namespace ctranslate2 {
     }
 
     if (!_queue.empty()) {
-      auto job = std::move(_queue.front());
-      _queue.pop();
+      std::pop_heap(_queue.begin(), _queue.end());
+      auto job = std::move(_queue.back().job);
+      _queue.pop_back();
       lock.unlock();
       _can_put_job.notify_one();
       return job;
@@ -18,13 +18,55 @@ namespace ctranslate2 {
                                     const TranslationOptions& options,
                                     const size_t max_batch_size,
                                     const BatchType batch_type) {
+    if (use_continuous_batching())
+      return post_continuous_examples<TranslationResult>(
+        load_examples({source, target_prefix}),
+        options,
+        _translation_requests,
+        [](models::SequenceToSequenceReplica& model,
+           RequestQueue<models::TranslationRequest>& queue,
+           size_t max_batch_size) {
+          model.translate_continuous(queue, max_batch_size);
+        });
+
     return post_examples<TranslationResult>(
       load_examples({source, target_prefix}),
       max_batch_size,
       batch_type,
+      std::max(options.beam_size, options.num_hypotheses),
       [options](models::SequenceToSequenceReplica& model, const Batch& batch) {
         return run_translation(model, batch, options);
-      });
+      },
+      options.scheduling);
+  }
+
+  std::shared_ptr<GenerationStream>
+  Translator::generate_tokens(const std::vector<std::string>& source,
+                              const std::vector<std::string>& target_prefix,
+                              TranslationOptions options,
+                              const size_t stream_capacity) {
+    auto stream = std::make_shared<GenerationStream>(stream_capacity);
+    auto producer = std::make_shared<GenerationStreamProducer>(stream);
+    options.callback = producer->make_callback(std::move(options.callback));
+
+    std::vector<std::vector<std::string>> target_prefixes;
+    if (!target_prefix.empty())
+      target_prefixes.emplace_back(target_prefix);
+
+    // The stream is finished by the producer, so continuous batching is not used.
+    post_examples<TranslationResult>(
+      load_examples({{source}, std::move(target_prefixes)}),
+      /*max_batch_size=*/0,
+      BatchType::Examples,
+      std::max(options.beam_size, options.num_hypotheses),
+      [options, producer](models::SequenceToSequenceReplica& model, const Batch& batch) {
+        return producer->run([&] {
+          return run_translation(model, batch, options);
+        });
+      },
+      options.scheduling);
+
+    return GenerationStream::make_consumer_handle(stream);
   }
 
   std::vector<std::future<ScoringResult>>
@@ -37,6 +79,7 @@ namespace ctranslate2 {
       load_examples({source, target}),
       max_batch_size,
       batch_type,
+      /*beam_size=*/1,
       [options](models::SequenceToSequenceReplica& model, const Batch& batch) {
         return run_scoring(model, batch, options);
       });
@@ -32,12 +32,14 @@ namespace ctranslate2 {
       return;
 
 #if defined(CT2_X86_BUILD)
-    spdlog::info("CPU: {} (SSE4.1={}, AVX={}, AVX2={}, AVX512={})",
+    spdlog::info("CPU: {} (SSE4.1={}, AVX={}, AVX2={}, AVX512={}, AVX512_VNNI={}, AMX={})",
                  cpu::cpu_vendor(),
                  cpu::cpu_supports_sse41(),
                  cpu::cpu_supports_avx(),
                  cpu::cpu_supports_avx2(),
-                 cpu::cpu_supports_avx512());
+                 cpu::cpu_supports_avx512(),
+                 cpu::cpu_supports_avx512_vnni(),
+                 cpu::cpu_supports_amx());
 #elif defined(CT2_ARM64_BUILD)
     spdlog::info("CPU: {} (NEON={})",
                  cpu::cpu_vendor(),
@@ -55,6 +57,7 @@ namespace ctranslate2 {
                  cpu::gemm_backend_to_str(cpu::get_gemm_backend(ComputeType::INT8)),
                  cpu::pack_gemm_weights(ComputeType::INT8),
                  cpu::prefer_u8s8s32_gemm());
+    spdlog::info(" - Use AMX: {} (BF16 GEMM: {})", cpu::mayiuse_amx(), cpu::use_bf16_gemm());
 
 #ifdef CT2_WITH_CUDA
     for (int i = 0; i < cuda::get_gpu_count(); ++i) {
@@ -88,9 +91,8 @@ namespace ctranslate2 {
 
 #ifdef _OPENMP
     omp_set_num_threads(num_threads);
-#else
-    cpu::set_num_threads(num_threads);
 #endif
+    cpu::set_num_threads(num_threads);
 
 #ifdef CT2_WITH_RUY
     cpu::get_ruy_context()->set_max_num_threads(num_threads);
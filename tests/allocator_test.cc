@@ -0,0 +1,77 @@
+#include <cstdlib>
+#include <thread>
+
+#include "test_utils.h"
+#include "cpu/caching_allocator.h"
+
+// Counts the blocks allocated and freed by the caching allocator.
+class CountingAllocator : public Allocator {
+public:
+  void* allocate(size_t size, int) override {
+    ++num_allocations;
+    return std::malloc(size);
+  }
+
+  void free(void* ptr, int) override {
+    ++num_frees;
+    std::free(ptr);
+  }
+
+  size_t num_allocations = 0;
+  size_t num_frees = 0;
+};
+
+TEST(AllocatorTest, CachingAllocatorReuse) {
+  CountingAllocator base;
+  cpu::CachingAllocator allocator(base, 64, 2, 6, 10, 1 << 20, 1 << 20);
+
+  void* ptr = allocator.allocate(100, 0);
+  allocator.free(ptr, 0);
+  EXPECT_EQ(allocator.cached_bytes(), 128);
+
+  // A block of the same size class is reused.
+  EXPECT_EQ(allocator.allocate(120, 0), ptr);
+  EXPECT_EQ(base.num_allocations, 1);
+  EXPECT_EQ(allocator.cached_bytes(), 0);
+  allocator.free(ptr, 0);
+
+  // Blocks larger than the largest bin are not cached.
+  allocator.free(allocator.allocate(2048, 0), 0);
+  EXPECT_EQ(base.num_frees, 1);
+
+  allocator.clear_cache();
+  EXPECT_EQ(allocator.cached_bytes(), 0);
+  EXPECT_EQ(base.num_frees, 2);
+}
+
+TEST(AllocatorTest, CachingAllocatorMaxCachedBytes) {
+  CountingAllocator base;
+  cpu::CachingAllocator allocator(base, 64, 2, 6, 10, 256, 384);
+
+  // The thread cache is limited to 256 bytes.
+  void* a = allocator.allocate(128, 0);
+  void* b = allocator.allocate(128, 0);
+  void* c = allocator.allocate(128, 0);
+  allocator.free(a, 0);
+  allocator.free(b, 0);
+  allocator.free(c, 0);
+  EXPECT_EQ(allocator.cached_bytes(), 256);
+  EXPECT_EQ(base.num_frees, 1);
+
+  // All threads together are limited to 384 bytes.
+  std::thread thread([&allocator] {
+    void* d = allocator.allocate(128, 0);
+    void* e = allocator.allocate(128, 0);
+    allocator.free(d, 0);
+    allocator.free(e, 0);
+    EXPECT_EQ(allocator.cached_bytes(), 384);
+  });
+  thread.join();
+
+  // The blocks cached by the thread are released when it exits.
+  EXPECT_EQ(allocator.cached_bytes(), 256);
+  EXPECT_EQ(base.num_frees, 3);
+
+  allocator.clear_cache();
+  EXPECT_EQ(base.num_frees, base.num_allocations);
+}
@@ -36,3 +36,33 @@ TEST(BatchingTest, RebatchInput) {
     EXPECT_EQ(batch.example_index, expected_batches[i]);
   }
 }
+
+TEST(BatchingTest, RebatchInputPaddedTokens) {
+  const std::vector<std::vector<std::string>> source = {
+    {"a", "b"},
+    {"a", "b", "c"},
+    {"a"},
+    {},
+    {"a", "b", "c", "d"},
+    {"a", "b", "c", "d", "e"}
+  };
+
+  const auto get_batches = [&source](size_t max_batch_size, size_t beam_size) {
+    std::vector<std::vector<size_t>> batches;
+    for (const auto& batch : rebatch_input(load_examples({source}),
+                                           max_batch_size,
+                                           BatchType::PaddedTokens,
+                                           beam_size))
+      batches.emplace_back(batch.example_index);
+    return batches;
+  };
+
+  // The batch is split when more than 30% of the positions are padding.
+  EXPECT_EQ(get_batches(100, 1), (std::vector<std::vector<size_t>>{{5, 4, 1, 0}, {2, 3}}));
+
+  // The beam expansion is included in the batch size.
+  EXPECT_EQ(get_batches(20, 2), (std::vector<std::vector<size_t>>{{5, 4}, {1, 0}, {2, 3}}));
+
+  // An example larger than the budget is still returned in its own batch.
+  EXPECT_EQ(get_batches(4, 1).front(), (std::vector<size_t>{5}));
+}
@@ -233,6 +233,210 @@ TEST(LayerTest, PadderIgnore) {
   expect_storage_eq(x, original);
 }
 
+static StorageView make_sequence_data(const Shape& shape, float offset) {
+  StorageView x(shape, DataType::FLOAT32);
+  for (dim_t i = 0; i < x.size(); ++i)
+    x.data<float>()[i] = std::sin(float(i) + offset);
+  return x;
+}
+
+TEST(LayerTest, PagedKVCache) {
+  const dim_t batch_size = 2;
+  const dim_t num_heads = 2;
+  const dim_t head_dim = 3;
+  const dim_t page_size = 2;
+
+  StorageView page_table(DataType::INT32);
+  StorageView lengths(DataType::INT32);
+  StorageView key_pages;
+  StorageView value_pages;
+
+  // Cache 3 time steps with a single key/value head.
+  const StorageView keys = make_sequence_data({batch_size, 1, 3, head_dim}, 0);
+  const StorageView values = make_sequence_data({batch_size, 1, 3, head_dim}, 100);
+  {
+    const layers::PagedKVCache cache(page_table, lengths, 0, batch_size, 3, page_size);
+    EXPECT_TRUE(cache.was_empty());
+    cache.append(keys, key_pages);
+    cache.append(values, value_pages);
+  }
+  ASSERT_EQ(page_table.shape(), Shape({batch_size, 2}));
+  expect_storage_eq(lengths, StorageView({batch_size}, std::vector<int32_t>{3, 3}));
+
+  // Both sequences continue from the first sequence, as in beam search.
+  const StorageView beam_indices({batch_size}, std::vector<int32_t>{0, 0});
+  ops::Gather()(page_table, beam_indices);
+  ops::Gather()(lengths, beam_indices);
+
+  const StorageView new_keys = make_sequence_data({batch_size, 1, 1, head_dim}, 200);
+  const StorageView new_values = make_sequence_data({batch_size, 1, 1, head_dim}, 300);
+  const layers::PagedKVCache cache(page_table, lengths, key_pages.dim(0), batch_size, 1, page_size);
+  EXPECT_FALSE(cache.was_empty());
+  EXPECT_EQ(cache.length(), 4);
+  cache.append(new_keys, key_pages);
+  cache.append(new_values, value_pages);
+
+  // The full page is still shared, but the partial page was copied before being written.
+  EXPECT_EQ(page_table.at<int32_t>({0, 0}), page_table.at<int32_t>({1, 0}));
+  EXPECT_NE(page_table.at<int32_t>({0, 1}), page_table.at<int32_t>({1, 1}));
+
+  // Compare with the attention over the contiguous keys and values.
+  StorageView expected_keys;
+  StorageView expected_values;
+  {
+    StorageView prev_keys;
+    StorageView prev_values;
+    ops::Gather()(keys, beam_indices, prev_keys);
+    ops::Gather()(values, beam_indices, prev_values);
+    ops::Concat(2)({&prev_keys, &new_keys}, expected_keys);
+    ops::Concat(2)({&prev_values, &new_values}, expected_values);
+    ops::Tile(1, num_heads)(expected_keys);
+    ops::Tile(1, num_heads)(expected_values);
+  }
+
+  const float scale = 0.5;
+  const StorageView queries = make_sequence_data({batch_size, num_heads, 1, head_dim}, 400);
+  StorageView scores;
+  StorageView expected;
+  ops::MatMul(false, true, scale)(queries, expected_keys, scores);
+  ops::SoftMax()(scores);
+  ops::MatMul()(scores, expected_values, expected);
+
+  StorageView output;
+  const ops::PagedAttention paged_attention_op(scale);
+  paged_attention_op(queries,
+                     key_pages,
+                     value_pages,
+                     cache.page_table(),
+                     cache.length(),
+                     nullptr,
+                     output);
+  expect_storage_eq(output, expected, 1e-5);
+}
+
+TEST(LayerTest, PrefixCache) {
+  // Each step contains its position in the prompt plus an offset identifying the prompt.
+  const auto get_steps = [](float prompt_offset, dim_t& num_calls) {
+    return [prompt_offset, &num_calls](dim_t begin, dim_t end) {
+      num_calls++;
+      std::vector<float> values;
+      for (dim_t i = begin; i < end; ++i)
+        values.push_back(prompt_offset + i);
+      return layers::DecoderState{{"steps", StorageView({end - begin, 1}, values)}};
+    };
+  };
+
+  const std::vector<size_t> a = {1, 2, 3, 4};
+  const std::vector<size_t> b = {1, 2, 5, 6};
+  const size_t step_size = sizeof (float);
+  dim_t num_calls = 0;
+  size_t length = 0;
+
+  layers::PrefixCache cache(7 * step_size);
+  EXPECT_TRUE(cache.get({a}, 4, length).empty());
+  EXPECT_EQ(length, 0);
+
+  cache.save(a, 4, get_steps(0, num_calls));
+  EXPECT_EQ(cache.size(), 4 * step_size);
+
+  auto steps = cache.get({{1, 2, 3, 9}}, 10, length);
+  EXPECT_EQ(length, 3);
+  ASSERT_EQ(steps.size(), 1);
+  expect_storage_eq(steps[0].at("steps"), StorageView({3, 1}, std::vector<float>{0, 1, 2}));
+
+  // Only the steps after the common prefix are requested, and the shared node is split.
+  num_calls = 0;
+  cache.save(b, 4, get_steps(100, num_calls));
+  EXPECT_EQ(num_calls, 1);
+  EXPECT_EQ(cache.size(), 6 * step_size);
+
+  // The prefix length is the minimum cached length in the batch.
+  steps = cache.get({a, {1, 2, 5, 7}}, 10, length);
+  EXPECT_EQ(length, 3);
+  ASSERT_EQ(steps.size(), 2);
+  expect_storage_eq(steps[0].at("steps"), StorageView({3, 1}, std::vector<float>{0, 1, 2}));
+  expect_storage_eq(steps[1].at("steps"), StorageView({3, 1}, std::vector<float>{0, 1, 102}));
+
+  steps = cache.get({b}, 10, length);
+  EXPECT_EQ(length, 4);
+  expect_storage_eq(steps[0].at("steps"), StorageView({4, 1}, std::vector<float>{0, 1, 102, 103}));
+
+  steps = cache.get({a}, 3, length);
+  EXPECT_EQ(length, 3);
+  expect_storage_eq(steps[0].at("steps"), StorageView({3, 1}, std::vector<float>{0, 1, 2}));
+
+  // Saving a new prompt exceeds the maximum size: the least recently used leaf is evicted.
+  cache.save({7, 8}, 2, get_steps(200, num_calls));
+  EXPECT_EQ(cache.size(), 6 * step_size);
+  cache.get({b}, 10, length);
+  EXPECT_EQ(length, 2);
+  cache.get({a}, 10, length);
+  EXPECT_EQ(length, 4);
+  cache.get({{7, 8}}, 10, length);
+  EXPECT_EQ(length, 2);
+
+  // The steps are built without holding the lock, so other replicas can use the cache in the
+  // meantime. The steps they saved are not inserted twice.
+  layers::PrefixCache shared_cache(10 * step_size);
+  shared_cache.save(a, 4, [&](dim_t begin, dim_t end) {
+    shared_cache.save({1, 2}, 2, get_steps(0, num_calls));
+    return get_steps(0, num_calls)(begin, end);
+  });
+  EXPECT_EQ(shared_cache.size(), 4 * step_size);
+  steps = shared_cache.get({a}, 10, length);
+  EXPECT_EQ(length, 4);
+  expect_storage_eq(steps[0].at("steps"), StorageView({4, 1}, std::vector<float>{0, 1, 2, 3}));
+}
+
+TEST(LayerTest, EncoderCache) {
+  const auto make_key = [](const std::vector<size_t>& ids) {
+    layers::EncoderCache::Key key{};
+    layers::EncoderCache::hash(key, ids.data(), ids.size() * sizeof (size_t));
+    return key;
+  };
+
+  const auto a = make_key({1, 2, 3});
+  const auto b = make_key({1, 2, 4});
+  const auto c = make_key({5});
+  EXPECT_NE(a, b);
+  EXPECT_NE(make_key({}), make_key({0}));
+
+  const size_t step_size = 2 * sizeof (float);
+  layers::EncoderCache cache(4 * step_size);
+  EXPECT_TRUE(cache.enabled());
+  EXPECT_FALSE(layers::EncoderCache(0).enabled());
+  EXPECT_EQ(cache.get(a), nullptr);
+
+  cache.save(a, StorageView({2, 2}, std::vector<float>{1, 2, 3, 4}));
+  cache.save(b, StorageView({1, 2}, std::vector<float>{5, 6}));
+  EXPECT_EQ(cache.size(), 3 * step_size);
+
+  // Outputs larger than the cache are returned but not cached.
+  const auto large = cache.save(c, StorageView({5, 2}, 0.f));
+  EXPECT_EQ(large->dim(0), 5);
+  EXPECT_EQ(cache.get(c), nullptr);
+
+  const auto output_a = cache.get(a);
+  ASSERT_NE(output_a, nullptr);
+  const auto output_b = cache.get(b);
+  ASSERT_NE(output_b, nullptr);
+
+  StorageView batch;
+  StorageView lengths;
+  layers::EncoderCache::stack({output_a, output_b}, 4, batch, &lengths);
+  expect_storage_eq(batch, StorageView({2, 4, 2}, std::vector<float>{
+        1, 2, 3, 4, 0, 0, 0, 0,
+        5, 6, 0, 0, 0, 0, 0, 0}));
+  expect_storage_eq(lengths, StorageView({2}, std::vector<int32_t>{2, 1}));
+
+  // The least recently used output is evicted.
+  cache.save(c, StorageView({2, 2}, 0.f));
+  EXPECT_EQ(cache.size(), 3 * step_size);
+  EXPECT_EQ(cache.get(a), nullptr);
+  EXPECT_NE(cache.get(b), nullptr);
+  EXPECT_NE(cache.get(c), nullptr);
+}
+
 TEST(LayerTest, PositionEncoderNoSharedState) {
   // Test case for issue: http://forum.opennmt.net/t/ctranslate2-c-api-returns-strange-results-when-initializing-2-models/3208
   layers::SinusoidalPositionEncoder position_encoder_1(4);
@@ -1,7 +1,15 @@
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <random>
+
+#include <ctranslate2/models/model_reader.h>
 #include <ctranslate2/models/sequence_to_sequence.h>
+#include <ctranslate2/models/whisper.h>
 
 #include <ctranslate2/decoding.h>
 
+#include "cpu/numa.h"
 #include "test_utils.h"
 
 TEST(ModelTest, ContainsModel) {
@@ -42,6 +50,16 @@ TEST(ModelTest, UpdateDecoderOutputLayer) {
   EXPECT_EQ(decoder.to_original_word_id(2), 2);
   EXPECT_EQ(decoder.to_original_word_id(3), 5);
   EXPECT_EQ(decoder.to_original_word_id(4), 0);
+  EXPECT_EQ(decoder.to_output_word_id(5), 3);
+
+  // Restrict to another selection.
+  decoder.update_output_layer(1, {7, 3});
+  EXPECT_EQ(decoder.output_size(), 2);
+  EXPECT_FALSE(decoder.is_in_output(5));
+  EXPECT_TRUE(decoder.is_in_output(3));
+  EXPECT_EQ(decoder.to_output_word_id(7), 0);
+  EXPECT_EQ(decoder.to_output_word_id(3), 1);
+  EXPECT_THROW(decoder.to_output_word_id(0), std::out_of_range);
 
   // Remove restriction.
   decoder.update_output_layer();
@@ -149,3 +167,485 @@ TEST(ModelTest, DecoderIterativeSequence) {
     expect_storage_eq(state_sequence[key], state_by_step[key], 1e-5);
   }
 }
+
+TEST(ModelTest, DecoderCachedSteps) {
+  auto model = models::Model::load(default_model_dir())->as_sequence_to_sequence();
+  auto& encoder_decoder = dynamic_cast<models::EncoderDecoderReplica&>(*model);
+  auto& decoder = encoder_decoder.decoder();
+
+  StorageView source_ids({2, 6}, std::vector<int32_t>{31, 10, 19, 13, 5, 7,
+                                                      31, 10, 19, 13, 5, 7});
+  StorageView target_ids({2, 3}, std::vector<int32_t>{1, 3, 11, 1, 23, 13});
+  StorageView next_ids({2}, std::vector<int32_t>{23, 7});
+
+  StorageView encoder_output;
+  encoder_decoder.encoder()(source_ids, encoder_output);
+
+  layers::DecoderState state = decoder.initial_state();
+  state.emplace("memory", encoder_output);
+  decoder(0, target_ids, state);
+
+  // Restore the cached steps in a new state, with the batches in reverse order.
+  layers::DecoderState restored_state = decoder.initial_state();
+  decoder.set_cached_steps(restored_state, {decoder.get_cached_steps(state, 1, 0, 3),
+                                            decoder.get_cached_steps(state, 0, 0, 3)});
+  for (auto& [name, value] : restored_state) {
+    if (starts_with(name, "memory"))
+      value = state.at(name);
+  }
+
+  StorageView reversed_next_ids({2}, std::vector<int32_t>{7, 23});
+  StorageView logits;
+  StorageView restored_logits;
+  decoder(3, next_ids, state, &logits);
+  decoder(3, reversed_next_ids, restored_state, &restored_logits);
+
+  StorageView reversed_logits;
+  ops::Gather()(restored_logits, StorageView({2}, std::vector<int32_t>{1, 0}), reversed_logits);
+  expect_storage_eq(reversed_logits, logits, 1e-5);
+
+  // The steps can also be exported partially.
+  const auto steps = decoder.get_cached_steps(state, 0, 1, 4);
+  const auto restored_steps = decoder.get_cached_steps(restored_state, 1, 1, 4);
+  for (const auto& [name, value] : steps) {
+    EXPECT_EQ(value.dim(0), 3);
+    expect_storage_eq(restored_steps.at(name), value, 1e-5);
+  }
+}
+
+TEST(ModelTest, DecoderSourceIndex) {
+  auto model = models::Model::load(default_model_dir())->as_sequence_to_sequence();
+  auto& encoder_decoder = dynamic_cast<models::EncoderDecoderReplica&>(*model);
+  auto& decoder = encoder_decoder.decoder();
+
+  StorageView source_ids({2, 6}, std::vector<int32_t>{31, 10, 19, 13, 5, 7,
+                                                      12, 4, 27, 8, 0, 0});
+  StorageView lengths({2}, std::vector<int32_t>{6, 4});
+  StorageView encoder_output;
+  encoder_decoder.encoder()(source_ids, lengths, encoder_output);
+
+  // The memory is replicated in the first state and indexed in the second state.
+  const dim_t num_hypotheses = 3;
+  layers::DecoderState replicated_state = decoder.initial_state();
+  replicated_state.emplace("memory", encoder_output);
+  replicated_state.emplace("memory_lengths", lengths);
+  for (auto& [name, value] : replicated_state) {
+    if (value)
+      repeat_batch(value, num_hypotheses);
+  }
+
+  layers::DecoderState indexed_state = decoder.initial_state();
+  indexed_state.emplace("memory", encoder_output);
+  indexed_state.emplace("memory_lengths", lengths);
+  decoder.replicate_state(indexed_state, num_hypotheses, /*independent_replicas=*/true);
+  EXPECT_EQ(indexed_state.at("memory").dim(0), 2);
+
+  const std::vector<std::vector<int32_t>> step_ids = {{1, 1, 1, 1, 1, 1}, {3, 11, 23}, {7}};
+  // The hypotheses are removed unevenly, then the first source is no longer used.
+  const std::vector<std::vector<int32_t>> alive_batches = {{0, 2, 3}, {2}};
+
+  for (size_t step = 0; step < step_ids.size(); ++step) {
+    const StorageView ids({dim_t(step_ids[step].size())}, step_ids[step]);
+
+    StorageView replicated_logits;
+    StorageView indexed_logits;
+    decoder(step, ids, replicated_state, &replicated_logits);
+    decoder(step, ids, indexed_state, &indexed_logits);
+    expect_storage_eq(indexed_logits, replicated_logits, 1e-5);
+
+    if (step < alive_batches.size()) {
+      const StorageView alive({dim_t(alive_batches[step].size())}, alive_batches[step]);
+      decoder.update_state(replicated_state, alive);
+      decoder.update_state(indexed_state, alive);
+    }
+  }
+
+  EXPECT_EQ(indexed_state.at("memory_keys_0").dim(0), 1);
+}
+
+TEST(ModelTest, LoadWithMmap) {
+  const auto model = models::Model::load(default_model_dir());
+  const auto mapped_model = models::Model::load(default_model_dir(),
+                                                Device::CPU,
+                                                /*device_index=*/0,
+                                                ComputeType::DEFAULT,
+                                                /*use_flash_attention=*/false,
+                                                /*tensor_parallel=*/false,
+                                                /*use_mmap=*/true);
+
+  const auto variables = model->get_variables();
+  const auto mapped_variables = mapped_model->get_variables();
+  ASSERT_EQ(mapped_variables.size(), variables.size());
+  for (const auto& pair : variables)
+    expect_storage_eq(mapped_variables.at(pair.first), pair.second);
+}
+
+TEST(ModelTest, LoadWithWeightCache) {
+  const auto cache_dir = std::filesystem::temp_directory_path() / "ct2_weight_cache_test";
+  std::filesystem::remove_all(cache_dir);
+  std::filesystem::create_directories(cache_dir);
+
+  // The first load saves the cache and the second load reads it.
+  setenv("CT2_WEIGHT_CACHE_DIR", cache_dir.c_str(), 1);
+  const auto model = models::Model::load(default_model_dir(), Device::CPU, 0, ComputeType::INT8);
+  ASSERT_FALSE(std::filesystem::is_empty(cache_dir));
+  const auto cached_model = models::Model::load(default_model_dir(),
+                                                Device::CPU,
+                                                0,
+                                                ComputeType::INT8);
+  unsetenv("CT2_WEIGHT_CACHE_DIR");
+  std::filesystem::remove_all(cache_dir);
+
+  EXPECT_EQ(cached_model->effective_compute_type(), model->effective_compute_type());
+  const auto variables = model->get_variables();
+  const auto cached_variables = cached_model->get_variables();
+  ASSERT_EQ(cached_variables.size(), variables.size());
+  for (const auto& pair : variables)
+    expect_storage_eq(cached_variables.at(pair.first), pair.second);
+}
+
+TEST(ModelTest, WeightCacheVocabularyMap) {
+  const auto temp_dir = std::filesystem::temp_directory_path() / "ct2_weight_cache_vmap_test";
+  const auto model_dir = temp_dir / "model";
+  const auto cache_dir = temp_dir / "cache";
+  std::filesystem::remove_all(temp_dir);
+  std::filesystem::create_directories(cache_dir);
+  std::filesystem::copy(default_model_dir(), model_dir);
+
+  setenv("CT2_WEIGHT_CACHE_DIR", cache_dir.c_str(), 1);
+  models::Model::load(model_dir.string(), Device::CPU, 0, ComputeType::INT8);
+
+  // Adding a vocabulary map changes the packed weights, so the previous cache is not used.
+  {
+    std::ofstream vmap(model_dir / "vmap.txt");
+    vmap << "\ta t z m o n\n";
+  }
+  const auto cached_model = models::Model::load(model_dir.string(),
+                                                Device::CPU,
+                                                0,
+                                                ComputeType::INT8);
+  unsetenv("CT2_WEIGHT_CACHE_DIR");
+  const auto model = models::Model::load(model_dir.string(), Device::CPU, 0, ComputeType::INT8);
+
+  const auto num_cache_files = std::distance(std::filesystem::directory_iterator(cache_dir),
+                                             std::filesystem::directory_iterator());
+  std::filesystem::remove_all(temp_dir);
+
+  EXPECT_EQ(num_cache_files, 2);
+  const auto variables = model->get_variables();
+  const auto cached_variables = cached_model->get_variables();
+  ASSERT_EQ(cached_variables.size(), variables.size());
+  for (const auto& pair : variables)
+    EXPECT_TRUE(cached_variables.count(pair.first)) << pair.first;
+}
+
+TEST(ModelTest, WeightCacheModelSignature) {
+  const auto model_dir = std::filesystem::temp_directory_path() / "ct2_model_signature_test";
+  std::filesystem::remove_all(model_dir);
+  std::filesystem::create_directories(model_dir);
+  const auto model_path = model_dir / "model.bin";
+  {
+    std::ofstream file(model_path);
+    file << "weights";
+  }
+
+  // The model file is identified by its canonical path, size, and modification time.
+  models::ModelFileReader reader(model_dir.string());
+  models::ModelFileReader relative_reader((model_dir / ".." / model_dir.filename()).string());
+  const std::string signature = reader.get_file_signature("model.bin");
+  EXPECT_FALSE(signature.empty());
+  EXPECT_EQ(relative_reader.get_file_signature("model.bin"), signature);
+  EXPECT_TRUE(reader.get_file_signature("missing.bin").empty());
+
+  {
+    std::ofstream file(model_path, std::ios_base::app);
+    file << "updated";
+  }
+  EXPECT_NE(reader.get_file_signature("model.bin"), signature);
+
+  // Other readers are identified by the model content.
+  models::ModelMemoryReader memory_reader("model");
+  memory_reader.register_file("model.bin", "weights");
+  EXPECT_TRUE(memory_reader.get_file_signature("model.bin").empty());
+
+  std::filesystem::remove_all(model_dir);
+}
+
+TEST(ModelTest, ParseNumaCpuList) {
+  EXPECT_EQ(cpu::parse_cpu_list("0"), (std::vector<int>{0}));
+  EXPECT_EQ(cpu::parse_cpu_list("0-3,8-9"), (std::vector<int>{0, 1, 2, 3, 8, 9}));
+  EXPECT_EQ(cpu::parse_cpu_list("2,4-5"), (std::vector<int>{2, 4, 5}));
+  EXPECT_TRUE(cpu::parse_cpu_list("").empty());
+}
+
+TEST(ModelTest, LoadNumaAware) {
+  models::ModelLoader model_loader(default_model_dir());
+  model_loader.num_replicas_per_device = 3;
+  model_loader.numa_aware = true;
+  const auto replicas = model_loader.load();
+  ASSERT_EQ(replicas.size(), 3);
+
+  const size_t num_nodes = cpu::get_numa_nodes().size();
+  for (const auto& replica : replicas) {
+    if (num_nodes > 1)
+      EXPECT_GE(replica->numa_node(), 0);
+    else
+      EXPECT_EQ(replica->numa_node(), -1);
+  }
+}
+
+TEST(ModelTest, LoadForContinuousBatching) {
+  // The paging mode of the decoder is decided when the model is loaded.
+  models::ModelLoader model_loader(default_model_dir());
+  const auto model = model_loader.load()[0]->as_sequence_to_sequence();
+  auto& decoder = dynamic_cast<models::EncoderDecoderReplica&>(*model).decoder();
+  EXPECT_FALSE(decoder.support_continuous_batching());
+
+  model_loader.continuous_batching = true;
+  const auto continuous_model = model_loader.load()[0]->as_sequence_to_sequence();
+  auto& continuous_decoder = dynamic_cast<models::EncoderDecoderReplica&>(
+    *continuous_model).decoder();
+  EXPECT_TRUE(continuous_decoder.support_continuous_batching());
+}
+
+TEST(ModelTest, SpeculativeDecoding) {
+  auto model = models::Model::load(default_model_dir())->as_sequence_to_sequence();
+  auto draft_model = models::Model::load(default_model_dir())->as_sequence_to_sequence();
+  auto& encoder_decoder = dynamic_cast<models::EncoderDecoderReplica&>(*model);
+  auto& draft_encoder_decoder = dynamic_cast<models::EncoderDecoderReplica&>(*draft_model);
+  auto& decoder = encoder_decoder.decoder();
+  auto& draft_decoder = draft_encoder_decoder.decoder();
+
+  StorageView source_ids({1, 6}, std::vector<int32_t>{31, 10, 19, 13, 5, 7});
+  // The draft decoder also attends to another source so that some draft tokens are rejected.
+  StorageView draft_source_ids({1, 4}, std::vector<int32_t>{31, 10, 12, 7});
+
+  StorageView memory;
+  StorageView draft_memory;
+  encoder_decoder.encoder()(source_ids, memory);
+  draft_encoder_decoder.encoder()(draft_source_ids, draft_memory);
+
+  const std::vector<std::vector<size_t>> start_tokens = {{1}, {1, 3, 11}};
+
+  for (const auto* draft_memory_ptr : {&memory, &draft_memory}) {
+    for (const auto& tokens : start_tokens) {
+      DecodingOptions options;
+      options.return_scores = true;
+
+      layers::DecoderState state = decoder.initial_state();
+      state.emplace("memory", memory);
+      const auto expected = decode(decoder, state, {tokens}, {2}, options)[0];
+
+      layers::DecoderState speculative_state = decoder.initial_state();
+      speculative_state.emplace("memory", memory);
+      layers::DecoderState draft_state = draft_decoder.initial_state();
+      draft_state.emplace("memory", *draft_memory_ptr);
+
+      options.draft_decoder = &draft_decoder;
+      options.draft_state = &draft_state;
+      options.num_draft_tokens = 3;
+      const auto result = decode(decoder, speculative_state, {tokens}, {2}, options)[0];
+
+      EXPECT_EQ(result.hypotheses, expected.hypotheses);
+      ASSERT_EQ(result.scores.size(), 1);
+      EXPECT_NEAR(result.scores[0], expected.scores[0], 1e-4);
+    }
+  }
+}
+
+TEST(ModelTest, WhisperFeatureStream) {
+  const dim_t n_mels = 80;
+  const dim_t window_frames = 20;
+  const dim_t hop_length = 160;
+  const dim_t num_samples = 5000;
+
+  // White noise has energy in all Mel bands, so the features of the audio are not clamped.
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> distribution(-1.f, 1.f);
+  std::vector<float> audio(num_samples);
+  for (auto& value : audio)
+    value = distribution(generator);
+
+  // The full features are computed as Whisper with 1 window of silence after the audio.
+  std::vector<float> padded_audio(audio);
+  padded_audio.resize(num_samples + window_frames * hop_length, 0.f);
+  const ops::LogMelSpectrogram log_mel_spectrogram(n_mels);
+  StorageView expected;
+  log_mel_spectrogram(StorageView({1, dim_t(padded_audio.size())}, padded_audio), expected);
+
+  // The result should not depend on how the audio is split.
+  for (const size_t chunk_size : {size_t(num_samples), size_t(100), size_t(1234)}) {
+    models::WhisperFeatureStream stream(n_mels, window_frames);
+    std::vector<StorageView> windows;
+    StorageView window;
+
+    for (size_t offset = 0; offset < audio.size(); offset += chunk_size) {
+      stream.push(audio.data() + offset, std::min(chunk_size, audio.size() - offset));
+      while (stream.next(window))
+        windows.emplace_back(std::move(window));
+    }
+
+    stream.finish();
+    while (stream.next(window))
+      windows.emplace_back(std::move(window));
+
+    EXPECT_EQ(stream.num_frames(), num_samples / hop_length);
+    ASSERT_EQ(windows.size(), 2);
+
+    // The frames of silence are clamped to a different value since each window is normalized
+    // with its own maximum.
+    for (dim_t w = 0; w < 2; ++w) {
+      ASSERT_EQ(windows[w].shape(), Shape({n_mels, window_frames}));
+      for (dim_t m = 0; m < n_mels; ++m) {
+        for (dim_t t = 0; t < window_frames; ++t) {
+          const dim_t frame = w * window_frames + t;
+          if (frame >= num_samples / hop_length)
+            break;
+          EXPECT_NEAR(windows[w].at<float>({m, t}), expected.at<float>({0, m, frame}), 1e-4);
+        }
+      }
+    }
+  }
+}
+
+// Builds a Whisper model with random weights, 1 encoder layer, and 1 decoder layer.
+static std::shared_ptr<const models::Model> make_tiny_whisper_model(const dim_t n_mels,
+                                                                     const dim_t window_frames) {
+  const dim_t d_model = 16;
+  const dim_t ffn_size = 32;
+  const dim_t max_length = 32;
+  const std::vector<std::string> tokens = {
+    "a", "b", "c", "d", "e", "f",
+    "<|endoftext|>", "<|startoftranscript|>", "<|startofprev|>",
+    "<|nocaptions|>", "<|notimestamps|>",
+  };
+  const dim_t vocabulary_size = tokens.size();
+
+  std::mt19937 generator(1234);
+  std::normal_distribution<float> distribution(0.f, 1.f);
+
+  std::string model;
+  uint32_t num_variables = 0;
+  std::string variables;
+
+  const auto add_bytes = [](std::string& buffer, const auto value) {
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof (value));
+  };
+
+  const auto add_string = [&add_bytes](std::string& buffer, const std::string& str) {
+    add_bytes(buffer, uint16_t(str.size() + 1));
+    buffer.append(str.c_str(), str.size() + 1);
+  };
+
+  const auto add_variable = [&](const std::string& name,
+                                const Shape& shape,
+                                const std::optional<float> value = std::nullopt) {
+    add_string(variables, name);
+    add_bytes(variables, uint8_t(shape.size()));
+    for (const dim_t dim : shape)
+      add_bytes(variables, uint32_t(dim));
+    add_bytes(variables, uint8_t(sizeof (float)));
+    const dim_t size = compute_size(shape);
+    add_bytes(variables, uint32_t(size));
+    for (dim_t i = 0; i < size; ++i)
+      add_bytes(variables, value ? *value : distribution(generator));
+    ++num_variables;
+  };
+
+  const auto add_layer_norm = [&](const std::string& scope) {
+    add_variable(scope + "/gamma", {d_model}, 1.f);
+    add_variable(scope + "/beta", {d_model}, 0.f);
+  };
+
+  const auto add_dense = [&](const std::string& scope, const dim_t out_size, const dim_t in_size) {
+    add_variable(scope + "/weight", {out_size, in_size});
+    add_variable(scope + "/bias", {out_size});
+  };
+
+  const auto add_ffn = [&](const std::string& scope) {
+    add_layer_norm(scope + "/layer_norm");
+    add_dense(scope + "/linear_0", ffn_size, d_model);
+    add_dense(scope + "/linear_1", d_model, ffn_size);
+  };
+
+  add_variable("encoder/conv1/weight", {d_model, n_mels, 3});
+  add_variable("encoder/conv1/bias", {d_model});
+  add_variable("encoder/conv2/weight", {d_model, d_model, 3});
+  add_variable("encoder/conv2/bias", {d_model});
+  add_variable("encoder/position_encodings/encodings", {window_frames / 2, d_model});
+  add_layer_norm("encoder/layer_0/self_attention/layer_norm");
+  add_dense("encoder/layer_0/self_attention/linear_0", 3 * d_model, d_model);
+  add_dense("encoder/layer_0/self_attention/linear_1", d_model, d_model);
+  add_ffn("encoder/layer_0/ffn");
+  add_layer_norm("encoder/layer_norm");
+
+  add_variable("decoder/embeddings/weight", {vocabulary_size, d_model});
+  add_variable("decoder/position_encodings/encodings", {max_length, d_model});
+  add_layer_norm("decoder/layer_0/self_attention/layer_norm");
+  add_dense("decoder/layer_0/self_attention/linear_0", 3 * d_model, d_model);
+  add_dense("decoder/layer_0/self_attention/linear_1", d_model, d_model);
+  add_layer_norm("decoder/layer_0/attention/layer_norm");
+  add_dense("decoder/layer_0/attention/linear_0", d_model, d_model);
+  add_dense("decoder/layer_0/attention/linear_1", 2 * d_model, d_model);
+  add_dense("decoder/layer_0/attention/linear_2", d_model, d_model);
+  add_ffn("decoder/layer_0/ffn");
+  add_layer_norm("decoder/layer_norm");
+  add_dense("decoder/projection", vocabulary_size, d_model);
+
+  add_bytes(model, uint32_t(2));  // Binary version.
+  add_string(model, "WhisperSpec");
+  add_bytes(model, uint32_t(3));  // Spec revision.
+  add_bytes(model, num_variables);
+  model += variables;
+
+  std::string vocabulary;
+  for (const auto& token : tokens)
+    vocabulary += token + "\n";
+
+  models::ModelMemoryReader reader("tiny-whisper");
+  reader.register_file("model.bin", std::move(model));
+  reader.register_file("vocabulary.txt", std::move(vocabulary));
+  reader.register_file("config.json", "{\"suppress_ids\": [], \"suppress_ids_begin\": []}");
+  return models::Model::load(reader);
+}
+
+TEST(ModelTest, WhisperTranscribeBatch) {
+  const dim_t n_mels = 4;
+  const dim_t window_frames = 20;
+  const auto model = make_tiny_whisper_model(n_mels, window_frames);
+  const auto replica = models::WhisperReplica::create_from_model(*model);
+
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> distribution(-1.f, 1.f);
+  std::vector<StorageView> features;
+  for (const dim_t num_frames : {dim_t(100), dim_t(70)}) {
+    std::vector<float> values(n_mels * num_frames);
+    for (auto& value : values)
+      value = distribution(generator);
+    features.emplace_back(Shape{n_mels, num_frames}, values);
+  }
+
+  models::WhisperTranscriptionOptions options;
+  options.with_timestamps = false;
+  options.temperatures = {0};
+  options.no_speech_threshold = 1;
+  options.decoding_options.max_length = 32;
+  options.decoding_options.suppress_tokens = {7, 8, 9, 10};
+
+  // Each audio is transcribed with its own previous text, so the result should not
+  // depend on the other audios in the batch.
+  const auto results = replica->transcribe(features, options);
+  ASSERT_EQ(results.size(), features.size());
+
+  for (size_t i = 0; i < features.size(); ++i) {
+    const auto expected = replica->transcribe({features[i]}, options)[0];
+    const auto& segments = results[i].segments;
+    ASSERT_EQ(segments.size(), expected.segments.size());
+    for (size_t s = 0; s < segments.size(); ++s) {
+      EXPECT_EQ(segments[s].tokens_ids, expected.segments[s].tokens_ids);
+      EXPECT_EQ(segments[s].start, expected.segments[s].start);
+      EXPECT_EQ(segments[s].end, expected.segments[s].end);
+      EXPECT_NEAR(segments[s].avg_log_prob, expected.segments[s].avg_log_prob, 1e-4);
+    }
+  }
+}
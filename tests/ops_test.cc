@@ -118,6 +118,60 @@ TEST(OpTest, QuantizeINT16) {
   expect_storage_eq(reverse, input);
 }
 
+TEST(OpTest, NormQuantize) {
+  const dim_t batch_size = 3;
+  const dim_t depth = 45;
+
+  std::vector<float> values(batch_size * depth);
+  std::vector<float> residual_values(batch_size * depth);
+  std::vector<float> gamma_values(depth);
+  std::vector<float> beta_values(depth);
+  for (dim_t i = 0; i < batch_size * depth; ++i) {
+    values[i] = std::sin(float(i)) * 2;
+    residual_values[i] = std::cos(float(i) * 0.7f);
+  }
+  for (dim_t i = 0; i < depth; ++i) {
+    gamma_values[i] = 1 + std::sin(float(i)) * 0.1f;
+    beta_values[i] = std::cos(float(i)) * 0.1f;
+  }
+
+  const StorageView x({batch_size, depth}, values);
+  const StorageView residual({batch_size, depth}, residual_values);
+  const StorageView gamma({depth}, gamma_values);
+  const StorageView beta({depth}, beta_values);
+
+  for (const bool rms_norm : {false, true}) {
+    for (const bool shift_to_uint8 : {false, true}) {
+      // Reference: the residual addition, the normalization and the quantization are
+      // computed separately.
+      StorageView expected_sum;
+      ops::Add()(x, residual, expected_sum);
+      StorageView normalized;
+      if (rms_norm)
+        ops::RMSNorm(1e-5)(gamma, expected_sum, normalized);
+      else
+        ops::LayerNorm(-1, 1e-5)(beta, gamma, expected_sum, normalized);
+      StorageView expected(DataType::INT8);
+      StorageView expected_scale;
+      ops::Quantize(ops::Quantize::ScaleType::GLOBAL, shift_to_uint8)(normalized,
+                                                                     expected,
+                                                                     expected_scale);
+
+      StorageView y(DataType::INT8);
+      StorageView scale;
+      StorageView sum;
+      const ops::NormQuantize norm_quantize_op(1e-5, false, shift_to_uint8);
+      norm_quantize_op(rms_norm ? nullptr : &beta, gamma, x, y, scale, &residual, &sum);
+
+      expect_storage_eq(sum, expected_sum);
+      expect_storage_eq(scale, expected_scale, 1e-4);
+      ASSERT_EQ(y.shape(), expected.shape());
+      for (dim_t i = 0; i < y.size(); ++i)
+        EXPECT_NEAR(y.data<int8_t>()[i], expected.data<int8_t>()[i], 1) << "index " << i;
+    }
+  }
+}
+
 TEST(OpTest, MedianFilter) {
   StorageView x({2, 8}, std::vector<float>{
       0.2556743323802948, 0.8028775453567505, 0.3514494299888611, 0.3542254865169525,
@@ -134,6 +188,324 @@ TEST(OpTest, MedianFilter) {
   expect_storage_eq(y, expected);
 }
 
+TEST(OpTest, LogMelSpectrogram) {
+  const dim_t num_samples = 1600;
+  const float pi = std::acos(-1.f);
+
+  // The first example is silent and the second one is a 1 kHz tone.
+  std::vector<float> values(2 * num_samples, 0.f);
+  for (dim_t i = 0; i < num_samples; ++i)
+    values[num_samples + i] = std::sin(2 * pi * 1000 * i / 16000);
+  StorageView audio({2, num_samples}, values);
+
+  StorageView features;
+  ops::LogMelSpectrogram(80)(audio, features);
+  ASSERT_EQ(features.shape(), Shape({2, 80, 10}));
+
+  // log10 of the minimum energy is -10, which is rescaled to -1.5.
+  for (dim_t i = 0; i < 80 * 10; ++i)
+    EXPECT_FLOAT_EQ(features.at<float>(i), -1.5f);
+
+  // The maximum energy is in the Mel band centered around 1 kHz.
+  for (dim_t t = 1; t < 9; ++t) {
+    dim_t best_mel = 0;
+    for (dim_t m = 1; m < 80; ++m) {
+      if (features.at<float>({1, m, t}) > features.at<float>({1, best_mel, t}))
+        best_mel = m;
+    }
+    EXPECT_EQ(best_mel, 26);
+  }
+
+  // The features are clamped to 8 below the maximum value.
+  const float max_value = *std::max_element(features.data<float>() + 80 * 10,
+                                            features.data<float>() + 2 * 80 * 10);
+  const float min_value = *std::min_element(features.data<float>() + 80 * 10,
+                                            features.data<float>() + 2 * 80 * 10);
+  EXPECT_NEAR(max_value - min_value, 2.f, 1e-5);
+}
+
+TEST(OpTest, GatedActivation) {
+  const dim_t batch_size = 3;
+  const dim_t depth = 37;
+  const std::vector<ops::ActivationType> activation_types = {
+    ops::ActivationType::ReLU,
+    ops::ActivationType::Swish,
+    ops::ActivationType::GELU,
+  };
+
+  std::vector<float> values(batch_size * depth * 2);
+  for (size_t i = 0; i < values.size(); ++i)
+    values[i] = std::sin(float(i)) * 3;
+  StorageView x({batch_size, 1, depth * 2}, values);
+
+  for (const auto activation_type : activation_types) {
+    // Reference: the activation and the gate are computed separately.
+    StorageView activation_input;
+    StorageView gate;
+    ops::Split(-1)(x, activation_input, gate);
+    StorageView expected;
+    ops::get_activation_op(activation_type)(activation_input, expected);
+    ops::Mul()(expected, gate, expected);
+
+    StorageView y;
+    const ops::GatedActivation gated_activation_op(activation_type);
+    gated_activation_op(x, y);
+    EXPECT_EQ(y.shape(), Shape({batch_size, 1, depth}));
+    expect_storage_eq(y, expected, 1e-5);
+  }
+}
+
+// Reference attention for inputs with the shape [batch, time, heads, head_dim]. Each query
+// attends to the previous keys in the window, and bias has the shape [heads, num_keys].
+static StorageView reference_attention(const StorageView& queries,
+                                       const StorageView& keys,
+                                       const StorageView& values,
+                                       const dim_t num_keys,
+                                       const float scale,
+                                       const dim_t sliding_window,
+                                       const std::vector<float>* bias) {
+  const dim_t batch_size = queries.dim(0);
+  const dim_t num_queries = queries.dim(1);
+  const dim_t num_heads = queries.dim(2);
+  const dim_t depth = queries.dim(3);
+  const dim_t num_heads_kv = keys.dim(2);
+
+  StorageView output(queries.shape(), 0.f);
+  std::vector<float> scores(num_keys);
+
+  for (dim_t b = 0; b < batch_size; ++b) {
+    for (dim_t h = 0; h < num_heads; ++h) {
+      const dim_t h_kv = h / (num_heads / num_heads_kv);
+
+      for (dim_t t = 0; t < num_queries; ++t) {
+        const dim_t position = num_keys - num_queries + t;
+        const dim_t begin = sliding_window > 0 ? std::max(position - sliding_window, dim_t(0)) : 0;
+        float max_score = -std::numeric_limits<float>::infinity();
+
+        for (dim_t j = begin; j <= position; ++j) {
+          float score = 0;
+          for (dim_t d = 0; d < depth; ++d)
+            score += queries.at<float>({b, t, h, d}) * keys.at<float>({b, j, h_kv, d});
+          scores[j] = score * scale + (bias ? (*bias)[h * num_keys + j] : 0.f);
+          max_score = std::max(max_score, scores[j]);
+        }
+
+        float sum = 0;
+        for (dim_t j = begin; j <= position; ++j) {
+          scores[j] = std::exp(scores[j] - max_score);
+          sum += scores[j];
+        }
+
+        for (dim_t j = begin; j <= position; ++j) {
+          for (dim_t d = 0; d < depth; ++d)
+            output.at<float>({b, t, h, d}) += scores[j] / sum * values.at<float>({b, j, h_kv, d});
+        }
+      }
+    }
+  }
+
+  return output;
+}
+
+static StorageView random_data(const Shape& shape) {
+  std::vector<float> data(compute_size(shape));
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = std::sin(float(i) * 0.37f) + std::cos(float(i) * 0.11f);
+  return StorageView(shape, data);
+}
+
+TEST(OpTest, FlashAttentionCPU) {
+  const dim_t batch_size = 2;
+  const dim_t num_heads = 4;
+  const dim_t num_heads_kv = 2;
+  const dim_t depth = 8;
+  const dim_t prompt_length = 300;  // More than one tile of keys.
+  const float scale = 0.35;
+
+  for (const dim_t sliding_window : {dim_t(0), dim_t(50)}) {
+    for (const bool with_alibi : {false, true}) {
+      const dim_t num_keys = prompt_length + 1;
+      std::vector<float> bias_data(num_heads * num_keys);
+      for (dim_t h = 0; h < num_heads; ++h) {
+        for (dim_t j = 0; j < num_keys; ++j)
+          bias_data[h * num_keys + j] = -0.01f * (h + 1) * (num_keys - 1 - j);
+      }
+      const StorageView alibi({1, num_heads, 1, num_keys}, bias_data);
+
+      const StorageView queries = random_data({batch_size, prompt_length + 1, num_heads, depth});
+      const StorageView keys = random_data({batch_size, prompt_length + 1, num_heads_kv, depth});
+      StorageView values = random_data({batch_size, prompt_length + 1, num_heads_kv, depth});
+      ops::Mul()(values, StorageView(0.5f), values);
+
+      // Forward the prompt, then one step with the keys and values written in the cache.
+      StorageView prompt_queries;
+      StorageView prompt_keys;
+      StorageView prompt_values;
+      StorageView step_queries;
+      StorageView step_keys;
+      StorageView step_values;
+      const ops::Split split_op(1, {prompt_length, 1});
+      split_op(queries, prompt_queries, step_queries);
+      split_op(keys, prompt_keys, step_keys);
+      split_op(values, prompt_values, step_values);
+
+      const ops::FlashAttention attention_op(scale, sliding_window);
+
+      std::vector<float> prompt_bias;
+      for (dim_t h = 0; h < num_heads; ++h)
+        prompt_bias.insert(prompt_bias.end(),
+                           bias_data.begin() + h * num_keys,
+                           bias_data.begin() + h * num_keys + prompt_length);
+      StorageView prompt_alibi;
+      ops::Slide(3, 0, prompt_length)(alibi, prompt_alibi);
+
+      // The cache has free space after the prompt.
+      const StorageView cache_padding = random_data({batch_size, 4, num_heads_kv, depth});
+      StorageView cached_keys;
+      StorageView cached_values;
+      ops::Concat(1)({&prompt_keys, &cache_padding}, cached_keys);
+      ops::Concat(1)({&prompt_values, &cache_padding}, cached_values);
+
+      StorageView output;
+      attention_op(prompt_queries, prompt_keys, prompt_values, output,
+                   nullptr, nullptr, nullptr, true, nullptr, nullptr, false,
+                   with_alibi ? &prompt_alibi : nullptr, 0);
+      expect_storage_eq(output,
+                        reference_attention(prompt_queries, prompt_keys, prompt_values,
+                                            prompt_length, scale, sliding_window,
+                                            with_alibi ? &prompt_bias : nullptr),
+                        1e-4);
+
+      attention_op(step_queries, step_keys, step_values, output,
+                   &cached_keys, &cached_values, nullptr, true, nullptr, nullptr, false,
+                   with_alibi ? &alibi : nullptr, prompt_length);
+      expect_storage_eq(output,
+                        reference_attention(step_queries, keys, values,
+                                            num_keys, scale, sliding_window,
+                                            with_alibi ? &bias_data : nullptr),
+                        1e-4);
+    }
+  }
+}
+
+TEST(OpTest, GemmInt4) {
+  const dim_t n = 40;
+  const dim_t k = 128;
+  const dim_t group_size = 64;
+  const dim_t num_groups = k / group_size;
+
+  std::vector<int8_t> packed(n * k / 2);
+  std::vector<float> scales(n * num_groups);
+  std::vector<float> zeros(n * num_groups);
+  std::vector<float> weight(n * k);
+
+  for (dim_t j = 0; j < n; ++j) {
+    for (dim_t g = 0; g < num_groups; ++g) {
+      scales[j * num_groups + g] = 0.01f * (1 + (j + g) % 7);
+      zeros[j * num_groups + g] = (j * 3 + g) % 16;
+    }
+
+    for (dim_t i = 0; i < k; ++i) {
+      const uint8_t q = (j * 7 + i * 5) % 16;
+      const dim_t block = i / 32;
+      const dim_t position = i % 32;
+      auto& byte = reinterpret_cast<uint8_t&>(packed[j * k / 2 + block * 16 + position % 16]);
+      byte |= position < 16 ? q : q << 4;
+
+      const dim_t g = i / group_size;
+      weight[j * k + i] = (q - zeros[j * num_groups + g]) * scales[j * num_groups + g];
+    }
+  }
+
+  const StorageView b({n, k / 2}, packed);
+  const StorageView scale({n, num_groups}, scales);
+  const StorageView zero({n, num_groups}, zeros);
+  const StorageView dense_weight({n, k}, weight);
+  const StorageView bias = random_data({n});
+  const auto activation = ops::ActivationType::ReLU;
+
+  // The small inputs use the int4 kernel and the larger inputs dequantize the weights.
+  for (const dim_t m : {dim_t(1), dim_t(5), dim_t(20)}) {
+    const StorageView a = random_data({m, k});
+
+    StorageView expected;
+    ops::Gemm(1, 0, false, true, false, false, &activation)(a, dense_weight, expected,
+                                                            nullptr, &bias);
+
+    const ops::GemmInt4 gemm_op(&activation);
+    StorageView c;
+    gemm_op(a, b, scale, zero, c, &bias);
+    expect_storage_eq(c, expected, 1e-4);
+  }
+}
+
+TEST(OpTest, IndexedGemm) {
+  const dim_t rows = 50;
+  const dim_t k = 37;
+  const StorageView index({6}, std::vector<int32_t>{4, 0, 49, 17, 4, 23});
+  const dim_t n = index.size();
+
+  const StorageView weight = random_data({rows, k});
+  const StorageView bias = random_data({n});
+  const auto activation = ops::ActivationType::GELU;
+
+  std::vector<int8_t> int8_weight_data(rows * k);
+  for (dim_t i = 0; i < rows * k; ++i)
+    int8_weight_data[i] = (i * 37) % 255 - 127;
+  const StorageView int8_weight({rows, k}, int8_weight_data);
+
+  StorageView int8_selected_weight(DataType::INT8);
+  ops::Gather()(int8_weight, index, int8_selected_weight);
+  StorageView compensation({n}, DataType::INT32);
+  for (dim_t j = 0; j < n; ++j) {
+    int32_t sum = 0;
+    for (dim_t i = 0; i < k; ++i)
+      sum += int8_selected_weight.at<int8_t>({j, i});
+    compensation.at<int32_t>(j) = -128 * sum;
+  }
+
+  // The small inputs use the indexed kernel and the larger inputs copy blocks of rows.
+  for (const dim_t m : {dim_t(1), dim_t(5), dim_t(20)}) {
+    {
+      const StorageView a = random_data({m, k});
+
+      StorageView selected_weight;
+      ops::Gather()(weight, index, selected_weight);
+      StorageView expected;
+      ops::Gemm(1, 0, false, true, false, false, &activation)(a, selected_weight, expected,
+                                                              nullptr, &bias);
+
+      const ops::IndexedGemm gemm_op(&activation);
+      StorageView c;
+      gemm_op(a, weight, index, c, nullptr, &bias);
+      expect_storage_eq(c, expected, 1e-4);
+    }
+
+    {
+      std::vector<int8_t> a_data(m * k);
+      std::vector<int8_t> shifted_a_data(m * k);
+      for (dim_t i = 0; i < m * k; ++i) {
+        a_data[i] = (i * 13) % 255 - 127;
+        reinterpret_cast<uint8_t&>(shifted_a_data[i]) = a_data[i] + 128;
+      }
+      const StorageView a({m, k}, a_data);
+      const StorageView shifted_a({m, k}, shifted_a_data);
+
+      StorageView expected(DataType::INT32);
+      ops::Gemm(1, 0, false, true)(a, int8_selected_weight, expected);
+
+      const ops::IndexedGemm gemm_op;
+      StorageView c(DataType::INT32);
+      gemm_op(a, int8_weight, index, c);
+      expect_storage_eq(c, expected);
+
+      StorageView shifted_c(DataType::INT32);
+      gemm_op(shifted_a, int8_weight, index, shifted_c, &compensation);
+      expect_storage_eq(shifted_c, expected);
+    }
+  }
+}
+
 class OpDeviceTest : public ::testing::TestWithParam<Device> {
 };
 
@@ -1,6 +1,16 @@
+#include <mutex>
+#include <set>
+
 #include "test_utils.h"
 #include "ctranslate2/primitives.h"
 #include "dispatch.h"
+#include "cpu/parallel.h"
+#include "cpu/task_scheduler.h"
+#ifdef CT2_WITH_BUILTIN_GEMM
+#  include "cpu/backend.h"
+#  include "cpu/builtin_gemm.h"
+#  include "cpu/cpu_info.h"
+#endif
 
 class PrimitiveTest : public ::testing::TestWithParam<Device> {
 };
@@ -51,6 +61,195 @@ TEST_P(PrimitiveTest, PenalizePreviousTokens) {
   expect_storage_eq(scores, expected);
 }
 
+template <typename Function>
+static void scheduler_parallel_for(cpu::TaskScheduler& scheduler,
+                                   dim_t begin,
+                                   dim_t end,
+                                   dim_t max_threads,
+                                   const Function& f) {
+  scheduler.parallel_for(begin, end, max_threads,
+                         [](const void* context, dim_t chunk_begin, dim_t chunk_end) {
+                           (*static_cast<const Function*>(context))(chunk_begin, chunk_end);
+                         },
+                         &f);
+}
+
+TEST(TaskSchedulerTest, UnevenLoop) {
+  cpu::TaskScheduler scheduler(3);
+  const dim_t size = 1000;
+  std::vector<std::atomic<int>> visits(size);
+
+  for (int repeat = 0; repeat < 10; ++repeat) {
+    scheduler_parallel_for(scheduler, 0, size, 4, [&](dim_t begin, dim_t end) {
+      for (dim_t i = begin; i < end; ++i) {
+        if (i % 100 == 0)
+          std::this_thread::sleep_for(std::chrono::microseconds(100));
+        visits[i]++;
+      }
+    });
+  }
+
+  for (dim_t i = 0; i < size; ++i)
+    EXPECT_EQ(visits[i], 10);
+}
+
+TEST(TaskSchedulerTest, NestedLoops) {
+  cpu::TaskScheduler scheduler(3);
+  const dim_t outer_size = 8;
+  const dim_t inner_size = 500;
+  std::vector<std::atomic<int>> visits(outer_size * inner_size);
+
+  scheduler_parallel_for(scheduler, 0, outer_size, 4, [&](dim_t begin, dim_t end) {
+    for (dim_t i = begin; i < end; ++i) {
+      scheduler_parallel_for(scheduler, 0, inner_size, 4, [&](dim_t inner_begin,
+                                                              dim_t inner_end) {
+        for (dim_t j = inner_begin; j < inner_end; ++j)
+          visits[i * inner_size + j]++;
+      });
+    }
+  });
+
+  for (const auto& count : visits)
+    EXPECT_EQ(count, 1);
+}
+
+TEST(TaskSchedulerTest, Exception) {
+  cpu::TaskScheduler scheduler(2);
+  std::atomic<dim_t> num_visits(0);
+
+  EXPECT_THROW(scheduler_parallel_for(scheduler, 0, 100, 3, [&](dim_t begin, dim_t end) {
+    num_visits += end - begin;
+    if (begin <= 50 && 50 < end)
+      throw std::runtime_error("error");
+  }), std::runtime_error);
+
+  // The other chunks are still executed.
+  EXPECT_EQ(num_visits, 100);
+}
+
+TEST(TaskSchedulerTest, NestedParallelFor) {
+  // cpu::parallel_for runs in the task scheduler in all builds, so the inner loops are
+  // also parallelized.
+  const size_t num_threads = cpu::get_num_threads();
+  cpu::set_num_threads(4);
+
+  const dim_t outer_size = 4;
+  const dim_t inner_size = 16;
+  std::vector<std::atomic<int>> visits(outer_size * inner_size);
+  std::mutex mutex;
+  std::set<std::thread::id> thread_ids;
+
+  cpu::parallel_for(0, outer_size, 1, [&](dim_t begin, dim_t end) {
+    for (dim_t i = begin; i < end; ++i) {
+      cpu::parallel_for(0, inner_size, 1, [&](dim_t inner_begin, dim_t inner_end) {
+        for (dim_t j = inner_begin; j < inner_end; ++j) {
+          std::this_thread::sleep_for(std::chrono::microseconds(200));
+          visits[i * inner_size + j]++;
+        }
+        const std::lock_guard<std::mutex> lock(mutex);
+        thread_ids.emplace(std::this_thread::get_id());
+      });
+    }
+  });
+
+  cpu::set_num_threads(num_threads);
+
+  for (const auto& count : visits)
+    EXPECT_EQ(count, 1);
+  if (cpu::get_task_scheduler().num_workers() > 0)
+    EXPECT_GT(thread_ids.size(), 1);
+}
+
+#ifdef CT2_WITH_BUILTIN_GEMM
+class BuiltinGemmTest : public ::testing::TestWithParam<bool> {
+protected:
+  void SetUp() override {
+    if (!cpu::mayiuse_builtin_gemm())
+      GTEST_SKIP() << "The CPU does not support AVX512-VNNI";
+    if (GetParam() && !cpu::mayiuse_amx())
+      GTEST_SKIP() << "The CPU does not support AMX";
+  }
+};
+
+TEST_P(BuiltinGemmTest, U8S8S32) {
+  const bool use_amx = GetParam();
+
+  for (const dim_t m : {1, 5, 35}) {
+    const dim_t n = 50;
+    const dim_t k = 130;
+
+    std::vector<uint8_t> a(m * k);
+    std::vector<int8_t> b(n * k);  // Transposed.
+    std::vector<int32_t> compensation(n);
+    for (size_t i = 0; i < a.size(); ++i)
+      a[i] = (i * 37) % 256;
+    for (size_t i = 0; i < b.size(); ++i)
+      b[i] = int8_t((i * 13) % 255 - 127);
+    for (dim_t j = 0; j < n; ++j)
+      compensation[j] = j - 25;
+
+    std::vector<int8_t> packed_b(cpu::builtin_gemm_s8_pack_b_size(k, n));
+    cpu::builtin_gemm_s8_pack_b(b.data(), /*transpose_b=*/true, k, n, packed_b.data());
+
+    std::vector<int32_t> c(m * n, 3);
+    cpu::builtin_gemm_u8s8s32(use_amx, m, n, k,
+                              1, a.data(), k,
+                              packed_b.data(),
+                              1, c.data(), n,
+                              compensation.data());
+
+    for (dim_t i = 0; i < m; ++i) {
+      for (dim_t j = 0; j < n; ++j) {
+        int32_t expected = 3 + compensation[j];
+        for (dim_t l = 0; l < k; ++l)
+          expected += int32_t(a[i * k + l]) * int32_t(b[j * k + l]);
+        ASSERT_EQ(c[i * n + j], expected) << "m=" << m << ", i=" << i << ", j=" << j;
+      }
+    }
+  }
+}
+
+TEST_P(BuiltinGemmTest, BF16) {
+  if (!cpu::cpu_supports_avx512_bf16())
+    GTEST_SKIP() << "The CPU does not support AVX512-BF16";
+
+  const bool use_amx = GetParam();
+
+  for (const dim_t m : {2, 40}) {
+    const dim_t n = 20;
+    const dim_t k = 75;
+
+    // Values exactly representable in bfloat16.
+    std::vector<float> a(m * k);
+    std::vector<float> b(k * n);
+    for (size_t i = 0; i < a.size(); ++i)
+      a[i] = float(int(i % 17) - 8) / 8;
+    for (size_t i = 0; i < b.size(); ++i)
+      b[i] = float(int(i % 11) - 5) / 4;
+
+    std::vector<uint16_t> packed_b(cpu::builtin_gemm_bf16_pack_b_size(k, n) / sizeof (uint16_t));
+    cpu::builtin_gemm_bf16_pack_b(b.data(), /*transpose_b=*/false, k, n, 2, packed_b.data());
+
+    std::vector<float> c(m * n, 1);
+    cpu::builtin_gemm_bf16(use_amx, m, n, k, a.data(), k, packed_b.data(), 1, c.data(), n);
+
+    for (dim_t i = 0; i < m; ++i) {
+      for (dim_t j = 0; j < n; ++j) {
+        float expected = 1;
+        for (dim_t l = 0; l < k; ++l)
+          expected += 2 * a[i * k + l] * b[l * n + j];
+        ASSERT_NEAR(c[i * n + j], expected, 1e-4) << "m=" << m << ", i=" << i << ", j=" << j;
+      }
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(CPU, BuiltinGemmTest, ::testing::Values(false, true),
+                         [](const ::testing::TestParamInfo<bool>& info) {
+                           return info.param ? "AMX" : "AVX512";
+                         });
+#endif
+
 INSTANTIATE_TEST_SUITE_P(CPU, PrimitiveTest, ::testing::Values(Device::CPU));
 #ifdef CT2_WITH_CUDA
 INSTANTIATE_TEST_SUITE_P(CUDA, PrimitiveTest, ::testing::Values(Device::CUDA));
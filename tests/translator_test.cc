@@ -1,10 +1,16 @@
 #include <ctranslate2/buffered_translation_wrapper.h>
 #include <ctranslate2/translator.h>
 #include <ctranslate2/decoding.h>
+#include <ctranslate2/profiler.h>
 
 #include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
 #include <unordered_set>
 
+#include <nlohmann/json.hpp>
+
 #include "test_utils.h"
 
 static std::string
@@ -925,6 +931,451 @@ TEST(TranslatorTest, BeamSizeLargerThanVocabSize) {
   EXPECT_EQ(result.num_hypotheses(), options.num_hypotheses);
 }
 
+TEST(TranslatorTest, ContinuousBatching) {
+  ReplicaPoolConfig config;
+  config.continuous_batch_size = 2;
+  Translator continuous_translator(default_model_dir(),
+                                   Device::CPU,
+                                   ComputeType::DEFAULT,
+                                   /*device_indices=*/{0},
+                                   /*tensor_parallel=*/false,
+                                   config);
+  Translator translator = default_translator();
+
+  TranslationOptions options;
+  options.beam_size = 1;
+  options.return_scores = true;
+  const std::vector<std::vector<std::string>> inputs = {
+    {"آ", "ت", "ز", "م", "و", "ن"},
+    {"آ", "ز", "ا"},
+    {},
+    {"آ", "ت", "ز", "م", "و", "ن"},
+    {"آ", "ز", "ا"}};
+  const std::vector<std::vector<std::string>> prefixes = {{}, {}, {}, {"a", "t", "s"}, {}};
+
+  const auto expected = translator.translate_batch(inputs, prefixes, options);
+
+  std::vector<size_t> callback_batch_ids;
+  std::mutex callback_mutex;
+  options.callback = [&](GenerationStepResult step_result) {
+    const std::lock_guard<std::mutex> lock(callback_mutex);
+    callback_batch_ids.emplace_back(step_result.batch_id);
+    return false;
+  };
+
+  // The requests are decoded in a batch of 2 sequences which is refilled at each step.
+  auto futures = continuous_translator.translate_batch_async(inputs, prefixes, options);
+  ASSERT_EQ(futures.size(), expected.size());
+
+  for (size_t i = 0; i < futures.size(); ++i) {
+    const auto result = futures[i].get();
+    EXPECT_EQ(result.output(), expected[i].output());
+    EXPECT_NEAR(result.score(), expected[i].score(), 1e-4) << i;
+  }
+
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    if (i == 2)
+      continue;
+    EXPECT_NE(std::find(callback_batch_ids.begin(), callback_batch_ids.end(), i),
+              callback_batch_ids.end());
+  }
+}
+
+TEST(TranslatorTest, FlashAttentionCPU) {
+  models::ModelLoader model_loader(default_model_dir());
+  model_loader.use_flash_attention = true;
+  Translator flash_translator(model_loader);
+  Translator translator = default_translator();
+
+  TranslationOptions options;
+  options.return_scores = true;
+  const std::vector<std::vector<std::string>> inputs = {
+    {"آ", "ت", "ز", "م", "و", "ن"},
+    {"آ", "ز", "ا"}};
+
+  const auto expected = translator.translate_batch(inputs, options);
+  const auto results = flash_translator.translate_batch(inputs, options);
+  ASSERT_EQ(results.size(), expected.size());
+
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].output(), expected[i].output());
+    EXPECT_NEAR(results[i].score(), expected[i].score(), 1e-4);
+  }
+}
+
+TEST(TranslatorTest, KVCacheInt8) {
+  // The variable is read when the decoder is created.
+  setenv("CT2_KV_CACHE_INT8", "1", 1);
+  Translator int8_cache_translator = default_translator();
+  unsetenv("CT2_KV_CACHE_INT8");
+  Translator translator = default_translator();
+
+  TranslationOptions options;
+  options.return_scores = true;
+  const std::vector<std::vector<std::string>> inputs = {
+    {"آ", "ت", "ز", "م", "و", "ن"},
+    {"آ", "ز", "ا"}};
+
+  const auto expected = translator.translate_batch(inputs, options);
+  const auto results = int8_cache_translator.translate_batch(inputs, options);
+  ASSERT_EQ(results.size(), expected.size());
+
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].output(), expected[i].output());
+    EXPECT_NEAR(results[i].score(), expected[i].score(), 1e-2);
+  }
+}
+
+static std::string read_file(const std::string& path) {
+  std::ifstream file(path, std::ios_base::binary);
+  std::ostringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+TEST(TranslatorTest, VocabularyMapInt8) {
+  if (!mayiuse_int8(Device::CPU))
+    GTEST_SKIP() << "The CPU does not support int8";
+
+  // The vocabulary map is loaded before the weights are packed, so the output projection
+  // stays unpacked and its rows can be selected.
+  const std::string model_dir = default_model_dir();
+  models::ModelMemoryReader reader("aren-transliteration");
+  for (const char* filename : {"model.bin", "source_vocabulary.txt", "target_vocabulary.txt"})
+    reader.register_file(filename, read_file(model_dir + "/" + filename));
+  reader.register_file("vmap.txt", "\ta t z m o n\n");
+
+  Translator translator(models::Model::load(reader, Device::CPU, 0, ComputeType::INT8));
+
+  TranslationOptions options;
+  options.use_vmap = true;
+  const auto result = translator.translate_batch({{"آ", "ت", "ز", "م", "و", "ن"}}, options)[0];
+  EXPECT_EQ(result.output(), (std::vector<std::string>{"a", "t", "z", "m", "o", "n"}));
+}
+
+TEST(TranslatorTest, VocabularyMapInt8Scores) {
+  if (!mayiuse_int8(Device::CPU))
+    GTEST_SKIP() << "The CPU does not support int8";
+
+  // When the map selects all target tokens, the logits computed from the selected rows of
+  // the int8 projection match the logits of the full projection.
+  const std::string model_dir = default_model_dir();
+  const std::string target_vocabulary = read_file(model_dir + "/target_vocabulary.txt");
+  std::string candidates = target_vocabulary;
+  std::replace(candidates.begin(), candidates.end(), '\n', ' ');
+
+  models::ModelMemoryReader reader("aren-transliteration");
+  reader.register_file("model.bin", read_file(model_dir + "/model.bin"));
+  reader.register_file("source_vocabulary.txt",
+                       read_file(model_dir + "/source_vocabulary.txt"));
+  reader.register_file("target_vocabulary.txt", target_vocabulary);
+  reader.register_file("vmap.txt", "\t" + candidates + "\n");
+
+  Translator vmap_translator(models::Model::load(reader, Device::CPU, 0, ComputeType::INT8));
+  Translator translator(models::Model::load(model_dir, Device::CPU, 0, ComputeType::INT8));
+
+  TranslationOptions options;
+  options.return_scores = true;
+  const std::vector<std::vector<std::string>> inputs = {
+    {"آ", "ت", "ز", "م", "و", "ن"},
+    {"آ", "ز", "ا"}};
+
+  const auto expected = translator.translate_batch(inputs, options);
+  options.use_vmap = true;
+  const auto results = vmap_translator.translate_batch(inputs, options);
+  ASSERT_EQ(results.size(), expected.size());
+
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].output(), expected[i].output());
+    EXPECT_NEAR(results[i].score(), expected[i].score(), 1e-4);
+  }
+}
+
+TEST(TranslatorTest, Tracing) {
+  Translator translator = default_translator();
+  start_tracing();
+  translator.translate_batch({{"آ", "ت", "ز", "م", "و", "ن"}});
+  stop_tracing();
+
+  std::ostringstream trace;
+  dump_trace(trace);
+  const auto events = nlohmann::json::parse(trace.str())["traceEvents"];
+
+  size_t num_decoder_events = 0;
+  for (const auto& event : events) {
+    if (event["ph"] != "X" || event["name"] != "TransformerDecoder")
+      continue;
+    EXPECT_EQ(event["args"]["replica"], 0);
+    EXPECT_TRUE(event["args"].contains("batch"));
+    EXPECT_EQ(event["args"]["step"], num_decoder_events);
+    ++num_decoder_events;
+  }
+  EXPECT_GT(num_decoder_events, 0);
+
+  // Events are no longer recorded when tracing is stopped.
+  translator.translate_batch({{"آ", "ز", "ا"}});
+  std::ostringstream new_trace;
+  dump_trace(new_trace);
+  const auto new_events = nlohmann::json::parse(new_trace.str())["traceEvents"];
+  size_t num_new_decoder_events = 0;
+  for (const auto& event : new_events) {
+    if (event["name"] == "TransformerDecoder")
+      ++num_new_decoder_events;
+  }
+  EXPECT_EQ(num_new_decoder_events, num_decoder_events);
+}
+
+TEST(TranslatorTest, TracingThreadExit) {
+  start_tracing();
+  std::thread thread([] {
+    { PROFILE("exited_thread_scope"); }
+    PROFILE("stopped_scope");
+    stop_tracing();
+  });
+  thread.join();
+
+  std::ostringstream trace;
+  dump_trace(trace);
+  const auto events = nlohmann::json::parse(trace.str())["traceEvents"];
+
+  // The events of a thread are still dumped after it exits, and the scopes closed after
+  // the tracing was stopped are not recorded.
+  size_t num_exited_thread_events = 0;
+  for (const auto& event : events) {
+    EXPECT_NE(event["name"], "stopped_scope");
+    if (event["name"] == "exited_thread_scope")
+      ++num_exited_thread_events;
+  }
+  EXPECT_EQ(num_exited_thread_events, 1);
+}
+
+TEST(TranslatorTest, CancelRequest) {
+  Translator translator = default_translator();
+  const std::vector<std::vector<std::string>> inputs = {{"آ", "ت", "ز", "م", "و", "ن"}};
+
+  TranslationOptions options;
+  options.beam_size = 1;
+  const auto token = std::make_shared<CancellationToken>();
+  options.scheduling.cancellation_token = token;
+
+  // The decoding is stopped before the step following the cancellation.
+  size_t num_steps = 0;
+  options.callback = [&](GenerationStepResult) {
+    ++num_steps;
+    token->cancel();
+    return false;
+  };
+
+  EXPECT_THROW(translator.translate_batch(inputs, options), RequestCancelled);
+  EXPECT_EQ(num_steps, 1);
+
+  // Requests are not started after their deadline.
+  options.callback = nullptr;
+  options.scheduling.cancellation_token = nullptr;
+  options.scheduling.deadline = SchedulingOptions::Clock::now();
+  EXPECT_THROW(translator.translate_batch(inputs, options), RequestCancelled);
+
+  ReplicaPoolConfig config;
+  config.continuous_batch_size = 2;
+  Translator continuous_translator(default_model_dir(),
+                                   Device::CPU,
+                                   ComputeType::DEFAULT,
+                                   /*device_indices=*/{0},
+                                   /*tensor_parallel=*/false,
+                                   config);
+  auto futures = continuous_translator.translate_batch_async(inputs, options);
+  EXPECT_THROW(futures[0].get(), RequestCancelled);
+}
+
+TEST(TranslatorTest, GenerateTokens) {
+  Translator translator = default_translator();
+  const std::vector<std::vector<std::string>> inputs = {
+    {"آ", "ت", "ز", "م", "و", "ن"},
+    {"آ", "ز", "ا"},
+    {"آ", "ت", "ز", "م", "و", "ن", "آ", "ز", "ا"}};
+
+  for (const size_t beam_size : {1, 4}) {
+    TranslationOptions options;
+    options.beam_size = beam_size;
+    const auto expected = translator.translate_batch(inputs, options);
+
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      auto stream = translator.generate_tokens(inputs[i], {}, options);
+
+      std::vector<std::string> tokens;
+      GenerationStepResult step_result;
+      while (stream->next(step_result)) {
+        if (step_result.token != "</s>")
+          tokens.emplace_back(step_result.token);
+      }
+
+      EXPECT_TRUE(stream->finished());
+      EXPECT_EQ(tokens, expected[i].output()) << "beam_size=" << beam_size << ", example " << i;
+    }
+  }
+}
+
+TEST(TranslatorTest, GenerateTokensCancel) {
+  Translator translator = default_translator();
+  const std::vector<std::string> input = {"آ", "ت", "ز", "م", "و", "ن"};
+
+  // The decoding stops when the consumer closes the stream.
+  auto stream = translator.generate_tokens(input);
+  stream->close();
+  GenerationStepResult step_result;
+  size_t num_tokens = 0;
+  while (stream->next(step_result))
+    ++num_tokens;
+  EXPECT_LE(num_tokens, 1);
+
+  // The decoding does not wait for a consumer that does not read the stream: it stops when
+  // the queue is full and the replica can run the next requests.
+  TranslationOptions overflow_options;
+  overflow_options.beam_size = 1;
+  std::atomic<size_t> num_steps(0);
+  overflow_options.callback = [&num_steps](GenerationStepResult) {
+    ++num_steps;
+    return false;
+  };
+  stream = translator.generate_tokens(input, {}, overflow_options, /*stream_capacity=*/1);
+  EXPECT_EQ(translator.translate_batch({input})[0].output(),
+            (std::vector<std::string>{"a", "t", "z", "m", "o", "n"}));
+  ASSERT_TRUE(stream->next(step_result));
+  EXPECT_EQ(step_result.token, "a");
+  EXPECT_THROW(stream->next(step_result), GenerationStreamOverflow);
+  EXPECT_EQ(num_steps.load(), 2);
+
+  // The stream returns the error of requests that are not started.
+  TranslationOptions options;
+  options.scheduling.deadline = SchedulingOptions::Clock::now();
+  stream = translator.generate_tokens(input, {}, options);
+  EXPECT_THROW(stream->next(step_result), RequestCancelled);
+}
+
+TEST(TranslatorTest, GenerationStreamOverflow) {
+  GenerationStream stream(2);
+  GenerationStepResult step_result;
+
+  for (size_t step = 0; step < 2; ++step) {
+    step_result.step = step;
+    EXPECT_FALSE(stream.push(step_result));
+  }
+
+  // The producer does not wait when the queue is full: the result is dropped and the
+  // decoding should stop.
+  step_result.step = 2;
+  EXPECT_TRUE(stream.push(step_result));
+  EXPECT_TRUE(stream.push(step_result));
+  stream.finish();
+
+  for (size_t step = 0; step < 2; ++step) {
+    ASSERT_TRUE(stream.next(step_result));
+    EXPECT_EQ(step_result.step, step);
+  }
+  EXPECT_THROW(stream.next(step_result), GenerationStreamOverflow);
+}
+
+TEST(TranslatorTest, SchedulingOrder) {
+  Translator translator = default_translator();
+
+  // Block the replica until all jobs are queued.
+  std::promise<void> started;
+  std::promise<void> unblock;
+  auto unblocked = unblock.get_future().share();
+  auto first = translator.post<int>([&started, unblocked](models::SequenceToSequenceReplica&) {
+    started.set_value();
+    unblocked.wait();
+    return 0;
+  });
+  started.get_future().wait();
+
+  std::vector<int> order;
+  std::mutex order_mutex;
+  const auto post = [&](int id, const SchedulingOptions& scheduling) {
+    return translator.post<int>([&order, &order_mutex, id](models::SequenceToSequenceReplica&) {
+      const std::lock_guard<std::mutex> lock(order_mutex);
+      order.emplace_back(id);
+      return id;
+    }, scheduling);
+  };
+
+  const auto now = SchedulingOptions::Clock::now();
+  SchedulingOptions low;
+  low.priority = Priority::Low;
+  SchedulingOptions late;
+  late.deadline = now + std::chrono::hours(2);
+  SchedulingOptions early;
+  early.deadline = now + std::chrono::hours(1);
+  SchedulingOptions high;
+  high.priority = Priority::High;
+
+  std::vector<std::future<int>> futures;
+  futures.emplace_back(post(1, low));
+  futures.emplace_back(post(2, late));
+  futures.emplace_back(post(3, early));
+  futures.emplace_back(post(4, high));
+
+  unblock.set_value();
+  first.get();
+  for (auto& future : futures)
+    future.get();
+
+  EXPECT_EQ(order, (std::vector<int>{4, 3, 2, 1}));
+}
+
+TEST(TranslatorTest, ContinuousBatchingSchedulingOrder) {
+  ReplicaPoolConfig config;
+  config.continuous_batch_size = 2;
+  Translator translator(default_model_dir(),
+                        Device::CPU,
+                        ComputeType::DEFAULT,
+                        /*device_indices=*/{0},
+                        /*tensor_parallel=*/false,
+                        config);
+
+  // Block the replica until all jobs are queued.
+  std::promise<void> started;
+  std::promise<void> unblock;
+  auto unblocked = unblock.get_future().share();
+  auto first = translator.post<int>([&started, unblocked](models::SequenceToSequenceReplica&) {
+    started.set_value();
+    unblocked.wait();
+    return 0;
+  });
+  started.get_future().wait();
+
+  std::vector<int> order;
+  std::mutex order_mutex;
+  const auto record = [&order, &order_mutex](int id) {
+    const std::lock_guard<std::mutex> lock(order_mutex);
+    if (std::find(order.begin(), order.end(), id) == order.end())
+      order.emplace_back(id);
+  };
+
+  auto normal = translator.post<int>([&record](models::SequenceToSequenceReplica&) {
+    record(1);
+    return 1;
+  });
+
+  // The decoding loop is queued with the priority of its requests.
+  TranslationOptions options;
+  options.beam_size = 1;
+  options.scheduling.priority = Priority::High;
+  options.callback = [&record](GenerationStepResult) {
+    record(2);
+    return false;
+  };
+  auto futures = translator.translate_batch_async({{"آ", "ز", "ا"}}, options);
+
+  unblock.set_value();
+  first.get();
+  normal.get();
+  for (auto& future : futures)
+    future.get();
+
+  EXPECT_EQ(order, (std::vector<int>{2, 1}));
+}
+
 TEST(BufferedTranslationWrapperTest, Basic) {
   BufferedTranslationWrapper wrapper(std::make_shared<Translator>(default_model_dir()),
                                      /*max_batch_size=*/32,